@@ -0,0 +1,153 @@
+#ifndef ACK_BATCH_H
+
+#define ACK_BATCH_H
+
+#include "global.h"
+#include "packet.h"
+#include "stats.h"
+#include "histogram.h"
+#include "logger.h"
+
+/** See tx.h, which needs the sizes below */
+struct tx_stage;
+
+/** Size of an (N)ACK on the wire, also the GSO segment size */
+#define ACK_FRAME_SIZE 11
+
+/** Maximum number of (N)ACKs in a batch (UDP_MAX_SEGMENTS of older kernels) */
+#define ACK_BATCH_MAX 64
+
+/**
+ * ## Use
+ *
+ * The (N)ACKs a handler has to send, batched per destination.
+ *
+ * The frames are stored back to back (every `ACK_FRAME_SIZE`
+ * bytes) so that a batch is sent with a single `sendmsg` using
+ * UDP GSO (UDP_SEGMENT = 11): the kernel walks the stack once
+ * for the whole batch and cuts it into 11 bytes datagrams at the
+ * very end, instead of once per datagram with `sendmmsg`.
+ *
+ * A batch only ever holds frames for one destination: reserving a
+ * frame for another one, or for a full batch, sends the batch
+ * first. The handler also sends it once its stream is empty, so
+ * the (N)ACKs of several requests of the same client queued one
+ * after the other leave in a single send.
+ *
+ * If the kernel or the NIC refuses GSO, the batch is sent with
+ * `sendmmsg` and GSO isn't tried again.
+ *
+ * With a TX stage (-T), a full batch is handed over to the stage
+ * instead of being sent: the handler doesn't do any syscall and
+ * its rx_to_ack latency stops at the handover.
+ */
+typedef struct ack_batch {
+    /** Socket to send on */
+    int sockfd;
+
+    /** Use UDP_SEGMENT? */
+    bool gso;
+
+    /** Destination of the frames (a copy: the client may be removed before the send) */
+    struct sockaddr_in6 destination;
+
+    /** Number of frames */
+    size_t count;
+
+    /** Number of frames committed since the initialization */
+    uint64_t committed;
+
+    /** Frames, `ACK_FRAME_SIZE` bytes each */
+    uint8_t frames[ACK_BATCH_MAX * ACK_FRAME_SIZE];
+
+    /** Receive timestamps of the requests acknowledged by this batch */
+    uint64_t timestamps[ACK_BATCH_MAX];
+
+    /** Number of timestamps */
+    size_t timestamp_count;
+
+    /** Counters of the handler */
+    stats_t *stats;
+
+    /** Latency histograms of the handler (`HIST_COUNT`), may be NULL */
+    hist_t *latency;
+
+    /** TX stage sending the batches (-T), NULL = sent by the handler */
+    struct tx_stage *tx;
+} ack_batch_t;
+
+/**
+ * ## Use
+ *
+ * Initializes an empty batch.
+ *
+ * ## Arguments
+ *
+ * - `acks`    - the batch
+ * - `sockfd`  - the socket to send on
+ * - `stats`   - counters of the handler (hd_acks, hd_nacks, ...)
+ * - `latency` - latency histograms of the handler, may be NULL
+ */
+void ack_batch_init(ack_batch_t *acks, int sockfd, stats_t *stats, hist_t *latency);
+
+/**
+ * ## Use
+ *
+ * Reserves the next frame of the batch for `destination`, sends
+ * the batch first if it is full or for another destination. The
+ * frame only counts once `ack_batch_commit` is called.
+ *
+ * ## Arguments
+ *
+ * - `acks`        - the batch
+ * - `destination` - where the frame goes
+ *
+ * ## Return value
+ *
+ * the `ACK_FRAME_SIZE` bytes to pack the frame in.
+ */
+uint8_t *ack_batch_reserve(ack_batch_t *acks, struct sockaddr_in6 *destination);
+
+/**
+ * ## Use
+ *
+ * Adds the frame packed in the last `ack_batch_reserve` to the batch.
+ *
+ * ## Arguments
+ *
+ * - `acks` - the batch
+ */
+void ack_batch_commit(ack_batch_t *acks);
+
+/**
+ * ## Use
+ *
+ * Records the receive timestamp of a request whose (N)ACKs are in
+ * the batch, its rx_to_ack latency is recorded once they're sent.
+ *
+ * ## Arguments
+ *
+ * - `acks`      - the batch
+ * - `timestamp` - kernel receive time (ns, CLOCK_REALTIME), 0 if unknown
+ */
+void ack_batch_stamp(ack_batch_t *acks, uint64_t timestamp);
+
+/**
+ * ## Use
+ *
+ * Sends the batch (if not empty), or hands it over to the TX
+ * stage, and empties it. Failures are counted in hd_send_errors
+ * and logged.
+ *
+ * ## Arguments
+ *
+ * - `acks` - the batch
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int ack_batch_flush(ack_batch_t *acks);
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef ARENA_H
+
+#define ARENA_H
+
+#include "global.h"
+
+/** mmap, madvise */
+#include <sys/mman.h>
+
+/** Size of a huge page (x86_64 & aarch64 with 4 KiB pages) */
+#define ARENA_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+/** Size of a normal page, used when pre-faulting */
+#define ARENA_PAGE_SIZE 4096UL
+
+/** Objects are aligned on cache lines */
+#define ARENA_ALIGN 64UL
+
+/**
+ * The pools reserved at startup, see `arenas_init`.
+ */
+typedef enum arena_kind {
+    /** Handle requests (`hd_req_t`, 8 KiB each) */
+    ARENA_REQUESTS = 0,
+
+    /** Client windows (`buf_t`) */
+    ARENA_WINDOWS,
+
+    /** Packet views of the client windows (`pkt_view_t`) */
+    ARENA_VIEWS,
+
+    /** Number of arenas, must always be last */
+    ARENA_COUNT
+} arena_kind_t;
+
+/**
+ * What the memory of an arena ended up being backed by.
+ */
+typedef enum arena_backing {
+    /** Not initialized: every allocation goes to malloc */
+    ARENA_MALLOC = 0,
+
+    /** Normal pages */
+    ARENA_NORMAL,
+
+    /** Transparent huge pages (madvise) */
+    ARENA_THP,
+
+    /** Huge pages reserved with MAP_HUGETLB */
+    ARENA_HUGETLB
+} arena_backing_t;
+
+/** Names of the backings, in the same order as `arena_backing_t` */
+extern const char *arena_backing_names[];
+
+/** Names of the arenas, in the same order as `arena_kind_t` */
+extern const char *arena_names[ARENA_COUNT];
+
+/**
+ * ## Use
+ *
+ * A pool of fixed size objects in a single mapping, reserved
+ * up front so that the requests and the windows of every client
+ * are packed in a few huge pages instead of being scattered
+ * malloc blocks (one TLB entry covers 2 MiB instead of 4 KiB).
+ *
+ * Objects are handed out from a free list (the freed objects,
+ * the link is stored in the object itself) and then by bumping
+ * `bumped`, so that fresh objects are contiguous.
+ *
+ * ## Concurrency
+ *
+ * The arena is protected by a mutex: allocations only happen
+ * while the streams and windows are being filled (new clients,
+ * bursts), the nodes are recycled through the return streams
+ * afterwards.
+ */
+typedef struct arena {
+    /** Protects the free list and `bumped` */
+    pthread_mutex_t lock;
+
+    /** Start of the mapping */
+    uint8_t *base;
+
+    /** Size of the mapping */
+    size_t size;
+
+    /** Size of an object (rounded up to `ARENA_ALIGN`) */
+    size_t object_size;
+
+    /** Number of objects */
+    size_t capacity;
+
+    /** Number of objects that have ever been handed out */
+    size_t bumped;
+
+    /** Freed objects */
+    void *free_list;
+
+    /** Number of objects in use */
+    size_t in_use;
+
+    /** What the mapping is backed by */
+    arena_backing_t backing;
+} arena_t;
+
+/** The pools, indexed by `arena_kind_t` */
+extern arena_t arenas[ARENA_COUNT];
+
+/**
+ * ## Use
+ *
+ * Reserves the memory of an arena. It first tries huge pages
+ * (MAP_HUGETLB, requires `vm.nr_hugepages`), then a 2 MiB aligned
+ * mapping advised for transparent huge pages and finally normal pages.
+ *
+ * ## Arguments
+ *
+ * - `arena`       - the arena to initialize
+ * - `object_size` - the size of an object
+ * - `capacity`    - the number of objects
+ * - `prefault`    - true = touches every page now instead of on
+ *                   the first use (in the middle of a transfer)
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int arena_init(arena_t *arena, size_t object_size, size_t capacity, bool prefault);
+
+/**
+ * ## Use
+ *
+ * Unmaps an arena, every object it handed out becomes invalid.
+ *
+ * ## Arguments
+ *
+ * - `arena` - the arena
+ */
+void arena_destroy(arena_t *arena);
+
+/**
+ * ## Use
+ *
+ * Takes an object out of an arena. The content of the object
+ * is undefined.
+ *
+ * ## Arguments
+ *
+ * - `arena` - the arena
+ *
+ * ## Return value
+ *
+ * the object, NULL if the arena is full (errno is set to
+ * FAILED_TO_ALLOCATE).
+ */
+void *arena_alloc(arena_t *arena);
+
+/**
+ * ## Use
+ *
+ * Gives an object back to its arena.
+ *
+ * ## Arguments
+ *
+ * - `arena`  - the arena
+ * - `object` - an object of this arena
+ */
+void arena_free(arena_t *arena, void *object);
+
+/**
+ * ## Use
+ *
+ * Checks whether a pointer is in the mapping of an arena.
+ *
+ * ## Arguments
+ *
+ * - `arena` - the arena
+ * - `ptr`   - the pointer
+ */
+static inline bool arena_contains(arena_t *arena, void *ptr) {
+    return (uint8_t *) ptr >= arena->base && (uint8_t *) ptr < arena->base + arena->size;
+}
+
+/**
+ * ## Use
+ *
+ * Reserves the arenas of the receiver.
+ *
+ * ## Arguments
+ *
+ * - `max_clients` - maximum number of clients (one window each)
+ * - `requests`    - number of handle requests
+ * - `prefault`    - see `arena_init`
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error and the
+ * receiver can keep on using malloc.
+ */
+int arenas_init(size_t max_clients, size_t requests, bool prefault);
+
+/**
+ * ## Use
+ *
+ * Unmaps every arena, see `arena_destroy`.
+ */
+void arenas_destroy();
+
+/**
+ * ## Use
+ *
+ * Allocates an object of a kind: from its arena if it was
+ * initialized and isn't full, from malloc otherwise.
+ *
+ * ## Arguments
+ *
+ * - `kind` - the pool
+ * - `size` - the size of the object (for malloc)
+ *
+ * ## Return value
+ *
+ * the object, NULL if it failed (errno is set to FAILED_TO_ALLOCATE).
+ */
+void *arena_get(arena_kind_t kind, size_t size);
+
+/**
+ * ## Use
+ *
+ * Frees an object allocated with `arena_get`: it is given back to
+ * the arena it comes from or freed if it came from malloc.
+ *
+ * ## Arguments
+ *
+ * - `object` - the object, may be NULL
+ */
+void arena_put(void *object);
+
+#endif
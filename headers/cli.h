@@ -17,6 +17,40 @@ typedef struct stream_setting {
     size_t stream;
 } sts_t;
 
+/** The stream isn't bound to a NUMA node */
+#define TOPO_NO_NODE SIZE_MAX
+
+/** Largest busy-poll budget accepted by -B (us) */
+#define MAX_BUSY_POLL_US 1000000
+
+/** Largest TX stage deadline accepted by -T (us) */
+#define MAX_TX_DEADLINE_US 1000000
+
+/** Largest number of worker processes accepted by -P */
+#define MAX_WORKERS 64
+
+/** Requests in the pool per client and per thread when -q isn't given */
+#define DEFAULT_POOL_PER_CLIENT 4
+#define DEFAULT_POOL_PER_THREAD 128
+
+/**
+ * What a receiver does when there is no request left in the
+ * pool of its stream, see -Q.
+ */
+typedef enum pool_policy {
+    /** Drops the datagrams that don't fit (the newest) */
+    POOL_DROP = 0,
+
+    /** Like POOL_DROP, and a client can't hold more than its share of the pool */
+    POOL_CLIENT,
+
+    /** Waits for a handler to return a request (the socket buffer fills up) */
+    POOL_BLOCK
+} pool_policy_t;
+
+/** Names of the policies (-Q), in the same order as `pool_policy_t` */
+extern const char *pool_policy_names[];
+
 /**
  * Contains a receiver configuration.
  */
@@ -30,6 +64,9 @@ typedef struct config_receiver {
     /** Number of handler thread, ignored if `sequential` equals true */
     size_t handle_num;
 
+    /** Minimum number of active handlers (-n min:max), `handle_num` if not elastic */
+    size_t handle_min;
+
     /** CPU core affinities for the handler threads */
     afs_t *handle_affinities;
 
@@ -51,6 +88,9 @@ typedef struct config_receiver {
     /** How many packet to read in a single syscall, see recvmmsg */
     size_t receive_window_size;
 
+    /** Smallest batch (-W min:max, see rx_adapt), `receive_window_size` if fixed */
+    size_t receive_window_min;
+
     /** Output file name format length */
     size_t format_len;
     
@@ -68,6 +108,42 @@ typedef struct config_receiver {
     
     /** The input port */
     uint16_t port;
+
+    /** Path of the statistics Unix socket, NULL if disabled */
+    char *stats_path;
+
+    /** Name of the shared memory statistics segment, NULL if disabled */
+    char *shm_name;
+
+    /** Reserves the requests and windows up front (see arena.h) */
+    bool arenas;
+
+    /** Touches every page of the arenas at startup */
+    bool prefault;
+
+    /** Number of requests in flight, 0 = unbounded (allocated on demand) */
+    size_t pool_size;
+
+    /** What to do when the pool is exhausted */
+    pool_policy_t pool_policy;
+
+    /** Places the threads from the CPU topology instead of affinity.cfg */
+    bool auto_affinity;
+
+    /** NUMA node of each stream (`TOPO_NO_NODE` if unknown), NULL on a single node host */
+    size_t *stream_nodes;
+
+    /** Busy-poll budget of the sockets and of the threads (us), 0 = disabled */
+    size_t busy_poll_us;
+
+    /** Sends the (N)ACKs from a TX stage per stream (-T), see tx.h */
+    bool tx_stage;
+
+    /** Deadline of a batch in a TX stage (us) */
+    size_t tx_deadline_us;
+
+    /** Number of worker processes (-P), see workers.h. 0 = a single process */
+    size_t workers;
 } config_rcv_t;
 
 /**
@@ -5,6 +5,8 @@
 
 #define CLIENT_H
 
+/** Defined in shm.h */
+struct shm_client;
 
 typedef struct client {
     /**
@@ -46,6 +48,21 @@ typedef struct client {
 
     /** Total bytes transferred */
     uint64_t transferred;
+
+    /** Packets that were already received (retransmissions) */
+    uint64_t duplicates;
+
+    /** Record in the statistics segment, NULL if disabled */
+    struct shm_client *record;
+
+    /** Requests of this client waiting for a handler (see -Q client) */
+    volatile uint32_t queued;
+
+    /** Requests pinned by the views of the window (see `hd_req_t`) */
+    uint32_t pinned;
+
+    /** Entry in the client registry (see registry.h), -1 if none */
+    int registry_entry;
 } client_t;
 
 /**
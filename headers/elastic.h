@@ -0,0 +1,161 @@
+#ifndef ELASTIC_H
+
+#define ELASTIC_H
+
+#include "global.h"
+#include "stream.h"
+#include "handler.h"
+#include "cli.h"
+
+/** Period of the controller */
+#define ELASTIC_INTERVAL_MS 100
+
+/** A stream is saturated above this many requests queued per active handler */
+#define ELASTIC_DEPTH_HIGH 4
+
+/** A stream is saturated above this utilization of its active handlers */
+#define ELASTIC_UTIL_HIGH 0.85
+
+/** A handler is parked when the others would stay below this utilization */
+#define ELASTIC_UTIL_LOW 0.5
+
+/** Number of calm periods in a row before parking a handler (2 seconds) */
+#define ELASTIC_CALM_PERIODS 20
+
+/**
+ * ## Use
+ *
+ * Elastic handlers (-n min:max): every handler thread is started
+ * at startup (`max` of them, each on its affinity slot) but only
+ * `min` of them take requests, the others are parked on a
+ * condition and don't use any CPU.
+ *
+ * Every `ELASTIC_INTERVAL_MS`, the controller looks at the length
+ * of every `rx_to_hd` stream and at the utilization of its active
+ * handlers (`hd_busy_ns`):
+ * - a saturated stream gets one more handler right away
+ * - a stream whose load would fit in one handler less gets one
+ *   parked after `ELASTIC_CALM_PERIODS` calm periods in a row
+ *
+ * Handlers are unparked by increasing id and parked by decreasing
+ * id, so the first affinity slots (the best ones with -A auto) stay
+ * active. Every stream always keeps at least one active handler.
+ */
+typedef struct elastic {
+    /** The handlers */
+    hd_cfg_t **handlers;
+
+    /** Number of handlers */
+    size_t handle_num;
+
+    /** Stream of every handler */
+    sts_t *handle_streams;
+
+    /** Receive to Handle streams */
+    stream_t **streams;
+
+    /** Number of streams */
+    size_t stream_count;
+
+    /** Minimum number of active handlers */
+    size_t min;
+
+    /** Number of active handlers */
+    size_t active;
+
+    /** `hd_busy_ns` of every handler at the previous period */
+    uint64_t *last_busy;
+
+    /** Calm periods in a row of every stream */
+    size_t *calm;
+
+    /** Controller thread, NULL if not started */
+    pthread_t *thread;
+
+    /** true = the controller should stop */
+    volatile bool stop;
+} elastic_t;
+
+/**
+ * ## Use
+ *
+ * Parks the handlers above the minimum, before they are started
+ * (their `park_lock` and `park_cond` must be initialized).
+ *
+ * ## Arguments
+ *
+ * - `elastic`  - the controller
+ * - `config`   - the configuration (`handle_min`, streams)
+ * - `handlers` - the handler configurations
+ * - `streams`  - the Receive to Handle streams
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int elastic_init(elastic_t *elastic, config_rcv_t *config, hd_cfg_t **handlers, stream_t **streams);
+
+/**
+ * ## Use
+ *
+ * Starts the controller thread.
+ *
+ * ## Arguments
+ *
+ * - `elastic` - an initialized controller
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int elastic_start(elastic_t *elastic);
+
+/**
+ * ## Use
+ *
+ * Runs a single period of the controller, see `elastic_t`.
+ *
+ * ## Arguments
+ *
+ * - `elastic` - an initialized controller
+ */
+void elastic_run_once(elastic_t *elastic);
+
+/**
+ * ## Use
+ *
+ * Stops the controller and unparks every handler so that
+ * they can receive their STOP request.
+ *
+ * ## Arguments
+ *
+ * - `elastic` - the controller, may be uninitialized (zeroed)
+ */
+void elastic_stop(elastic_t *elastic);
+
+/**
+ * ## Use
+ *
+ * Frees the controller, once the handlers have been joined.
+ *
+ * ## Arguments
+ *
+ * - `elastic` - the controller, may be uninitialized (zeroed)
+ */
+void elastic_destroy(elastic_t *elastic);
+
+/**
+ * ## Use
+ *
+ * Parks or unparks a handler.
+ *
+ * ## Arguments
+ *
+ * - `handler` - the handler
+ * - `parked`  - true = parks it
+ */
+void elastic_set_parked(hd_cfg_t *handler, bool parked);
+
+#endif
@@ -104,6 +104,36 @@ typedef enum Errors {
     /** Failed to resize (hashtable) */
     FAILED_TO_RESIZE = 32,
 
+    /** Huge pages mode invalid (off, on or prefault) */
+    CLI_HUGE_INVALID = 33,
+
+    /** Request pool size or policy invalid (drop, client or block) */
+    CLI_POOL_INVALID = 34,
+
+    /** Affinity mode invalid (file or auto) */
+    CLI_AFFINITY_INVALID = 35,
+
+    /** Failed to read the CPU topology */
+    TOPOLOGY_UNAVAILABLE = 36,
+
+    /** Busy-poll budget invalid (microseconds, at most 1s) */
+    CLI_BUSY_POLL_INVALID = 37,
+
+    /** The ring of a TX stage is full */
+    TX_FULL = 38,
+
+    /** TX stage deadline invalid (microseconds, at most 1s) */
+    CLI_TX_INVALID = 39,
+
+    /** Number of worker processes invalid (at most MAX_WORKERS) */
+    CLI_WORKERS_INVALID = 40,
+
+    /** The client registry is full */
+    REGISTRY_FULL = 41,
+
+    /** The client belonged to a worker that crashed (see registry.h) */
+    REGISTRY_ORPHAN = 42,
+
     /** Unknown/internal error */
     UNKNOWN = 255
 
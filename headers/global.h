@@ -81,6 +81,47 @@
 
 #include <getopt.h>
 
+/** Required for the statistics socket */
+#include <sys/un.h>
+
+/** Required for waiting on the statistics socket */
+#include <poll.h>
+
+/** Required for waiting on many sockets (benchmark tools) */
+#include <sys/epoll.h>
+
+/** Required for UDP_SEGMENT (GSO) */
+#include <netinet/udp.h>
+
+/** Required for the release timer of the impairment relay */
+#include <sys/timerfd.h>
+
+/** Required for reading the CPU topology (sysfs) */
+#include <dirent.h>
+
+/** Required for finding the interface of the bound address */
+#include <ifaddrs.h>
+#include <net/if.h>
+
+/** Required for mbind (raw syscall, no libnuma) */
+#include <sys/syscall.h>
+
+/** Required for the timer slack of the TX stages */
+#include <sys/prctl.h>
+
+/** Required for supervising the worker processes */
+#include <sys/wait.h>
+
+/** Carry-less multiplication (PCLMULQDQ) of `crc32_batch` */
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/** Busy polling, SO_PREFER_BUSY_POLL is Linux 5.11 and missing from older headers */
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
 /** Custom error number definitions */
 #include "errors.h"
 
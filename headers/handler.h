@@ -6,6 +6,11 @@
 #include "client.h"
 #include "cli.h"
 #include "hash_table.h"
+#include "stats.h"
+#include "shm.h"
+#include "logger.h"
+#include "ack_batch.h"
+#include "tx.h"
 
 #define HD_H
 
@@ -35,8 +40,63 @@ typedef struct handle_thread_config {
     
     /** The socket file descriptor */
     int sockfd;
+
+    /** Counters of this handler */
+    stats_t *stats;
+
+    /** Latency histograms of this handler (`HIST_COUNT`), may be NULL */
+    hist_t *latency;
+
+    /** true = parked by the elastic controller, see elastic.h */
+    volatile bool parked;
+
+    /** Protects `parked` while waiting */
+    pthread_mutex_t park_lock;
+
+    /** Signaled when the handler is unparked */
+    pthread_cond_t park_cond;
+
+    /** Spin budget before sleeping on the stream (ns), 0 = always sleep, see -B */
+    uint64_t spin_ns;
+
+    /** TX stage of the stream sending the (N)ACKs (-T), NULL = sent by the handler */
+    tx_stage_t *ack_tx;
+
+    /** Below this many requests in the return stream, no request is pinned (see `hd_req_t`), 0 = unbounded pool */
+    size_t pin_reserve;
 } hd_cfg_t;
 
+/** Size of a handle request, header included (two pages) */
+#define HD_REQ_SIZE 8192
+
+/** Bytes of datagrams a handle request can hold */
+#define HD_REQ_DATA_SIZE (HD_REQ_SIZE - 128)
+
+/**
+ * ## Use
+ *
+ * A batch of datagrams of a single client, passed from a
+ * receiver to a handler.
+ *
+ * The datagrams are packed one after the other in `data`
+ * (datagram `i` spans `offsets[i]` to `offsets[i + 1]`) so that
+ * a request only touches the cache lines of the bytes it holds
+ * instead of a full 528 bytes slot per datagram. A request holds
+ * about 15 full sized datagrams or all 31 of a window of small
+ * ones; when it is full, the receiver hands it over and takes
+ * another one for the rest of the batch.
+ *
+ * The handler decodes the datagrams in place: the window of the
+ * client holds views (`pkt_view_t`) pointing in `data`, so the
+ * payload is only copied once, into the output. A request with
+ * views in the window is pinned (`refs` > 0) and only goes back to
+ * its return stream once the last of them is written. When the
+ * pool is bounded and its return stream runs low (`pin_reserve`),
+ * the packets ahead of the window that would pin another request
+ * are dropped (the sender sends them again): the receivers always
+ * have requests left for the missing packets, however many clients
+ * are waiting for theirs.
+ */
 typedef struct handle_request {
     /** true = the loop should stop */
     bool stop;
@@ -47,15 +107,220 @@ typedef struct handle_request {
     /** number of buffers read */
     size_t num;
 
-    uint16_t lengths[MAX_WINDOW_SIZE];
+    /** kernel receive time of the first buffer (ns, CLOCK_REALTIME), 0 if unknown */
+    uint64_t timestamp;
+
+    /** views of the request in the window of its client (protected by the client lock) */
+    uint32_t refs;
+
+    /** node holding the request, set by the handler */
+    s_node_t *node;
+
+    /** stream the request goes back to once it isn't pinned, set by the handler */
+    stream_t *home;
+
+    /** start of each datagram in `data`, `offsets[num]` is the number of bytes used */
+    uint16_t offsets[MAX_WINDOW_SIZE + 1];
 
     /** data read from the network */
-    uint8_t buffer[MAX_WINDOW_SIZE][MAX_PACKET_SIZE];
+    uint8_t data[HD_REQ_DATA_SIZE] __attribute__((aligned(64)));
 } hd_req_t;
 
-uint8_t *get_buffer(hd_req_t* self);
+_Static_assert(sizeof(hd_req_t) <= HD_REQ_SIZE, "hd_req_t does not fit in HD_REQ_SIZE");
+
+/**
+ * ## Use
+ *
+ * Empties a request, keeping its client.
+ *
+ * ## Arguments
+ *
+ * - `req` - the request
+ */
+static inline void hd_req_reset(hd_req_t *req) {
+    req->num = 0;
+    req->offsets[0] = 0;
+}
+
+/**
+ * ## Use
+ *
+ * Gets a datagram of a request.
+ *
+ * ## Arguments
+ *
+ * - `req` - the request
+ * - `i`   - the index of the datagram, lower than `req->num`
+ */
+static inline uint8_t *hd_req_datagram(hd_req_t *req, size_t i) {
+    return req->data + req->offsets[i];
+}
+
+/**
+ * ## Use
+ *
+ * Gets the length of a datagram of a request.
+ *
+ * ## Arguments
+ *
+ * - `req` - the request
+ * - `i`   - the index of the datagram, lower than `req->num`
+ */
+static inline uint16_t hd_req_length(hd_req_t *req, size_t i) {
+    return req->offsets[i + 1] - req->offsets[i];
+}
+
+/**
+ * ## Use
+ *
+ * Appends a datagram at the end of a request.
+ *
+ * ## Arguments
+ *
+ * - `req`      - the request
+ * - `datagram` - the datagram
+ * - `len`      - its length, at most MAX_PACKET_SIZE
+ *
+ * ## Return value
+ *
+ * false if the request is full (no room left or already
+ * MAX_WINDOW_SIZE datagrams), true otherwise.
+ */
+static inline bool hd_req_push(hd_req_t *req, uint8_t *datagram, uint16_t len) {
+    uint16_t used = req->offsets[req->num];
+    if (req->num >= MAX_WINDOW_SIZE || used + len > HD_REQ_DATA_SIZE) {
+        return false;
+    }
 
-void set_buffer(hd_req_t* self, uint8_t *buffer, uint16_t len);
+    memcpy(req->data + used, datagram, len);
+    req->offsets[++req->num] = used + len;
+
+    return true;
+}
+
+/**
+ * ## Use
+ *
+ * Computes the header and payload CRCs of every datagram of a
+ * request at once (see `crc32_batch`), for `unpack_precomputed`.
+ * The CRC of a part that doesn't fit in its datagram (or of the
+ * payload of anything but an untruncated DATA) is left at 0,
+ * `unpack_precomputed` fails on the length before looking at it.
+ *
+ * ## Arguments
+ *
+ * - `req`          - the request
+ * - `header_crcs`  - receives the CRC of each header (T bit cleared)
+ * - `payload_crcs` - receives the CRC of each payload
+ */
+void hd_req_crcs(hd_req_t *req, uint32_t header_crcs[MAX_WINDOW_SIZE], uint32_t payload_crcs[MAX_WINDOW_SIZE]);
+
+/**
+ * ## Use
+ *
+ * Same as `hd_req_crcs` for datagrams anywhere in memory.
+ *
+ * ## Arguments
+ *
+ * - `datagrams`    - the datagrams
+ * - `lengths`      - their lengths
+ * - `count`        - the number of datagrams
+ * - `header_crcs`  - receives the CRC of each header (T bit cleared)
+ * - `payload_crcs` - receives the CRC of each payload
+ */
+void hd_crcs(uint8_t **datagrams, size_t *lengths, size_t count, uint32_t *header_crcs, uint32_t *payload_crcs);
+
+/**
+ * ## Use
+ *
+ * Decodes a datagram of a client into its window (see `hd_req_t`)
+ * and queues the (N)ACK it calls for, if any. The ACK of the packets
+ * it makes writable is left to `hd_flush`. Called with the client
+ * lock.
+ *
+ * ## Arguments
+ *
+ * - `cfg`            - the handler
+ * - `client`         - the client of the datagram
+ * - `owner`          - the request holding the datagram, pinned by the
+ *                      view left in the window. NULL if the caller
+ *                      keeps the datagram until the view is written
+ *                      or moved (see sequential.h)
+ * - `datagram`       - the datagram
+ * - `length`         - its length
+ * - `crc1`           - the CRC of its header, see `hd_crcs`
+ * - `crc2`           - the CRC of its payload
+ * - `acks`           - the (N)ACKs of the handler
+ * - `last_timestamp` - receives the timestamp of the packet
+ */
+void hd_decode(
+    hd_cfg_t *cfg,
+    client_t *client,
+    hd_req_t *owner,
+    uint8_t *datagram,
+    int length,
+    uint32_t crc1,
+    uint32_t crc2,
+    ack_batch_t *acks,
+    uint32_t *last_timestamp
+);
+
+/**
+ * ## Use
+ *
+ * Writes the packets of the window of a client that are in order
+ * and queues their ACK, closes the output at the end of the
+ * transfer. Called with the client lock.
+ *
+ * ## Arguments
+ *
+ * - `cfg`            - the handler
+ * - `client`         - the client
+ * - `file_buffer`    - scratch space for the payloads
+ * - `acks`           - the (N)ACKs of the handler
+ * - `last_timestamp` - timestamp to echo if nothing is written before
+ * - `timestamp`      - kernel receive time of the datagrams (ns), 0 if unknown
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 if the output could
+ * not be written.
+ */
+int hd_flush(
+    hd_cfg_t *cfg,
+    client_t *client,
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE],
+    ack_batch_t *acks,
+    uint32_t last_timestamp,
+    uint64_t timestamp
+);
+
+/**
+ * ## Use
+ *
+ * Drops the reference of a view written (or discarded) from the
+ * window of a client. Once its request isn't referenced anymore,
+ * it goes back to its return stream. Called with the client lock.
+ *
+ * ## Arguments
+ *
+ * - `client` - the client of the window
+ * - `view`   - the view
+ */
+void hd_view_release(client_t *client, pkt_view_t *view);
+
+/**
+ * ## Use
+ *
+ * Releases every view left in the window of a client that is
+ * being removed, see `hd_view_release`. The return streams must
+ * still exist.
+ *
+ * ## Arguments
+ *
+ * - `client` - the client
+ */
+void hd_window_release(client_t *client);
 
 /**
  * /!\ This is a THREAD definition
@@ -161,20 +426,31 @@ void enqueue_or_free(stream_t *stream, s_node_t *node);
  * 
  * - `wait`            - should wait while popping?
  * - `cfg`             - receiver configuration
- * - `decoded`         - decoded packet (for buffer reuse)
  * - `exit`            - should exit? (output)
  * - `file_buffer`     - temporary file buffer (on the stack)
- * - `packets_to_send` - buffers for the (N)ACK to send (on the stack)
- * - `msg`             - messages for sendmmsg (on the stack)
+ * - `acks`            - the (N)ACKs to send, sent once the stream is
+ *                       empty (see ack_batch.h)
  */
 void hd_run_once(
     bool wait,
     hd_cfg_t *cfg,
-    packet_t **decoded,
     bool *exit,
-    uint8_t file_buffer[MAX_PACKET_SIZE * MAX_WINDOW_SIZE],
-    uint8_t packets_to_send[][12],
-    struct mmsghdr *msg
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE],
+    ack_batch_t *acks
 );
 
+/**
+ * ## Use
+ *
+ * Waits while the handler is parked by the elastic controller
+ * (see elastic.h). The (N)ACKs still in `acks` are sent first:
+ * their senders would otherwise wait until it is unparked.
+ *
+ * ## Arguments
+ *
+ * - `cfg`  - handler configuration
+ * - `acks` - the (N)ACKs of the handler
+ */
+void hd_park(hd_cfg_t *cfg, ack_batch_t *acks);
+
 #endif
@@ -218,6 +218,26 @@ bool ht_contains(ht_t* table, uint16_t port, uint8_t *ip);
  */
 client_t *ht_get(ht_t *table, uint16_t port, uint8_t *ip);
 
+/**
+ * ## Use :
+ * 
+ * Same as `ht_get` without taking the lock, for a table that
+ * only one thread modifies and reads (see sequential.h)
+ * 
+ * ## Arguments :
+ *
+ * - `table` - a pointer to a hash table
+ * - `port`  - the port to hash
+ * - `ip`    - the ip to compare
+ *
+ * ## Return value:
+ * 
+ * a value if the key is in the hashtable,
+ * NULL otherwise
+ * 
+ */
+client_t *ht_get_nolock(ht_t *table, uint16_t port, uint8_t *ip);
+
 /**
  * ## Use :
  * 
@@ -0,0 +1,203 @@
+#ifndef HISTOGRAM_H
+
+#define HISTOGRAM_H
+
+#include "global.h"
+
+/** log2 of the number of sub-buckets per power of two */
+#define HIST_SUB_BITS 3
+
+/** Number of sub-buckets per power of two (~12.5% precision) */
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+
+/** Largest power of two that can be recorded (2^40 ns is ~18 minutes) */
+#define HIST_MAX_POWER 40
+
+/** Total number of buckets */
+#define HIST_BUCKETS ((HIST_MAX_POWER - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+/**
+ * Every latency measured by the handlers, all of them
+ * start at the kernel receive timestamp (SO_TIMESTAMPNS).
+ */
+typedef enum hist_kind {
+    /** Until the request is popped by a handler */
+    HIST_RX_TO_DEQUEUE = 0,
+
+    /** Until the payloads are written to the output file */
+    HIST_RX_TO_WRITE,
+
+    /** Until the (N)ACKs are handed to `sendmmsg` */
+    HIST_RX_TO_ACK,
+
+    /** Number of histograms, must always be last */
+    HIST_COUNT
+} hist_kind_t;
+
+/** Names of the histograms, in the same order as `hist_kind_t` */
+extern const char *hist_names[HIST_COUNT];
+
+/**
+ * ## Use
+ *
+ * An HDR-style (log-linear) histogram of nanosecond values.
+ *
+ * Values below `HIST_SUB_BUCKETS` get their own bucket, above that
+ * each power of two is split in `HIST_SUB_BUCKETS` linear buckets.
+ * This keeps the relative error constant (at most 1/8th) from
+ * nanoseconds to minutes with only a few hundred counters.
+ *
+ * ## Concurrency
+ *
+ * Like `stats_t`, a histogram only has a single writer and uses
+ * relaxed loads and stores: recording a value is a `lzcnt`, a shift
+ * and an `add`. Readers may see a slightly outdated histogram.
+ *
+ * ## Sources
+ *
+ * - [HdrHistogram](http://hdrhistogram.org/)
+ */
+typedef struct histogram {
+    /** Number of recorded values */
+    uint64_t count;
+
+    /** Sum of the recorded values */
+    uint64_t sum;
+
+    /** Largest recorded value */
+    uint64_t max;
+
+    /** The buckets */
+    uint64_t buckets[HIST_BUCKETS];
+} __attribute__((aligned(64))) hist_t;
+
+/**
+ * ## Use
+ *
+ * Returns the bucket in which a value is recorded.
+ *
+ * ## Arguments
+ *
+ * - `value` - the value
+ *
+ * ## Return value
+ *
+ * the index of the bucket
+ */
+static inline size_t hist_index(uint64_t value) {
+    if (value < HIST_SUB_BUCKETS) {
+        return value;
+    }
+
+    int shift = 63 - __builtin_clzl(value) - HIST_SUB_BITS;
+    size_t index = (shift + 1) * HIST_SUB_BUCKETS + ((value >> shift) & (HIST_SUB_BUCKETS - 1));
+
+    return index < HIST_BUCKETS ? index : HIST_BUCKETS - 1;
+}
+
+/**
+ * ## Use
+ *
+ * Returns the smallest value recorded in a bucket.
+ *
+ * ## Arguments
+ *
+ * - `index` - the index of the bucket
+ *
+ * ## Return value
+ *
+ * the lower bound of the bucket
+ */
+uint64_t hist_lower_bound(size_t index);
+
+/**
+ * ## Use
+ *
+ * Records a value, must only be called by the owner thread.
+ *
+ * ## Arguments
+ *
+ * - `hist`  - the histogram
+ * - `value` - the value to record
+ */
+static inline void hist_record(hist_t *hist, uint64_t value) {
+    uint64_t *bucket = &hist->buckets[hist_index(value)];
+
+    __atomic_store_n(bucket, __atomic_load_n(bucket, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->count, __atomic_load_n(&hist->count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&hist->sum, __atomic_load_n(&hist->sum, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+
+    if (value > __atomic_load_n(&hist->max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&hist->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * ## Use
+ *
+ * Returns the time elapsed since a kernel timestamp
+ * (CLOCK_REALTIME, like SO_TIMESTAMPNS) in nanoseconds.
+ *
+ * ## Arguments
+ *
+ * - `since` - the timestamp in nanoseconds
+ *
+ * ## Return value
+ *
+ * the elapsed time, 0 if the clock went backwards
+ */
+static inline uint64_t hist_elapsed(uint64_t since) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    uint64_t now_ns = (uint64_t) now.tv_sec * 1000000000UL + now.tv_nsec;
+
+    return now_ns > since ? now_ns - since : 0;
+}
+
+/**
+ * ## Use
+ *
+ * Adds every value of `src` into `dst` (reading `src` from any thread).
+ *
+ * ## Arguments
+ *
+ * - `dst` - the histogram to add into
+ * - `src` - the histogram to read
+ */
+void hist_merge(hist_t *dst, hist_t *src);
+
+/**
+ * ## Use
+ *
+ * Computes a percentile of the histogram.
+ *
+ * ## Arguments
+ *
+ * - `hist`       - the histogram
+ * - `percentile` - the percentile (between 0 and 100)
+ *
+ * ## Return value
+ *
+ * the lower bound of the bucket containing the percentile,
+ * 0 if the histogram is empty
+ */
+uint64_t hist_percentile(hist_t *hist, double percentile);
+
+/**
+ * ## Use
+ *
+ * Writes a summary of the histogram, one `<scope>.<name>.<field> <value>`
+ * per line where field is `count`, `mean`, `p50`, `p90`, `p99`, `p999`
+ * or `max` (all in nanoseconds).
+ *
+ * ## Arguments
+ *
+ * - `hist`  - the histogram
+ * - `scope` - the scope (e.g `hd.0`)
+ * - `name`  - the name of the histogram
+ * - `out`   - the output stream
+ */
+void hist_write_text(hist_t *hist, char *scope, const char *name, FILE *out);
+
+#endif
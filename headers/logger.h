@@ -0,0 +1,215 @@
+#ifndef LOGGER_H
+
+#define LOGGER_H
+
+#include "global.h"
+
+/** Number of records in the ring of each thread (power of two) */
+#define LOG_RING_SIZE 1024
+
+/** Maximum number of threads that can register */
+#define LOG_MAX_THREADS 256
+
+/** Number of numeric arguments of a record */
+#define LOG_MAX_ARGS 3
+
+/** How often the logger thread wakes up when there's nothing to write (in µs) */
+#define LOG_IDLE_US 10000
+
+/**
+ * Message classes, each class is rate limited independently.
+ */
+typedef enum log_class {
+    /** Lifecycle messages (new client, transfer done, thread stopped) */
+    LOG_CLASS_INFO = 0,
+
+    /** Invalid packets, at most one per corrupted datagram */
+    LOG_CLASS_PACKET,
+
+    /** Failed syscalls and allocations */
+    LOG_CLASS_ERROR,
+
+    /** Number of classes, must always be last */
+    LOG_CLASS_COUNT
+} log_class_t;
+
+/**
+ * Every message that can be logged asynchronously. The format
+ * and the class of each message are defined in src/logger.c.
+ */
+typedef enum log_msg {
+    LOG_HD_TYPE_WRONG = 0,
+    LOG_HD_NON_DATA_TRUNCATED,
+    LOG_HD_CRC_HEADER,
+    LOG_HD_CRC_PAYLOAD,
+    LOG_HD_TOO_SHORT,
+    LOG_HD_TOO_LONG,
+    LOG_HD_PAYLOAD_TOO_LONG,
+    LOG_HD_UNKNOWN_ERROR,
+    LOG_HD_PACK_ACK_FAILED,
+    LOG_HD_PACK_NACK_FAILED,
+    LOG_HD_INTERNAL_ERROR,
+    LOG_HD_WRITE_FAILED,
+    LOG_HD_TIMESPEC_FAILED,
+    LOG_HD_DONE,
+    LOG_HD_SEND_FAILED,
+    LOG_HD_RECEIVED_STOP,
+    LOG_HD_AFFINITY_FAILED,
+    LOG_HD_AFFINITY,
+    LOG_HD_START_FAILED,
+    LOG_HD_STOPPED,
+    LOG_HD_GSO_DISABLED,
+    LOG_RX_RECV_FAILED,
+    LOG_RX_CLIENT_ALLOC_FAILED,
+    LOG_RX_CLIENT_INIT_FAILED,
+    LOG_RX_NEW_CLIENT,
+    LOG_RX_NODE_ALLOC_FAILED,
+    LOG_RX_AFFINITY_FAILED,
+    LOG_RX_AFFINITY,
+    LOG_RX_STOPPED,
+
+    /** Number of messages, must always be last */
+    LOG_MSG_COUNT
+} log_msg_t;
+
+/**
+ * A message waiting to be formatted. Only the message ID
+ * and its arguments are stored, the formatting (and the
+ * conversion of the address to a string) happens on the
+ * logger thread.
+ */
+typedef struct log_record {
+    /** The message (`log_msg_t`) */
+    uint16_t msg;
+
+    /** Client port (network order) */
+    uint16_t port;
+
+    /** Client ID */
+    uint32_t id;
+
+    /** Client address */
+    uint8_t addr[16];
+
+    /** Numeric arguments */
+    uint64_t args[LOG_MAX_ARGS];
+} log_rec_t;
+
+/**
+ * /!\ READ THIS CAREFULLY IF YOU DON'T UNDERSTAND WHY THIS EXISTS
+ *
+ * ## Problem
+ *
+ * `LOG` calls `fprintf(stderr, ...)`: it formats the message and
+ * takes the lock of `stderr` on the calling thread. When a sender
+ * starts sending garbage, every corrupted datagram becomes a write
+ * on stderr from the handlers, and they all fight for the same lock.
+ *
+ * ## Solution
+ *
+ * Each worker thread owns a ring (single producer, single consumer)
+ * in which it copies the message ID and its arguments. A background
+ * thread drains the rings, formats the messages and writes them.
+ * Logging is a handful of stores and never waits: if the ring
+ * is full the message is dropped (and counted).
+ *
+ * On top of that every thread limits the number of messages
+ * per class and per second, the others are suppressed (and counted).
+ *
+ * Threads that did not register (e.g the main thread or the tests)
+ * format their messages synchronously, with the same rate limits.
+ */
+typedef struct log_ring {
+    /** Next record to write, only written by the producer */
+    uint64_t head __attribute__((aligned(64)));
+
+    /** Next record to read, only written by the logger thread */
+    uint64_t tail __attribute__((aligned(64)));
+
+    /** Messages suppressed by the rate limit, per class */
+    uint64_t suppressed[LOG_CLASS_COUNT] __attribute__((aligned(64)));
+
+    /** Messages dropped because the ring was full, per class */
+    uint64_t dropped[LOG_CLASS_COUNT];
+
+    /** The records */
+    log_rec_t records[LOG_RING_SIZE];
+} log_ring_t;
+
+/**
+ * ## Use
+ *
+ * Starts the logger thread.
+ *
+ * ## Arguments
+ *
+ * - `out` - where to write the messages (usually stderr)
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int logger_start(FILE *out);
+
+/**
+ * ## Use
+ *
+ * Writes every pending message, stops the logger thread and
+ * frees the rings. Every registered thread must have exited
+ * (except the calling thread).
+ */
+void logger_stop();
+
+/**
+ * ## Use
+ *
+ * Gives a ring to the calling thread.
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise
+ * (the thread will then log synchronously).
+ * If it failed, errno is set to an appropriate error.
+ */
+int logger_register();
+
+/**
+ * ## Use
+ *
+ * Logs a message that is not related to a client.
+ *
+ * ## Arguments
+ *
+ * - `msg`          - the message
+ * - `a0`, `a1`, `a2` - the arguments (see the format of the message)
+ */
+void log_event(log_msg_t msg, uint64_t a0, uint64_t a1, uint64_t a2);
+
+/**
+ * ## Use
+ *
+ * Logs a message related to a client.
+ *
+ * ## Arguments
+ *
+ * - `msg`          - the message
+ * - `id`           - the client ID
+ * - `address`      - the client address
+ * - `a0`, `a1`, `a2` - the arguments (see the format of the message)
+ */
+void log_client_event(log_msg_t msg, uint32_t id, struct sockaddr_in6 *address, uint64_t a0, uint64_t a1, uint64_t a2);
+
+/**
+ * ## Use
+ *
+ * Writes the suppressed and dropped counters of every class,
+ * one `log.<class>.<suppressed|dropped> <value>` per line.
+ *
+ * ## Arguments
+ *
+ * - `out` - the output stream
+ */
+void logger_write_text(FILE *out);
+
+#endif
@@ -40,4 +40,30 @@ extern const uint8_t sequences[256][256];
  */
 extern const char *ascii[256];
 
+/**
+ * The header CRC of an ACK or a NACK split per field, see
+ * `pack_ack`. The CRC32 of a message of a given length is an
+ * affine function of its bits, so the CRC of the 7 bytes header
+ * is the XOR of the contribution of each byte at its position:
+ *
+ * ```c
+ * ack_crc[0][header] ^ ack_crc[1][seqnum] ^
+ * ack_crc[2][t0] ^ ack_crc[3][t1] ^ ack_crc[4][t2] ^ ack_crc[5][t3]
+ * ```
+ *
+ * Where `t0` to `t3` are the timestamp bytes in the order they're
+ * sent. The length byte of an ACK is always 0 and doesn't
+ * contribute anything, the CRC of the all-zero header is folded
+ * in `ack_crc[0]`.
+ *
+ * Generated using a bit of C code (with `crc32_8bytes`)
+ */
+extern const uint32_t ack_crc[6][256];
+
+/**
+ * The slicing-by-16 tables of lib/Crc32.cpp (exported with C
+ * linkage), used by `crc32_batch`.
+ */
+extern const uint32_t Crc32Lookup[16][256];
+
 #endif
@@ -5,6 +5,12 @@
 #include "packet.h"
 #include "receiver.h"
 #include "handler.h"
+#include "stats.h"
+#include "shm.h"
+#include "topology.h"
+#include "elastic.h"
+#include "sequential.h"
+#include "workers.h"
 
 /**
  * ## Use
@@ -5,6 +5,7 @@
 #include "global.h"
 #include "errors.h"
 #include "lookup.h"
+#include "arena.h"
 
 typedef enum PType {
     IGNORE = 0,
@@ -49,6 +50,37 @@ typedef struct Packet {
     uint8_t payload[MAX_PAYLOAD_SIZE];
 } packet_t;
 
+/** See handler.h */
+struct handle_request;
+
+/**
+ * A packet decoded in place (see `unpack_view`): the payload is
+ * left in the datagram it came in, so the view is only valid as
+ * long as the request holding that datagram (`owner`) is.
+ */
+typedef struct packet_view {
+    /** Packet type */
+    ptype_t type;
+
+    /** Is it truncated ? */
+    bool truncated;
+
+    /** The sequence number */
+    uint8_t seqnum;
+
+    /** The payload length */
+    uint16_t length;
+
+    /** The timestamp */
+    uint32_t timestamp;
+
+    /** The payload, in the datagram */
+    uint8_t *payload;
+
+    /** The request holding the datagram, set by the handler */
+    struct handle_request *owner;
+} pkt_view_t;
+
 /**
  * ## Use
  *
@@ -195,6 +227,110 @@ int unpack(uint8_t *packet, int length, packet_t *out);
  */
 int pack(uint8_t *packet, packet_t *in, bool recompute_crc2);
 
+/**
+ * ## Use
+ *
+ * Packs an ACK or a NACK, byte for byte the same frame as `pack`
+ * (`ACK_FRAME_SIZE` bytes) but only the type, the window, the
+ * seqnum and the timestamp are read. The header CRC is the XOR
+ * of one lookup per byte (see `ack_crc` in lookup.h) instead of
+ * running the CRC over the header.
+ *
+ * ## Arguments
+ *
+ * - `packet` - a pointer to a buffer of at least 11 bytes
+ * - `in` - a pointer to an ACK or a NACK
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int pack_ack(uint8_t *packet, packet_t *in);
+
+/**
+ * ## Use
+ *
+ * Same as `unpack` but with the header and payload CRCs already
+ * computed (see `crc32_batch`): `crc1` is the CRC of the header with
+ * the T bit cleared and `crc2` the CRC of the payload. They're only
+ * compared when `unpack` would have computed them.
+ *
+ * ## Arguments
+ *
+ * - `packet` - a pointer to a packet buffer
+ * - `length` - the length of the buffer
+ * - `out` - a pointer to an output packet
+ * - `crc1` - the CRC of the header
+ * - `crc2` - the CRC of the payload
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int unpack_precomputed(uint8_t *packet, int length, packet_t *out, uint32_t crc1, uint32_t crc2);
+
+/**
+ * ## Use
+ *
+ * Same as `unpack_precomputed` but without copying the payload:
+ * `out->payload` points to it in `packet`, which must outlive the
+ * view. `out->owner` is left untouched.
+ *
+ * ## Arguments
+ *
+ * - `packet` - a pointer to a packet buffer
+ * - `length` - the length of the buffer
+ * - `out` - a pointer to an output view
+ * - `crc1` - the CRC of the header
+ * - `crc2` - the CRC of the payload
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int unpack_view(uint8_t *packet, int length, pkt_view_t *out, uint32_t crc1, uint32_t crc2);
+
+/** Number of CRCs `crc32_batch` computes side by side */
+#define CRC_LANES 4
+
+/** Shortest buffer `crc32_batch` folds with PCLMULQDQ */
+#define CRC_FOLD_MIN 64
+
+/**
+ * ## Use
+ *
+ * Computes the CRC32 of `count` independent buffers.
+ *
+ * A single CRC is a chain of dependent table lookups: every 8 bytes
+ * need the previous CRC, so the core mostly waits for its loads.
+ * The short buffers (headers) are instead taken `CRC_LANES` at a
+ * time and advanced 8 bytes each per step (slicing-by-8) so that the
+ * lookups of the different chains are in flight together. The part
+ * of a buffer past the shortest one of its group is finished on its
+ * own.
+ *
+ * On x86 CPUs with PCLMULQDQ, the buffers of at least `CRC_FOLD_MIN`
+ * bytes (payloads) are folded instead: four independent 128 bits
+ * accumulators, each advanced 16 bytes per step with carry-less
+ * multiplications, which don't need any table lookup at all.
+ *
+ * ## Arguments
+ *
+ * - `data` - the buffers
+ * - `lengths` - their lengths
+ * - `count` - the number of buffers
+ * - `crcs` - receives the CRC of each buffer
+ *
+ * ## Source
+ *
+ * - [Fast CRC32](https://create.stephan-brumme.com/crc32/)
+ * - [Fast CRC Computation for Generic Polynomials Using PCLMULQDQ](https://www.intel.com/content/dam/www/public/us/en/documents/white-papers/fast-crc-computation-generic-polynomials-pclmulqdq-paper.pdf)
+ */
+void crc32_batch(uint8_t **data, size_t *lengths, size_t count, uint32_t *crcs);
+
 /**
  * ## Use
  *
@@ -263,4 +399,16 @@ bool ip_equals(uint8_t *ip1, uint8_t *ip2);
  */
 void *allocate_packet();
 
+/**
+ * ## Use
+ *
+ * An allocator that allocates an empty view, for the
+ * windows of the clients.
+ * 
+ * ## Return value
+ * 
+ * A pointer to a `pkt_view_t` and NULL if failed.
+ */
+void *allocate_view();
+
 #endif
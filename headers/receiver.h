@@ -9,9 +9,28 @@
 #include "client.h"
 #include "cli.h"
 #include "handler.h"
+#include "stats.h"
+#include "shm.h"
+#include "logger.h"
+#include "registry.h"
 
 #define RX_H
 
+/** Size of the ancillary data of a message (SO_TIMESTAMPNS) */
+#define RX_CONTROL_LEN CMSG_SPACE(sizeof(struct timespec))
+
+/** `recvmmsg` timeout with the largest batch (and with a fixed one) */
+#define RX_TIMEOUT_MAX_NS (1000 * 1000)
+
+/** `recvmmsg` timeout with the smallest batch */
+#define RX_TIMEOUT_MIN_NS (50 * 1000)
+
+/** Fixed point scale of the average fill of the batches */
+#define RX_FILL_ONE 16
+
+/** Syscalls between two changes of the batch size */
+#define RX_ADAPT_PERIOD 8
+
 typedef struct receive_thread_config {
     /** Thread ID */
     size_t id;
@@ -19,8 +38,11 @@ typedef struct receive_thread_config {
     /** Thread reference */
     pthread_t *thread;
 
-    /** the number of clients that have connected */
-    volatile uint32_t *idx;
+    /** IDs and owners of the clients of every worker */
+    reg_t *registry;
+
+    /** Worker process (-P), 0 without */
+    uint32_t worker;
 
     /** the file name format */
     char *file_format;
@@ -50,6 +72,36 @@ typedef struct receive_thread_config {
 
     /** Maximum number of packets per syscall */
     size_t window_size;
+
+    /** Smallest batch the controller may ask for (-W min:max), fixed if 0 or `window_size` */
+    size_t batch_min;
+
+    /** Datagrams asked per syscall (<= `window_size`), 0 until the first call */
+    size_t batch;
+
+    /** Current `recvmmsg` timeout (ns) */
+    long timeout_ns;
+
+    /** Average datagrams per syscall (x `RX_FILL_ONE`) */
+    int fill;
+
+    /** Syscalls since the last change of `batch` */
+    size_t since_resize;
+
+    /** Counters of this receiver */
+    stats_t *stats;
+
+    /** Statistics segment, NULL if disabled */
+    shm_seg_t *shm;
+
+    /** Requests in the pool of this receiver's stream, 0 = unbounded */
+    size_t pool_size;
+
+    /** What to do when the pool is exhausted */
+    pool_policy_t pool_policy;
+
+    /** Spin budget before sleeping in `recvmmsg` (ns), 0 = always sleep, see -B */
+    uint64_t spin_ns;
 } rx_cfg_t;
 
 /**
@@ -98,6 +150,11 @@ typedef struct receive_thread_config {
  * waiting, a new one is allocated. This should guarantee that
  * all allocation happen close to the startup of the application.
  * 
+ * Unless the pool is bounded (`pool_size`, see -q): every request
+ * is then allocated at startup and the receiver applies its policy
+ * (`pool_policy`, see -Q) when none is left: the datagrams are
+ * dropped or it waits for a handler to return one.
+ * 
  * Once a node has been popped from a stream it has to be
  * enqueued onto the return stream. If it cannot be it should be
  * deallocated to avoid memory leaks.
@@ -108,7 +165,150 @@ void *receive_thread(void *);
 /**
  * ## Use :
  * 
- * Essentially runs one loop of the receive thread. You'll have to
+ * Receives a batch of datagrams from the socket (`recvmmsg`),
+ * waits at most 1ms for the first one. With a spin budget (-B) it
+ * polls the socket without blocking for that long first.
+ * 
+ * ## Arguments :
+ *
+ * - `cfg`  - receiver configuration
+ * - `msgs` - messages for recvmmsg (`cfg->window_size` of them)
+ * 
+ * ## Return value:
+ * 
+ * the number of datagrams received, 0 if there were none
+ * or if it failed (the failure is counted and logged).
+ */
+int rx_receive(rx_cfg_t *cfg, struct mmsghdr *msgs);
+
+/**
+ * ## Use :
+ * 
+ * Batch size controller (-W min:max), called with the result of
+ * every `recvmmsg`. It keeps a moving average of the datagrams
+ * received per call: when the batches come back mostly full
+ * (3/4) the arrival rate is high and the batch is doubled, when
+ * they come back mostly empty (1/4) it is halved, at most once
+ * every `RX_ADAPT_PERIOD` calls and within [`batch_min`,
+ * `window_size`].
+ * 
+ * The timeout follows the batch between `RX_TIMEOUT_MIN_NS` and
+ * `RX_TIMEOUT_MAX_NS`: with MSG_WAITFORONE the kernel only checks
+ * it between two datagrams, so it bounds how long a batch is
+ * drained before the first datagram is handed over.
+ * 
+ * The current setting is exported in rx_batch & rx_timeout_us.
+ * 
+ * ## Arguments :
+ *
+ * - `cfg`    - receiver configuration
+ * - `retval` - the number of datagrams the last call returned
+ */
+void rx_adapt(rx_cfg_t *cfg, int retval);
+
+/**
+ * ## Use :
+ * 
+ * Gets the kernel receive time of a message (SO_TIMESTAMPNS).
+ * 
+ * ## Arguments :
+ *
+ * - `hdr` - the message
+ * 
+ * ## Return value:
+ * 
+ * the timestamp in nanoseconds (CLOCK_REALTIME), 0 if there is none
+ */
+static inline uint64_t rx_timestamp(struct msghdr *hdr) {
+    if (hdr->msg_control == NULL) {
+        return 0;
+    }
+
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec time;
+            memcpy(&time, CMSG_DATA(cmsg), sizeof(struct timespec));
+
+            return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * ## Use :
+ * 
+ * Groups the datagrams of a batch by client (address & port) using a
+ * small open addressing table: `heads` gets the first datagram of
+ * every client, by order of arrival, and `next` chains the datagrams
+ * of a client in order (-1 ends a chain).
+ * 
+ * ## Arguments :
+ *
+ * - `addrs`  - source address of the datagrams
+ * - `count`  - number of datagrams
+ * - `heads`  - receives the first datagram of each client (`count` of them)
+ * - `next`   - receives the chains (`count` of them)
+ * 
+ * ## Return value:
+ * 
+ * the number of clients in the batch
+ */
+int rx_group(struct sockaddr_in6 *addrs, int count, int *heads, int *next);
+
+/**
+ * ## Use :
+ * 
+ * Finds the client of an address, creating it if there's room
+ * (`max_clients`). Otherwise its datagrams are counted as refused.
+ * 
+ * ## Arguments :
+ *
+ * - `cfg`      - receiver configuration
+ * - `addr`     - the address of the client
+ * - `addr_len` - length of an IPv6 address
+ * - `count`    - number of datagrams from the client
+ * 
+ * ## Return value:
+ * 
+ * the client, NULL if its datagrams must be ignored
+ */
+client_t *rx_client(rx_cfg_t *cfg, struct sockaddr_in6 *addr, socklen_t addr_len, int count);
+
+/**
+ * ## Use :
+ * 
+ * Groups the datagrams of a batch by client, creates the new
+ * clients and enqueues the requests for the handlers.
+ * 
+ * It doesn't touch the socket: the batch may just as well come
+ * from `rx_receive` or from memory (see tools/replay.c).
+ * 
+ * ## Arguments :
+ *
+ * - `cfg`      - receiver configuration
+ * - `buffers`  - content of the datagrams
+ * - `addr_len` - length of an IPv6 address
+ * - `addrs`    - source address of the datagrams
+ * - `msgs`     - the messages (`msg_len`, `msg_flags` and `msg_control`)
+ * - `count`    - number of datagrams in the batch
+ */
+void rx_dispatch(
+    rx_cfg_t *cfg, 
+    uint8_t buffers[][MAX_PACKET_SIZE],
+    socklen_t addr_len,
+    struct sockaddr_in6 *addrs, 
+    struct mmsghdr *msgs,
+    int count
+);
+
+/**
+ * ## Use :
+ * 
+ * Essentially runs one loop of the receive thread (`rx_receive`
+ * followed by `rx_dispatch`). You'll have to
  * read the detailed description of receiver.h/handle_thread for all
  * the details.
  * 
@@ -120,6 +320,13 @@ void *receive_thread(void *);
  * - `addrs`    - addresses for recvmmsg (on the stack)
  * - `msgs`     - messages for recvmmsg (on the stack)
  * 
+ * ## Timestamps
+ * 
+ * If the messages have a `msg_control` buffer (of `RX_CONTROL_LEN`
+ * bytes) and the socket has SO_TIMESTAMPNS enabled, the kernel
+ * receive time of the first datagram of each request is stored
+ * in `hd_req_t.timestamp`.
+ * 
  */
 void rx_run_once(
     rx_cfg_t *cfg, 
@@ -129,6 +336,23 @@ void rx_run_once(
     struct mmsghdr *msgs
 );
 
+/**
+ * ## Use :
+ * 
+ * Opens and binds a socket on the address of the receiver
+ * (SO_REUSEPORT: one per stream and per worker process, the
+ * kernel spreads the clients between them by address).
+ * 
+ * ## Arguments :
+ *
+ * - `config` - the receiver configuration
+ *
+ * ## Return value:
+ *
+ * the socket, -1 if it failed (the failure is logged).
+ */
+int rx_socket(config_rcv_t *config);
+
 /**
  * ## Use :
  * 
@@ -0,0 +1,180 @@
+#ifndef REGISTRY_H
+
+#define REGISTRY_H
+
+#include "global.h"
+#include "stats.h"
+
+/** Required for mmap */
+#include <sys/mman.h>
+
+/** Seconds the address of a client lost in a crash stays refused */
+#define REG_ORPHAN_S 30
+
+/** The entry is free */
+#define REG_FREE 0
+
+/** The entry is being filled by its worker */
+#define REG_CLAIMING 1
+
+/** The entry belongs to a live client of its worker */
+#define REG_OWNED 2
+
+/** The worker of the client crashed */
+#define REG_ORPHAN 3
+
+/** State of an entry: the two low bits, the worker is above them */
+#define REG_STATE(state) ((state) & 3)
+
+/** Worker of an entry */
+#define REG_WORKER(state) ((state) >> 2)
+
+/**
+ * A client of one of the workers.
+ */
+typedef struct registry_entry {
+    /**
+     * `REG_FREE`, or the state and the worker (`REG_STATE` and
+     * `REG_WORKER`) so that both change with a single CAS.
+     */
+    uint32_t state;
+
+    /** The client ID (number) */
+    uint32_t id;
+
+    /** Client port (network order) */
+    uint16_t port;
+
+    /** Client IP */
+    uint8_t ip[16];
+
+    /** When the worker crashed (CLOCK_MONOTONIC, ns), if `REG_ORPHAN` */
+    uint64_t orphaned_ns;
+} reg_entry_t;
+
+/**
+ * Start of the registry, followed by `capacity` entries.
+ */
+typedef struct registry_header {
+    /** Next client ID */
+    uint32_t next_id;
+
+    /** Number of entries */
+    uint32_t capacity;
+} __attribute__((aligned(CACHE_LINE_SIZE))) reg_header_t;
+
+/**
+ * ## Use
+ *
+ * The clients of every worker process (-P, see workers.h).
+ *
+ * The registry is an anonymous shared mapping created before the
+ * workers are forked: they all see the same IDs (hence the same
+ * output files) and the same `capacity` (-m) whichever of them
+ * the kernel gives a client to. The supervisor frees the entries
+ * of a worker that exited and marks those of one that crashed as
+ * orphans: their transfers are lost (the windows and files were
+ * in the worker) so their datagrams are refused for `REG_ORPHAN_S`
+ * seconds rather than written in a new file from the middle.
+ *
+ * The entries are only written with atomics, a worker that dies
+ * while holding one can't block the others. Looking for a client
+ * is a linear scan, it only happens when a new client is seen.
+ * Two workers never claim the same address at once: SO_REUSEPORT
+ * gives all the datagrams of an address to the same socket.
+ *
+ * It is also used without -P, as the counter of the IDs.
+ */
+typedef struct registry {
+    /** Size of the mapping */
+    size_t size;
+
+    /** Start of the mapping */
+    reg_header_t *header;
+
+    /** Entries */
+    reg_entry_t *entries;
+} reg_t;
+
+/**
+ * ## Use
+ *
+ * Creates (and maps) a registry, shared with the processes
+ * forked afterwards.
+ *
+ * ## Arguments
+ *
+ * - `registry` - a pointer to an already allocated registry
+ * - `capacity` - the maximum number of clients
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int create_registry(reg_t *registry, size_t capacity);
+
+/**
+ * ## Use
+ *
+ * Unmaps a registry (in this process only).
+ *
+ * ## Arguments
+ *
+ * - `registry` - the registry, may have failed to be created
+ */
+void close_registry(reg_t *registry);
+
+/**
+ * ## Use
+ *
+ * Registers a new client of `worker` and gives it an ID.
+ *
+ * ## Arguments
+ *
+ * - `registry` - the registry
+ * - `worker`   - the worker (0 without -P)
+ * - `addr`     - the address of the client
+ * - `id`       - where to write the ID
+ *
+ * ## Return value
+ *
+ * The entry of the client (for `reg_release`), -1 otherwise
+ * with errno set to:
+ * - REGISTRY_FULL if every entry is used
+ * - REGISTRY_ORPHAN if the address belongs to a crashed worker
+ *   (or, if the sockets changed, to another one)
+ */
+int reg_claim(reg_t *registry, uint32_t worker, struct sockaddr_in6 *addr, uint32_t *id);
+
+/**
+ * ## Use
+ *
+ * Frees the entry of a client that was removed.
+ *
+ * ## Arguments
+ *
+ * - `registry` - the registry
+ * - `entry`    - the entry returned by `reg_claim`, ignored if < 0
+ */
+void reg_release(reg_t *registry, int entry);
+
+/**
+ * ## Use
+ *
+ * Frees (`orphan` = false) or marks as orphans (`orphan` = true)
+ * the entries of a worker that is gone.
+ *
+ * ## Arguments
+ *
+ * - `registry` - the registry
+ * - `worker`   - the worker
+ * - `orphan`   - true if the worker crashed
+ *
+ * ## Return value
+ *
+ * The number of entries of the worker.
+ */
+size_t reg_release_worker(reg_t *registry, uint32_t worker, bool orphan);
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef SEQUENTIAL_H
+
+#define SEQUENTIAL_H
+
+#include "global.h"
+#include "receiver.h"
+#include "handler.h"
+#include "stats.h"
+#include "shm.h"
+#include "logger.h"
+#include "ack_batch.h"
+
+/** Period of the housekeeping (statistics, SIGUSR1, removal of the clients) in ms */
+#define SEQ_TICK_MS 100
+
+/** `recvmmsg` calls per readiness of the socket, at most, before the timer is looked at */
+#define SEQ_DRAIN_MAX 64
+
+/** Seconds a finished client is kept before being removed */
+#define SEQ_LINGER_S 30
+
+/**
+ * ## Use
+ *
+ * The sequential mode (-s): a single thread that receives, decodes,
+ * writes and acknowledges without any stream, lock or copy of the
+ * datagrams in between.
+ *
+ * It waits on an epoll instance for the socket and a timerfd. When
+ * the socket is readable, it is drained with non blocking `recvmmsg`
+ * calls and each batch is grouped by client (`rx_group`). The CRCs
+ * of the whole batch are computed at once (`hd_crcs`) and the
+ * datagrams are decoded where `recvmmsg` wrote them (`hd_decode`),
+ * then the window of the client is written (`hd_flush`).
+ *
+ * The receive buffers are reused by the next batch: the packets a
+ * batch leaves in a window (ahead of a missing one) have their
+ * payload moved to a request of the engine (`spills`), which they
+ * pin like in the threaded mode. It is the only copy besides the
+ * one into the output and it only happens on loss or reordering.
+ * When the pool is bounded (-q), the requests are taken from it and
+ * the packets that don't find one are dropped (hd_pin_drops).
+ *
+ * The timer (every `SEQ_TICK_MS`) publishes the statistics, dumps
+ * them on SIGUSR1 and removes the clients finished for
+ * `SEQ_LINGER_S` seconds.
+ */
+typedef struct sequential {
+    /** Receiver configuration: socket, clients, pool and RX counters */
+    rx_cfg_t *rx;
+
+    /** Handler configuration: window size and HD counters */
+    hd_cfg_t *hd;
+
+    /** epoll instance (socket & timer) */
+    int epfd;
+
+    /** Housekeeping timer */
+    int timerfd;
+
+    /** Datagrams per `recvmmsg` */
+    size_t batch;
+
+    /** Receive buffers, `batch` of everything */
+    uint8_t (*buffers)[MAX_PACKET_SIZE];
+    uint8_t (*controls)[RX_CONTROL_LEN];
+    struct sockaddr_in6 *addrs;
+    struct mmsghdr *msgs;
+    struct iovec *iovecs;
+
+    /** Requests holding the packets kept in the windows */
+    s_node_t **spills;
+
+    /** Number of requests in `spills` */
+    size_t spill_count;
+
+    /** Room in `spills` */
+    size_t spill_size;
+
+    /** Largest number of requests, 0 = unbounded */
+    size_t spill_max;
+
+    /** Where to start looking for a free request */
+    size_t spill_next;
+
+    /** Request being filled, NULL if none */
+    hd_req_t *spill;
+
+    /** The (N)ACKs */
+    ack_batch_t acks;
+
+    /** Scratch space for the payloads written */
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE];
+} seq_t;
+
+/**
+ * ## Use
+ *
+ * Initializes the engine. With a bounded pool, its requests are
+ * taken from the return stream of the receiver (`rx->rx`).
+ *
+ * ## Arguments
+ *
+ * - `seq` - the engine
+ * - `rx`  - the receiver configuration
+ * - `hd`  - the handler configuration
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int seq_init(seq_t *seq, rx_cfg_t *rx, hd_cfg_t *hd);
+
+/**
+ * ## Use
+ *
+ * Waits for the socket or the timer (at most `timeout_ms`, -1 =
+ * forever) and handles what is ready.
+ *
+ * ## Arguments
+ *
+ * - `seq`        - the engine
+ * - `timeout_ms` - `epoll_wait` timeout
+ *
+ * ## Return value
+ *
+ * - 1 if the timer expired (the caller does the housekeeping
+ *   that isn't the engine's, see `seq_run`)
+ * - 0 if only datagrams were handled, or nothing
+ * - -1 if `epoll_wait` failed, errno is set (EINTR for a signal)
+ */
+int seq_run_once(seq_t *seq, int timeout_ms);
+
+/**
+ * ## Use
+ *
+ * Runs the engine until `tick` returns true. `tick` is called on
+ * every expiry of the timer and whenever a signal interrupts the
+ * wait, it publishes what belongs to the caller.
+ *
+ * ## Arguments
+ *
+ * - `seq`  - the engine
+ * - `tick` - housekeeping of the caller, true = stop
+ */
+void seq_run(seq_t *seq, bool (*tick)());
+
+/**
+ * ## Use
+ *
+ * Removes the clients finished for `SEQ_LINGER_S` seconds.
+ *
+ * ## Arguments
+ *
+ * - `seq` - the engine
+ */
+void seq_reap(seq_t *seq);
+
+/**
+ * ## Use
+ *
+ * Frees the engine. Its requests go back to the return stream of
+ * the receiver, which must outlive the clients still pinning them.
+ *
+ * ## Arguments
+ *
+ * - `seq` - the engine
+ */
+void seq_destroy(seq_t *seq);
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef SHM_H
+
+#define SHM_H
+
+#include "global.h"
+#include "stats.h"
+#include "client.h"
+
+/** Required for shm_open */
+#include <sys/mman.h>
+
+/** Required for fstat */
+#include <sys/stat.h>
+
+/** Required for O_CREAT & co. */
+#include <fcntl.h>
+
+/** Magic number at the start of the segment ("TRTP") */
+#define SHM_MAGIC 0x54525450
+
+/** Layout version, must be bumped when a record changes */
+#define SHM_VERSION 1
+
+/** Maximum length of a counter name in the segment */
+#define SHM_NAME_LEN 24
+
+/** Default name of the segment */
+#define DEFAULT_SHM_NAME "/trtp"
+
+typedef enum shm_thread_kind {
+    SHM_RECEIVER = 0,
+    SHM_HANDLER = 1
+} shm_kind_t;
+
+/**
+ * Published counters of a single thread.
+ */
+typedef struct shm_thread {
+    /** Seqlock version, odd while being written */
+    uint32_t seq;
+
+    /** Receiver or handler */
+    uint32_t kind;
+
+    /** Thread ID */
+    uint32_t id;
+
+    /** Copy of the thread counters */
+    uint64_t counters[STAT_COUNT];
+} __attribute__((aligned(CACHE_LINE_SIZE))) shm_thread_t;
+
+/**
+ * Published state of a single client.
+ */
+typedef struct shm_client {
+    /** Seqlock version, odd while being written */
+    uint32_t seq;
+
+    /** Is the slot in use? */
+    uint32_t used;
+
+    /** Is the client actively exchanging data? */
+    uint32_t active;
+
+    /** The client ID (number) */
+    uint32_t id;
+
+    /** Client port (network order) */
+    uint16_t port;
+
+    /** Lowest sequence number of the window */
+    uint8_t window_low;
+
+    /** Number of packets waiting in the window */
+    uint8_t window_length;
+
+    /** The client's IP as a string */
+    char ip_as_string[INET6_ADDRSTRLEN];
+
+    /** Total bytes transferred */
+    uint64_t transferred;
+
+    /** Packets that were already received (retransmissions) */
+    uint64_t duplicates;
+
+    /** Average rate since the connection (bytes per second) */
+    uint64_t rate;
+
+    /** Time of connection (CLOCK_MONOTONIC, ns) */
+    uint64_t connected_ns;
+
+    /** Last time the window moved forward (CLOCK_MONOTONIC, ns) */
+    uint64_t progress_ns;
+} __attribute__((aligned(CACHE_LINE_SIZE))) shm_client_t;
+
+/**
+ * Start of the segment, followed by `thread_count` threads
+ * and `client_count` clients.
+ */
+typedef struct shm_header {
+    /** Always SHM_MAGIC */
+    uint32_t magic;
+
+    /** Always SHM_VERSION */
+    uint32_t version;
+
+    /** PID of the receiver */
+    uint32_t pid;
+
+    /** Number of thread records */
+    uint32_t thread_count;
+
+    /** Number of client records */
+    uint32_t client_count;
+
+    /** Number of counters per thread */
+    uint32_t stat_count;
+
+    /** Time at which the receiver started (CLOCK_MONOTONIC, ns) */
+    uint64_t start_ns;
+
+    /** Names of the counters */
+    char stat_names[STAT_COUNT][SHM_NAME_LEN];
+} __attribute__((aligned(CACHE_LINE_SIZE))) shm_header_t;
+
+/**
+ * /!\ READ THIS CAREFULLY IF YOU DON'T UNDERSTAND SEQLOCKS
+ *
+ * ## Problem
+ *
+ * We want an operator to be able to look at a loaded receiver
+ * from another process (see tools/trtpstat.c). Asking the receiver
+ * (like the statistics socket does) costs syscalls, and using
+ * a mutex shared between processes means the receiver could be
+ * slowed down (or blocked!) by the viewer.
+ *
+ * ## Solution
+ *
+ * The receiver writes its statistics into a shared memory segment
+ * (`shm_open`) and the viewer maps it read-only. Publishing is
+ * a handful of memory stores: no syscall on the data path.
+ *
+ * Each record is protected by a sequence lock (seqlock). There is
+ * always a single writer for a record (the handler holding the
+ * client lock, or the main thread for the thread records):
+ *
+ * - the writer increments `seq` (it becomes odd), writes the record
+ *   and increments `seq` again (it becomes even)
+ * - the reader reads `seq`, copies the record and reads `seq` again,
+ *   if it was odd or if it changed the copy is retried
+ *
+ * The writer never waits for the reader.
+ *
+ * ## Sources
+ *
+ * - [Seqlock](https://en.wikipedia.org/wiki/Seqlock)
+ * - [shm_open](https://man7.org/linux/man-pages/man3/shm_open.3.html)
+ */
+typedef struct shm_segment {
+    /** Name of the segment */
+    char *name;
+
+    /** Size of the mapping */
+    size_t size;
+
+    /** Start of the mapping */
+    shm_header_t *header;
+
+    /** Thread records */
+    shm_thread_t *threads;
+
+    /** Client records */
+    shm_client_t *clients;
+
+    /** true = created by this process (and should be unlinked) */
+    bool owner;
+} shm_seg_t;
+
+/**
+ * ## Use
+ *
+ * Creates (and maps) a new statistics segment.
+ *
+ * ## Arguments
+ *
+ * - `segment`      - a pointer to an already allocated segment
+ * - `name`         - the name of the segment (e.g `/trtp`)
+ * - `rx_num`       - the number of receivers
+ * - `hd_num`       - the number of handlers
+ * - `client_count` - the maximum number of clients
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int create_shm(shm_seg_t *segment, char *name, size_t rx_num, size_t hd_num, size_t client_count);
+
+/**
+ * ## Use
+ *
+ * Maps an existing segment read-only (used by the viewer).
+ *
+ * ## Arguments
+ *
+ * - `segment` - a pointer to an already allocated segment
+ * - `name`    - the name of the segment
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int open_shm(shm_seg_t *segment, char *name);
+
+/**
+ * ## Use
+ *
+ * Unmaps the segment, and unlinks it if it was created by this process.
+ *
+ * ## Arguments
+ *
+ * - `segment` - a pointer to a segment
+ */
+void close_shm(shm_seg_t *segment);
+
+/**
+ * ## Use
+ *
+ * Copies the counters of every thread into the segment.
+ *
+ * ## Arguments
+ *
+ * - `segment`  - a pointer to a created segment
+ * - `registry` - the registry to publish
+ */
+void shm_publish_threads(shm_seg_t *segment, stats_reg_t *registry);
+
+/**
+ * ## Use
+ *
+ * Reserves a client record, must be called with the client
+ * table lock held.
+ *
+ * ## Arguments
+ *
+ * - `segment` - a pointer to a created segment
+ * - `client`  - the new client
+ */
+void shm_attach_client(shm_seg_t *segment, client_t *client);
+
+/**
+ * ## Use
+ *
+ * Releases the record of a client.
+ *
+ * ## Arguments
+ *
+ * - `client` - the client being removed
+ */
+void shm_detach_client(client_t *client);
+
+/**
+ * ## Use
+ *
+ * Publishes the state of a client, must be called with the
+ * client lock held.
+ *
+ * ## Arguments
+ *
+ * - `client` - the client to publish
+ */
+void shm_publish_client(client_t *client);
+
+/**
+ * ## Use
+ *
+ * Copies a thread record without tearing.
+ *
+ * ## Arguments
+ *
+ * - `src` - the record in the segment
+ * - `dst` - the copy
+ */
+void shm_read_thread(shm_thread_t *src, shm_thread_t *dst);
+
+/**
+ * ## Use
+ *
+ * Copies a client record without tearing.
+ *
+ * ## Arguments
+ *
+ * - `src` - the record in the segment
+ * - `dst` - the copy
+ */
+void shm_read_client(shm_client_t *src, shm_client_t *dst);
+
+#endif
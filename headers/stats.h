@@ -0,0 +1,369 @@
+#ifndef STATS_H
+
+#define STATS_H
+
+#include "global.h"
+#include "stream.h"
+#include "histogram.h"
+#include "logger.h"
+
+/** Cache line size used to pad per-thread structures */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Every counter kept by the receivers and the handlers.
+ *
+ * New counters must be added before `STAT_COUNT` and given
+ * a name in `stat_names` (src/stats.c).
+ */
+typedef enum stat_counter {
+    /** Number of `recvmmsg` calls that returned at least one datagram */
+    STAT_RX_BATCHES = 0,
+
+    /** Number of datagrams received */
+    STAT_RX_PACKETS,
+
+    /** Number of bytes received */
+    STAT_RX_BYTES,
+
+    /** Datagrams dropped because they are longer than a packet */
+    STAT_RX_TRUNCATED,
+
+    /** Datagrams dropped because they are shorter than a header */
+    STAT_RX_UNDERSIZED,
+
+    /** Datagrams dropped because the maximum number of clients is reached */
+    STAT_RX_REFUSED,
+
+    /** Number of clients created */
+    STAT_RX_NEW_CLIENTS,
+
+    /** Number of requests sent to the handlers */
+    STAT_RX_REQUESTS,
+
+    /** Number of requests allocated because none were returned */
+    STAT_RX_ALLOCATIONS,
+
+    /** Number of failed `recvmmsg` calls */
+    STAT_RX_ERRORS,
+
+    /** Number of datagrams dropped because no request was available (see -Q) */
+    STAT_RX_POOL_DROPS,
+
+    /** Number of times a receiver waited for a request (-Q block) */
+    STAT_RX_POOL_WAITS,
+
+    /** Number of batches received while spinning (-B) */
+    STAT_RX_SPIN_HITS,
+
+    /** Number of times a receiver spun for its whole budget and slept in `recvmmsg` (-B) */
+    STAT_RX_SLEEPS,
+
+    /** Gauge: datagrams currently asked per `recvmmsg` (-W min:max) */
+    STAT_RX_BATCH,
+
+    /** Gauge: current `recvmmsg` timeout (us) */
+    STAT_RX_TIMEOUT_US,
+
+    /** Number of times the batch size was changed */
+    STAT_RX_BATCH_RESIZES,
+
+    /** Number of requests processed */
+    STAT_HD_REQUESTS,
+
+    /** Number of packets processed */
+    STAT_HD_PACKETS,
+
+    /** Packets with an invalid header CRC */
+    STAT_HD_CRC_HEADER,
+
+    /** Packets with an invalid payload CRC */
+    STAT_HD_CRC_PAYLOAD,
+
+    /** Packets with an invalid length (too short, too long, etc.) */
+    STAT_HD_BAD_LENGTH,
+
+    /** Packets with a wrong type or a truncated non-data packet */
+    STAT_HD_BAD_TYPE,
+
+    /** Packets that failed to decode for another reason */
+    STAT_HD_BAD_OTHER,
+
+    /** Packets already present in the window */
+    STAT_HD_DUPLICATES,
+
+    /** Packets outside of the window */
+    STAT_HD_OUT_OF_WINDOW,
+
+    /** Truncated packets (answered with a NACK) */
+    STAT_HD_TRUNCATED,
+
+    /** Packets received for a client that already completed */
+    STAT_HD_INACTIVE,
+
+    /** Number of ACK packets sent */
+    STAT_HD_ACKS,
+
+    /** Number of NACK packets sent */
+    STAT_HD_NACKS,
+
+    /** Number of failed (N)ACK sends */
+    STAT_HD_SEND_ERRORS,
+
+    /** Number of syscalls sending (N)ACKs, see ack_batch.h */
+    STAT_HD_ACK_SENDS,
+
+    /** Number of failed writes to an output file */
+    STAT_HD_WRITE_ERRORS,
+
+    /** Number of bytes written to the output files */
+    STAT_HD_BYTES_WRITTEN,
+
+    /** Number of transfers completed */
+    STAT_HD_COMPLETED,
+
+    /** Time spent processing requests (ns), see elastic.h */
+    STAT_HD_BUSY_NS,
+
+    /** Number of requests popped while spinning (-B) */
+    STAT_HD_SPIN_HITS,
+
+    /** Number of times a handler spun for its whole budget and slept on its stream (-B) */
+    STAT_HD_SLEEPS,
+
+    /** Number of (N)ACK batches a handler sent itself because the ring of its TX stage was full (-T) */
+    STAT_HD_TX_FULL,
+
+    /** Packets ahead of the window dropped because the pool ran low, see `hd_req_t` */
+    STAT_HD_PIN_DROPS,
+
+    /** Number of sendmmsg calls of a TX stage */
+    STAT_TX_SENDS,
+
+    /** Number of (N)ACKs sent by a TX stage */
+    STAT_TX_FRAMES,
+
+    /** Number of failed sendmmsg calls of a TX stage */
+    STAT_TX_ERRORS,
+
+    /** Number of counters, must always be last */
+    STAT_COUNT
+} stat_counter_t;
+
+/** Names of the counters, in the same order as `stat_counter_t` */
+extern const char *stat_names[STAT_COUNT];
+
+/**
+ * ## Use
+ *
+ * Per-thread counters. Every receiver and handler owns exactly one
+ * of these and is the only one writing to it.
+ *
+ * ## Why not atomics?
+ *
+ * A single writer means we don't need a `lock` prefixed
+ * read-modify-write (like `_faa`) which would cost us tens of cycles
+ * per increment at a million packets per second. Instead the owner
+ * does a relaxed load followed by a relaxed store, which compiles to
+ * a plain `add`, and readers use relaxed loads. Readers may see a
+ * slightly outdated value but never a torn one.
+ *
+ * ## Why aligned?
+ *
+ * Each thread's counters are aligned (and padded) on a cache line
+ * so that two threads never write to the same line (false sharing).
+ *
+ * ## Sources
+ *
+ * - [False sharing](https://en.wikipedia.org/wiki/False_sharing)
+ * - [Memory ordering](https://gcc.gnu.org/onlinedocs/gcc/_005f_005fatomic-Builtins.html)
+ */
+typedef struct stats {
+    uint64_t counters[STAT_COUNT];
+} __attribute__((aligned(CACHE_LINE_SIZE))) stats_t;
+
+/**
+ * Adds `value` to a counter, must only be called by the owner thread.
+ */
+#define STAT_ADD(stats, counter, value) do { \
+    uint64_t *__counter = &(stats)->counters[counter]; \
+    __atomic_store_n( \
+        __counter, \
+        __atomic_load_n(__counter, __ATOMIC_RELAXED) + (value), \
+        __ATOMIC_RELAXED \
+    ); \
+} while(0)
+
+/**
+ * Increments a counter, must only be called by the owner thread.
+ */
+#define STAT_INC(stats, counter) STAT_ADD(stats, counter, 1)
+
+/**
+ * Sets a gauge (a counter holding a current value rather than a
+ * running total), must only be called by the owner thread.
+ */
+#define STAT_SET(stats, counter, value) \
+    __atomic_store_n(&(stats)->counters[counter], (value), __ATOMIC_RELAXED)
+
+/**
+ * Reads a counter from any thread.
+ */
+#define STAT_GET(stats, counter) \
+    __atomic_load_n(&(stats)->counters[counter], __ATOMIC_RELAXED)
+
+/**
+ * Contains the counters of every thread as well as the streams
+ * used to report the queue depths.
+ */
+typedef struct stats_registry {
+    /** Number of receivers */
+    size_t rx_num;
+
+    /** Receiver counters (one per receiver) */
+    stats_t *rx;
+
+    /** Number of handlers */
+    size_t hd_num;
+
+    /** Handler counters (one per handler) */
+    stats_t *hd;
+
+    /** Handler latencies (`HIST_COUNT` per handler) */
+    hist_t *latency;
+
+    /** Number of TX stages (-T), 0 if disabled */
+    size_t tx_num;
+
+    /** TX stage counters (one per stage), NULL if disabled */
+    stats_t *tx;
+
+    /** Number of streams */
+    size_t stream_count;
+
+    /** Receive to Handle streams */
+    stream_t **rx_to_hd;
+
+    /** Handle to Receive streams */
+    stream_t **hd_to_rx;
+
+    /** Time at which the registry was created */
+    struct timespec start;
+} stats_reg_t;
+
+/**
+ * The statistics server, answers every connection on
+ * its Unix socket with a text snapshot of the registry.
+ */
+typedef struct stats_server {
+    /** Thread reference */
+    pthread_t thread;
+
+    /** The registry to expose */
+    stats_reg_t *registry;
+
+    /** Listening socket */
+    int sockfd;
+
+    /** Path of the Unix socket */
+    char *path;
+
+    /** true = the loop should stop */
+    volatile bool stop;
+} stats_srv_t;
+
+/**
+ * ## Use
+ *
+ * Allocates the (aligned) counters and histograms of every thread.
+ *
+ * ## Arguments
+ *
+ * - `registry` - a pointer to an already allocated registry
+ * - `rx_num`   - the number of receivers
+ * - `hd_num`   - the number of handlers
+ * - `tx_num`   - the number of TX stages, 0 if disabled
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int allocate_stats_registry(stats_reg_t *registry, size_t rx_num, size_t hd_num, size_t tx_num);
+
+/**
+ * ## Use
+ *
+ * Deallocates the counters and histograms of a registry.
+ *
+ * ## Arguments
+ *
+ * - `registry` - a pointer to an allocated registry
+ */
+void dealloc_stats_registry(stats_reg_t *registry);
+
+/**
+ * ## Use
+ *
+ * Increments the counter matching an unpack error.
+ *
+ * ## Arguments
+ *
+ * - `stats` - the counters of the calling thread
+ * - `error` - the errno set by `unpack`
+ */
+void stats_count_unpack_error(stats_t *stats, int error);
+
+/**
+ * ## Use
+ *
+ * Writes a text snapshot of the registry. Each line is
+ * formatted as `<scope>.<name> <value>`, where the scope
+ * is either `rx.<id>`, `hd.<id>`, `stream.<id>` or `total`.
+ *
+ * The latency histograms are summarized as
+ * `<scope>.<histogram>.<field> <value>` (see `hist_write_text`)
+ * and followed by the logger counters (see `logger_write_text`).
+ *
+ * ## Arguments
+ *
+ * - `registry` - a pointer to an allocated registry
+ * - `out`      - the output stream
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ */
+int stats_write_text(stats_reg_t *registry, FILE *out);
+
+/**
+ * ## Use
+ *
+ * Binds a Unix socket at `path` and starts the thread
+ * answering connections on it.
+ *
+ * ## Arguments
+ *
+ * - `server`   - a pointer to an already allocated server
+ * - `registry` - the registry to expose
+ * - `path`     - the path of the Unix socket
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int start_stats_server(stats_srv_t *server, stats_reg_t *registry, char *path);
+
+/**
+ * ## Use
+ *
+ * Stops the statistics thread and removes the socket.
+ *
+ * ## Arguments
+ *
+ * - `server` - a pointer to a started server
+ */
+void stop_stats_server(stats_srv_t *server);
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef STREAM_H
 
 #include "global.h"
+#include "arena.h"
 
 #define STREAM_H
 
@@ -121,6 +122,20 @@ typedef struct stream {
     __sync_fetch_and_sub(ptr, dec)
 #endif
 
+/**
+ * Tells the CPU we're in a spin loop (`pause` on x86), lets the
+ * sibling hyperthread run and saves power while busy-polling.
+ */
+#ifndef _pause
+#if defined(__x86_64__) || defined(__i386__)
+#define _pause() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define _pause() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define _pause() __asm__ __volatile__("" ::: "memory")
+#endif
+#endif
+
 /**
  * ## Use
  *
@@ -214,4 +229,24 @@ bool stream_enqueue(stream_t *stream, s_node_t *node);
  */
 s_node_t *stream_pop(stream_t *stream, bool wait);
 
+/**
+ * ## Use
+ *
+ * Pops a node from the stream, spinning on its length for up to
+ * `spin_ns` nanoseconds before sleeping like `stream_pop(stream, true)`.
+ * Used by the latency mode (-B): the wakeup of a sleeping thread costs
+ * tens of microseconds, spinning costs a core.
+ * 
+ * ## Arguments
+ *
+ * - `stream`  - a pointer to an already allocated stream
+ * - `spin_ns` - the spin budget, 0 sleeps right away
+ * - `slept`   - set to true if the budget ran out and the thread slept
+ *
+ * ## Return value
+ * 
+ * A node, or NULL if another thread took the node seen while spinning.
+ */
+s_node_t *stream_pop_spin(stream_t *stream, uint64_t spin_ns, bool *slept);
+
 #endif
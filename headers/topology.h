@@ -0,0 +1,199 @@
+#ifndef TOPOLOGY_H
+
+#define TOPOLOGY_H
+
+#include "global.h"
+#include "cli.h"
+
+/** Highest CPU number supported (same as CPU_SETSIZE) */
+#define TOPO_MAX_CPUS 1024
+
+/** Highest NUMA node supported (same as the kernel's MAX_NUMNODES) */
+#define TOPO_MAX_NODES 1024
+
+/** mbind(2) constants, see linux/mempolicy.h */
+#define TOPO_MPOL_PREFERRED 1
+#define TOPO_MPOL_MF_MOVE (1 << 1)
+
+/**
+ * A logical CPU, as seen in /sys/devices/system/cpu/cpuN.
+ *
+ * Cores, L3 domains and nodes are identified by their lowest
+ * CPU so that they are unique across packages.
+ */
+typedef struct topo_cpu {
+    /** CPU number */
+    size_t cpu;
+
+    /** Physical core (lowest of the SMT siblings) */
+    size_t core;
+
+    /** Physical package (socket) */
+    size_t package;
+
+    /** NUMA node, 0 when the kernel has no NUMA */
+    size_t node;
+
+    /** L3 domain (lowest CPU sharing the L3), `package` when there's no L3 */
+    size_t l3;
+
+    /** Handles an interrupt of the NIC */
+    bool irq;
+
+    /** One of the SMT siblings handles an interrupt of the NIC */
+    bool irq_core;
+
+    /** Shares its L3 with a CPU handling an interrupt of the NIC */
+    bool irq_l3;
+} topo_cpu_t;
+
+/**
+ * The online CPUs of the host.
+ */
+typedef struct topology {
+    /** Number of online CPUs */
+    size_t count;
+
+    /** The online CPUs, by increasing number */
+    topo_cpu_t *cpus;
+
+    /** Number of CPUs handling an interrupt of the NIC */
+    size_t irq_count;
+} topo_t;
+
+/**
+ * ## Use
+ *
+ * Reads the topology of the online CPUs: SMT siblings,
+ * packages, L3 domains and NUMA nodes.
+ *
+ * ## Arguments
+ *
+ * - `topo` - the topology to fill
+ * - `root` - prefix of /sys, "" on a real host
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int topology_discover(topo_t *topo, const char *root);
+
+/**
+ * ## Use
+ *
+ * Frees a topology.
+ *
+ * ## Arguments
+ *
+ * - `topo` - the topology
+ */
+void topology_free(topo_t *topo);
+
+/**
+ * ## Use
+ *
+ * Marks the CPUs handling the interrupts of a network interface,
+ * using its MSI vectors (/sys/class/net/<if>/device/msi_irqs) and
+ * their affinity (/proc/irq/<n>/effective_affinity_list).
+ *
+ * ## Arguments
+ *
+ * - `topo`   - a discovered topology
+ * - `root`   - prefix of /sys and /proc, "" on a real host
+ * - `ifname` - the interface, NULL = every interface backed by a device
+ *
+ * ## Return value
+ *
+ * the number of CPUs marked (0 for virtual interfaces like lo).
+ */
+size_t topology_mark_irqs(topo_t *topo, const char *root, const char *ifname);
+
+/**
+ * ## Use
+ *
+ * Places the threads on the CPUs:
+ * - the receivers on the cores handling the interrupts of the NIC
+ *   (their SMT sibling first), then in the same L3 domain
+ * - the handlers on the other physical cores sharing the L3 of
+ *   a receiver of their stream, then on the SMT siblings of that
+ *   L3, then on the same node
+ * Every CPU gets a thread before any gets a second one.
+ *
+ * ## Arguments
+ *
+ * - `topo`   - a discovered topology
+ * - `config` - the configuration, its streams must be set. Its
+ *              affinities are allocated and filled.
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int topology_place(topo_t *topo, config_rcv_t *config);
+
+/**
+ * ## Use
+ *
+ * Finds the NUMA node of every stream: the node of the CPU of its
+ * first pinned receiver (or handler). The memory owned by a stream
+ * (its requests) is then bound to that node, see `topology_bind`.
+ *
+ * Nothing is done on hosts with a single node or if no thread is
+ * pinned: `config->stream_nodes` stays NULL.
+ *
+ * ## Arguments
+ *
+ * - `config` - the configuration, its streams & affinities must be set
+ * - `root`   - prefix of /sys, "" on a real host
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int topology_stream_nodes(config_rcv_t *config, const char *root);
+
+/**
+ * ## Use
+ *
+ * Sets the preferred NUMA node of a memory range (mbind with
+ * MPOL_PREFERRED, without libnuma). The pages already faulted
+ * are moved, the others are allocated there on the first touch.
+ * Allocations never fail because the node is full.
+ *
+ * ## Arguments
+ *
+ * - `addr` - start of the range, only the whole pages inside
+ *            the range are bound
+ * - `len`  - length of the range
+ * - `node` - the node
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int topology_bind(void *addr, size_t len, size_t node);
+
+/**
+ * ## Use
+ *
+ * Discovers the topology of the host, finds the interface the
+ * receiver is bound to, places the threads and prints the plan
+ * on stderr (-A auto).
+ *
+ * ## Arguments
+ *
+ * - `config` - the configuration, its streams must be set
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise, the
+ * threads are then not pinned.
+ * If it failed, errno is set to an appropriate error.
+ */
+int topology_plan(config_rcv_t *config);
+
+#endif
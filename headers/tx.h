@@ -0,0 +1,197 @@
+#ifndef TX_H
+
+#define TX_H
+
+#include "global.h"
+#include "stats.h"
+#include "logger.h"
+#include "ack_batch.h"
+
+/** Number of batches a TX stage can hold (a power of two) */
+#define TX_RING_SIZE 256
+
+/** Largest number of batches sent by one `sendmmsg` */
+#define TX_SEND_MAX 16
+
+/** Sleep of an idle TX stage when the deadline is shorter (ns) */
+#define TX_IDLE_NS 20000
+
+/**
+ * A batch of (N)ACKs handed over to a TX stage, see `ack_batch_t`.
+ *
+ * `sequence` is the lap at which the slot can be written
+ * (`sequence == position`) or read (`sequence == position + 1`).
+ */
+typedef struct tx_slot {
+    /** Position of the slot in the ring, see above */
+    uint64_t sequence;
+
+    /** When the batch was pushed (ns, CLOCK_MONOTONIC) */
+    uint64_t queued;
+
+    /** Number of frames */
+    size_t count;
+
+    /** Destination of the frames */
+    struct sockaddr_in6 destination;
+
+    /** Frames, `ACK_FRAME_SIZE` bytes each */
+    uint8_t frames[ACK_BATCH_MAX * ACK_FRAME_SIZE];
+} __attribute__((aligned(CACHE_LINE_SIZE))) tx_slot_t;
+
+/**
+ * ## Use
+ *
+ * A transmit stage (-T us): a thread per stream that sends the
+ * (N)ACKs of every handler of the stream so that the handlers
+ * never do a syscall to send.
+ *
+ * The handlers push their batches in a bounded lock-free ring
+ * (multiple producers, one consumer). The TX thread collects
+ * them and sends up to `TX_SEND_MAX` batches, one GSO datagram
+ * each, in a single `sendmmsg` as soon as it has that many or the
+ * deadline of the oldest batch it holds has passed. A deadline of
+ * 0 sends whatever is in the ring each time the thread wakes up.
+ *
+ * When the ring is full, the handler sends its batch itself (it
+ * is counted in hd_tx_full), so a slow TX thread never blocks
+ * the handlers.
+ *
+ * ## Cost
+ *
+ * One more thread per stream that polls the ring every deadline
+ * (at least every `TX_IDLE_NS`) when it is idle.
+ *
+ * ## Source
+ *
+ * - [Bounded MPMC queue](https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue)
+ */
+typedef struct tx_stage {
+    /** Identifier, used in the thread name */
+    size_t id;
+
+    /** Socket to send on */
+    int sockfd;
+
+    /** Use UDP_SEGMENT? */
+    bool gso;
+
+    /** Deadline of a batch in the ring (ns) */
+    uint64_t deadline_ns;
+
+    /** The ring, `TX_RING_SIZE` slots */
+    tx_slot_t *slots;
+
+    /** Next position to write (producers) */
+    uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /** Next position to read (TX thread only) */
+    uint64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /** Counters of the stage (tx_sends, tx_frames, ...) */
+    stats_t *stats;
+
+    /** Thread reference, NULL if not started */
+    pthread_t *thread;
+
+    /** true = the thread should send what's left and stop */
+    volatile bool stop;
+} tx_stage_t;
+
+/**
+ * ## Use
+ *
+ * Initializes a stage and its ring, the thread isn't started.
+ *
+ * ## Arguments
+ *
+ * - `tx`          - the stage
+ * - `id`          - its identifier
+ * - `sockfd`      - the socket to send on
+ * - `deadline_us` - the deadline of a batch (us)
+ * - `stats`       - counters of the stage
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int tx_init(tx_stage_t *tx, size_t id, int sockfd, size_t deadline_us, stats_t *stats);
+
+/**
+ * ## Use
+ *
+ * Hands a batch over to the stage, called by the handlers.
+ *
+ * ## Arguments
+ *
+ * - `tx`          - the stage
+ * - `destination` - destination of the frames
+ * - `frames`      - the frames, `ACK_FRAME_SIZE` bytes each
+ * - `count`       - number of frames (at most `ACK_BATCH_MAX`)
+ *
+ * ## Return value
+ *
+ * 0 if the batch is queued, -1 if the ring is full (errno is
+ * set to TX_FULL).
+ */
+int tx_push(tx_stage_t *tx, struct sockaddr_in6 *destination, uint8_t *frames, size_t count);
+
+/**
+ * ## Use
+ *
+ * Sends up to `TX_SEND_MAX` batches of the ring in one `sendmmsg`.
+ * Called by the TX thread only.
+ *
+ * ## Arguments
+ *
+ * - `tx`    - the stage
+ * - `force` - send even if there are less than `TX_SEND_MAX` batches
+ *             and the oldest one is before its deadline
+ *
+ * ## Return value
+ *
+ * the number of batches taken out of the ring.
+ */
+size_t tx_run_once(tx_stage_t *tx, bool force);
+
+/**
+ * ## Use
+ *
+ * Starts the TX thread.
+ *
+ * ## Arguments
+ *
+ * - `tx` - the stage
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int tx_start(tx_stage_t *tx);
+
+/**
+ * ## Use
+ *
+ * Stops the TX thread once it has sent every batch of the ring,
+ * the handlers must have stopped first.
+ *
+ * ## Arguments
+ *
+ * - `tx` - the stage
+ */
+void tx_stop(tx_stage_t *tx);
+
+/**
+ * ## Use
+ *
+ * Frees the ring of a stopped stage.
+ *
+ * ## Arguments
+ *
+ * - `tx` - the stage
+ */
+void tx_destroy(tx_stage_t *tx);
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef WORKERS_H
+
+#define WORKERS_H
+
+#include "global.h"
+#include "cli.h"
+#include "receiver.h"
+#include "registry.h"
+
+/** Least time between two starts of the same worker (ms) */
+#define WORKERS_RESPAWN_MS 1000
+
+/** Period at which the supervisor looks at its workers (ms) */
+#define WORKERS_POLL_MS 100
+
+/** The worker is waiting to be (re)started */
+#define WORKER_WAITING 0
+
+/** The worker exited and won't be restarted */
+#define WORKER_DONE -1
+
+/**
+ * ## Use
+ *
+ * The worker processes (-P): the supervisor (the process started
+ * by the user) forks `count` workers which each run a whole
+ * receiver (threads, streams, pool, arenas, -s) on their own
+ * SO_REUSEPORT sockets. The kernel spreads the clients between
+ * the sockets by address, the workers share nothing but the client
+ * registry (IDs and -m, see registry.h): no allocator, stdio or
+ * lock is contended between them and each can be put in its own
+ * cgroup (cpuset, memory).
+ *
+ * The supervisor opens the sockets of every worker before forking
+ * and keeps them open: a worker that dies doesn't change the
+ * SO_REUSEPORT group (which would move the clients of the others)
+ * and the datagrams of its clients wait in its socket until it is
+ * restarted. Only a worker killed by a signal (a crash or the OOM
+ * killer) is restarted, at most once per `WORKERS_RESPAWN_MS`: the
+ * others keep going and only its transfers are lost. A worker that
+ * exits with an error would fail again and is not restarted.
+ *
+ * SIGINT and SIGUSR1 are forwarded to the workers, which are in
+ * their own process group so that Ctrl-C reaches them once, and
+ * which stop if the supervisor dies (PR_SET_PDEATHSIG).
+ */
+typedef struct workers {
+    /** Number of workers */
+    size_t count;
+
+    /** Sockets per worker (one per stream) */
+    size_t stream_count;
+
+    /** Sockets, `stream_count` per worker, -1 once closed */
+    int *sockfds;
+
+    /** Process of each worker, `WORKER_WAITING` or `WORKER_DONE` */
+    pid_t *pids;
+
+    /** Last start of each worker (CLOCK_MONOTONIC, ns) */
+    uint64_t *started_ns;
+
+    /** Number of times each worker was restarted */
+    size_t *restarts;
+
+    /** Workers that crashed or exited with an error */
+    size_t failures;
+
+    /** The configuration, the names of the statistics are made per worker */
+    config_rcv_t *config;
+
+    /** The client registry, created by the caller before the workers */
+    reg_t *registry;
+
+    /** Statistics segment of this worker (-M) */
+    char shm_name[NAME_MAX];
+
+    /** Statistics socket of this worker (-S) */
+    char stats_path[sizeof(((struct sockaddr_un *) NULL)->sun_path)];
+} workers_t;
+
+/**
+ * ## Use
+ *
+ * Opens the sockets of `config->workers` workers.
+ *
+ * ## Arguments
+ *
+ * - `workers`  - the workers
+ * - `config`   - the configuration (`workers` and `stream_count`)
+ * - `registry` - the client registry
+ *
+ * ## Return value
+ *
+ * 0 if the process completed successfully. -1 otherwise.
+ * If it failed, errno is set to an appropriate error.
+ */
+int workers_init(workers_t *workers, config_rcv_t *config, reg_t *registry);
+
+/**
+ * ## Use
+ *
+ * Starts the workers and supervises them, see `workers_t`.
+ *
+ * It returns in every worker (forked from here, including the
+ * restarted ones) with `config->shm_name` and `config->stats_path`
+ * suffixed with the worker (e.g `/trtp.1`). The worker then uses
+ * its sockets, `stream_count` from `sockfds[worker * stream_count]`
+ * and calls `workers_destroy`.
+ *
+ * ## Arguments
+ *
+ * - `workers` - the workers
+ *
+ * ## Return value
+ *
+ * - the worker (>= 0) in a worker process
+ * - -1 in the supervisor, once every worker is done
+ */
+int workers_run(workers_t *workers);
+
+/**
+ * ## Use
+ *
+ * Closes the sockets that are still open and frees the workers
+ * (not the registry).
+ *
+ * ## Arguments
+ *
+ * - `workers` - the workers
+ */
+void workers_destroy(workers_t *workers);
+
+#endif
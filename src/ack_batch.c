@@ -0,0 +1,181 @@
+#define _GNU_SOURCE
+#include "../headers/tx.h"
+
+/*
+ * Refer to headers/ack_batch.h
+ */
+void ack_batch_init(ack_batch_t *acks, int sockfd, stats_t *stats, hist_t *latency) {
+    acks->sockfd = sockfd;
+    acks->gso = true;
+    memset(&acks->destination, 0, sizeof(struct sockaddr_in6));
+    acks->count = 0;
+    acks->committed = 0;
+    acks->timestamp_count = 0;
+    acks->stats = stats;
+    acks->latency = latency;
+    acks->tx = NULL;
+}
+
+/*
+ * Refer to headers/ack_batch.h
+ */
+uint8_t *ack_batch_reserve(ack_batch_t *acks, struct sockaddr_in6 *destination) {
+    if (acks->count > 0 && (
+        acks->count == ACK_BATCH_MAX ||
+        memcmp(&acks->destination, destination, sizeof(struct sockaddr_in6))
+    )) {
+        ack_batch_flush(acks);
+    }
+
+    if (acks->count == 0) {
+        memcpy(&acks->destination, destination, sizeof(struct sockaddr_in6));
+    }
+
+    return &acks->frames[acks->count * ACK_FRAME_SIZE];
+}
+
+/*
+ * Refer to headers/ack_batch.h
+ */
+void ack_batch_commit(ack_batch_t *acks) {
+    acks->count++;
+    acks->committed++;
+}
+
+/*
+ * Refer to headers/ack_batch.h
+ */
+void ack_batch_stamp(ack_batch_t *acks, uint64_t timestamp) {
+    if (timestamp != 0 && acks->latency != NULL && acks->timestamp_count < ACK_BATCH_MAX) {
+        acks->timestamps[acks->timestamp_count++] = timestamp;
+    }
+}
+
+/**
+ * Sends the whole batch in one datagram cut in `ACK_FRAME_SIZE`
+ * segments by the kernel. Returns the number of frames sent or -1.
+ */
+static int ack_batch_send_gso(ack_batch_t *acks) {
+    struct iovec iov = {
+        .iov_base = acks->frames,
+        .iov_len = acks->count * ACK_FRAME_SIZE
+    };
+
+    uint8_t control[CMSG_SPACE(sizeof(uint16_t))];
+    memset(control, 0, sizeof(control));
+
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(struct msghdr));
+    hdr.msg_name = &acks->destination;
+    hdr.msg_namelen = sizeof(struct sockaddr_in6);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+    uint16_t segment = ACK_FRAME_SIZE;
+    memcpy(CMSG_DATA(cmsg), &segment, sizeof(uint16_t));
+
+    if (sendmsg(acks->sockfd, &hdr, 0) == -1) {
+        return -1;
+    }
+
+    return acks->count;
+}
+
+/**
+ * Sends the frames one datagram each. Returns the number
+ * of frames sent or -1.
+ */
+static int ack_batch_send_each(ack_batch_t *acks) {
+    struct mmsghdr msgs[ACK_BATCH_MAX];
+    struct iovec iovecs[ACK_BATCH_MAX];
+
+    size_t i;
+    for (i = 0; i < acks->count; i++) {
+        iovecs[i].iov_base = &acks->frames[i * ACK_FRAME_SIZE];
+        iovecs[i].iov_len = ACK_FRAME_SIZE;
+
+        memset(&msgs[i], 0, sizeof(struct mmsghdr));
+        msgs[i].msg_hdr.msg_name = &acks->destination;
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    return sendmmsg(acks->sockfd, msgs, acks->count, 0);
+}
+
+/*
+ * Refer to headers/ack_batch.h
+ */
+int ack_batch_flush(ack_batch_t *acks) {
+    if (acks->count == 0) {
+        acks->timestamp_count = 0;
+        return 0;
+    }
+
+    stats_t *stats = acks->stats;
+
+    int retval = -1;
+    bool queued = false;
+    if (acks->tx != NULL) {
+        queued = tx_push(acks->tx, &acks->destination, acks->frames, acks->count) == 0;
+
+        if (queued) {
+            retval = acks->count;
+        } else {
+            /** A slow TX stage must not block the handler: sends it here */
+            STAT_INC(stats, STAT_HD_TX_FULL);
+        }
+    }
+
+    if (!queued && acks->gso && acks->count > 1) {
+        retval = ack_batch_send_gso(acks);
+        STAT_INC(stats, STAT_HD_ACK_SENDS);
+
+        /** No GSO on this kernel, socket or route: never again */
+        if (retval == -1 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)) {
+            log_event(LOG_HD_GSO_DISABLED, errno, 0, 0);
+            acks->gso = false;
+        }
+    }
+
+    if (retval == -1 && (!acks->gso || acks->count == 1)) {
+        retval = ack_batch_send_each(acks);
+        STAT_INC(stats, STAT_HD_ACK_SENDS);
+    }
+
+    int result = 0;
+    if (retval == -1) {
+        STAT_INC(stats, STAT_HD_SEND_ERRORS);
+        log_event(LOG_HD_SEND_FAILED, acks->sockfd, acks->count, errno);
+        result = -1;
+    } else {
+        int nacks = 0;
+        int i;
+        for (i = 0; i < retval; i++) {
+            nacks += (acks->frames[i * ACK_FRAME_SIZE] >> 6) == NACK;
+        }
+
+        STAT_ADD(stats, STAT_HD_ACKS, retval - nacks);
+        STAT_ADD(stats, STAT_HD_NACKS, nacks);
+
+        if (retval > 0) {
+            size_t j;
+            for (j = 0; j < acks->timestamp_count; j++) {
+                hist_record(&acks->latency[HIST_RX_TO_ACK], hist_elapsed(acks->timestamps[j]));
+            }
+        }
+    }
+
+    acks->count = 0;
+    acks->timestamp_count = 0;
+
+    return result;
+}
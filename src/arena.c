@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include "../headers/arena.h"
+#include "../headers/handler.h"
+#include "../headers/buffer.h"
+
+/** Names of the backings, in the same order as `arena_backing_t` */
+const char *arena_backing_names[] = {
+    "malloc",
+    "normal pages",
+    "transparent huge pages",
+    "huge pages"
+};
+
+/** Names of the arenas, in the same order as `arena_kind_t` */
+const char *arena_names[ARENA_COUNT] = {
+    "requests",
+    "windows",
+    "views"
+};
+
+arena_t arenas[ARENA_COUNT];
+
+/**
+ * Maps `size` bytes aligned on a huge page, so that transparent
+ * huge pages can back the whole mapping.
+ */
+static void *map_aligned(size_t size) {
+    size_t padded = size + ARENA_HUGE_PAGE_SIZE;
+
+    uint8_t *map = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    uint8_t *aligned = (uint8_t *) (((uintptr_t) map + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1));
+
+    if (aligned > map) {
+        munmap(map, aligned - map);
+    }
+
+    if (aligned + size < map + padded) {
+        munmap(aligned + size, (map + padded) - (aligned + size));
+    }
+
+    return aligned;
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+int arena_init(arena_t *arena, size_t object_size, size_t capacity, bool prefault) {
+    memset(arena, 0, sizeof(arena_t));
+
+    if (object_size == 0 || capacity == 0) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    arena->object_size = (object_size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    arena->capacity = capacity;
+    arena->size = (arena->object_size * capacity + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1);
+
+    void *map = mmap(
+        NULL,
+        arena->size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+        -1,
+        0
+    );
+
+    if (map != MAP_FAILED) {
+        arena->backing = ARENA_HUGETLB;
+    } else {
+        map = map_aligned(arena->size);
+        if (map == NULL) {
+            errno = FAILED_TO_ALLOCATE;
+            return -1;
+        }
+
+        arena->backing = madvise(map, arena->size, MADV_HUGEPAGE) ? ARENA_NORMAL : ARENA_THP;
+    }
+
+    if (pthread_mutex_init(&arena->lock, NULL)) {
+        munmap(map, arena->size);
+        arena->backing = ARENA_MALLOC;
+        errno = FAILED_TO_INIT_MUTEX;
+        return -1;
+    }
+
+    arena->base = map;
+
+    if (prefault) {
+        size_t offset;
+        for (offset = 0; offset < arena->size; offset += ARENA_PAGE_SIZE) {
+            arena->base[offset] = 0;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+void arena_destroy(arena_t *arena) {
+    if (arena->backing == ARENA_MALLOC) {
+        return;
+    }
+
+    munmap(arena->base, arena->size);
+    pthread_mutex_destroy(&arena->lock);
+
+    memset(arena, 0, sizeof(arena_t));
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+void *arena_alloc(arena_t *arena) {
+    void *object = NULL;
+
+    pthread_mutex_lock(&arena->lock);
+
+    if (arena->free_list != NULL) {
+        object = arena->free_list;
+        arena->free_list = *(void **) object;
+    } else if (arena->bumped < arena->capacity) {
+        object = arena->base + arena->bumped++ * arena->object_size;
+    }
+
+    if (object != NULL) {
+        arena->in_use++;
+    }
+
+    pthread_mutex_unlock(&arena->lock);
+
+    if (object == NULL) {
+        errno = FAILED_TO_ALLOCATE;
+    }
+
+    return object;
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+void arena_free(arena_t *arena, void *object) {
+    pthread_mutex_lock(&arena->lock);
+
+    *(void **) object = arena->free_list;
+    arena->free_list = object;
+    arena->in_use--;
+
+    pthread_mutex_unlock(&arena->lock);
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+int arenas_init(size_t max_clients, size_t requests, bool prefault) {
+    size_t sizes[ARENA_COUNT] = { sizeof(hd_req_t), sizeof(buf_t), sizeof(pkt_view_t) };
+    size_t capacities[ARENA_COUNT] = { requests, max_clients, max_clients * MAX_BUFFER_SIZE };
+
+    size_t i;
+    for (i = 0; i < ARENA_COUNT; i++) {
+        if (arena_init(&arenas[i], sizes[i], MAX(capacities[i], 1), prefault)) {
+            arenas_destroy();
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+void arenas_destroy() {
+    size_t i;
+    for (i = 0; i < ARENA_COUNT; i++) {
+        arena_destroy(&arenas[i]);
+    }
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+void *arena_get(arena_kind_t kind, size_t size) {
+    if (arenas[kind].backing != ARENA_MALLOC) {
+        void *object = arena_alloc(&arenas[kind]);
+        if (object != NULL) {
+            return object;
+        }
+    }
+
+    /** Not reserved or full */
+    void *object = malloc(size);
+    if (object == NULL) {
+        errno = FAILED_TO_ALLOCATE;
+    }
+
+    return object;
+}
+
+/*
+ * Refer to headers/arena.h
+ */
+void arena_put(void *object) {
+    if (object == NULL) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < ARENA_COUNT; i++) {
+        if (arenas[i].backing != ARENA_MALLOC && arena_contains(&arenas[i], object)) {
+            arena_free(&arenas[i], object);
+            return;
+        }
+    }
+
+    free(object);
+}
@@ -134,10 +134,8 @@ void deallocate_buffer(buf_t *buffer) {
     int i = 0;
     for (; i < MAX_BUFFER_SIZE; i++) {
 
-        if (buffer->nodes[i].value != NULL) {
-            free(buffer->nodes[i].value);
-        }
+        arena_put(buffer->nodes[i].value);
     }
 
-    free(buffer);
+    arena_put(buffer);
 }
@@ -1,5 +1,46 @@
 #include "../headers/cli.h"
 
+/** Names of the policies (-Q), in the same order as `pool_policy_t` */
+const char *pool_policy_names[] = {
+    "drop",
+    "client",
+    "block"
+};
+
+/**
+ * Parses either `value` (min = max = value) or `min:max` with
+ * 1 <= min <= max. Returns -1 if it is invalid.
+ */
+static int parse_range(char *s, size_t *min, size_t *max) {
+    char min_str[32];
+    char *colon = strchr(s, ':');
+    if (colon == NULL) {
+        if (str2size(max, s, 10) == -1) {
+            return -1;
+        }
+
+        *min = *max;
+        return 0;
+    }
+
+    if ((size_t) (colon - s) >= sizeof(min_str)) {
+        return -1;
+    }
+
+    memcpy(min_str, s, colon - s);
+    min_str[colon - s] = 0;
+
+    if (
+        str2size(min, min_str, 10) == -1 ||
+        str2size(max, colon + 1, 10) == -1 ||
+        *min < 1 ||
+        *min > *max
+    ) {
+        return -1;
+    }
+
+    return 0;
+}
 
 /*
  * Refer to headers/cli.h
@@ -25,6 +66,27 @@ int parse_receiver(int argc, char *argv[], config_rcv_t *config) {
     /** Output file format */
     char *o = DEFAULT_OUT_FORMAT;
 
+    /** Huge pages mode */
+    char *H = "on";
+
+    /** Request pool size, NULL = sized from -m, -n & -N */
+    char *q = NULL;
+
+    /** Request pool policy */
+    char *Q = "drop";
+
+    /** Affinity mode */
+    char *A = "file";
+
+    /** Busy-poll budget (us) */
+    char *B = "0";
+
+    /** TX stage deadline (us), NULL = no TX stage */
+    char *T = NULL;
+
+    /** Worker processes */
+    char *P = "0";
+
     /** Input IP mask */
     char *ip = NULL;
 
@@ -32,8 +94,10 @@ int parse_receiver(int argc, char *argv[], config_rcv_t *config) {
     char *port = NULL;
 
     config->sequential = false;
+    config->stats_path = NULL;
+    config->shm_name = NULL;
     optind = 0;
-    while((c = getopt(argc, argv, ":m:o:n:w:sN:W:")) != -1) {
+    while((c = getopt(argc, argv, ":m:o:n:w:sN:W:S:M:H:q:Q:A:B:T:P:")) != -1) {
         switch(c) {
             case 'm':
                 m = optarg;
@@ -63,6 +127,42 @@ int parse_receiver(int argc, char *argv[], config_rcv_t *config) {
                 config->sequential = true;
                 break;
 
+            case 'S':
+                config->stats_path = optarg;
+                break;
+
+            case 'M':
+                config->shm_name = optarg;
+                break;
+
+            case 'H':
+                H = optarg;
+                break;
+
+            case 'q':
+                q = optarg;
+                break;
+
+            case 'Q':
+                Q = optarg;
+                break;
+
+            case 'A':
+                A = optarg;
+                break;
+
+            case 'B':
+                B = optarg;
+                break;
+
+            case 'T':
+                T = optarg;
+                break;
+
+            case 'P':
+                P = optarg;
+                break;
+
             case ':':
                 errno = CLI_O_VALUE_MISSING;
                 return -1;
@@ -164,13 +264,16 @@ int parse_receiver(int argc, char *argv[], config_rcv_t *config) {
 
     /* handle number */
 
+    /** `min:max` = elastic handlers */
     size_t handle_num;
-    if (str2size(&handle_num, n, 10) == -1 || handle_num < 0) {
+    size_t handle_min;
+    if (parse_range(n, &handle_min, &handle_num)) {
         errno = CLI_HANDLE_INVALID;
         return -1;
     }
 
     config->handle_num = (uint16_t) handle_num;
+    config->handle_min = (uint16_t) handle_min;
 
     /* Receiver count */
     size_t receive_num;
@@ -193,13 +296,87 @@ int parse_receiver(int argc, char *argv[], config_rcv_t *config) {
 
     /* max receive size */
 
+    /** `min:max` = adaptive batches, see rx_adapt */
     size_t receive_size;
-    if (str2size(&receive_size, W, 10) == -1 || receive_size < 0) {
+    size_t receive_min;
+    if (parse_range(W, &receive_min, &receive_size) || receive_size < 1) {
         errno = CLI_WINDOW_INVALID;
         return -1;
     }
 
     config->receive_window_size = (uint16_t) receive_size;
+    config->receive_window_min = (uint16_t) receive_min;
+
+    /* huge pages mode */
+
+    if (!strcmp(H, "off")) {
+        config->arenas = false;
+        config->prefault = false;
+    } else if (!strcmp(H, "on")) {
+        config->arenas = true;
+        config->prefault = false;
+    } else if (!strcmp(H, "prefault")) {
+        config->arenas = true;
+        config->prefault = true;
+    } else {
+        errno = CLI_HUGE_INVALID;
+        return -1;
+    }
+
+    /* request pool */
+
+    if (q == NULL) {
+        config->pool_size = config->max_connections * DEFAULT_POOL_PER_CLIENT +
+            (config->receive_num + config->handle_num) * DEFAULT_POOL_PER_THREAD;
+    } else if (str2size(&config->pool_size, q, 10) == -1) {
+        errno = CLI_POOL_INVALID;
+        return -1;
+    }
+
+    if (!strcmp(Q, "drop")) {
+        config->pool_policy = POOL_DROP;
+    } else if (!strcmp(Q, "client")) {
+        config->pool_policy = POOL_CLIENT;
+    } else if (!strcmp(Q, "block")) {
+        config->pool_policy = POOL_BLOCK;
+    } else {
+        errno = CLI_POOL_INVALID;
+        return -1;
+    }
+
+    /* affinity mode */
+
+    if (!strcmp(A, "file")) {
+        config->auto_affinity = false;
+    } else if (!strcmp(A, "auto")) {
+        config->auto_affinity = true;
+    } else {
+        errno = CLI_AFFINITY_INVALID;
+        return -1;
+    }
+
+    /* busy-poll budget */
+
+    if (str2size(&config->busy_poll_us, B, 10) == -1 || config->busy_poll_us > MAX_BUSY_POLL_US) {
+        errno = CLI_BUSY_POLL_INVALID;
+        return -1;
+    }
+
+    /* TX stage deadline */
+
+    config->tx_stage = T != NULL;
+    config->tx_deadline_us = 0;
+    if (T != NULL && (str2size(&config->tx_deadline_us, T, 10) == -1 || config->tx_deadline_us > MAX_TX_DEADLINE_US)) {
+        errno = CLI_TX_INVALID;
+        return -1;
+    }
+
+    /* worker processes */
+
+    if (str2size(&config->workers, P, 10) == -1 || config->workers > MAX_WORKERS) {
+        errno = CLI_WORKERS_INVALID;
+        return -1;
+    }
 
     /* IPv6 validation */
 
@@ -231,6 +408,7 @@ int parse_receiver(int argc, char *argv[], config_rcv_t *config) {
 
     config->handle_affinities = NULL;
     config->receive_affinities = NULL;
+    config->stream_nodes = NULL;
 
     return 0;
 }
@@ -527,7 +705,11 @@ int parse_streams_file(config_rcv_t *config) {
 void print_config(config_rcv_t *config) {
     fprintf(stderr, " - - - - - - - - CONFIG - - - - - - - - \n");
     fprintf(stderr, "Maximum advertised window: %zu (default %d)\n", config->max_window, MAX_WINDOW_SIZE);
-    fprintf(stderr, "Maximum packets per syscall: %zu (default %d)\n", config->receive_window_size, MAX_WINDOW_SIZE);
+    if (config->receive_window_min < config->receive_window_size) {
+        fprintf(stderr, "Packets per syscall: %zu to %zu, adaptive (default %d)\n", config->receive_window_min, config->receive_window_size, MAX_WINDOW_SIZE);
+    } else {
+        fprintf(stderr, "Maximum packets per syscall: %zu (default %d)\n", config->receive_window_size, MAX_WINDOW_SIZE);
+    }
     fprintf(stderr, "Sequential? %s\n", config->sequential ? "yes" : "no");
     if (!config->sequential) {
 
@@ -543,7 +725,11 @@ void print_config(config_rcv_t *config) {
             fprintf(stderr, "\n");
         }
 
-        fprintf(stderr, " - Number of handlers: %zu (default 2)\n", config->handle_num);
+        if (config->handle_min < config->handle_num) {
+            fprintf(stderr, " - Number of handlers: %zu to %zu, elastic (default 2)\n", config->handle_min, config->handle_num);
+        } else {
+            fprintf(stderr, " - Number of handlers: %zu (default 2)\n", config->handle_num);
+        }
         if (config->handle_num > 0 && config->handle_affinities != NULL) {
             fprintf(stderr, "  - Affinities (CPU): ");
 
@@ -578,6 +764,43 @@ void print_config(config_rcv_t *config) {
     ip_to_string((struct sockaddr_in6 *) config->addr_info->ai_addr, ip);
     fprintf(stderr, "Input IP mask: %s\n", ip);
     fprintf(stderr, "Input port: %d\n", config->port);
+    fprintf(stderr, "Statistics socket: %s\n", config->stats_path == NULL ? "disabled" : config->stats_path);
+    fprintf(stderr, "Statistics segment: %s\n", config->shm_name == NULL ? "disabled" : config->shm_name);
+    fprintf(
+        stderr, "Affinities: %s\n",
+        config->workers > 0 ? "none (worker processes)" : config->auto_affinity ? "auto (CPU topology)" : "affinity.cfg"
+    );
+    if (config->stream_nodes != NULL) {
+        fprintf(stderr, "  NUMA node of the streams (#Stream -> #Node): ");
+        for (i = 0; i < config->stream_count; i++) {
+            if (config->stream_nodes[i] == TOPO_NO_NODE) {
+                fprintf(stderr, "%zu -> none%s", i, (i == config->stream_count - 1) ? "\n" : ", ");
+            } else {
+                fprintf(stderr, "%zu -> %zu%s", i, config->stream_nodes[i], (i == config->stream_count - 1) ? "\n" : ", ");
+            }
+        }
+    }
+    if (config->busy_poll_us == 0) {
+        fprintf(stderr, "Busy-poll: disabled\n");
+    } else {
+        fprintf(stderr, "Busy-poll: %zuus before sleeping\n", config->busy_poll_us);
+    }
+    if (!config->tx_stage) {
+        fprintf(stderr, "TX stage: disabled\n");
+    } else {
+        fprintf(stderr, "TX stage: one per stream, %zuus deadline\n", config->tx_deadline_us);
+    }
+    if (config->workers == 0) {
+        fprintf(stderr, "Worker processes: none\n");
+    } else {
+        fprintf(stderr, "Worker processes: %zu (shared client registry)\n", config->workers);
+    }
+    if (config->pool_size == 0) {
+        fprintf(stderr, "Request pool: unbounded\n");
+    } else {
+        fprintf(stderr, "Request pool: %zu requests (%s)\n", config->pool_size, pool_policy_names[config->pool_policy]);
+    }
+    fprintf(stderr, "Arenas: %s\n", !config->arenas ? "disabled" : config->prefault ? "enabled, pre-faulted" : "enabled");
     fprintf(stderr, " - - - - - - - - - - - - - - - - - - - -\n");
 }
 
@@ -1,4 +1,5 @@
 #include "../headers/client.h"
+#include "../headers/handler.h"
 
 /*
  * Refer to headers/client.h
@@ -49,6 +50,7 @@ int initialize_client(
     client->id = id;
     client->active = true;
     client->end_time = NULL;
+    client->registry_entry = -1;
     
     client->lock = (pthread_mutex_t *) malloc(sizeof(pthread_mutex_t));
     if(client->lock == NULL) {
@@ -90,7 +92,7 @@ int initialize_client(
 
     client->addr_len = *addr_len;
 
-    client->window = (buf_t *) malloc(sizeof(buf_t));
+    client->window = (buf_t *) arena_get(ARENA_WINDOWS, sizeof(buf_t));
     if(client->window == NULL){
         free(client->address);
         pthread_mutex_destroy(client->lock);
@@ -100,11 +102,11 @@ int initialize_client(
         return -1;
     }
     
-    if(initialize_buffer(client->window, &allocate_packet) != 0) { 
+    if(initialize_buffer(client->window, &allocate_view) != 0) { 
         free(client->address);
         pthread_mutex_destroy(client->lock);
         free(client->lock);
-        free(client->window);
+        arena_put(client->window);
         free(client);
 
         errno = FAILED_TO_ALLOCATE;
@@ -124,6 +126,10 @@ int initialize_client(
 
     clock_gettime(1, &client->connection_time);
     client->transferred = 0;
+    client->duplicates = 0;
+    client->record = NULL;
+    client->queued = 0;
+    client->pinned = 0;
 
     return 0;
 }
@@ -150,6 +156,7 @@ void deallocate_client(client_t *client, bool dealloc_addr, bool close_file) {
     }
 
     if (client->window != NULL) {
+        hd_window_release(client);
         deallocate_buffer(client->window);
     }
 
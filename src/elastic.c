@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include "../headers/elastic.h"
+
+/*
+ * Refer to headers/elastic.h
+ */
+void elastic_set_parked(hd_cfg_t *handler, bool parked) {
+    pthread_mutex_lock(&handler->park_lock);
+    handler->parked = parked;
+    pthread_cond_signal(&handler->park_cond);
+    pthread_mutex_unlock(&handler->park_lock);
+}
+
+/*
+ * Refer to headers/elastic.h
+ */
+int elastic_init(elastic_t *elastic, config_rcv_t *config, hd_cfg_t **handlers, stream_t **streams) {
+    memset(elastic, 0, sizeof(elastic_t));
+
+    elastic->last_busy = calloc(config->handle_num, sizeof(uint64_t));
+    elastic->calm = calloc(config->stream_count, sizeof(size_t));
+    if (elastic->last_busy == NULL || elastic->calm == NULL) {
+        free(elastic->last_busy);
+        free(elastic->calm);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    elastic->handlers = handlers;
+    elastic->handle_num = config->handle_num;
+    elastic->handle_streams = config->handle_streams;
+    elastic->streams = streams;
+    elastic->stream_count = config->stream_count;
+    elastic->min = config->handle_min;
+
+    size_t i, s;
+    for (i = 0; i < config->handle_num; i++) {
+        handlers[i]->parked = true;
+    }
+
+    /** The first handler of every stream, then round robin until `min` */
+    for (s = 0; s < elastic->stream_count; s++) {
+        for (i = 0; i < elastic->handle_num; i++) {
+            if (elastic->handle_streams[i].stream == s) {
+                handlers[i]->parked = false;
+                elastic->active++;
+                break;
+            }
+        }
+    }
+
+    bool found = true;
+    while (elastic->active < elastic->min && found) {
+        found = false;
+        for (s = 0; s < elastic->stream_count && elastic->active < elastic->min; s++) {
+            for (i = 0; i < elastic->handle_num; i++) {
+                if (elastic->handle_streams[i].stream == s && handlers[i]->parked) {
+                    handlers[i]->parked = false;
+                    elastic->active++;
+                    found = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Refer to headers/elastic.h
+ */
+void elastic_run_once(elastic_t *elastic) {
+    const double period = ELASTIC_INTERVAL_MS * 1000000.0;
+
+    size_t s, i;
+    for (s = 0; s < elastic->stream_count; s++) {
+        size_t active = 0;
+        uint64_t busy = 0;
+        hd_cfg_t *first_parked = NULL;
+        hd_cfg_t *last_active = NULL;
+
+        for (i = 0; i < elastic->handle_num; i++) {
+            if (elastic->handle_streams[i].stream != s) {
+                continue;
+            }
+
+            hd_cfg_t *handler = elastic->handlers[i];
+            uint64_t total = STAT_GET(handler->stats, STAT_HD_BUSY_NS);
+
+            if (handler->parked) {
+                first_parked = first_parked == NULL ? handler : first_parked;
+            } else {
+                active++;
+                busy += total - elastic->last_busy[i];
+                last_active = handler;
+            }
+
+            elastic->last_busy[i] = total;
+        }
+
+        if (active == 0) {
+            continue;
+        }
+
+        int length = elastic->streams[s]->length;
+        size_t depth = length < 0 ? 0 : (size_t) length;
+        double utilization = (double) busy / (period * active);
+
+        if (first_parked != NULL && (depth > ELASTIC_DEPTH_HIGH * active || utilization > ELASTIC_UTIL_HIGH)) {
+            elastic_set_parked(first_parked, false);
+            elastic->active++;
+            elastic->calm[s] = 0;
+
+            LOG(
+                "ELASTIC",
+                "Handler #%d unparked (stream %zu, depth %zu, utilization %.0f%%, %zu active)\n",
+                first_parked->id,
+                s,
+                depth,
+                utilization * 100.0,
+                elastic->active
+            );
+        } else if (
+            active > 1 &&
+            elastic->active > elastic->min &&
+            depth == 0 &&
+            utilization * active < ELASTIC_UTIL_LOW * (active - 1)
+        ) {
+            if (++elastic->calm[s] >= ELASTIC_CALM_PERIODS) {
+                elastic_set_parked(last_active, true);
+                elastic->active--;
+                elastic->calm[s] = 0;
+
+                LOG(
+                    "ELASTIC",
+                    "Handler #%d parked (stream %zu, utilization %.0f%%, %zu active)\n",
+                    last_active->id,
+                    s,
+                    utilization * 100.0,
+                    elastic->active
+                );
+            }
+        } else {
+            elastic->calm[s] = 0;
+        }
+    }
+}
+
+/**
+ * The controller thread, see `elastic_t`.
+ */
+static void *elastic_thread(void *arg) {
+    elastic_t *elastic = (elastic_t *) arg;
+    struct timespec period = {
+        .tv_sec = ELASTIC_INTERVAL_MS / 1000,
+        .tv_nsec = (ELASTIC_INTERVAL_MS % 1000) * 1000000L
+    };
+
+    while (!elastic->stop) {
+        nanosleep(&period, NULL);
+        elastic_run_once(elastic);
+    }
+
+    return NULL;
+}
+
+/*
+ * Refer to headers/elastic.h
+ */
+int elastic_start(elastic_t *elastic) {
+    elastic->thread = malloc(sizeof(pthread_t));
+    if (elastic->thread == NULL) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    elastic->stop = false;
+    if (pthread_create(elastic->thread, NULL, &elastic_thread, elastic)) {
+        free(elastic->thread);
+        elastic->thread = NULL;
+        errno = UNKNOWN;
+        return -1;
+    }
+
+    pthread_setname_np(*elastic->thread, "trtp-elastic");
+
+    return 0;
+}
+
+/*
+ * Refer to headers/elastic.h
+ */
+void elastic_stop(elastic_t *elastic) {
+    if (elastic->thread != NULL) {
+        elastic->stop = true;
+        pthread_join(*elastic->thread, NULL);
+        free(elastic->thread);
+        elastic->thread = NULL;
+    }
+
+    size_t i;
+    for (i = 0; i < elastic->handle_num; i++) {
+        if (elastic->handlers[i] != NULL && elastic->handlers[i]->parked) {
+            elastic_set_parked(elastic->handlers[i], false);
+        }
+    }
+
+    elastic->active = elastic->handle_num;
+}
+
+/*
+ * Refer to headers/elastic.h
+ */
+void elastic_destroy(elastic_t *elastic) {
+    if (elastic->handlers == NULL) {
+        return;
+    }
+
+    free(elastic->last_busy);
+    free(elastic->calm);
+    memset(elastic, 0, sizeof(elastic_t));
+}
@@ -4,322 +4,551 @@
 #include "../headers/global.h"
 
 
-#define LOG_ERROR(message, id, port, ip_as_str, ...) \
-    LOG("HANDLER][ERROR", "Error on client #%d [%s]:%u: " message "\n", id, ip_as_str, ntohs(port), __VA_ARGS__)
-
-#define LOG_ERRORN(message, id, port, ip_as_str) \
-    LOG("HANDLER][ERROR", "Error on client #%d [%s]:%u: " message "\n", id, ip_as_str, ntohs(port))
-
-
-void print_unpack_error(uint32_t id, uint16_t port, char *ip_as_str) {
+/**
+ * Logs the reason why `unpack` failed (using errno).
+ */
+void print_unpack_error(client_t *client) {
+    log_msg_t msg;
     switch(errno) {
         case TYPE_IS_WRONG:
-            LOG_ERRORN("Type is wrong", id, port, ip_as_str);
+            msg = LOG_HD_TYPE_WRONG;
             break;
         case NON_DATA_TRUNCATED:
-            LOG_ERRORN("Non-PData packet truncated", id, port, ip_as_str);
+            msg = LOG_HD_NON_DATA_TRUNCATED;
             break;
         case CRC_VALIDATION_FAILED:
-            LOG_ERRORN("Header could not be validated", id, port, ip_as_str);
+            msg = LOG_HD_CRC_HEADER;
             break;
         case PAYLOAD_VALIDATION_FAILED:
-            LOG_ERRORN("Payload could not be validated", id, port, ip_as_str);
+            msg = LOG_HD_CRC_PAYLOAD;
             break;
         case PACKET_TOO_SHORT:
-            LOG_ERRORN("Packet has incorrect size (too short)", id, port, ip_as_str);
+            msg = LOG_HD_TOO_SHORT;
             break;
         case PACKET_TOO_LONG:
-            LOG_ERRORN("Packet has incorrect size (too long)", id, port, ip_as_str);
+            msg = LOG_HD_TOO_LONG;
             break;
         case PAYLOAD_TOO_LONG:
-            LOG_ERRORN("Payload has incorrect size (too long)", id, port, ip_as_str);
+            msg = LOG_HD_PAYLOAD_TOO_LONG;
             break;
         default:
-            LOG_ERROR("Unknown packet error (errno = %d)", id, port, ip_as_str, errno);
+            msg = LOG_HD_UNKNOWN_ERROR;
             break;
     }
+
+    log_client_event(msg, client->id, client->address, errno, 0, 0);
 }
 
-void bytes_to_unit(uint64_t total, char *size, double *multiplier) {
-    char *sizes[5] = {
-        "B", "KiB", "MiB", "GiB", "TiB"
-    };
-
-    int i;
-    *multiplier = 1.0;
-    for (i = 0; i < 5; i++) {
-        if (total > 1024 && i != 4) {
-            total /= 1024;
-            *multiplier *= 1024;
-        } else {
-            strcpy(size, sizes[i]);
-            break;
+/*
+ * Refer to headers/handler.h
+ */
+void hd_req_crcs(hd_req_t *req, uint32_t header_crcs[MAX_WINDOW_SIZE], uint32_t payload_crcs[MAX_WINDOW_SIZE]) {
+    uint8_t *datagrams[MAX_WINDOW_SIZE];
+    size_t lengths[MAX_WINDOW_SIZE];
+
+    size_t i;
+    for (i = 0; i < req->num; i++) {
+        datagrams[i] = hd_req_datagram(req, i);
+        lengths[i] = hd_req_length(req, i);
+    }
+
+    hd_crcs(datagrams, lengths, req->num, header_crcs, payload_crcs);
+}
+
+/*
+ * Refer to headers/handler.h
+ */
+void hd_crcs(uint8_t **datagrams, size_t *lengths, size_t count, uint32_t *header_crcs, uint32_t *payload_crcs) {
+    /** The arrays below can't be empty */
+    if (count == 0) {
+        return;
+    }
+
+    /** The headers are copied: the T bit must be cleared but `unpack` still has to read it */
+    uint8_t headers[count][8];
+    uint8_t *header_data[count], *payload_data[count];
+    size_t header_lengths[count], payload_lengths[count];
+    size_t header_index[count], payload_index[count];
+    uint32_t crcs[count];
+    size_t header_count = 0, payload_count = 0;
+
+    size_t i;
+    for (i = 0; i < count; i++) {
+        uint8_t *buffer = datagrams[i];
+        size_t length = lengths[i];
+
+        header_crcs[i] = 0;
+        payload_crcs[i] = 0;
+
+        if (length < 2) {
+            continue;
+        }
+
+        bool is_long = (buffer[1] & 0x80) != 0;
+        size_t header_length = 7 + is_long;
+        if (length < header_length) {
+            continue;
+        }
+
+        memcpy(headers[header_count], buffer, header_length);
+        headers[header_count][0] &= 0xDF;
+        header_data[header_count] = headers[header_count];
+        header_lengths[header_count] = header_length;
+        header_index[header_count++] = i;
+
+        size_t payload_length = is_long ? ntohs((buffer[1] & 0x7F) | (buffer[2] << 8)) : buffer[1] & 0x7F;
+        bool data = (buffer[0] >> 6) == DATA && !(buffer[0] & 0x20);
+
+        if (data && payload_length > 0 && payload_length <= MAX_PAYLOAD_SIZE && length >= header_length + 8 + payload_length) {
+            payload_data[payload_count] = buffer + header_length + 4;
+            payload_lengths[payload_count] = payload_length;
+            payload_index[payload_count++] = i;
         }
     }
+
+    crc32_batch(header_data, header_lengths, header_count, crcs);
+    for (i = 0; i < header_count; i++) {
+        header_crcs[header_index[i]] = crcs[i];
+    }
+
+    crc32_batch(payload_data, payload_lengths, payload_count, crcs);
+    for (i = 0; i < payload_count; i++) {
+        payload_crcs[payload_index[i]] = crcs[i];
+    }
 }
 
 /*
- * Refer to headers/buffer.h
+ * Refer to headers/handler.h
  */
-void hd_run_once(
-    bool wait,
+void hd_view_release(client_t *client, pkt_view_t *view) {
+    hd_req_t *req = view->owner;
+    view->owner = NULL;
+
+    if (req != NULL && --req->refs == 0) {
+        client->pinned--;
+
+        /** Otherwise its handler is still on it and returns it itself */
+        if (req->home != NULL) {
+            enqueue_or_free(req->home, req->node);
+        }
+    }
+}
+
+/*
+ * Refer to headers/handler.h
+ */
+void hd_window_release(client_t *client) {
+    buf_t *window = client->window;
+
+    size_t i;
+    for (i = 0; i < MAX_BUFFER_SIZE; i++) {
+        if (window->nodes[i].used) {
+            window->nodes[i].used = false;
+            hd_view_release(client, (pkt_view_t *) window->nodes[i].value);
+        }
+    }
+}
+
+/*
+ * Refer to headers/handler.h
+ */
+void hd_decode(
     hd_cfg_t *cfg,
-    packet_t **decoded,
-    bool *exit,
-    uint8_t file_buffer[MAX_PACKET_SIZE * MAX_WINDOW_SIZE],
-    uint8_t packets_to_send[][12],
-    struct mmsghdr *msg
+    client_t *client,
+    hd_req_t *owner,
+    uint8_t *datagram,
+    int length,
+    uint32_t crc1,
+    uint32_t crc2,
+    ack_batch_t *acks,
+    uint32_t *last_timestamp
 ) {
+    stats_t *stats = cfg->stats;
+    buf_t *window = client->window;
     packet_t to_send;
-    int len_to_send = 0;
-    s_node_t *node_rx = stream_pop(cfg->rx, wait);
-    if (node_rx == NULL) {
-        sched_yield();
+    pkt_view_t decoded;
+
+    if (unpack_view(datagram, length, &decoded, crc1, crc2)) {
+        stats_count_unpack_error(stats, errno);
+
+        to_send.type = ACK;
+        to_send.truncated = false;
+        to_send.seqnum = window->window_low;
+        to_send.long_length = false;
+        to_send.length = 0;
+        to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
+        to_send.timestamp = client->last_timestamp;
+
+        if (pack_ack(ack_batch_reserve(acks, client->address), &to_send)) {
+            log_client_event(LOG_HD_PACK_ACK_FAILED, client->id, client->address, errno, 0, 0);
+        } else {
+            ack_batch_commit(acks);
+        }
+
+        print_unpack_error(client);
         return;
     }
 
-    hd_req_t *req = (hd_req_t *) node_rx->content;
-    if (req != NULL) {
-        if (req->stop == true) {
-            LOG("HD", "Received STOP (%d)\n", cfg->id);
-            free(*decoded);
-            deallocate_node(node_rx);
-            
-            *exit = true;
-            return;
+    *last_timestamp = decoded.timestamp;
+
+    if (!client->active) {
+        STAT_INC(stats, STAT_HD_INACTIVE);
+
+        to_send.type = ACK;
+        to_send.truncated = false;
+        to_send.seqnum = window->window_low;
+        to_send.long_length = false;
+        to_send.length = 0;
+        to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
+        to_send.timestamp = decoded.timestamp;
+
+        if (pack_ack(ack_batch_reserve(acks, client->address), &to_send)) {
+            log_client_event(LOG_HD_PACK_ACK_FAILED, client->id, client->address, errno, 0, 0);
+        } else {
+            ack_batch_commit(acks);
         }
+    } else if (decoded.type == DATA) {
+        if (decoded.truncated) {
+            STAT_INC(stats, STAT_HD_TRUNCATED);
 
-        client_t *client = req->client;
-        buf_t *window = client->window;
-        pthread_mutex_lock(client_get_lock(client));
-        uint32_t last_timestamp = client->last_timestamp;
+            to_send.type = NACK;
+            to_send.truncated = false;
+            to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->window_low);
+            to_send.long_length = false;
+            to_send.length = 0;
+            to_send.seqnum = decoded.seqnum;
+            to_send.timestamp = decoded.timestamp;
 
-        size_t i = 0;
-        for (i = 0; i < req->num; i++) {
-            uint8_t *buffer = req->buffer[i];
-            int length = req->lengths[i];
-
-            if (unpack(buffer, length, *decoded)) {
-                to_send.type = ACK;
-                to_send.truncated = false;
-                to_send.seqnum = window->window_low;
-                to_send.long_length = false;
-                to_send.length = 0;
-                to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
-                to_send.timestamp = client->last_timestamp;
-
-                msg[len_to_send].msg_hdr.msg_name = client->address;
-                if (pack(packets_to_send[len_to_send++], &to_send, false)) {
-                    LOG_ERROR("Failed to pack ACK (errno = %d)", client->id, client->address->sin6_port, client->ip_as_string, errno);
-                    len_to_send--;
-                }
-
-                print_unpack_error(client->id, client->address->sin6_port, client->ip_as_string);
-                
-                continue;
+            if (pack_ack(ack_batch_reserve(acks, client->address), &to_send)) {
+                log_client_event(LOG_HD_PACK_NACK_FAILED, client->id, client->address, errno, 0, 0);
+            } else {
+                ack_batch_commit(acks);
+            }
+
+            TRACE(
+                "Received truncated: %d (low: %d) for client #%d [%s]:%u\n", 
+                decoded.seqnum, window->window_low,
+                client->id, client->ip_as_string, ntohs(client->address->sin6_port)
+            );
+        } else if (!sequences[window->window_low][decoded.seqnum]) {
+            STAT_INC(stats, STAT_HD_OUT_OF_WINDOW);
+            client->duplicates++;
+
+            to_send.type = ACK;
+            to_send.truncated = false;
+            to_send.seqnum = window->window_low;
+            to_send.long_length = false;
+            to_send.length = 0;
+            to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
+            to_send.timestamp = decoded.timestamp;
+
+            if (pack_ack(ack_batch_reserve(acks, client->address), &to_send)) {
+                log_client_event(LOG_HD_PACK_ACK_FAILED, client->id, client->address, errno, 0, 0);
+            } else {
+                ack_batch_commit(acks);
+            }
+
+            TRACE(
+                "Received out of order: %d (low: %d) for client #%d [%s]:%u\n", 
+                decoded.seqnum, window->window_low,
+                client->id, client->ip_as_string, ntohs(client->address->sin6_port)
+            );
+        } else if(is_used(window, decoded.seqnum)) {
+            STAT_INC(stats, STAT_HD_DUPLICATES);
+            client->duplicates++;
+
+            to_send.type = ACK;
+            to_send.truncated = false;
+            to_send.seqnum = window->window_low;
+            to_send.long_length = false;
+            to_send.length = 0;
+            to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
+            to_send.timestamp = decoded.timestamp;
+
+            if (pack_ack(ack_batch_reserve(acks, client->address), &to_send)) {
+                log_client_event(LOG_HD_PACK_ACK_FAILED, client->id, client->address, errno, 0, 0);
+            } else {
+                ack_batch_commit(acks);
             }
 
-            last_timestamp = (*decoded)->timestamp;
-
-            if (!client->active) {
-                to_send.type = ACK;
-                to_send.truncated = false;
-                to_send.seqnum = window->window_low;
-                to_send.long_length = false;
-                to_send.length = 0;
-                to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
-                to_send.timestamp = (*decoded)->timestamp;
-
-                msg[len_to_send].msg_hdr.msg_name = client->address;
-                if (pack(packets_to_send[len_to_send++], &to_send, false)) {
-                    LOG_ERROR("Failed to pack ACK (errno = %d)", client->id, client->address->sin6_port, client->ip_as_string, errno);
-                    len_to_send--;
-                }
-            } else if ((*decoded)->type == DATA) {
-                if ((*decoded)->truncated) {
-                    to_send.type = NACK;
-                    to_send.truncated = false;
-                    to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->window_low);
-                    to_send.long_length = false;
-                    to_send.length = 0;
-                    to_send.seqnum = (*decoded)->seqnum;
-                    to_send.timestamp = (*decoded)->timestamp;
-
-                    msg[len_to_send].msg_hdr.msg_name = client->address;
-                    if (pack(packets_to_send[len_to_send++], &to_send, false)) {
-                        LOG_ERROR("Failed to pack NACK (errno = %d)", client->id, client->address->sin6_port, client->ip_as_string, errno);
-                        len_to_send--;
-                    }
-
-                    TRACE(
-                        "Received truncated: %d (low: %d) for client #%d [%s]:%u\n", 
-                        (*decoded)->seqnum, window->window_low,
-                        client->id, client->ip_as_string, ntohs(client->address->sin6_port)
-                    );
-                } else if (!sequences[window->window_low][(*decoded)->seqnum]) {
-                    to_send.type = ACK;
-                    to_send.truncated = false;
-                    to_send.seqnum = window->window_low;
-                    to_send.long_length = false;
-                    to_send.length = 0;
-                    to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
-                    to_send.timestamp = (*decoded)->timestamp;
-
-                    msg[len_to_send].msg_hdr.msg_name = client->address;
-                    if (pack(packets_to_send[len_to_send++], &to_send, false)) {
-                        LOG_ERROR("Failed to pack ACK (errno = %d)", client->id, client->address->sin6_port, client->ip_as_string, errno);
-                        len_to_send--;
-                    }
-
-                    TRACE(
-                        "Received out of order: %d (low: %d) for client #%d [%s]:%u\n", 
-                        (*decoded)->seqnum, window->window_low,
-                        client->id, client->ip_as_string, ntohs(client->address->sin6_port)
-                    );
-                } else if(is_used(window, (*decoded)->seqnum)) {
-                    to_send.type = ACK;
-                    to_send.truncated = false;
-                    to_send.seqnum = window->window_low;
-                    to_send.long_length = false;
-                    to_send.length = 0;
-                    to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
-                    to_send.timestamp = (*decoded)->timestamp;
-
-                    msg[len_to_send].msg_hdr.msg_name = client->address;
-                    if (pack(packets_to_send[len_to_send++], &to_send, false)) {
-                        LOG_ERROR("Failed to pack ACK (errno = %d)", client->id, client->address->sin6_port, client->ip_as_string, errno);
-                        len_to_send--;
-                    }
-
-                    TRACE(
-                        "Received duplicate: %d (low: %d) for client #%d [%s]:%u\n", 
-                        (*decoded)->seqnum, window->window_low,
-                        client->id, client->ip_as_string, ntohs(client->address->sin6_port)
-                    );
-                } else {
-                    node_t *spot = next(window, (*decoded)->seqnum);
-                    if (spot == NULL) {
-                        LOGN("HD", "Internal error");
-                    }
-
-                    packet_t *temp = (packet_t *) spot->value;
-                    spot->value = *decoded;
-                    *decoded = temp;
-                }
+            TRACE(
+                "Received duplicate: %d (low: %d) for client #%d [%s]:%u\n", 
+                decoded.seqnum, window->window_low,
+                client->id, client->ip_as_string, ntohs(client->address->sin6_port)
+            );
+        } else if (
+            owner != NULL && decoded.seqnum != window->window_low && cfg->pin_reserve > 0 &&
+            (size_t) __atomic_load_n(&cfg->tx->length, __ATOMIC_RELAXED) < cfg->pin_reserve
+        ) {
+            /**
+             * The window_low one is always taken: it is written right below.
+             * Whether the request is already pinned or not: one that holds
+             * window_low would otherwise pin every later packet it carries.
+             */
+            STAT_INC(stats, STAT_HD_PIN_DROPS);
+        } else {
+            node_t *spot = next(window, decoded.seqnum);
+            if (spot == NULL) {
+                log_event(LOG_HD_INTERNAL_ERROR, 0, 0, 0);
             }
+
+            if (owner != NULL && owner->refs++ == 0) {
+                client->pinned++;
+            }
+
+            decoded.owner = owner;
+            *(pkt_view_t *) spot->value = decoded;
         }
+    }
+}
 
-        int offset = 0;
+/*
+ * Refer to headers/handler.h
+ */
+int hd_flush(
+    hd_cfg_t *cfg,
+    client_t *client,
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE],
+    ack_batch_t *acks,
+    uint32_t last_timestamp,
+    uint64_t timestamp
+) {
+    stats_t *stats = cfg->stats;
+    buf_t *window = client->window;
+    packet_t to_send;
 
-        node_t *node;
-        packet_t *pak;
-        int cnt = 0;
-        i = window->window_low;
-        bool remove;
-        do {
-            node = get(window, i & 0xFF, false);
-            if (node != NULL) {
-                pak = (packet_t *) node->value;
+    int offset = 0;
+
+    node_t *node;
+    pkt_view_t *pak;
+    node_t *written[MAX_WINDOW_SIZE];
+    int cnt = 0;
+    size_t i = window->window_low;
+    bool remove = false;
+    do {
+        node = get(window, i & 0xFF, false);
+        if (node != NULL) {
+            pak = (pkt_view_t *) node->value;
+
+            if (pak->length > 0) {
+                memcpy(file_buffer + offset, pak->payload, pak->length);
+                offset += pak->length;
+
+                remove = false;
+            } else if (pak->length == 0 && !remove) {
+                remove = true;
+            }
+
+            last_timestamp = pak->timestamp;
 
-                if (pak->length > 0) {
-                    memcpy(file_buffer + offset, pak->payload, pak->length);
-                    offset += pak->length;
+            written[cnt++] = node;
+            i++;
+        }
+    } while(sequences[client->window->window_low][i & 0xFF] && node != NULL && cnt < MAX_WINDOW_SIZE && !remove);
 
-                    remove = false;
-                } else if (pak->length == 0 && !remove) {
-                    remove = true;
-                }
+    if (cnt > 0) {
+        int result = fwrite(
+            file_buffer,
+            sizeof(uint8_t),
+            offset,
+            client->out_file
+        );
 
-                last_timestamp = pak->timestamp;
+        if (result != offset) {
+            STAT_INC(stats, STAT_HD_WRITE_ERRORS);
+            fseek(client->out_file, -result, SEEK_SET);
 
-                cnt++;
-                i++;
+            /** Back in the window, their requests still hold the payloads */
+            int j;
+            for (j = 0; j < cnt; j++) {
+                written[j]->used = true;
             }
-        } while(sequences[client->window->window_low][i & 0xFF] && node != NULL && cnt < MAX_WINDOW_SIZE && !remove);
-
-        if (cnt > 0) {
-            int result = fwrite(
-                file_buffer,
-                sizeof(uint8_t),
-                offset,
-                client->out_file
-            );
 
-            if (result != offset) {
-                fseek(client->out_file, -result, SEEK_SET);
+            log_client_event(LOG_HD_WRITE_FAILED, client->id, client->address, 0, 0, 0);
+            return -1;
+        }
 
-                LOGN("HD", "Failed to write to file, won't be writing ACK to get retransmission timer\n");
-                enqueue_or_free(cfg->tx, node_rx);
+        /** The payloads are in the file: their requests can go back */
+        int j;
+        for (j = 0; j < cnt; j++) {
+            hd_view_release(client, (pkt_view_t *) written[j]->value);
+        }
 
-                pthread_mutex_unlock(client_get_lock(client));
+        client->transferred += offset;
+        STAT_ADD(stats, STAT_HD_BYTES_WRITTEN, offset);
 
+        if (timestamp != 0 && cfg->latency != NULL) {
+            hist_record(&cfg->latency[HIST_RX_TO_WRITE], hist_elapsed(timestamp));
+        }
 
-                return;
+        window->length -= cnt;
+        window->window_low += cnt;
+        client->last_timestamp = last_timestamp;
+
+        if (remove && client->active) {
+            STAT_INC(stats, STAT_HD_COMPLETED);
+
+            client->active = false;
+            fclose(client->out_file);
+
+            client->end_time = malloc(sizeof(struct timespec));
+            if (!client->end_time) {
+                log_event(LOG_HD_TIMESPEC_FAILED, 0, 0, 0);
             }
 
-            client->transferred += offset;
+            clock_gettime(CLOCK_MONOTONIC, client->end_time);
 
-            window->length -= cnt;
-            window->window_low += cnt;
-            client->last_timestamp = last_timestamp;
+            uint64_t duration = (client->end_time->tv_sec - client->connection_time.tv_sec) * 1000000000UL + 
+                client->end_time->tv_nsec - client->connection_time.tv_nsec;
 
-            if (remove && client->active) {
-                client->active = false;
-                fclose(client->out_file);
+            log_client_event(LOG_HD_DONE, client->id, client->address, client->transferred, duration, 0);
+        }
+
+        to_send.type = ACK;
+        to_send.truncated = false;
+        to_send.long_length = false;
+        to_send.length = 0;
+        to_send.seqnum = window->window_low;
+        to_send.timestamp = last_timestamp;
+        to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
 
-                time_t end;
-                char size[4], speed[4];
-                double sizem = 0.0, speedm = 0.0;
+        if (pack_ack(ack_batch_reserve(acks, client->address), &to_send)) {
+            log_client_event(LOG_HD_PACK_ACK_FAILED, client->id, client->address, errno, 0, 0);
+        } else {
+            ack_batch_commit(acks);
+        }
+    }
 
-                time(&end);
+    return 0;
+}
 
-                bytes_to_unit(client->transferred, size, &sizem);
+/*
+ * Refer to headers/handler.h
+ */
+void hd_run_once(
+    bool wait,
+    hd_cfg_t *cfg,
+    bool *exit,
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE],
+    ack_batch_t *acks
+) {
+    stats_t *stats = cfg->stats;
+    s_node_t *node_rx = NULL;
+    if (acks->count > 0) {
+        /** Never sleep with (N)ACKs pending, another handler may have taken the next request */
+        node_rx = stream_pop(cfg->rx, false);
+        if (node_rx == NULL) {
+            ack_batch_flush(acks);
+        }
+    }
 
-                client->end_time = malloc(sizeof(struct timespec));
-                if (!client->end_time) {
-                    LOGN("MAIN][ERROR", "Failed to allocate timespec\n");
-                }
+    if (node_rx == NULL && wait && cfg->spin_ns > 0) {
+        bool slept;
+        node_rx = stream_pop_spin(cfg->rx, cfg->spin_ns, &slept);
+        if (slept) {
+            STAT_INC(stats, STAT_HD_SLEEPS);
+        } else if (node_rx != NULL) {
+            STAT_INC(stats, STAT_HD_SPIN_HITS);
+        }
+    } else if (node_rx == NULL) {
+        node_rx = stream_pop(cfg->rx, wait);
+    }
 
-                clock_gettime(CLOCK_MONOTONIC, client->end_time);
+    if (node_rx == NULL) {
+        ack_batch_flush(acks);
 
-                double time = ((double)client->end_time->tv_sec + 1.0e-9*client->end_time->tv_nsec) - 
-                    ((double)client->connection_time.tv_sec + 1.0e-9*client->connection_time.tv_nsec);
-                    
-                bytes_to_unit(client->transferred / time, speed, &speedm);
+        /** Busy-polling handlers keep their core */
+        if (cfg->spin_ns == 0) {
+            sched_yield();
+        }
+        return;
+    }
 
-                LOG(
-                    "HD",
-                    "Done, total transferred: %.1f %s, in %.2fs., avg. speed of %.1f %s/s for client #%d [%s]:%d\n",
-                    client->transferred / sizem, size,
-                    time,
-                    (client->transferred / time) / speedm, speed,
-                    client->id, client->ip_as_string, ntohs(client->address->sin6_port)
-                );
-            }
+    hd_req_t *req = (hd_req_t *) node_rx->content;
+    if (req != NULL) {
+        if (req->stop == true) {
+            log_event(LOG_HD_RECEIVED_STOP, cfg->id, 0, 0);
+            ack_batch_flush(acks);
+            deallocate_node(node_rx);
             
-            to_send.type = ACK;
-            to_send.truncated = false;
-            to_send.long_length = false;
-            to_send.length = 0;
-            to_send.seqnum = window->window_low;
-            to_send.timestamp = last_timestamp;
-            to_send.window = min(cfg->max_window_size, MAX_WINDOW_SIZE - window->length);
+            *exit = true;
+            return;
+        }
+
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        STAT_INC(stats, STAT_HD_REQUESTS);
+        STAT_ADD(stats, STAT_HD_PACKETS, req->num);
+
+        hist_t *latency = req->timestamp == 0 ? NULL : cfg->latency;
+        if (latency != NULL) {
+            hist_record(&latency[HIST_RX_TO_DEQUEUE], hist_elapsed(req->timestamp));
+        }
+
+        client_t *client = req->client;
+        uint64_t acks_before = acks->committed;
 
-            msg[len_to_send].msg_hdr.msg_name = client->address;
-            if (pack(packets_to_send[len_to_send++], &to_send, false)) {
-                LOG_ERROR("Failed to pack ACK (errno = %d)", client->id, client->address->sin6_port, client->ip_as_string, errno);
-                len_to_send--;
+        uint64_t timestamp = req->timestamp;
+
+        req->refs = 0;
+        req->node = node_rx;
+        req->home = NULL;
+
+        __sync_fetch_and_sub(&client->queued, 1);
+        pthread_mutex_lock(client_get_lock(client));
+        uint32_t last_timestamp = client->last_timestamp;
+
+        uint32_t header_crcs[MAX_WINDOW_SIZE];
+        uint32_t payload_crcs[MAX_WINDOW_SIZE];
+        hd_req_crcs(req, header_crcs, payload_crcs);
+
+        size_t i;
+        for (i = 0; i < req->num; i++) {
+            hd_decode(
+                cfg, client, req,
+                hd_req_datagram(req, i), hd_req_length(req, i),
+                header_crcs[i], payload_crcs[i],
+                acks, &last_timestamp
+            );
+        }
+
+        if (hd_flush(cfg, client, file_buffer, acks, last_timestamp, timestamp)) {
+            if (req->refs == 0) {
+                enqueue_or_free(cfg->tx, node_rx);
+            } else {
+                req->home = cfg->tx;
             }
+
+            pthread_mutex_unlock(client_get_lock(client));
+            return;
+        }
+
+        shm_publish_client(client);
+
+        /** Pinned: it goes back once its last view is written, by whoever writes it */
+        bool returned = req->refs == 0;
+        if (!returned) {
+            req->home = cfg->tx;
         }
         pthread_mutex_unlock(client_get_lock(client));
-    
-        int retval = sendmmsg(cfg->sockfd, msg, len_to_send, 0);
-        if (retval == -1) {
-            LOG("TX", "sendmmsg failed (fd: %d, len_to_send: %d)\n ", cfg->sockfd, len_to_send);
-            perror("sendmmsg()");
+
+        if (acks->committed > acks_before) {
+            ack_batch_stamp(acks, timestamp);
+        }
+
+        /** More requests queued: they may be for the same client, the (N)ACKs wait for them */
+        if (__atomic_load_n(&cfg->rx->length, __ATOMIC_ACQUIRE) <= 0) {
+            ack_batch_flush(acks);
         }
 
-        enqueue_or_free(cfg->tx, node_rx);
+        if (returned) {
+            enqueue_or_free(cfg->tx, node_rx);
+        }
+
+        struct timespec end;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        STAT_ADD(stats, STAT_HD_BUSY_NS, (end.tv_sec - start.tv_sec) * 1000000000UL + end.tv_nsec - start.tv_nsec);
     } else {
         free(node_rx);
     }
@@ -331,6 +560,9 @@ void hd_run_once(
 void *handle_thread(void *config) {
     hd_cfg_t *cfg = (hd_cfg_t *) config;
 
+    /** Falls back to synchronous logging if it fails */
+    logger_register();
+
     if (cfg->affinity != NULL) {
         pthread_t thread = pthread_self();
 
@@ -340,56 +572,52 @@ void *handle_thread(void *config) {
 
         int aff = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
         if (aff == -1) {
-            LOGN("HD", "Failed to set affinity\n");
+            log_event(LOG_HD_AFFINITY_FAILED, 0, 0, 0);
         } else {
-            LOG("HD", "Handler #%hhu running on CPU #%zu\n", cfg->id, cfg->affinity->cpu);
+            log_event(LOG_HD_AFFINITY, cfg->id, cfg->affinity->cpu, 0);
         }
     }
 
-    uint8_t packets_to_send[MAX_WINDOW_SIZE + 1][12];
-    struct mmsghdr msg[MAX_WINDOW_SIZE + 1];
-    struct iovec iovecs[MAX_WINDOW_SIZE + 1];
-
-    memset(iovecs, 0, sizeof(iovecs));
-    int i = 0;
-    for(; i < MAX_WINDOW_SIZE + 1; i++) {
-        memset(&iovecs[i], 0, sizeof(struct iovec));
-        iovecs[i].iov_base = packets_to_send[i];
-        iovecs[i].iov_len  = 11;
-
-        memset(&msg[i], 0, sizeof(struct mmsghdr));
-        msg[i].msg_hdr.msg_iov = &iovecs[i];
-        msg[i].msg_hdr.msg_iovlen = 1;
-        msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
-    }
+    ack_batch_t acks;
+    ack_batch_init(&acks, cfg->sockfd, cfg->stats, cfg->latency);
+    acks.tx = cfg->ack_tx;
 
     uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE];
 
-    packet_t *decoded = (packet_t *) allocate_packet();
-    init_packet(decoded);
-    if (decoded == NULL) {
-        LOGN("HD", "Failed to start handle thread: alloc failed\n");
-        return NULL;
-    }
-
     bool exit = false;
     while(!exit) {
+        if (cfg->parked) {
+            hd_park(cfg, &acks);
+        }
+
         hd_run_once(
             true,
             cfg,
-            &decoded,
             &exit,
             file_buffer,
-            packets_to_send,
-            msg
+            &acks
         );
     }
     
-    LOGN("HD", "Stopped\n");
+    log_event(LOG_HD_STOPPED, 0, 0, 0);
     
     pthread_exit(0);
 }
 
+/*
+ * Refer to headers/handler.h
+ */
+void hd_park(hd_cfg_t *cfg, ack_batch_t *acks) {
+    /** Never sleep with (N)ACKs pending, as in `hd_run_once` */
+    ack_batch_flush(acks);
+
+    pthread_mutex_lock(&cfg->park_lock);
+    while (cfg->parked) {
+        pthread_cond_wait(&cfg->park_cond, &cfg->park_lock);
+    }
+    pthread_mutex_unlock(&cfg->park_lock);
+}
+
 
 /**
  * Refer to headers/receiver.h
@@ -421,21 +649,16 @@ inline void enqueue_or_free(stream_t *stream, s_node_t *node) {
  * Refer to headers/receiver.h
  */
 void *allocate_handle_request() {
-    hd_req_t *req = (hd_req_t *) malloc(sizeof(hd_req_t));
+    hd_req_t *req = (hd_req_t *) arena_get(ARENA_REQUESTS, sizeof(hd_req_t));
     if(req == NULL) {
         errno = FAILED_TO_ALLOCATE;
         return NULL;
     }
 
-    int i = 0;
-    for (; i < MAX_WINDOW_SIZE; i++) {
-        memset(req->buffer[i], 0, MAX_PACKET_SIZE);
-        req->lengths[i] = 0;
-    }
-    
     req->stop = false;
     req->client = NULL;
-    req->num = 0;
+    req->timestamp = 0;
+    hd_req_reset(req);
 
     return req;
 }
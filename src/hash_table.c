@@ -93,11 +93,20 @@ bool ht_contains(ht_t* table, uint16_t port, uint8_t *ip) {
  */
 client_t *ht_get(ht_t *table, uint16_t port, uint8_t *ip) {
     pthread_mutex_lock(table->lock);
+    client_t *value = ht_get_nolock(table, port, ip);
+    pthread_mutex_unlock(table->lock);
+
+    return value;
+}
+
+/*
+ * Refer to headers/hash_table.h
+ */
+client_t *ht_get_nolock(ht_t *table, uint16_t port, uint8_t *ip) {
     uint16_t index = ht_hash(table, port);
     while(table->items[index].used) {
         if (table->items[index].port == port) {
             if (ip_equals(table->items[index].ip, ip)) {
-                pthread_mutex_unlock(table->lock);
                 return table->items[index].value;
             }
         }
@@ -105,7 +114,6 @@ client_t *ht_get(ht_t *table, uint16_t port, uint8_t *ip) {
         index = (index + 1) % table->size;
     }
 
-    pthread_mutex_unlock(table->lock);
     return NULL;
 }
 
@@ -137,10 +145,11 @@ client_t *ht_put_nolock(ht_t *table, uint16_t port, uint8_t *ip, client_t *item,
 
     memcpy(table->items[index].ip, ip, 16);
 
+    /** Read without the lock by the receivers (-Q client) */
     if (old == NULL && table->items[index].used) {
-        table->length++;
+        __atomic_fetch_add(&table->length, 1, __ATOMIC_RELAXED);
     } else if (old != NULL && !table->items[index].used) {
-        table->length--;
+        __atomic_fetch_sub(&table->length, 1, __ATOMIC_RELAXED);
     }
 
     return old;
@@ -0,0 +1,86 @@
+#include "../headers/histogram.h"
+
+/** Names of the histograms, in the same order as `hist_kind_t` */
+const char *hist_names[HIST_COUNT] = {
+    "rx_to_dequeue",
+    "rx_to_write",
+    "rx_to_ack"
+};
+
+/*
+ * Refer to headers/histogram.h
+ */
+uint64_t hist_lower_bound(size_t index) {
+    if (index < HIST_SUB_BUCKETS) {
+        return index;
+    }
+
+    int shift = index / HIST_SUB_BUCKETS - 1;
+
+    return ((uint64_t) HIST_SUB_BUCKETS + index % HIST_SUB_BUCKETS) << shift;
+}
+
+/*
+ * Refer to headers/histogram.h
+ */
+void hist_merge(hist_t *dst, hist_t *src) {
+    size_t i;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        dst->buckets[i] += __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+    }
+
+    dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    if (max > dst->max) {
+        dst->max = max;
+    }
+}
+
+/*
+ * Refer to headers/histogram.h
+ */
+uint64_t hist_percentile(hist_t *hist, double percentile) {
+    /** The buckets are summed since `count` may be ahead of them */
+    uint64_t count = 0;
+    size_t i;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        count += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t) (percentile / 100.0 * count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+        if (seen >= rank) {
+            return hist_lower_bound(i);
+        }
+    }
+
+    return hist_lower_bound(HIST_BUCKETS - 1);
+}
+
+/*
+ * Refer to headers/histogram.h
+ */
+void hist_write_text(hist_t *hist, char *scope, const char *name, FILE *out) {
+    uint64_t count = __atomic_load_n(&hist->count, __ATOMIC_RELAXED);
+    uint64_t sum = __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+
+    fprintf(out, "%s.%s.count %lu\n", scope, name, count);
+    fprintf(out, "%s.%s.mean %lu\n", scope, name, count == 0 ? 0 : sum / count);
+    fprintf(out, "%s.%s.p50 %lu\n", scope, name, hist_percentile(hist, 50.0));
+    fprintf(out, "%s.%s.p90 %lu\n", scope, name, hist_percentile(hist, 90.0));
+    fprintf(out, "%s.%s.p99 %lu\n", scope, name, hist_percentile(hist, 99.0));
+    fprintf(out, "%s.%s.p999 %lu\n", scope, name, hist_percentile(hist, 99.9));
+    fprintf(out, "%s.%s.max %lu\n", scope, name, __atomic_load_n(&hist->max, __ATOMIC_RELAXED));
+}
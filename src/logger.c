@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+#include "../headers/logger.h"
+
+/** Which client information a message prints before its arguments */
+typedef enum log_args {
+    /** Only the numeric arguments */
+    LOG_ARGS_NONE = 0,
+
+    /** Client ID, IP and port, then the numeric arguments */
+    LOG_ARGS_CLIENT,
+
+    /** IP and port, then the numeric arguments */
+    LOG_ARGS_ADDRESS
+} log_args_t;
+
+/** How a message is formatted */
+typedef struct log_format {
+    /** Class used for rate limiting */
+    log_class_t class;
+
+    /** Which client information is printed */
+    log_args_t args;
+
+    /** Component, printed between brackets */
+    const char *component;
+
+    /** printf format, numeric arguments are `%lu` */
+    const char *format;
+
+    /** Custom formatter, replaces `format` if not NULL */
+    void (*print)(FILE *out, log_rec_t *record, char *ip);
+} log_fmt_t;
+
+#define CLIENT_ERROR(text) \
+    "Error on client #%u [%s]:%u: " text "\n"
+
+void print_done(FILE *out, log_rec_t *record, char *ip);
+
+/** Formats of the messages, in the same order as `log_msg_t` */
+static const log_fmt_t formats[LOG_MSG_COUNT] = {
+    [LOG_HD_TYPE_WRONG]          = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Type is wrong"), NULL },
+    [LOG_HD_NON_DATA_TRUNCATED]  = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Non-PData packet truncated"), NULL },
+    [LOG_HD_CRC_HEADER]          = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Header could not be validated"), NULL },
+    [LOG_HD_CRC_PAYLOAD]         = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Payload could not be validated"), NULL },
+    [LOG_HD_TOO_SHORT]           = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Packet has incorrect size (too short)"), NULL },
+    [LOG_HD_TOO_LONG]            = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Packet has incorrect size (too long)"), NULL },
+    [LOG_HD_PAYLOAD_TOO_LONG]    = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Payload has incorrect size (too long)"), NULL },
+    [LOG_HD_UNKNOWN_ERROR]       = { LOG_CLASS_PACKET, LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Unknown packet error (errno = %lu)"), NULL },
+    [LOG_HD_PACK_ACK_FAILED]     = { LOG_CLASS_ERROR,  LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Failed to pack ACK (errno = %lu)"), NULL },
+    [LOG_HD_PACK_NACK_FAILED]    = { LOG_CLASS_ERROR,  LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Failed to pack NACK (errno = %lu)"), NULL },
+    [LOG_HD_INTERNAL_ERROR]      = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "HD", "Internal error\n", NULL },
+    [LOG_HD_WRITE_FAILED]        = { LOG_CLASS_ERROR,  LOG_ARGS_CLIENT, "HANDLER][ERROR", CLIENT_ERROR("Failed to write to file, won't be writing ACK to get retransmission timer"), NULL },
+    [LOG_HD_TIMESPEC_FAILED]     = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "MAIN][ERROR", "Failed to allocate timespec\n", NULL },
+    [LOG_HD_DONE]                = { LOG_CLASS_INFO,   LOG_ARGS_CLIENT, "HD", NULL, &print_done },
+    [LOG_HD_SEND_FAILED]         = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "TX", "sendmmsg failed (fd: %lu, len_to_send: %lu, errno = %lu)\n", NULL },
+    [LOG_HD_RECEIVED_STOP]       = { LOG_CLASS_INFO,   LOG_ARGS_NONE,   "HD", "Received STOP (%lu)\n", NULL },
+    [LOG_HD_AFFINITY_FAILED]     = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "HD", "Failed to set affinity\n", NULL },
+    [LOG_HD_AFFINITY]            = { LOG_CLASS_INFO,   LOG_ARGS_NONE,   "HD", "Handler #%lu running on CPU #%lu\n", NULL },
+    [LOG_HD_START_FAILED]        = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "HD", "Failed to start handle thread: alloc failed\n", NULL },
+    [LOG_HD_STOPPED]             = { LOG_CLASS_INFO,   LOG_ARGS_NONE,   "HD", "Stopped\n", NULL },
+    [LOG_HD_GSO_DISABLED]        = { LOG_CLASS_INFO,   LOG_ARGS_NONE,   "TX", "UDP GSO unavailable (errno = %lu), sending the ACKs one by one\n", NULL },
+    [LOG_RX_RECV_FAILED]         = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "RX][ERROR", "recvmmsg failed. (errno = %lu)\n", NULL },
+    [LOG_RX_CLIENT_ALLOC_FAILED] = { LOG_CLASS_ERROR,  LOG_ARGS_ADDRESS, "RX", "Client allocation failed [%s]:%u\n", NULL },
+    [LOG_RX_CLIENT_INIT_FAILED]  = { LOG_CLASS_ERROR,  LOG_ARGS_ADDRESS, "RX", "Client initialization failed [%s]:%u\n", NULL },
+    [LOG_RX_NEW_CLIENT]          = { LOG_CLASS_INFO,   LOG_ARGS_CLIENT, "RX", "New client #%u at [%s]:%u\n", NULL },
+    [LOG_RX_NODE_ALLOC_FAILED]   = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "RX", "Failed to allocate node(errno: %lu)\n", NULL },
+    [LOG_RX_AFFINITY_FAILED]     = { LOG_CLASS_ERROR,  LOG_ARGS_NONE,   "RX", "Failed to set affinity\n", NULL },
+    [LOG_RX_AFFINITY]            = { LOG_CLASS_INFO,   LOG_ARGS_NONE,   "RX", "Receiver #%lu running on CPU #%lu\n", NULL },
+    [LOG_RX_STOPPED]             = { LOG_CLASS_INFO,   LOG_ARGS_NONE,   "RX", "Stopped\n", NULL }
+};
+
+/** Names of the classes, in the same order as `log_class_t` */
+static const char *class_names[LOG_CLASS_COUNT] = {
+    "info",
+    "packet",
+    "error"
+};
+
+/** Maximum number of messages per class, per thread and per second */
+static const uint32_t class_limits[LOG_CLASS_COUNT] = {
+    1000,
+    20,
+    100
+};
+
+/** State of the logger (there's only one) */
+static struct {
+    /** Protects `rings` and `count` */
+    pthread_mutex_t lock;
+
+    /** Registered rings */
+    log_ring_t *rings[LOG_MAX_THREADS];
+
+    /** Number of registered rings */
+    size_t count;
+
+    /** Logger thread */
+    pthread_t thread;
+
+    /** Output stream */
+    FILE *out;
+
+    /** true = the logger thread is running */
+    volatile bool running;
+
+    /** true = the logger thread should stop */
+    volatile bool stop;
+
+    /** Suppressed messages of the threads without a ring */
+    uint64_t suppressed[LOG_CLASS_COUNT];
+} logger = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/** State of the calling thread */
+static __thread struct {
+    /** The ring of the thread, NULL if not registered */
+    log_ring_t *ring;
+
+    /** Start of the current rate limiting window (in ms) */
+    uint64_t window[LOG_CLASS_COUNT];
+
+    /** Number of messages in the current window */
+    uint32_t count[LOG_CLASS_COUNT];
+} local;
+
+/**
+ * Converts a number of bytes to a human readable unit.
+ */
+static void bytes_to_unit(uint64_t total, char *size, double *multiplier) {
+    char *sizes[5] = {
+        "B", "KiB", "MiB", "GiB", "TiB"
+    };
+
+    int i;
+    *multiplier = 1.0;
+    for (i = 0; i < 5; i++) {
+        if (total > 1024 && i != 4) {
+            total /= 1024;
+            *multiplier *= 1024;
+        } else {
+            strcpy(size, sizes[i]);
+            break;
+        }
+    }
+}
+
+/**
+ * Formats the end of a transfer, the arguments are
+ * the number of bytes and the duration in ns.
+ */
+void print_done(FILE *out, log_rec_t *record, char *ip) {
+    uint64_t transferred = record->args[0];
+    double time = record->args[1] * 1.0e-9;
+
+    char size[4], speed[4];
+    double sizem = 0.0, speedm = 0.0;
+
+    bytes_to_unit(transferred, size, &sizem);
+    bytes_to_unit(time > 0.0 ? transferred / time : 0, speed, &speedm);
+
+    fprintf(
+        out,
+        "Done, total transferred: %.1f %s, in %.2fs., avg. speed of %.1f %s/s for client #%u [%s]:%u\n",
+        transferred / sizem, size,
+        time,
+        (time > 0.0 ? transferred / time : 0.0) / speedm, speed,
+        record->id, ip, ntohs(record->port)
+    );
+}
+
+/**
+ * Formats a record, the caller must hold the lock of `out`.
+ */
+static void format_record(FILE *out, log_rec_t *record) {
+    const log_fmt_t *fmt = &formats[record->msg];
+
+    char ip[INET6_ADDRSTRLEN] = "";
+    if (fmt->args != LOG_ARGS_NONE) {
+        inet_ntop(AF_INET6, record->addr, ip, INET6_ADDRSTRLEN);
+    }
+
+    fprintf(out, "[%s] ", fmt->component);
+
+    if (fmt->print != NULL) {
+        fmt->print(out, record, ip);
+        return;
+    }
+
+    uint64_t *args = record->args;
+    switch (fmt->args) {
+        case LOG_ARGS_CLIENT:
+            fprintf(out, fmt->format, record->id, ip, ntohs(record->port), args[0], args[1], args[2]);
+            break;
+        case LOG_ARGS_ADDRESS:
+            fprintf(out, fmt->format, ip, ntohs(record->port), args[0], args[1], args[2]);
+            break;
+        default:
+            fprintf(out, fmt->format, args[0], args[1], args[2]);
+            break;
+    }
+}
+
+/**
+ * Applies the rate limit of a class for the calling thread.
+ */
+static bool log_allowed(log_class_t class) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+
+    uint64_t now = (uint64_t) time.tv_sec * 1000 + time.tv_nsec / 1000000;
+    if (now - local.window[class] >= 1000) {
+        local.window[class] = now;
+        local.count[class] = 0;
+    }
+
+    if (local.count[class] < class_limits[class]) {
+        local.count[class]++;
+        return true;
+    }
+
+    if (local.ring != NULL && logger.running) {
+        uint64_t *counter = &local.ring->suppressed[class];
+        __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    } else {
+        __sync_fetch_and_add(&logger.suppressed[class], 1);
+    }
+
+    return false;
+}
+
+/**
+ * Appends a record to the ring of the calling thread,
+ * or formats it right away if there is none.
+ */
+static void log_push(log_rec_t *record) {
+    log_ring_t *ring = local.ring;
+
+    if (ring == NULL || !logger.running) {
+        FILE *out = logger.out == NULL ? stderr : logger.out;
+
+        flockfile(out);
+        format_record(out, record);
+        funlockfile(out);
+
+        return;
+    }
+
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    if (head - tail >= LOG_RING_SIZE) {
+        uint64_t *counter = &ring->dropped[formats[record->msg].class];
+        __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    ring->records[head & (LOG_RING_SIZE - 1)] = *record;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Refer to headers/logger.h
+ */
+void log_event(log_msg_t msg, uint64_t a0, uint64_t a1, uint64_t a2) {
+    if (!log_allowed(formats[msg].class)) {
+        return;
+    }
+
+    log_rec_t record;
+    memset(&record, 0, sizeof(log_rec_t));
+
+    record.msg = msg;
+    record.args[0] = a0;
+    record.args[1] = a1;
+    record.args[2] = a2;
+
+    log_push(&record);
+}
+
+/*
+ * Refer to headers/logger.h
+ */
+void log_client_event(log_msg_t msg, uint32_t id, struct sockaddr_in6 *address, uint64_t a0, uint64_t a1, uint64_t a2) {
+    if (!log_allowed(formats[msg].class)) {
+        return;
+    }
+
+    log_rec_t record;
+
+    record.msg = msg;
+    record.id = id;
+    record.port = address->sin6_port;
+    memcpy(record.addr, address->sin6_addr.__in6_u.__u6_addr8, 16);
+    record.args[0] = a0;
+    record.args[1] = a1;
+    record.args[2] = a2;
+
+    log_push(&record);
+}
+
+/**
+ * Sums the suppressed and dropped counters of a class,
+ * the caller must hold `logger.lock`.
+ */
+static void sum_counters(log_class_t class, uint64_t *suppressed, uint64_t *dropped) {
+    *suppressed = __atomic_load_n(&logger.suppressed[class], __ATOMIC_RELAXED);
+    *dropped = 0;
+
+    size_t i;
+    for (i = 0; i < logger.count; i++) {
+        *suppressed += __atomic_load_n(&logger.rings[i]->suppressed[class], __ATOMIC_RELAXED);
+        *dropped += __atomic_load_n(&logger.rings[i]->dropped[class], __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * The logger thread: drains the rings and, once per second,
+ * reports the messages that were suppressed or dropped.
+ */
+void *logger_thread(void *arg) {
+    (void) arg;
+
+    FILE *out = logger.out;
+
+    uint64_t last_suppressed[LOG_CLASS_COUNT];
+    uint64_t last_dropped[LOG_CLASS_COUNT];
+    memset(last_suppressed, 0, sizeof(last_suppressed));
+    memset(last_dropped, 0, sizeof(last_dropped));
+
+    struct timespec last, now;
+    clock_gettime(CLOCK_MONOTONIC, &last);
+
+    while (true) {
+        bool stopping = __atomic_load_n(&logger.stop, __ATOMIC_ACQUIRE);
+
+        pthread_mutex_lock(&logger.lock);
+        size_t count = logger.count;
+        pthread_mutex_unlock(&logger.lock);
+
+        size_t i, written = 0;
+        flockfile(out);
+        for (i = 0; i < count; i++) {
+            log_ring_t *ring = logger.rings[i];
+
+            uint64_t tail = ring->tail;
+            uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+            for (; tail != head; tail++) {
+                format_record(out, &ring->records[tail & (LOG_RING_SIZE - 1)]);
+                written++;
+            }
+
+            __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+        }
+        funlockfile(out);
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > last.tv_sec || stopping) {
+            last = now;
+
+            pthread_mutex_lock(&logger.lock);
+            size_t class;
+            for (class = 0; class < LOG_CLASS_COUNT; class++) {
+                uint64_t suppressed, dropped;
+                sum_counters(class, &suppressed, &dropped);
+
+                if (suppressed != last_suppressed[class] || dropped != last_dropped[class]) {
+                    fprintf(
+                        out, "[LOG] %lu %s messages suppressed (rate limit), %lu dropped (ring full)\n",
+                        suppressed - last_suppressed[class], class_names[class],
+                        dropped - last_dropped[class]
+                    );
+                    written++;
+                }
+
+                last_suppressed[class] = suppressed;
+                last_dropped[class] = dropped;
+            }
+            pthread_mutex_unlock(&logger.lock);
+        }
+
+        if (written) {
+            fflush(out);
+        }
+
+        if (stopping) {
+            break;
+        }
+
+        if (!written) {
+            usleep(LOG_IDLE_US);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Refer to headers/logger.h
+ */
+int logger_start(FILE *out) {
+    if (out == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (logger.running) {
+        errno = ALREADY_ALLOCATED;
+        return -1;
+    }
+
+    logger.out = out;
+    logger.count = 0;
+    logger.stop = false;
+    memset(logger.suppressed, 0, sizeof(logger.suppressed));
+
+    if (pthread_create(&logger.thread, NULL, &logger_thread, NULL)) {
+        logger.out = NULL;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    pthread_setname_np(logger.thread, "trtp-log");
+
+    logger.running = true;
+
+    return 0;
+}
+
+/*
+ * Refer to headers/logger.h
+ */
+void logger_stop() {
+    if (!logger.running) {
+        return;
+    }
+
+    __atomic_store_n(&logger.stop, true, __ATOMIC_RELEASE);
+    pthread_join(logger.thread, NULL);
+
+    logger.running = false;
+
+    pthread_mutex_lock(&logger.lock);
+    size_t i;
+    for (i = 0; i < logger.count; i++) {
+        free(logger.rings[i]);
+        logger.rings[i] = NULL;
+    }
+    logger.count = 0;
+    pthread_mutex_unlock(&logger.lock);
+
+    local.ring = NULL;
+    logger.out = NULL;
+}
+
+/*
+ * Refer to headers/logger.h
+ */
+int logger_register() {
+    if (!logger.running) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (local.ring != NULL) {
+        errno = ALREADY_ALLOCATED;
+        return -1;
+    }
+
+    log_ring_t *ring = NULL;
+    if (posix_memalign((void **) &ring, 64, sizeof(log_ring_t))) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(log_ring_t));
+
+    pthread_mutex_lock(&logger.lock);
+    if (logger.count >= LOG_MAX_THREADS) {
+        pthread_mutex_unlock(&logger.lock);
+        free(ring);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    logger.rings[logger.count++] = ring;
+    pthread_mutex_unlock(&logger.lock);
+
+    local.ring = ring;
+
+    return 0;
+}
+
+/*
+ * Refer to headers/logger.h
+ */
+void logger_write_text(FILE *out) {
+    pthread_mutex_lock(&logger.lock);
+
+    size_t class;
+    for (class = 0; class < LOG_CLASS_COUNT; class++) {
+        uint64_t suppressed, dropped;
+        sum_counters(class, &suppressed, &dropped);
+
+        fprintf(out, "log.%s.suppressed %lu\n", class_names[class], suppressed);
+        fprintf(out, "log.%s.dropped %lu\n", class_names[class], dropped);
+    }
+
+    pthread_mutex_unlock(&logger.lock);
+}
@@ -8,7 +8,16 @@ bool global_stop;
 pthread_mutex_t stop_mutex;
 pthread_cond_t stop_cond;
 
-volatile uint32_t idx = 0;
+reg_t registry;
+workers_t workers;
+
+stats_reg_t stats_registry;
+stats_srv_t stats_server;
+volatile sig_atomic_t dump_requested = 0;
+shm_seg_t stats_segment;
+elastic_t elastic;
+tx_stage_t *tx_stages = NULL;
+seq_t sequential;
 
 /**
  * Handles the SIGINT signal
@@ -28,6 +37,40 @@ void handle_stop() {
     pthread_mutex_unlock(&stop_mutex);
 }
 
+/**
+ * Handles the SIGUSR1 signal, the dump itself
+ * is done by the main loop.
+ */
+void handle_dump() {
+    dump_requested = 1;
+}
+
+/**
+ * Writes the statistics and latency histograms
+ * to stderr if SIGUSR1 was received.
+ */
+void dump_if_requested() {
+    if (dump_requested) {
+        dump_requested = 0;
+        stats_write_text(&stats_registry, stderr);
+    }
+}
+
+/**
+ * Housekeeping of the sequential mode (see `seq_run`),
+ * returns true once stopped.
+ */
+bool sequential_tick() {
+    shm_publish_threads(&stats_segment, &stats_registry);
+    dump_if_requested();
+
+    pthread_mutex_lock(&stop_mutex);
+    bool stop = global_stop;
+    pthread_mutex_unlock(&stop_mutex);
+
+    return stop;
+}
+
 /**
  * Just read the name
  */
@@ -40,16 +83,24 @@ void print_usage(char *exec) {
     fprintf(stderr, "  -o  Output file format          [default: %%d]\n");
     fprintf(stderr, "  -s  Enables sequential mode     [default: false]\n");
     fprintf(stderr, "  -N  Number of receiver threads  [default: 1]\n");
-    fprintf(stderr, "  -n  Number of handler threads   [default: 2]\n");
-    fprintf(stderr, "  -W  Maximum receive buffer      [default: %d]\n", MAX_WINDOW_SIZE);
-    fprintf(stderr, "  -w  Maximum window size         [default: %d]\n\n", MAX_WINDOW_SIZE);
+    fprintf(stderr, "  -n  Number of handler threads   [default: 2] (min:max = elastic)\n");
+    fprintf(stderr, "  -W  Maximum receive buffer      [default: %d] (min:max = adaptive)\n", MAX_WINDOW_SIZE);
+    fprintf(stderr, "  -w  Maximum window size         [default: %d]\n", MAX_WINDOW_SIZE);
+    fprintf(stderr, "  -S  Statistics socket path      [default: none]\n");
+    fprintf(stderr, "  -M  Statistics segment name     [default: none]\n");
+    fprintf(stderr, "  -H  Huge pages (off|on|prefault) [default: on]\n");
+    fprintf(stderr, "  -q  Requests in flight (0: no limit) [default: 4 per client + 128 per thread]\n");
+    fprintf(stderr, "  -Q  Pool policy (drop|client|block) [default: drop]\n");
+    fprintf(stderr, "  -A  Affinities (file|auto)      [default: file]\n");
+    fprintf(stderr, "  -B  Busy-poll budget in us (0: off) [default: 0]\n");
+    fprintf(stderr, "  -T  Sends the ACKs from a TX stage, deadline in us [default: none]\n");
+    fprintf(stderr, "  -P  Number of worker processes  [default: 0]\n\n");
     fprintf(stderr, "Sequential:\n");
     fprintf(stderr, "  In sequential mode, only a single thread (the main thread) is used\n");
     fprintf(stderr, "  for the entire receiver. This means the parameters n & N will be\n");
-    fprintf(stderr, "  ignored. Affinities are also ignored.\n");
-    fprintf(stderr, "  Sequential mode comes with a huge performance penalty as the different\n");
-    fprintf(stderr, "  components are ran sequentially while being designed for multithreaded use.\n\n");
-    fprintf(stderr, "  /!\\ You can expect about half the speed using sequential mode.\n\n");
+    fprintf(stderr, "  ignored. Affinities, -B, -T and the min of -W are also ignored.\n");
+    fprintf(stderr, "  The datagrams are decoded where they are received, without any\n");
+    fprintf(stderr, "  queue or lock: a single core, for small deployments.\n\n");
     fprintf(stderr, "Affinities:\n");
     fprintf(stderr, "  Affinities are set using a affinity.cfg file in the\n");
     fprintf(stderr, "  working directory. This file should be formatted like this:\n");
@@ -59,7 +110,15 @@ void print_usage(char *exec) {
     fprintf(stderr, "\t0,1\n\t2,3,4,5\n");
     fprintf(stderr, "  It means the affinities of the receivers will be on CPU 0 & 1\n");
     fprintf(stderr, "  And the affinities of the handlers will be on CPU 2, 3, 4 & 5\n");
-    fprintf(stderr, "  To learn more about affinity: https://en.wikipedia.org/wiki/Processor_affinity\n\n");
+    fprintf(stderr, "  To learn more about affinity: https://en.wikipedia.org/wiki/Processor_affinity\n");
+    fprintf(stderr, "  With -A auto, the file is ignored and the threads are placed from the\n");
+    fprintf(stderr, "  CPU topology (/sys/devices/system/cpu): the receivers on the cores\n");
+    fprintf(stderr, "  handling the interrupts of the NIC (/proc/irq), the handlers on the\n");
+    fprintf(stderr, "  other cores sharing the L3 of a receiver of their stream, then on\n");
+    fprintf(stderr, "  the SMT siblings, then on the same NUMA node. The plan is printed.\n");
+    fprintf(stderr, "  On NUMA hosts, every stream belongs to the node of its first pinned\n");
+    fprintf(stderr, "  receiver (file or auto): its requests are bound to that node (mbind)\n");
+    fprintf(stderr, "  and the clients and windows are first touched by that receiver.\n\n");
     fprintf(stderr, "Streams:\n");
     fprintf(stderr, "  Streams are used for communication between the receivers and the\n");
     fprintf(stderr, "  handlers. Since they're semi locking to void races, they lock\n");
@@ -79,6 +138,73 @@ void print_usage(char *exec) {
     fprintf(stderr, "  Performace is maximal when the receive buffer is fairly large\n");
     fprintf(stderr, "  (few times the window). Also when each receiver has its own stream\n");
     fprintf(stderr, "  and a few handlers (typically two or three).\n");
+    fprintf(stderr, "  With -W min:max, each receiver adapts the number of datagrams it asks\n");
+    fprintf(stderr, "  per syscall to the arrival rate: mostly full batches double it (up to\n");
+    fprintf(stderr, "  max, 1ms timeout), mostly empty ones halve it (down to min, 50us\n");
+    fprintf(stderr, "  timeout). The current values are in rx_batch and rx_timeout_us.\n\n");
+    fprintf(stderr, "Statistics:\n");
+    fprintf(stderr, "  When a path is given with -S, a Unix socket is created at that path.\n");
+    fprintf(stderr, "  Every connection receives a text snapshot of the per-thread counters\n");
+    fprintf(stderr, "  and of the stream lengths, one `<scope>.<name> <value>` per line:\n");
+    fprintf(stderr, "\tnc -U /tmp/trtp.sock\n");
+    fprintf(stderr, "  The snapshot ends with the latency histograms of the handlers\n");
+    fprintf(stderr, "  (in ns, from the kernel receive timestamp to the dequeue, the write\n");
+    fprintf(stderr, "  and the ACK). The same snapshot is written to stderr on SIGUSR1:\n");
+    fprintf(stderr, "\tkill -USR1 <pid>\n");
+    fprintf(stderr, "  When a name is given with -M, the counters of every thread and the\n");
+    fprintf(stderr, "  state of every client are published in a shared memory segment\n");
+    fprintf(stderr, "  (see shm_open) about once per second. It can be watched using:\n");
+    fprintf(stderr, "\t./trtpstat %s\n", DEFAULT_SHM_NAME);
+    fprintf(stderr, "\nHuge pages:\n");
+    fprintf(stderr, "  The requests and the windows of the clients are reserved at startup\n");
+    fprintf(stderr, "  (for -m clients) in arenas backed by huge pages when available\n");
+    fprintf(stderr, "  (vm.nr_hugepages), by transparent huge pages otherwise. This keeps\n");
+    fprintf(stderr, "  the TLB misses down with hundreds of clients. With prefault, every\n");
+    fprintf(stderr, "  page is touched at startup rather than during the first transfers.\n");
+    fprintf(stderr, "  Once an arena is full, malloc is used.\n\n");
+    fprintf(stderr, "Elastic handlers:\n");
+    fprintf(stderr, "  With -n min:max, max handlers are started (on their affinity slots)\n");
+    fprintf(stderr, "  but only min of them take requests, the others are parked. Every\n");
+    fprintf(stderr, "  100ms, a stream whose queue or handlers are saturated gets one more\n");
+    fprintf(stderr, "  handler and, after 2 calm seconds, a stream whose load would fit in\n");
+    fprintf(stderr, "  one handler less gets one parked. Each stream keeps one handler.\n\n");
+    fprintf(stderr, "Request pool:\n");
+    fprintf(stderr, "  The requests passed from the receivers to the handlers are allocated\n");
+    fprintf(stderr, "  at startup (-q, split between the streams) so that the memory stays\n");
+    fprintf(stderr, "  the same under overload. When a receiver finds none left it either:\n");
+    fprintf(stderr, "\tdrop   - drops the datagrams (the newest ones)\n");
+    fprintf(stderr, "\tclient - same, and a client can't hold more than its share of the pool\n");
+    fprintf(stderr, "\tblock  - waits for a handler, the socket buffer fills up instead\n");
+    fprintf(stderr, "  The drops are counted in rx_pool_drops (see -S and -M).\n");
+    fprintf(stderr, "  With -q 0 the requests are allocated on demand, without any limit.\n\n");
+    fprintf(stderr, "Latency mode:\n");
+    fprintf(stderr, "  With -B us, the sockets busy-poll the NIC queue (SO_BUSY_POLL and\n");
+    fprintf(stderr, "  SO_PREFER_BUSY_POLL, raising it above net.core.busy_read needs\n");
+    fprintf(stderr, "  CAP_NET_ADMIN) and the threads spin for up to us microseconds before\n");
+    fprintf(stderr, "  sleeping: the receivers poll the socket without blocking, the handlers\n");
+    fprintf(stderr, "  watch their stream. Wakeups take microseconds instead of tens of\n");
+    fprintf(stderr, "  microseconds but every receiver and handler keeps its core busy:\n");
+    fprintf(stderr, "  give each one its own core (-A). See rx_spin_hits, rx_sleeps,\n");
+    fprintf(stderr, "  hd_spin_hits and hd_sleeps (-S and -M).\n\n");
+    fprintf(stderr, "TX stage:\n");
+    fprintf(stderr, "  With -T us, every stream gets a TX thread sending the (N)ACKs of all\n");
+    fprintf(stderr, "  its handlers: the handlers hand their batches over through a lock-free\n");
+    fprintf(stderr, "  ring and never call sendmsg. The TX thread sends up to 16 batches (one\n");
+    fprintf(stderr, "  GSO datagram each) in a single sendmmsg once it has that many or the\n");
+    fprintf(stderr, "  oldest one waited us microseconds (-T 0: whatever is there, every 20us).\n");
+    fprintf(stderr, "  A handler sends its batch itself when the ring is full (hd_tx_full).\n");
+    fprintf(stderr, "  See tx_sends and tx_frames (-S).\n\n");
+    fprintf(stderr, "Worker processes:\n");
+    fprintf(stderr, "  With -P count, the receiver forks count worker processes which each\n");
+    fprintf(stderr, "  run the whole configuration (-N, -n, -s, -q, ...) on their own\n");
+    fprintf(stderr, "  SO_REUSEPORT sockets: the kernel spreads the clients between them by\n");
+    fprintf(stderr, "  address. They share nothing but the client IDs (the output files)\n");
+    fprintf(stderr, "  and -m, which is the total of all of them, so each one can be put in\n");
+    fprintf(stderr, "  its own cgroup. The affinities are ignored. A worker killed by a\n");
+    fprintf(stderr, "  signal (a crash) is restarted within a second: only its transfers are\n");
+    fprintf(stderr, "  lost and their datagrams are refused for 30 seconds (rx_refused).\n");
+    fprintf(stderr, "  SIGINT and SIGUSR1 are forwarded to the workers, each publishes its\n");
+    fprintf(stderr, "  statistics with its number after -S and -M (e.g %s.0).\n", DEFAULT_SHM_NAME);
 }
 
 /**
@@ -95,6 +221,9 @@ void deallocate_everything(
 ) {
     LOGN("STOP", "Deallocation called\n");
     size_t i, j;
+
+    stop_stats_server(&stats_server);
+
     for (i = 0; i < config->receive_num; i++) {
         if (rx_configs[i] != NULL) {
             if (rx_configs[i]->thread != NULL) {
@@ -109,6 +238,9 @@ void deallocate_everything(
     }
     free(rx_configs);
 
+    /** Parked handlers must be able to receive their STOP */
+    elastic_stop(&elastic);
+
     for(i = 0; i < config->handle_num; i++) {
         for (j = 0; j < config->stream_count; j++) {
             s_node_t *stop_node = malloc(sizeof(s_node_t));
@@ -130,12 +262,26 @@ void deallocate_everything(
                     pthread_join(*hd_configs[i]->thread, NULL);
                     free(hd_configs[i]->thread);
                 }
+                pthread_mutex_destroy(&hd_configs[i]->park_lock);
+                pthread_cond_destroy(&hd_configs[i]->park_cond);
                 free(hd_configs[i]);
             }
         }
         free(hd_configs);
     }
 
+    elastic_destroy(&elastic);
+
+    /** After the handlers: they push in the rings until their STOP */
+    if (tx_stages != NULL) {
+        for (j = 0; j < config->stream_count; j++) {
+            tx_stop(&tx_stages[j]);
+            tx_destroy(&tx_stages[j]);
+        }
+        free(tx_stages);
+        tx_stages = NULL;
+    }
+
     if (config->addr_info != NULL) {
         freeaddrinfo(config->addr_info);
     }
@@ -148,6 +294,10 @@ void deallocate_everything(
         free(config->handle_affinities);
     }
 
+    if (config->stream_nodes != NULL) {
+        free(config->stream_nodes);
+    }
+
     if (config->handle_streams != NULL) {
         free(config->handle_streams);
     }
@@ -162,6 +312,12 @@ void deallocate_everything(
         }
     }
 
+    /** Before the streams: the requests pinned by the windows go back to them */
+    if (clients != NULL) {
+        dealloc_ht(clients);
+        free(clients);
+    }
+
     if (rx_to_hd != NULL) {
         for (j = 0; j < config->stream_count; j++) {
             dealloc_stream(rx_to_hd[j]);
@@ -178,11 +334,15 @@ void deallocate_everything(
         free(hd_to_rx);
     }
 
-    if (clients != NULL) {
-        dealloc_ht(clients);
-        free(clients);
-    }
+    /** After the clients and the streams: they hold objects of the arenas */
+    arenas_destroy();
+
+    close_shm(&stats_segment);
+    dealloc_stats_registry(&stats_registry);
+    close_registry(&registry);
 
+    /** Every worker has stopped: writes what's left */
+    logger_stop();
 }
 
 /*
@@ -195,6 +355,9 @@ int main(int argc, char *argv[]) {
     config_rcv_t config;
     memset(&config, 0, sizeof(config_rcv_t));
 
+    stats_server.sockfd = -1;
+    memset(&stats_segment, 0, sizeof(shm_seg_t));
+
     int parse = parse_receiver(argc, argv, &config);
     if (parse != 0) {
         switch(errno) {
@@ -234,10 +397,34 @@ int main(int argc, char *argv[]) {
                 LOGN("MAIN", "Invalid handler thread count\n");
                 print_usage(argv[0]);
                 break;
+            case CLI_POOL_INVALID:
+                LOGN("MAIN", "Invalid request pool size or policy\n");
+                print_usage(argv[0]);
+                break;
+            case CLI_AFFINITY_INVALID:
+                LOGN("MAIN", "Invalid affinity mode\n");
+                print_usage(argv[0]);
+                break;
+            case CLI_BUSY_POLL_INVALID:
+                LOGN("MAIN", "Invalid busy-poll budget\n");
+                print_usage(argv[0]);
+                break;
+            case CLI_TX_INVALID:
+                LOGN("MAIN", "Invalid TX stage deadline\n");
+                print_usage(argv[0]);
+                break;
+            case CLI_HUGE_INVALID:
+                LOGN("MAIN", "Invalid huge pages mode\n");
+                print_usage(argv[0]);
+                break;
             case CLI_IP_INVALID:
                 LOGN("MAIN", "Invalid IP mask\n");
                 print_usage(argv[0]);
                 break;
+            case CLI_WORKERS_INVALID:
+                LOGN("MAIN", "Invalid number of worker processes\n");
+                print_usage(argv[0]);
+                break;
             default:
                 LOG("MAIN", "Internal error (errno: %d)\n", errno);
                 break;
@@ -248,11 +435,22 @@ int main(int argc, char *argv[]) {
 
     if (config.sequential) {
         config.handle_num = 1;
+        config.handle_min = 1;
         config.receive_num = 1;
         config.stream_count = 1;
+
+        /** The handler runs on the same thread: nothing would ever be returned */
+        if (config.pool_policy == POOL_BLOCK) {
+            config.pool_policy = POOL_DROP;
+        }
     }
 
-    if (!config.sequential) {
+    /** The threads of the workers are left to the scheduler (and their cgroups) */
+    if (config.workers > 0) {
+        config.auto_affinity = false;
+    }
+
+    if (!config.sequential && !config.auto_affinity && config.workers == 0) {
         parse_affinity_file(&config);
     }
 
@@ -283,105 +481,110 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    print_config(&config);
-
-    stream_t **rx_to_hd = NULL;
-    stream_t **hd_to_rx = NULL;
-
-    ht_t *clients = NULL;
-
-    rx_cfg_t **rx_configs = NULL;
-    hd_cfg_t **hd_configs = NULL;
-
-    int sockfds[config.stream_count];
-    memset(sockfds, -1, config.stream_count);
-
-    // -------------------------------------------------------------------------
-    // Socket initialization
-    // -------------------------------------------------------------------------
+    if (!config.sequential && config.auto_affinity && topology_plan(&config)) {
+        LOG("MAIN", "Failed to place the threads (errno: %d), they are not pinned\n", errno);
+    }
 
-    size_t i;
-    for (i = 0; i < config.stream_count; i++) {
-        int sockfd = socket(
-            config.addr_info->ai_family, 
-            config.addr_info->ai_socktype, 
-            config.addr_info->ai_protocol
-        );
+    if (!config.sequential && topology_stream_nodes(&config, "")) {
+        LOG("MAIN", "Failed to find the NUMA nodes of the streams (errno: %d)\n", errno);
+    }
 
-        sockfds[i] = sockfd;
+    print_config(&config);
 
-        if (sockfd == -1) {
-            LOGN("MAIN", "Failed to create socket\n");
-            perror("socket");
+    /** Shared with the workers: created before they are forked */
+    if (create_registry(&registry, config.max_connections)) {
+        LOGN("MAIN", "Failed to create the client registry\n");
+        return -1;
+    }
 
+    /** Forked before any thread is started (the logger included) */
+    uint32_t worker = 0;
+    if (config.workers > 0) {
+        if (workers_init(&workers, &config, &registry)) {
+            LOG("MAIN", "Failed to open the sockets of the workers (errno: %d)\n", errno);
+            close_registry(&registry);
             return -1;
         }
 
-        LOG("MAIN", "Socket opened (fd: %d)\n", sockfd);
-
-        int one = 1;
-        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))) {
-            LOGN("MAIN", "Failed to set reuse address");
-            perror("setsockopt");
+        int run = workers_run(&workers);
+        if (run < 0) {
+            /** The supervisor: every worker is done */
+            size_t failures = workers.failures;
 
-            close(sockfd);
+            workers_destroy(&workers);
+            close_registry(&registry);
 
-            return -1;
-        }
+            freeaddrinfo(config.addr_info);
+            free(config.handle_streams);
+            free(config.receive_streams);
+            free(config.stream_nodes);
 
-        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))) {
-            LOGN("MAIN", "Failed to set reuse port");
-            perror("setsockopt");
+            LOG("STOP", "Goodbye (%zu workers failed)\n", failures);
 
-            close(sockfd);
-
-            return -1;
+            return failures == 0 ? 0 : -1;
         }
 
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 100000;
-
-        if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
-            LOGN("MAIN", "Failed to set receive timeout");
-            perror("setsockopt");
+        worker = run;
+    }
 
-            close(sockfd);
+    if (logger_start(stderr)) {
+        LOGN("MAIN", "Failed to start the logger, logging synchronously\n");
+    }
 
-            return -1;
+    if (config.arenas) {
+        /** The whole pool, or what it would be if it is unbounded */
+        size_t requests = config.pool_size > 0 ? config.pool_size : config.max_connections * DEFAULT_POOL_PER_CLIENT +
+            (config.receive_num + config.handle_num) * DEFAULT_POOL_PER_THREAD;
+
+        /** On NUMA hosts the pages are left to the first touch of their owner (or bound) */
+        if (arenas_init(config.max_connections, requests, config.prefault && config.stream_nodes == NULL)) {
+            LOGN("MAIN", "Failed to reserve the arenas, using malloc\n");
+        } else {
+            int kind;
+            for (kind = 0; kind < ARENA_COUNT; kind++) {
+                LOG(
+                    "MAIN", "Arena %s: %zu x %zu bytes (%zu MiB, %s)\n",
+                    arena_names[kind], arenas[kind].capacity, arenas[kind].object_size,
+                    arenas[kind].size >> 20, arena_backing_names[arenas[kind].backing]
+                );
+            }
         }
+    }
 
-        int size = 4000000;
-
-        if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size))) {
-            LOGN("MAIN", "Failed to set send buffer size");
-            perror("setsockopt");
+    stream_t **rx_to_hd = NULL;
+    stream_t **hd_to_rx = NULL;
 
-            close(sockfd);
+    ht_t *clients = NULL;
 
-            return -1;
-        }
+    rx_cfg_t **rx_configs = NULL;
+    hd_cfg_t **hd_configs = NULL;
 
-        if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size))) {
-            LOGN("MAIN", "Failed to set receive buffer size");
-            perror("setsockopt");
+    int sockfds[config.stream_count];
+    memset(sockfds, -1, config.stream_count);
 
-            close(sockfd);
+    // -------------------------------------------------------------------------
+    // Socket initialization
+    // -------------------------------------------------------------------------
 
-            return -1;
+    size_t i;
+    for (i = 0; i < config.stream_count; i++) {
+        /** A worker got its sockets from the supervisor */
+        if (config.workers > 0) {
+            sockfds[i] = workers.sockfds[worker * config.stream_count + i];
+            workers.sockfds[worker * config.stream_count + i] = -1;
+        } else {
+            sockfds[i] = rx_socket(&config);
         }
 
-        int status = bind(sockfd, config.addr_info->ai_addr, config.addr_info->ai_addrlen);
-        if (status) {
-            LOGN("MAIN", "Failed to bind socket");
-            perror("bind");
-
-            close(sockfd);
-
+        if (sockfds[i] == -1) {
             return -1;
         }
     }
 
+    if (config.workers > 0) {
+        workers_destroy(&workers);
+    }
+
     // -------------------------------------------------------------------------
     // Data structure allocations
     // -------------------------------------------------------------------------
@@ -457,6 +660,57 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // -------------------------------------------------------------------------
+    // Request pool, every request is allocated now if it is bounded
+    // -------------------------------------------------------------------------
+
+    size_t pool_per_stream = config.pool_size == 0 ? 0 : MAX(config.pool_size / config.stream_count, 1);
+    for (i = 0; i < config.stream_count; i++) {
+        /** The requests of the stream, bound to its node once allocated */
+        uint8_t *first = NULL;
+        uint8_t *last = NULL;
+
+        size_t j;
+        for (j = 0; j < pool_per_stream; j++) {
+            s_node_t *node = malloc(sizeof(s_node_t));
+            if (node == NULL || initialize_node(node, allocate_handle_request)) {
+                LOGN("MAIN", "Failed to allocate the request pool\n");
+                free(node);
+
+                deallocate_everything(
+                    &config,
+                    sockfds,
+                    rx_to_hd, 
+                    hd_to_rx,
+                    clients, 
+                    rx_configs,
+                    hd_configs
+                );
+
+                return -1;
+            }
+
+            if (arena_contains(&arenas[ARENA_REQUESTS], node->content)) {
+                first = first == NULL ? node->content : MIN(first, (uint8_t *) node->content);
+                last = MAX(last, (uint8_t *) node->content);
+            }
+
+            stream_enqueue(hd_to_rx[i], node);
+        }
+
+        if (config.stream_nodes != NULL && config.stream_nodes[i] != TOPO_NO_NODE && first != NULL) {
+            size_t len = last + arenas[ARENA_REQUESTS].object_size - first;
+            if (topology_bind(first, len, config.stream_nodes[i])) {
+                LOG("MAIN", "Failed to bind the requests of stream %zu to node %zu\n", i, config.stream_nodes[i]);
+            } else if (config.prefault) {
+                size_t offset;
+                for (offset = 0; offset < len; offset += ARENA_PAGE_SIZE) {
+                    first[offset] = 0;
+                }
+            }
+        }
+    }
+
     clients = calloc(1, sizeof(ht_t));
     if (clients == NULL || allocate_ht(clients)) {
         LOGN("MAIN", "Failed to initialize 'clients'\n");
@@ -529,7 +783,11 @@ int main(int argc, char *argv[]) {
 
     for (i = 0; i < config.handle_num; i++) {
         hd_configs[i] = calloc(1, sizeof(hd_cfg_t));
-        if (hd_configs[i] == NULL) {
+        if (
+            hd_configs[i] == NULL ||
+            pthread_mutex_init(&hd_configs[i]->park_lock, NULL) ||
+            pthread_cond_init(&hd_configs[i]->park_cond, NULL)
+        ) {
             LOG("MAIN", "Failed to initialize 'hd_configs[%zu]'\n", i);
         
             deallocate_everything(
@@ -546,6 +804,64 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    /** The sequential mode sends its own ACKs */
+    size_t tx_num = config.tx_stage && !config.sequential ? config.stream_count : 0;
+
+    if (allocate_stats_registry(&stats_registry, config.receive_num, config.handle_num, tx_num)) {
+        LOGN("MAIN", "Failed to initialize 'stats_registry'\n");
+        
+        deallocate_everything(
+            &config,
+            sockfds,
+            rx_to_hd, 
+            hd_to_rx, 
+            clients, 
+            rx_configs,
+            hd_configs
+        );
+        
+        return -1;
+    }
+
+    stats_registry.stream_count = config.stream_count;
+    stats_registry.rx_to_hd = rx_to_hd;
+    stats_registry.hd_to_rx = hd_to_rx;
+
+    if (tx_num > 0) {
+        tx_stages = calloc(tx_num, sizeof(tx_stage_t));
+
+        for (i = 0; i < tx_num && tx_stages != NULL; i++) {
+            if (tx_init(&tx_stages[i], i, sockfds[i], config.tx_deadline_us, &stats_registry.tx[i])) {
+                break;
+            }
+        }
+
+        if (tx_stages == NULL || i < tx_num) {
+            LOGN("MAIN", "Failed to initialize 'tx_stages'\n");
+
+            deallocate_everything(
+                &config,
+                sockfds,
+                rx_to_hd, 
+                hd_to_rx, 
+                clients, 
+                rx_configs,
+                hd_configs
+            );
+
+            return -1;
+        }
+    }
+
+    if (config.shm_name != NULL) {
+        if (create_shm(&stats_segment, config.shm_name, config.receive_num, config.handle_num, config.max_connections)) {
+            LOG("MAIN", "Failed to create the statistics segment %s\n", config.shm_name);
+            perror("shm");
+        } else {
+            LOG("MAIN", "Statistics published in %s\n", config.shm_name);
+        }
+    }
+
     // -------------------------------------------------------------------------
     // Thread configs initialization
     // -------------------------------------------------------------------------
@@ -554,7 +870,8 @@ int main(int argc, char *argv[]) {
         rx_configs[i]->id = i;
         rx_configs[i]->clients = clients;
         rx_configs[i]->file_format = config.format;
-        rx_configs[i]->idx = &idx;
+        rx_configs[i]->registry = &registry;
+        rx_configs[i]->worker = worker;
         rx_configs[i]->max_clients = config.max_connections;
         rx_configs[i]->sockfd = sockfds[config.receive_streams[i].stream];
         rx_configs[i]->stop = false;
@@ -562,7 +879,13 @@ int main(int argc, char *argv[]) {
         rx_configs[i]->tx = rx_to_hd[config.receive_streams[i].stream];
         rx_configs[i]->addr_len = &config.addr_info->ai_addrlen;
         rx_configs[i]->window_size = config.receive_window_size;
+        rx_configs[i]->batch_min = config.receive_window_min;
         rx_configs[i]->affinity = config.receive_affinities == NULL ? NULL : &config.receive_affinities[i];
+        rx_configs[i]->stats = &stats_registry.rx[i];
+        rx_configs[i]->shm = stats_segment.header == NULL ? NULL : &stats_segment;
+        rx_configs[i]->pool_size = pool_per_stream;
+        rx_configs[i]->pool_policy = config.pool_policy;
+        rx_configs[i]->spin_ns = config.busy_poll_us * 1000;
     }
 
     for (i = 0; i < config.handle_num; i++) {
@@ -573,6 +896,20 @@ int main(int argc, char *argv[]) {
         hd_configs[i]->tx = hd_to_rx[config.handle_streams[i].stream];
         hd_configs[i]->max_window_size = config.max_window;
         hd_configs[i]->affinity = config.handle_affinities == NULL ? NULL : &config.handle_affinities[i];
+        hd_configs[i]->stats = &stats_registry.hd[i];
+        hd_configs[i]->latency = &stats_registry.latency[i * HIST_COUNT];
+        hd_configs[i]->spin_ns = config.busy_poll_us * 1000;
+        hd_configs[i]->ack_tx = tx_stages == NULL ? NULL : &tx_stages[config.handle_streams[i].stream];
+        hd_configs[i]->pin_reserve = pool_per_stream == 0 ? 0 : MAX(pool_per_stream / 4, 1);
+    }
+
+    if (config.stats_path != NULL) {
+        if (start_stats_server(&stats_server, &stats_registry, config.stats_path)) {
+            LOG("MAIN", "Failed to start the statistics socket at %s\n", config.stats_path);
+            perror("stats");
+        } else {
+            LOG("MAIN", "Statistics available at %s\n", config.stats_path);
+        }
     }
 
     // -------------------------------------------------------------------------
@@ -613,6 +950,30 @@ int main(int argc, char *argv[]) {
                 
                 return -1;
             }
+
+            /** Shown by top -H and in /proc/<pid>/task/<tid>/comm */
+            char name[16];
+            snprintf(name, sizeof(name), "trtp-rx-%zu", i);
+            pthread_setname_np(*rx_configs[i]->thread, name);
+        }
+
+        /** Before the handlers, they may hand over (N)ACKs right away */
+        for (i = 0; i < tx_num; i++) {
+            if (tx_start(&tx_stages[i])) {
+                LOG("MAIN", "Failed to start the TX stage #%zu, its handlers send their own ACKs\n", i);
+
+                size_t k;
+                for (k = 0; k < config.handle_num; k++) {
+                    if (hd_configs[k]->ack_tx == &tx_stages[i]) {
+                        hd_configs[k]->ack_tx = NULL;
+                    }
+                }
+            }
+        }
+
+        /** Elastic handlers: the ones above the minimum start parked */
+        if (config.handle_min < config.handle_num && elastic_init(&elastic, &config, hd_configs, rx_to_hd)) {
+            LOGN("MAIN", "Failed to initialize the elastic handlers, they are all active\n");
         }
 
         for (i = 0; i < config.handle_num; i++) {
@@ -648,6 +1009,15 @@ int main(int argc, char *argv[]) {
                 
                 return -1;
             }
+
+            char name[16];
+            snprintf(name, sizeof(name), "trtp-hd-%zu", i);
+            pthread_setname_np(*hd_configs[i]->thread, name);
+        }
+
+        if (elastic.handlers != NULL && elastic_start(&elastic)) {
+            LOGN("MAIN", "Failed to start the elastic controller, the parked handlers are woken up\n");
+            elastic_stop(&elastic);
         }
     }
 
@@ -688,131 +1058,15 @@ int main(int argc, char *argv[]) {
     }
 
     signal(SIGINT, handle_stop);
+    signal(SIGUSR1, handle_dump);
 
     if (config.sequential) {
-        socklen_t addr_len = sizeof(struct sockaddr_in6);
-        uint8_t buffers[config.receive_window_size][MAX_PACKET_SIZE];
-        struct sockaddr_in6 addrs[config.receive_window_size];
-        struct mmsghdr msgs[config.receive_window_size];
-        struct iovec iovecs[config.receive_window_size];
-
-        size_t i;
-        for(i = 0; i < config.receive_window_size; i++) {
-            memset(&addrs[i], 0, sizeof(struct sockaddr_in6));
-            memset(&iovecs[i], 0, sizeof(struct iovec));
-            memset(&msgs[i], 0, sizeof(struct mmsghdr));
-            
-            iovecs[i].iov_base = buffers[i];
-            iovecs[i].iov_len = MAX_PACKET_SIZE;
-
-            msgs[i].msg_hdr.msg_name = &addrs[i];
-            msgs[i].msg_hdr.msg_namelen = addr_len;
-            msgs[i].msg_hdr.msg_iov = &iovecs[i];
-            msgs[i].msg_hdr.msg_iovlen = 1;
-            msgs[i].msg_hdr.msg_flags = 0;
-            msgs[i].msg_hdr.msg_control = NULL;
-        }
-
-        bool exit = false;
-        uint8_t file_buffer[MAX_PACKET_SIZE * MAX_WINDOW_SIZE];
-        packet_t **decoded = malloc(sizeof(packet_t *));
-        if (decoded == NULL) {
-            LOGN("MAIN", "Failed to start handle thread: alloc failed\n");
-            return -1;
-        }
-        *decoded = allocate_packet();
-        if (*decoded == NULL) {
-            LOGN("MAIN", "Failed to start handle thread: alloc failed\n");
-            return -1;
-        }
-
-        uint8_t packets_to_send[MAX_WINDOW_SIZE + 1][12];
-        struct mmsghdr msg[MAX_WINDOW_SIZE + 1];
-        struct iovec hd_iovecs[MAX_WINDOW_SIZE + 1];
-
-        memset(hd_iovecs, 0, sizeof(iovecs));
-        for(i = 0; i < MAX_WINDOW_SIZE + 1; i++) {
-            memset(&hd_iovecs[i], 0, sizeof(struct iovec));
-            hd_iovecs[i].iov_base = packets_to_send[i];
-            hd_iovecs[i].iov_len  = 11;
-
-            memset(&msg[i], 0, sizeof(struct mmsghdr));
-            msg[i].msg_hdr.msg_iov = &hd_iovecs[i];
-            msg[i].msg_hdr.msg_iovlen = 1;
-            msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
-        }
-
-        int cnt = 0;
-        while (true) {
-            cnt++;
-            pthread_mutex_lock(&stop_mutex);
-            if (global_stop) {
-                pthread_mutex_unlock(&stop_mutex);
-                break;
-            }
-            pthread_mutex_unlock(&stop_mutex);
-
-            rx_run_once(
-                rx_configs[0],
-                buffers,
-                addr_len,
-                addrs,
-                msgs
-            );
-
-            while(hd_configs[0]->rx->length != 0) {
-                hd_run_once(
-                    false,
-                    hd_configs[0],
-                    decoded,
-                    &exit,
-                    file_buffer,
-                    packets_to_send,
-                    msg
-                );
-            }
-
-            if (cnt % 10 == 0) {
-                struct timespec time;
-                clock_gettime(CLOCK_MONOTONIC, &time);
-
-                pthread_mutex_lock(clients->lock);
-
-                client_t *client_to_remove[clients->size];
-                size_t len_to_remove = 0;
-
-                for (i = 0; i < clients->size; i++) {
-                    client_t *client = clients->items[i].value;
-                    if (clients->items[i].used && client->end_time != NULL && !client->active) {
-                        double time_inactive = ((double) time.tv_sec + 1.0e-9 * time.tv_nsec) - 
-                            ((double) client->end_time->tv_sec + 1.0e-9 * client->end_time->tv_nsec);
-                        if (time_inactive > 30.0) {
-                            client_to_remove[len_to_remove++] = client;
-                        }
-                    }
-                }
-
-                pthread_mutex_unlock(clients->lock);
-
-                for (i = 0; i < len_to_remove; i++) {
-                    ht_remove(
-                        clients, 
-                        client_to_remove[i]->address->sin6_port, 
-                        client_to_remove[i]->address->sin6_addr.__in6_u.__u6_addr8
-                    );
-
-                    LOG("MAIN", "Client #%d removed\n", client_to_remove[i]->id);
-
-                    deallocate_client(client_to_remove[i], true, true);
-                }
-            }
+        if (seq_init(&sequential, rx_configs[0], hd_configs[0])) {
+            LOG("MAIN", "Failed to initialize the sequential engine (errno: %d)\n", errno);
+        } else {
+            seq_run(&sequential, sequential_tick);
+            seq_destroy(&sequential);
         }
-
-        if (decoded != NULL) {
-            dealloc_packet(*decoded);
-            free(decoded);
-        }
-
     } else {
         while (true) {
             pthread_mutex_lock(&stop_mutex);
@@ -825,6 +1079,9 @@ int main(int argc, char *argv[]) {
             struct timespec time;
             clock_gettime(CLOCK_MONOTONIC, &time);
 
+            shm_publish_threads(&stats_segment, &stats_registry);
+            dump_if_requested();
+
             pthread_mutex_lock(clients->lock);
 
             client_t *client_to_remove[clients->size];
@@ -856,6 +1113,8 @@ int main(int argc, char *argv[]) {
                     removed ? "yes" : "no"
                 );
 
+                reg_release(&registry, client_to_remove[i]->registry_entry);
+                shm_detach_client(client_to_remove[i]);
                 deallocate_client(client_to_remove[i], true, true);
             }
 
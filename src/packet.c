@@ -87,14 +87,16 @@ int init_packet(packet_t* packet) {
  * Refer to headers/packet.h
  */
 int dealloc_packet(packet_t* packet) {
-    free(packet);
+    arena_put(packet);
     return 0;
 }
 
 /**
- * Refer to headers/packet.h
+ * `unpack`, with the header and payload CRCs in `crcs` (or
+ * computed here if it's NULL). If `payload` isn't NULL, the
+ * payload isn't copied in `out` and it receives where it is.
  */
-int unpack(uint8_t *packet, int length, packet_t *out) {
+static int unpack_crcs(uint8_t *packet, int length, packet_t *out, uint32_t *crcs, uint8_t **payload) {
     uint8_t *buffer = packet;
     int length_rest = length;
 
@@ -153,7 +155,7 @@ int unpack(uint8_t *packet, int length, packet_t *out) {
     size_t len = 7 + is_long;
     *header_pointer &= 0xDF;
 
-    uint32_t crc = CRC32H(0, (void*) packet, len);
+    uint32_t crc = crcs == NULL ? CRC32H(0, (void*) packet, len) : crcs[0];
     if (out->crc1 != crc) {
         errno = CRC_VALIDATION_FAILED;
 
@@ -176,7 +178,9 @@ int unpack(uint8_t *packet, int length, packet_t *out) {
             return -1;
         }
 
-        if (&out->payload != memcpy(&out->payload, buffer, out->length)) {
+        if (payload != NULL) {
+            *payload = buffer;
+        } else if (&out->payload != memcpy(&out->payload, buffer, out->length)) {
             errno = FAILED_TO_COPY;
             return -1;
         }
@@ -213,7 +217,9 @@ int unpack(uint8_t *packet, int length, packet_t *out) {
         errno = PAYLOAD_TOO_LONG;
         return -1;
     } else if (out->length > 0 && !out->truncated) {
-        crc = CRC32P(0, (void*) out->payload, (size_t) out->length);
+        /** Only the payload of a DATA is copied (and precomputed) */
+        uint8_t *data = payload != NULL && out->type == DATA ? *payload : out->payload;
+        crc = crcs == NULL || out->type != DATA ? CRC32P(0, (void*) data, (size_t) out->length) : crcs[1];
         if (out->crc2 != crc) {
             errno = PAYLOAD_VALIDATION_FAILED;
 
@@ -224,6 +230,44 @@ int unpack(uint8_t *packet, int length, packet_t *out) {
     return 0;
 }
 
+/**
+ * Refer to headers/packet.h
+ */
+int unpack(uint8_t *packet, int length, packet_t *out) {
+    return unpack_crcs(packet, length, out, NULL, NULL);
+}
+
+/**
+ * Refer to headers/packet.h
+ */
+int unpack_precomputed(uint8_t *packet, int length, packet_t *out, uint32_t crc1, uint32_t crc2) {
+    uint32_t crcs[2] = { crc1, crc2 };
+    return unpack_crcs(packet, length, out, crcs, NULL);
+}
+
+/**
+ * Refer to headers/packet.h
+ */
+int unpack_view(uint8_t *packet, int length, pkt_view_t *out, uint32_t crc1, uint32_t crc2) {
+    /** Only the header fields are written, the payload stays in `packet` */
+    packet_t header;
+    uint8_t *payload = NULL;
+    uint32_t crcs[2] = { crc1, crc2 };
+
+    if (unpack_crcs(packet, length, &header, crcs, &payload)) {
+        return -1;
+    }
+
+    out->type = header.type;
+    out->truncated = header.truncated;
+    out->seqnum = header.seqnum;
+    out->length = header.length;
+    out->timestamp = header.timestamp;
+    out->payload = payload;
+
+    return 0;
+}
+
 /**
  * Refer to headers/packet.h
  */
@@ -243,9 +287,9 @@ int pack(uint8_t *packet, packet_t *in, bool recompute_crc2) {
     if (in->long_length) {
         length++;
 
-        uint16_t len = htons(in->length);
-        (*packet++) = (uint8_t) (0x80 | (len & 0x7F));
-        (*packet++) = (uint8_t) (len >> 7);
+        /** 15 bits in network byte order, the first bit is L */
+        (*packet++) = (uint8_t) (0x80 | ((in->length >> 8) & 0x7F));
+        (*packet++) = (uint8_t) (in->length & 0xFF);
     } else {
         (*packet++) = (uint8_t) (in->length & 0x7F);
     }
@@ -289,6 +333,291 @@ int pack(uint8_t *packet, packet_t *in, bool recompute_crc2) {
     return 0;
 }
 
+/**
+ * Refer to headers/packet.h
+ */
+int pack_ack(uint8_t *packet, packet_t *in) {
+    if (in == NULL || packet == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    if (in->type != ACK && in->type != NACK) {
+        errno = TYPE_IS_WRONG;
+        return -1;
+    }
+
+    uint8_t header = (in->type << 6) | (in->window & 0x1F);
+    uint32_t timestamp = htonl(in->timestamp);
+
+    uint8_t t0 = (uint8_t) (timestamp);
+    uint8_t t1 = (uint8_t) (timestamp >> 8);
+    uint8_t t2 = (uint8_t) (timestamp >> 16);
+    uint8_t t3 = (uint8_t) (timestamp >> 24);
+
+    uint32_t crc1 = htonl(
+        ack_crc[0][header] ^ ack_crc[1][in->seqnum] ^
+        ack_crc[2][t0] ^ ack_crc[3][t1] ^ ack_crc[4][t2] ^ ack_crc[5][t3]
+    );
+
+    packet[0] = header;
+    packet[1] = 0;
+    packet[2] = in->seqnum;
+    packet[3] = t0;
+    packet[4] = t1;
+    packet[5] = t2;
+    packet[6] = t3;
+    packet[7] = (uint8_t) (crc1);
+    packet[8] = (uint8_t) (crc1 >> 8);
+    packet[9] = (uint8_t) (crc1 >> 16);
+    packet[10] = (uint8_t) (crc1 >> 24);
+
+    return 0;
+}
+
+/**
+ * Advances a CRC (inverted) by the next 8 bytes of `data`, the
+ * slicing-by-8 step of lib/Crc32.cpp (little endian).
+ */
+static inline uint32_t crc32_step8(uint32_t crc, const uint8_t *data) {
+    uint32_t one, two;
+    memcpy(&one, data, sizeof(uint32_t));
+    memcpy(&two, data + 4, sizeof(uint32_t));
+    one ^= crc;
+
+    return Crc32Lookup[7][ one        & 0xFF] ^
+           Crc32Lookup[6][(one >>  8) & 0xFF] ^
+           Crc32Lookup[5][(one >> 16) & 0xFF] ^
+           Crc32Lookup[4][ one >> 24        ] ^
+           Crc32Lookup[3][ two        & 0xFF] ^
+           Crc32Lookup[2][(two >>  8) & 0xFF] ^
+           Crc32Lookup[1][(two >> 16) & 0xFF] ^
+           Crc32Lookup[0][ two >> 24        ];
+}
+
+/**
+ * Advances a CRC (inverted) by one byte.
+ */
+static inline uint32_t crc32_step1(uint32_t crc, uint8_t byte) {
+    return (crc >> 8) ^ Crc32Lookup[0][(crc ^ byte) & 0xFF];
+}
+
+/**
+ * Computes `CRC_LANES` CRCs side by side, see `crc32_batch`.
+ */
+static void crc32_lanes(uint8_t **data, size_t *lengths, uint32_t *crcs) {
+    uint8_t *p0 = data[0], *p1 = data[1], *p2 = data[2], *p3 = data[3];
+    uint32_t c0 = ~0U, c1 = ~0U, c2 = ~0U, c3 = ~0U;
+
+    size_t common = MIN(MIN(lengths[0], lengths[1]), MIN(lengths[2], lengths[3]));
+    size_t i;
+
+    for (i = 0; i + 8 <= common; i += 8) {
+        c0 = crc32_step8(c0, p0 + i);
+        c1 = crc32_step8(c1, p1 + i);
+        c2 = crc32_step8(c2, p2 + i);
+        c3 = crc32_step8(c3, p3 + i);
+    }
+
+    for (; i < common; i++) {
+        c0 = crc32_step1(c0, p0[i]);
+        c1 = crc32_step1(c1, p1[i]);
+        c2 = crc32_step1(c2, p2[i]);
+        c3 = crc32_step1(c3, p3[i]);
+    }
+
+    /** `crc32_16bytes` takes the CRC so far, not the inverted one */
+    crcs[0] = crc32_16bytes(p0 + common, lengths[0] - common, ~c0);
+    crcs[1] = crc32_16bytes(p1 + common, lengths[1] - common, ~c1);
+    crcs[2] = crc32_16bytes(p2 + common, lengths[2] - common, ~c2);
+    crcs[3] = crc32_16bytes(p3 + common, lengths[3] - common, ~c3);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Advances a CRC (inverted) by the `length` bytes of `data` (a multiple
+ * of 16, at least 64) by folding them with carry-less multiplications:
+ * four independent 128 bits accumulators, each folded 64 bytes ahead,
+ * then folded into one and reduced (Barrett) to 32 bits.
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_fold(const uint8_t *data, size_t length, uint32_t crc) {
+    /** The constants of the reflected CRC32 polynomial given in the paper */
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i *) (data + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i *) (data + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i *) (data + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i *) (data + 0x30));
+    __m128i x5, x6, x7, x8;
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+
+    data += 64;
+    length -= 64;
+
+    while (length >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) (data + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (data + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (data + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (data + 0x30)));
+
+        data += 64;
+        length -= 64;
+    }
+
+    /** Four accumulators into one */
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    while (length >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *) data)), x5);
+
+        data += 16;
+        length -= 16;
+    }
+
+    /** 128 bits to 64 bits */
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, low32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /** Barrett reduction to 32 bits */
+    x2 = _mm_and_si128(x1, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return (uint32_t) _mm_extract_epi32(x1, 1);
+}
+
+/**
+ * Computes the CRC of a buffer of at least 64 bytes with `crc32_fold`,
+ * the last `length % 16` bytes with the tables.
+ */
+static uint32_t crc32_long(const uint8_t *data, size_t length) {
+    size_t folded = length & ~((size_t) 15);
+    uint32_t crc = crc32_fold(data, folded, ~0U);
+
+    /** `crc32_16bytes` takes the CRC so far, not the inverted one */
+    return crc32_16bytes(data + folded, length - folded, ~crc);
+}
+
+/**
+ * Does the CPU have PCLMULQDQ (and SSE4.1)? Checked once.
+ */
+static bool crc32_has_fold() {
+    static int supported = -1;
+
+    if (supported == -1) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    }
+
+    return supported;
+}
+#endif
+
+/**
+ * Computes the CRCs of `count` buffers `CRC_LANES` at a time with
+ * `crc32_lanes`, see `crc32_batch`.
+ */
+static void crc32_grouped(uint8_t **data, size_t *lengths, size_t count, uint32_t *crcs) {
+    size_t i, j;
+    for (i = 0; i < count; i += CRC_LANES) {
+        uint8_t *lane_data[CRC_LANES];
+        size_t lane_lengths[CRC_LANES];
+        uint32_t lane_crcs[CRC_LANES];
+
+        /** The last group is padded with its first buffer (computed twice, ignored) */
+        for (j = 0; j < CRC_LANES; j++) {
+            size_t k = i + j < count ? i + j : i;
+            lane_data[j] = data[k];
+            lane_lengths[j] = lengths[k];
+        }
+
+        crc32_lanes(lane_data, lane_lengths, lane_crcs);
+
+        for (j = 0; j < CRC_LANES && i + j < count; j++) {
+            crcs[i + j] = lane_crcs[j];
+        }
+    }
+}
+
+/**
+ * Refer to headers/packet.h
+ */
+void crc32_batch(uint8_t **data, size_t *lengths, size_t count, uint32_t *crcs) {
+#if __BYTE_ORDER == __BIG_ENDIAN
+    size_t j;
+    for (j = 0; j < count; j++) {
+        crcs[j] = crc32_16bytes(data[j], lengths[j], 0);
+    }
+#else
+#if defined(__x86_64__) || defined(__i386__)
+    if (count > 0 && crc32_has_fold()) {
+        /** The long buffers are folded, the short ones go through the lanes */
+        uint8_t *short_data[count];
+        size_t short_lengths[count];
+        size_t short_index[count];
+        uint32_t short_crcs[count];
+        size_t shorts = 0;
+        size_t i;
+
+        for (i = 0; i < count; i++) {
+            if (lengths[i] >= CRC_FOLD_MIN) {
+                crcs[i] = crc32_long(data[i], lengths[i]);
+            } else {
+                short_data[shorts] = data[i];
+                short_lengths[shorts] = lengths[i];
+                short_index[shorts++] = i;
+            }
+        }
+
+        crc32_grouped(short_data, short_lengths, shorts, short_crcs);
+
+        for (i = 0; i < shorts; i++) {
+            crcs[short_index[i]] = short_crcs[i];
+        }
+
+        return;
+    }
+#endif
+
+    crc32_grouped(data, lengths, count, crcs);
+#endif
+}
+
 /**
  * Refer to headers/packet.h
  */
@@ -382,8 +711,24 @@ inline __attribute__((always_inline)) bool ip_equals(uint8_t *ip1, uint8_t *ip2)
 void *allocate_packet() {
     packet_t *pack = malloc(sizeof(packet_t));
     if (pack == NULL || init_packet(pack)) {
+        free(pack);
+        errno = FAILED_TO_ALLOCATE;
         return NULL;
     }
 
     return pack;
 }
+
+/**
+ * Refer to headers/packet.h
+ */
+void *allocate_view() {
+    pkt_view_t *view = arena_get(ARENA_VIEWS, sizeof(pkt_view_t));
+    if (view == NULL) {
+        return NULL;
+    }
+
+    memset(view, 0, sizeof(pkt_view_t));
+
+    return view;
+}
@@ -5,26 +5,124 @@
 bool init = false;
 pthread_mutex_t receiver_mutex;
 
+/**
+ * Polls the socket without blocking for at most `spin_ns`.
+ * With SO_BUSY_POLL every call also polls the device queue.
+ *
+ * Returns the number of datagrams received, 0 if the budget ran
+ * out, -1 if `recvmmsg` failed (errno is set).
+ */
+static int rx_spin(rx_cfg_t *rcv_cfg, struct mmsghdr *msgs) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    uint64_t deadline = (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec + rcv_cfg->spin_ns;
+
+    while (!rcv_cfg->stop) {
+        int retval = recvmmsg(rcv_cfg->sockfd, msgs, rcv_cfg->batch, MSG_DONTWAIT, NULL);
+        if (retval > 0) {
+            STAT_INC(rcv_cfg->stats, STAT_RX_SPIN_HITS);
+            return retval;
+        }
+
+        if (retval == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+
+        _pause();
+
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        if ((uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec >= deadline) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Sets the batch size and the matching timeout, see `rx_adapt`.
+ */
+static void rx_set_batch(rx_cfg_t *rcv_cfg, size_t batch) {
+    size_t min = rcv_cfg->batch_min;
+    size_t max = rcv_cfg->window_size;
+
+    rcv_cfg->batch = batch;
+    rcv_cfg->since_resize = 0;
+    if (min == 0 || min >= max) {
+        rcv_cfg->timeout_ns = RX_TIMEOUT_MAX_NS;
+    } else {
+        rcv_cfg->timeout_ns = RX_TIMEOUT_MIN_NS +
+            (long) ((RX_TIMEOUT_MAX_NS - RX_TIMEOUT_MIN_NS) * (batch - min) / (max - min));
+    }
+
+    STAT_SET(rcv_cfg->stats, STAT_RX_BATCH, batch);
+    STAT_SET(rcv_cfg->stats, STAT_RX_TIMEOUT_US, rcv_cfg->timeout_ns / 1000);
+}
+
 /*
  * Refer to headers/receiver.h
  */
-void rx_run_once(
-    rx_cfg_t *rcv_cfg, 
-    uint8_t buffers[][MAX_PACKET_SIZE],
-    socklen_t addr_len,
-    struct sockaddr_in6 *addrs, 
-    struct mmsghdr *msgs
-) {
+void rx_adapt(rx_cfg_t *rcv_cfg, int retval) {
+    size_t min = rcv_cfg->batch_min;
+    size_t max = rcv_cfg->window_size;
+    if (min == 0 || min >= max) {
+        return;
+    }
+
+    /** Exponential moving average, 1/8 weight for the last call */
+    rcv_cfg->fill += (retval * RX_FILL_ONE - rcv_cfg->fill) / 8;
+
+    if (++rcv_cfg->since_resize < RX_ADAPT_PERIOD) {
+        return;
+    }
+
+    size_t batch = rcv_cfg->batch;
+    size_t fill = (size_t) rcv_cfg->fill;
+    if (fill * 4 >= batch * RX_FILL_ONE * 3 && batch < max) {
+        rx_set_batch(rcv_cfg, MIN(batch * 2, max));
+        STAT_INC(rcv_cfg->stats, STAT_RX_BATCH_RESIZES);
+    } else if (fill * 4 < batch * RX_FILL_ONE && batch > min) {
+        rx_set_batch(rcv_cfg, MAX(batch / 2, min));
+        STAT_INC(rcv_cfg->stats, STAT_RX_BATCH_RESIZES);
+    }
+}
+
+/*
+ * Refer to headers/receiver.h
+ */
+int rx_receive(rx_cfg_t *rcv_cfg, struct mmsghdr *msgs) {
     int i;
-    int window_size = rcv_cfg->window_size;
-    s_node_t *node;
-    hd_req_t *req;
+
+    /** Starts from the largest batch, the controller brings it down when idle */
+    if (rcv_cfg->batch == 0) {
+        rcv_cfg->fill = rcv_cfg->window_size * RX_FILL_ONE;
+        rx_set_batch(rcv_cfg, rcv_cfg->window_size);
+    }
+
+    int window_size = rcv_cfg->batch;
 
     struct timespec tmo;
     tmo.tv_sec = 0;
-    tmo.tv_nsec = 1000*1000;
+    tmo.tv_nsec = rcv_cfg->timeout_ns;
 
-    int retval = recvmmsg(rcv_cfg->sockfd, msgs, window_size, MSG_WAITFORONE, &tmo);
+    /** The kernel overwrites the length of the ancillary data */
+    if (msgs[0].msg_hdr.msg_control != NULL) {
+        for (i = 0; i < window_size; i++) {
+            msgs[i].msg_hdr.msg_controllen = RX_CONTROL_LEN;
+        }
+    }
+
+    int retval = 0;
+    if (rcv_cfg->spin_ns > 0) {
+        retval = rx_spin(rcv_cfg, msgs);
+        if (retval == 0) {
+            STAT_INC(rcv_cfg->stats, STAT_RX_SLEEPS);
+        }
+    }
+
+    if (retval == 0) {
+        retval = recvmmsg(rcv_cfg->sockfd, msgs, window_size, MSG_WAITFORONE, &tmo);
+    }
     
     if (retval == -1) {
         switch(errno) {
@@ -34,116 +132,332 @@ void rx_run_once(
                 TRACEN("recvmmsg was interrupted\n");
                 break;
             default :
-                LOG("RX][ERROR]", "recvmmsg failed. (errno = %d)\n", errno);
-                perror("rcvmmsg");
+                STAT_INC(rcv_cfg->stats, STAT_RX_ERRORS);
+                log_event(LOG_RX_RECV_FAILED, errno, 0, 0);
                 break;
         }
-    } else if (retval >= 1) {
-        client_t *contained = NULL;
-        node = NULL;
-        for(i = 0; i < retval; i++) {
-            /**
-             * Compares the previous IP address & port to the current
-             * to check if it's the same client or another one.
-             * 
-             * Allows grouping of multiple packet in a single stream
-             * node without having to go through the hash table and
-             * the associated mutex.
-             */
-            if ((contained != NULL && ip_equals(
-                addrs[i].sin6_addr.__in6_u.__u6_addr8, 
-                addrs[i - 1].sin6_addr.__in6_u.__u6_addr8) && 
-                addrs[i - 1].sin6_port == addrs[i].sin6_port) && (i >= 0 && i < MAX_WINDOW_SIZE)
-            ) {
-            } else {
-                if (node != NULL) {
-                    stream_enqueue(rcv_cfg->tx, node);
-                    node = NULL;
-                }
 
-                contained = ht_get(rcv_cfg->clients, addrs[i].sin6_port, addrs[i].sin6_addr.__in6_u.__u6_addr8);
-                if (!contained) {
-                    pthread_mutex_lock(rcv_cfg->clients->lock);
-                    /** Checks if there's any room available */
-                    if (rcv_cfg->clients->length >= rcv_cfg->max_clients) {
-                        contained = NULL;
+        rx_adapt(rcv_cfg, 0);
+        return 0;
+    }
 
+    rx_adapt(rcv_cfg, retval);
+    return retval;
+}
 
-                        #ifdef DEBUG
-                            char ip_as_str[46];
-                            ip_to_string(&addrs[i], ip_as_str);
-                            TRACE("Too many clients connected, refusing [%s]:%u\n", ip_as_str, ntohs(addrs[i].sin6_port));
-                        #endif
+/**
+ * Takes a request for a client from the return stream, applies the
+ * pool policy when there is none. Returns NULL if the datagrams of
+ * the client must be dropped.
+ */
+static s_node_t *rx_acquire(rx_cfg_t *rcv_cfg, client_t *client) {
+    s_node_t *node;
 
-                        pthread_mutex_unlock(rcv_cfg->clients->lock);
-                        /** If there's no room available we ignore the packet */
-                        continue;
-                    }
+    if (rcv_cfg->pool_size == 0) {
+        node = stream_pop(rcv_cfg->rx, false);
+        if (node == NULL) {
+            STAT_INC(rcv_cfg->stats, STAT_RX_ALLOCATIONS);
+            node = malloc(sizeof(s_node_t));
+            if (node == NULL || initialize_node(node, allocate_handle_request)) {
+                log_event(LOG_RX_NODE_ALLOC_FAILED, errno, 0, 0);
+                free(node);
+                return NULL;
+            }
+        }
+    } else {
+        /** A client can't hold more than its share of the pool (the table is not locked here) */
+        if (rcv_cfg->pool_policy == POOL_CLIENT) {
+            size_t clients = __atomic_load_n(&rcv_cfg->clients->length, __ATOMIC_RELAXED);
+            size_t share = rcv_cfg->pool_size / MAX(clients, 1);
+            if (__atomic_load_n(&client->queued, __ATOMIC_RELAXED) >= MAX(share, 1)) {
+                return NULL;
+            }
+        }
 
-                    /** add new client in `clients` */
-                    contained = (client_t *) calloc(1, sizeof(client_t));
-                    if(contained == NULL) {
-                        char ip_as_str[46];
-                        ip_to_string(&addrs[i], ip_as_str);
-                        LOG("RX", "Client allocation failed [%s]:%u\n", ip_as_str, ntohs(addrs[i].sin6_port));
-                        break;
-                    }
+        node = stream_pop(rcv_cfg->rx, false);
+        if (node == NULL && rcv_cfg->pool_policy == POOL_BLOCK) {
+            STAT_INC(rcv_cfg->stats, STAT_RX_POOL_WAITS);
 
-                    if(initialize_client(
-                        contained, 
-                        __sync_fetch_and_add(rcv_cfg->idx, 1), 
-                        rcv_cfg->file_format, 
-                        &addrs[i], 
-                        &addr_len
-                    )) {
-                        char ip_as_str[46];
-                        ip_to_string(&addrs[i], ip_as_str);
-                        LOG("RX", "Client initialization failed [%s]:%u\n", ip_as_str, ntohs(addrs[i].sin6_port));
-                        continue;
-                    }
-                    
-                    pthread_mutex_unlock(rcv_cfg->clients->lock);
+            struct timespec pause = { .tv_sec = 0, .tv_nsec = 50 * 1000 };
+            while (node == NULL && !rcv_cfg->stop) {
+                nanosleep(&pause, NULL);
+                node = stream_pop(rcv_cfg->rx, false);
+            }
+        }
 
-                    ht_put(rcv_cfg->clients, addrs[i].sin6_port, addrs[i].sin6_addr.__in6_u.__u6_addr8, (void *) contained);
+        if (node == NULL) {
+            return NULL;
+        }
+    }
 
-                    LOG("RX", "New client #%d at [%s]:%u\n", contained->id, contained->ip_as_string, ntohs(contained->address->sin6_port));
-                }
+    __sync_fetch_and_add(&client->queued, 1);
 
-                node = stream_pop(rcv_cfg->rx, false);
-                if(node == NULL) {
-                    node = malloc(sizeof(s_node_t));
-                    if (initialize_node(node, allocate_handle_request)) {
-                        LOG("RX", "Failed to allocate node(errno: %d)\n", errno);
-                        break;
-                    }
-                }
+    return node;
+}
 
-                req = (hd_req_t *) node->content;
-                if(req == NULL) {
-                    TRACEN("`content` in a node was NULL\n");
-                    node->content = (hd_req_t *) allocate_handle_request();
-                    req = (hd_req_t *) node->content;
-                }
+/**
+ * Prepares the request of a node acquired for `client`.
+ */
+static hd_req_t *rx_request(s_node_t *node, client_t *client, struct msghdr *hdr) {
+    hd_req_t *req = (hd_req_t *) node->content;
+    if(req == NULL) {
+        TRACEN("`content` in a node was NULL\n");
+        node->content = (hd_req_t *) allocate_handle_request();
+        req = (hd_req_t *) node->content;
+    }
+
+    req->client = client;
+    req->timestamp = rx_timestamp(hdr);
+    hd_req_reset(req);
 
-                req->client = contained;
-                req->num = 0;
+    return req;
+}
+
+/**
+ * Hashes the address & port of a datagram for `rx_group`.
+ */
+static inline uint32_t rx_addr_hash(struct sockaddr_in6 *addr) {
+    uint32_t *ip = addr->sin6_addr.__in6_u.__u6_addr32;
+    uint32_t hash = (ip[0] ^ ip[1] ^ ip[2] ^ ip[3] ^ addr->sin6_port) * 0x9E3779B1;
+
+    return hash ^ (hash >> 16);
+}
+
+/*
+ * Refer to headers/receiver.h
+ */
+int rx_group(struct sockaddr_in6 *addrs, int retval, int *heads, int *next) {
+    size_t size = 16;
+    while (size < 2 * (size_t) retval) {
+        size <<= 1;
+    }
+
+    int slots[size];
+    int tails[retval];
+    memset(slots, -1, sizeof(slots));
+
+    int groups = 0;
+    int i;
+    for (i = 0; i < retval; i++) {
+        next[i] = -1;
+
+        size_t slot = rx_addr_hash(&addrs[i]) & (size - 1);
+        while (true) {
+            int group = slots[slot];
+            if (group == -1) {
+                slots[slot] = groups;
+                heads[groups] = i;
+                tails[groups] = i;
+                groups++;
+                break;
+            }
+
+            int head = heads[group];
+            if (addrs[head].sin6_port == addrs[i].sin6_port && ip_equals(
+                addrs[head].sin6_addr.__in6_u.__u6_addr8,
+                addrs[i].sin6_addr.__in6_u.__u6_addr8
+            )) {
+                next[tails[group]] = i;
+                tails[group] = i;
+                break;
             }
 
-            if (msgs[i].msg_len <= MAX_PACKET_SIZE && msgs[i].msg_len >= MIN_PACKET_SIZE) {
-                int idx = req->num++;
-                req->lengths[idx] = msgs[i].msg_len;
-                memcpy(req->buffer[idx], buffers[i], req->lengths[idx]);
+            slot = (slot + 1) & (size - 1);
+        }
+    }
+
+    return groups;
+}
+
+/*
+ * Refer to headers/receiver.h
+ */
+client_t *rx_client(rx_cfg_t *rcv_cfg, struct sockaddr_in6 *addr, socklen_t addr_len, int count) {
+    stats_t *stats = rcv_cfg->stats;
+
+    client_t *client = ht_get(rcv_cfg->clients, addr->sin6_port, addr->sin6_addr.__in6_u.__u6_addr8);
+    if (client != NULL) {
+        return client;
+    }
+
+    pthread_mutex_lock(rcv_cfg->clients->lock);
+    /** Checks if there's any room available */
+    if (rcv_cfg->clients->length >= rcv_cfg->max_clients) {
+        STAT_ADD(stats, STAT_RX_REFUSED, count);
+
+        #ifdef DEBUG
+            char ip_as_str[46];
+            ip_to_string(addr, ip_as_str);
+            TRACE("Too many clients connected, refusing [%s]:%u\n", ip_as_str, ntohs(addr->sin6_port));
+        #endif
+
+        pthread_mutex_unlock(rcv_cfg->clients->lock);
+        /** If there's no room available we ignore the packets */
+        return NULL;
+    }
+
+    /** Full for all the workers, or lost in the crash of one */
+    uint32_t id;
+    int entry = reg_claim(rcv_cfg->registry, rcv_cfg->worker, addr, &id);
+    if (entry < 0) {
+        STAT_ADD(stats, STAT_RX_REFUSED, count);
+
+        pthread_mutex_unlock(rcv_cfg->clients->lock);
+        return NULL;
+    }
+
+    /** add new client in `clients` */
+    client = (client_t *) calloc(1, sizeof(client_t));
+    if(client == NULL) {
+        pthread_mutex_unlock(rcv_cfg->clients->lock);
+        reg_release(rcv_cfg->registry, entry);
+        log_client_event(LOG_RX_CLIENT_ALLOC_FAILED, 0, addr, 0, 0, 0);
+        return NULL;
+    }
+
+    if(initialize_client(
+        client, 
+        id, 
+        rcv_cfg->file_format, 
+        addr, 
+        &addr_len
+    )) {
+        pthread_mutex_unlock(rcv_cfg->clients->lock);
+        reg_release(rcv_cfg->registry, entry);
+        log_client_event(LOG_RX_CLIENT_INIT_FAILED, 0, addr, 0, 0, 0);
+        return NULL;
+    }
+
+    client->registry_entry = entry;
+
+    shm_attach_client(rcv_cfg->shm, client);
+    
+    pthread_mutex_unlock(rcv_cfg->clients->lock);
+
+    ht_put(rcv_cfg->clients, addr->sin6_port, addr->sin6_addr.__in6_u.__u6_addr8, (void *) client);
+    STAT_INC(stats, STAT_RX_NEW_CLIENTS);
+
+    log_client_event(LOG_RX_NEW_CLIENT, client->id, client->address, 0, 0, 0);
+
+    return client;
+}
+
+/*
+ * Refer to headers/receiver.h
+ */
+void rx_dispatch(
+    rx_cfg_t *rcv_cfg, 
+    uint8_t buffers[][MAX_PACKET_SIZE],
+    socklen_t addr_len,
+    struct sockaddr_in6 *addrs, 
+    struct mmsghdr *msgs,
+    int retval
+) {
+    stats_t *stats = rcv_cfg->stats;
+
+    if (retval < 1) {
+        return;
+    }
+
+    STAT_INC(stats, STAT_RX_BATCHES);
+    STAT_ADD(stats, STAT_RX_PACKETS, retval);
+
+    /**
+     * Groups the whole batch by client so that interleaved clients
+     * (A, B, A, B, ...) still get a single request and a single
+     * lookup in the hash table each.
+     */
+    int heads[retval];
+    int next[retval];
+    int groups = rx_group(addrs, retval, heads, next);
+
+    /** The lookups below hit the cache */
+    int group;
+    item_t *items = rcv_cfg->clients->items;
+    for (group = 0; group < groups; group++) {
+        __builtin_prefetch(&items[ht_hash(rcv_cfg->clients, addrs[heads[group]].sin6_port)]);
+    }
+
+    for (group = 0; group < groups; group++) {
+        int first = heads[group];
+
+        int count = 0;
+        int i;
+        for (i = first; i != -1; i = next[i]) {
+            count++;
+        }
+
+        client_t *client = rx_client(rcv_cfg, &addrs[first], addr_len, count);
+        if (client == NULL) {
+            continue;
+        }
+
+        s_node_t *node = rx_acquire(rcv_cfg, client);
+        if (node == NULL) {
+            STAT_ADD(stats, STAT_RX_POOL_DROPS, count);
+            continue;
+        }
+
+        hd_req_t *req = rx_request(node, client, &msgs[first].msg_hdr);
+
+        for (i = first; i != -1; i = next[i]) {
+            if (node == NULL) {
+                /** No request left for this client: the rest of its datagrams are dropped too */
+                STAT_INC(stats, STAT_RX_POOL_DROPS);
+                continue;
+            }
+
+            STAT_ADD(stats, STAT_RX_BYTES, msgs[i].msg_len);
+
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                /** The datagram did not fit in the buffer, `msg_len` was clamped */
+                STAT_INC(stats, STAT_RX_TRUNCATED);
+                TRACE("Received a truncated datagram (length: %d)\n", msgs[i].msg_len);
+            } else if (msgs[i].msg_len <= MAX_PACKET_SIZE && msgs[i].msg_len >= MIN_PACKET_SIZE) {
+                if (!hd_req_push(req, buffers[i], msgs[i].msg_len)) {
+                    /** The request is full, the rest of the datagrams go in another one */
+                    stream_enqueue(rcv_cfg->tx, node);
+                    STAT_INC(stats, STAT_RX_REQUESTS);
+
+                    node = rx_acquire(rcv_cfg, client);
+                    if (node == NULL) {
+                        STAT_INC(stats, STAT_RX_POOL_DROPS);
+                        continue;
+                    }
+
+                    req = rx_request(node, client, &msgs[i].msg_hdr);
+                    hd_req_push(req, buffers[i], msgs[i].msg_len);
+                }
             } else {
+                STAT_INC(stats, msgs[i].msg_len < MIN_PACKET_SIZE ? STAT_RX_UNDERSIZED : STAT_RX_TRUNCATED);
                 TRACE("Received a packet with length: %d\n", msgs[i].msg_len);
             }
         }
 
-        if (node) {
+        if (node != NULL && req->num == 0) {
+            /** Nothing to handle (truncated or undersized): back to the pool */
+            __sync_fetch_and_sub(&client->queued, 1);
+            enqueue_or_free(rcv_cfg->rx, node);
+        } else if (node != NULL) {
             stream_enqueue(rcv_cfg->tx, node);
+            STAT_INC(stats, STAT_RX_REQUESTS);
         }
     }
 }
 
+/*
+ * Refer to headers/receiver.h
+ */
+void rx_run_once(
+    rx_cfg_t *rcv_cfg, 
+    uint8_t buffers[][MAX_PACKET_SIZE],
+    socklen_t addr_len,
+    struct sockaddr_in6 *addrs, 
+    struct mmsghdr *msgs
+) {
+    rx_dispatch(rcv_cfg, buffers, addr_len, addrs, msgs, rx_receive(rcv_cfg, msgs));
+}
+
 /*
  * Refer to headers/receiver.h
  */
@@ -160,6 +474,9 @@ void *receive_thread(void *receive_config) {
     rx_cfg_t *rcv_cfg = (rx_cfg_t *) receive_config;
     int window_size = rcv_cfg->window_size;
 
+    /** Falls back to synchronous logging if it fails */
+    logger_register();
+
     if (rcv_cfg->affinity != NULL) {
         pthread_t thread = pthread_self();
 
@@ -169,15 +486,16 @@ void *receive_thread(void *receive_config) {
 
         int aff = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
         if (aff == -1) {
-            LOGN("HD", "Failed to set affinity\n");
+            log_event(LOG_RX_AFFINITY_FAILED, 0, 0, 0);
         } else {
-            LOG("HD", "Receiver #%zu running on CPU #%zu\n", rcv_cfg->id, rcv_cfg->affinity->cpu);
+            log_event(LOG_RX_AFFINITY, rcv_cfg->id, rcv_cfg->affinity->cpu, 0);
         }
     }
 
     socklen_t addr_len = sizeof(struct sockaddr_in6);
 
     uint8_t buffers[window_size][MAX_PACKET_SIZE];
+    uint8_t controls[window_size][RX_CONTROL_LEN];
     struct sockaddr_in6 addrs[window_size];
     struct mmsghdr msgs[window_size];
     struct iovec iovecs[window_size];
@@ -195,7 +513,8 @@ void *receive_thread(void *receive_config) {
         msgs[i].msg_hdr.msg_iov = &iovecs[i];
         msgs[i].msg_hdr.msg_iovlen = 1;
         msgs[i].msg_hdr.msg_flags = 0;
-        msgs[i].msg_hdr.msg_control = NULL;
+        msgs[i].msg_hdr.msg_control = controls[i];
+        msgs[i].msg_hdr.msg_controllen = RX_CONTROL_LEN;
     }
     
     while(!rcv_cfg->stop) {
@@ -207,12 +526,116 @@ void *receive_thread(void *receive_config) {
             msgs
         );
     }
-    LOGN("RX", "Stopped\n");
+    log_event(LOG_RX_STOPPED, 0, 0, 0);
 
     pthread_exit(0);
     return NULL;
 }
 
+/*
+ * Refer to headers/receiver.h
+ */
+int rx_socket(config_rcv_t *config) {
+    int sockfd = socket(
+        config->addr_info->ai_family, 
+        config->addr_info->ai_socktype, 
+        config->addr_info->ai_protocol
+    );
+
+    if (sockfd == -1) {
+        LOGN("RX", "Failed to create socket\n");
+        perror("socket");
+
+        return -1;
+    }
+
+    LOG("RX", "Socket opened (fd: %d)\n", sockfd);
+
+    int one = 1;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))) {
+        LOGN("RX", "Failed to set reuse address");
+        perror("setsockopt");
+
+        close(sockfd);
+
+        return -1;
+    }
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one))) {
+        LOGN("RX", "Failed to set reuse port");
+        perror("setsockopt");
+
+        close(sockfd);
+
+        return -1;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv))) {
+        LOGN("RX", "Failed to set receive timeout");
+        perror("setsockopt");
+
+        close(sockfd);
+
+        return -1;
+    }
+
+    int size = 4000000;
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size))) {
+        LOGN("RX", "Failed to set send buffer size");
+        perror("setsockopt");
+
+        close(sockfd);
+
+        return -1;
+    }
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size))) {
+        LOGN("RX", "Failed to set receive buffer size");
+        perror("setsockopt");
+
+        close(sockfd);
+
+        return -1;
+    }
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one))) {
+        /** Not fatal: the latency histograms will simply stay empty */
+        LOGN("RX", "Failed to enable receive timestamps\n");
+        perror("setsockopt");
+    }
+
+    if (config->busy_poll_us > 0) {
+        /** Not fatal either: the threads still spin, only the NIC queue isn't polled */
+        int busy_poll = (int) config->busy_poll_us;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll))) {
+            LOGN("RX", "Failed to enable busy polling\n");
+            perror("setsockopt");
+        }
+
+        if (setsockopt(sockfd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &one, sizeof(one))) {
+            LOGN("RX", "Failed to prefer busy polling\n");
+            perror("setsockopt");
+        }
+    }
+
+    int status = bind(sockfd, config->addr_info->ai_addr, config->addr_info->ai_addrlen);
+    if (status) {
+        LOGN("RX", "Failed to bind socket");
+        perror("bind");
+
+        close(sockfd);
+
+        return -1;
+    }
+
+    return sockfd;
+}
+
 /*
  * Refer to headers/receiver.h
  */
@@ -0,0 +1,156 @@
+#include "../headers/registry.h"
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+static inline uint64_t reg_now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/*
+ * Refer to headers/registry.h
+ */
+int create_registry(reg_t *registry, size_t capacity) {
+    if (registry == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(registry, 0, sizeof(reg_t));
+
+    size_t size = sizeof(reg_header_t) + capacity * sizeof(reg_entry_t);
+
+    /** Zeroed: every entry is `REG_FREE` */
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    registry->size = size;
+    registry->header = (reg_header_t *) base;
+    registry->entries = (reg_entry_t *) ((uint8_t *) base + sizeof(reg_header_t));
+    registry->header->capacity = capacity;
+
+    return 0;
+}
+
+/*
+ * Refer to headers/registry.h
+ */
+void close_registry(reg_t *registry) {
+    if (registry == NULL || registry->header == NULL) {
+        return;
+    }
+
+    munmap(registry->header, registry->size);
+    memset(registry, 0, sizeof(reg_t));
+}
+
+/**
+ * Can the entry be claimed? Free, or orphaned for `REG_ORPHAN_S`.
+ */
+static inline bool reg_is_free(reg_entry_t *entry, uint32_t state, uint64_t now) {
+    return state == REG_FREE || (
+        REG_STATE(state) == REG_ORPHAN &&
+        now - entry->orphaned_ns >= (uint64_t) REG_ORPHAN_S * 1000000000UL
+    );
+}
+
+/*
+ * Refer to headers/registry.h
+ */
+int reg_claim(reg_t *registry, uint32_t worker, struct sockaddr_in6 *addr, uint32_t *id) {
+    uint64_t now = reg_now_ns();
+    uint8_t *ip = addr->sin6_addr.__in6_u.__u6_addr8;
+    uint32_t capacity = registry->header->capacity;
+
+    /** First entry that can be claimed */
+    uint32_t first = capacity;
+
+    uint32_t i;
+    for (i = 0; i < capacity; i++) {
+        reg_entry_t *entry = &registry->entries[i];
+        uint32_t state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+
+        if (reg_is_free(entry, state, now)) {
+            first = MIN(first, i);
+        } else if (
+            REG_STATE(state) != REG_CLAIMING &&
+            entry->port == addr->sin6_port &&
+            memcmp(entry->ip, ip, sizeof(entry->ip)) == 0
+        ) {
+            errno = REGISTRY_ORPHAN;
+            return -1;
+        }
+    }
+
+    /** The other workers may take the same entries in the meantime */
+    uint32_t claiming = (worker << 2) | REG_CLAIMING;
+    for (i = first; i < capacity; i++) {
+        reg_entry_t *entry = &registry->entries[i];
+        uint32_t state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+
+        if (
+            reg_is_free(entry, state, now) &&
+            __atomic_compare_exchange_n(&entry->state, &state, claiming, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)
+        ) {
+            entry->id = __atomic_fetch_add(&registry->header->next_id, 1, __ATOMIC_RELAXED);
+            entry->port = addr->sin6_port;
+            memcpy(entry->ip, ip, sizeof(entry->ip));
+            entry->orphaned_ns = 0;
+
+            __atomic_store_n(&entry->state, (worker << 2) | REG_OWNED, __ATOMIC_RELEASE);
+
+            *id = entry->id;
+            return i;
+        }
+    }
+
+    errno = REGISTRY_FULL;
+    return -1;
+}
+
+/*
+ * Refer to headers/registry.h
+ */
+void reg_release(reg_t *registry, int entry) {
+    if (entry < 0) {
+        return;
+    }
+
+    __atomic_store_n(&registry->entries[entry].state, REG_FREE, __ATOMIC_RELEASE);
+}
+
+/*
+ * Refer to headers/registry.h
+ */
+size_t reg_release_worker(reg_t *registry, uint32_t worker, bool orphan) {
+    uint64_t now = reg_now_ns();
+    size_t count = 0;
+
+    uint32_t i;
+    for (i = 0; i < registry->header->capacity; i++) {
+        reg_entry_t *entry = &registry->entries[i];
+        uint32_t state = __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE);
+
+        if (state == REG_FREE || REG_STATE(state) == REG_ORPHAN || REG_WORKER(state) != worker) {
+            continue;
+        }
+
+        count++;
+
+        /** A claim that didn't finish has no client behind it */
+        if (orphan && REG_STATE(state) == REG_OWNED) {
+            entry->orphaned_ns = now;
+            __atomic_store_n(&entry->state, (worker << 2) | REG_ORPHAN, __ATOMIC_RELEASE);
+        } else {
+            __atomic_store_n(&entry->state, REG_FREE, __ATOMIC_RELEASE);
+        }
+    }
+
+    return count;
+}
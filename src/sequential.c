@@ -0,0 +1,461 @@
+#define _GNU_SOURCE
+#include "../headers/sequential.h"
+
+/*
+ * Refer to headers/sequential.h
+ */
+int seq_init(seq_t *seq, rx_cfg_t *rx, hd_cfg_t *hd) {
+    if (seq == NULL || rx == NULL || hd == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(seq, 0, sizeof(seq_t));
+    seq->rx = rx;
+    seq->hd = hd;
+    seq->epfd = -1;
+    seq->timerfd = -1;
+    seq->batch = rx->window_size;
+    seq->spill_max = rx->pool_size;
+
+    size_t batch = seq->batch;
+    seq->buffers = malloc(batch * MAX_PACKET_SIZE);
+    seq->controls = malloc(batch * RX_CONTROL_LEN);
+    seq->addrs = calloc(batch, sizeof(struct sockaddr_in6));
+    seq->msgs = calloc(batch, sizeof(struct mmsghdr));
+    seq->iovecs = calloc(batch, sizeof(struct iovec));
+    seq->spill_size = seq->spill_max > 0 ? seq->spill_max : DEFAULT_POOL_PER_THREAD;
+    seq->spills = malloc(seq->spill_size * sizeof(s_node_t *));
+
+    if (
+        seq->buffers == NULL || seq->controls == NULL || seq->addrs == NULL ||
+        seq->msgs == NULL || seq->iovecs == NULL || seq->spills == NULL
+    ) {
+        seq_destroy(seq);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < batch; i++) {
+        seq->iovecs[i].iov_base = seq->buffers[i];
+        seq->iovecs[i].iov_len = MAX_PACKET_SIZE;
+
+        seq->msgs[i].msg_hdr.msg_name = &seq->addrs[i];
+        seq->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+        seq->msgs[i].msg_hdr.msg_iov = &seq->iovecs[i];
+        seq->msgs[i].msg_hdr.msg_iovlen = 1;
+        seq->msgs[i].msg_hdr.msg_control = seq->controls[i];
+        seq->msgs[i].msg_hdr.msg_controllen = RX_CONTROL_LEN;
+    }
+
+    /** The whole pool belongs to the engine, nobody else takes from the stream */
+    while (seq->spill_count < seq->spill_max) {
+        s_node_t *node = stream_pop(rx->rx, false);
+        if (node == NULL) {
+            break;
+        }
+
+        seq->spills[seq->spill_count++] = node;
+    }
+
+    seq->epfd = epoll_create1(EPOLL_CLOEXEC);
+    seq->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (seq->epfd == -1 || seq->timerfd == -1) {
+        int error = errno;
+        seq_destroy(seq);
+        errno = error;
+        return -1;
+    }
+
+    struct itimerspec period = {
+        .it_interval = { .tv_sec = SEQ_TICK_MS / 1000, .tv_nsec = (SEQ_TICK_MS % 1000) * 1000000L },
+        .it_value = { .tv_sec = SEQ_TICK_MS / 1000, .tv_nsec = (SEQ_TICK_MS % 1000) * 1000000L }
+    };
+
+    struct epoll_event socket_event = { .events = EPOLLIN, .data = { .fd = rx->sockfd } };
+    struct epoll_event timer_event = { .events = EPOLLIN, .data = { .fd = seq->timerfd } };
+
+    if (
+        timerfd_settime(seq->timerfd, 0, &period, NULL) ||
+        epoll_ctl(seq->epfd, EPOLL_CTL_ADD, rx->sockfd, &socket_event) ||
+        epoll_ctl(seq->epfd, EPOLL_CTL_ADD, seq->timerfd, &timer_event)
+    ) {
+        int error = errno;
+        seq_destroy(seq);
+        errno = error;
+        return -1;
+    }
+
+    ack_batch_init(&seq->acks, hd->sockfd, hd->stats, hd->latency);
+
+    return 0;
+}
+
+/**
+ * Takes a request of the engine that no view pins anymore, or
+ * allocates one if the pool is unbounded. Returns NULL if there's
+ * none left.
+ */
+static hd_req_t *seq_spill(seq_t *seq, client_t *client) {
+    s_node_t *node = NULL;
+
+    size_t k;
+    for (k = 0; k < seq->spill_count; k++) {
+        size_t i = (seq->spill_next + k) % seq->spill_count;
+        if (((hd_req_t *) seq->spills[i]->content)->refs == 0) {
+            node = seq->spills[i];
+            seq->spill_next = i + 1;
+            break;
+        }
+    }
+
+    if (node == NULL) {
+        if (seq->spill_max > 0 && seq->spill_count >= seq->spill_max) {
+            return NULL;
+        }
+
+        if (seq->spill_count == seq->spill_size) {
+            s_node_t **spills = realloc(seq->spills, 2 * seq->spill_size * sizeof(s_node_t *));
+            if (spills == NULL) {
+                return NULL;
+            }
+
+            seq->spills = spills;
+            seq->spill_size *= 2;
+        }
+
+        STAT_INC(seq->rx->stats, STAT_RX_ALLOCATIONS);
+        node = malloc(sizeof(s_node_t));
+        if (node == NULL || initialize_node(node, allocate_handle_request)) {
+            log_event(LOG_RX_NODE_ALLOC_FAILED, errno, 0, 0);
+            free(node);
+            return NULL;
+        }
+
+        seq->spills[seq->spill_count++] = node;
+    }
+
+    hd_req_t *req = (hd_req_t *) node->content;
+    req->client = client;
+    req->timestamp = 0;
+    req->refs = 0;
+    req->node = node;
+    req->home = NULL;
+    hd_req_reset(req);
+
+    seq->spill = req;
+
+    return req;
+}
+
+/**
+ * Moves the payloads of the packets a batch left in the window of a
+ * client (the views without a request) to a request of the engine,
+ * the receive buffers are about to be reused. The ones that don't
+ * find a request are dropped.
+ */
+static void seq_keep(seq_t *seq, client_t *client) {
+    buf_t *window = client->window;
+    if (window->length == 0) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < MAX_BUFFER_SIZE; i++) {
+        node_t *node = &window->nodes[i];
+        pkt_view_t *view = (pkt_view_t *) node->value;
+        if (!node->used || view->owner != NULL) {
+            continue;
+        }
+
+        hd_req_t *req = seq->spill;
+        if (req == NULL || req->client != client || !hd_req_push(req, view->payload, view->length)) {
+            req = seq_spill(seq, client);
+            if (req == NULL) {
+                STAT_INC(seq->hd->stats, STAT_HD_PIN_DROPS);
+                node->used = false;
+                window->length--;
+                continue;
+            }
+
+            hd_req_push(req, view->payload, view->length);
+        }
+
+        view->payload = hd_req_datagram(req, req->num - 1);
+        view->owner = req;
+        if (req->refs++ == 0) {
+            client->pinned++;
+        }
+    }
+}
+
+/**
+ * Handles a batch of `count` datagrams in the receive buffers.
+ */
+static void seq_batch(seq_t *seq, int count) {
+    rx_cfg_t *rx = seq->rx;
+    hd_cfg_t *hd = seq->hd;
+    stats_t *rx_stats = rx->stats;
+    stats_t *hd_stats = hd->stats;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    STAT_INC(rx_stats, STAT_RX_BATCHES);
+    STAT_ADD(rx_stats, STAT_RX_PACKETS, count);
+
+    uint8_t *datagrams[count];
+    size_t lengths[count];
+
+    int i;
+    for (i = 0; i < count; i++) {
+        struct mmsghdr *msg = &seq->msgs[i];
+        STAT_ADD(rx_stats, STAT_RX_BYTES, msg->msg_len);
+
+        datagrams[i] = seq->buffers[i];
+        lengths[i] = msg->msg_len;
+
+        /** Skipped below */
+        if (msg->msg_hdr.msg_flags & MSG_TRUNC) {
+            STAT_INC(rx_stats, STAT_RX_TRUNCATED);
+            lengths[i] = 0;
+        } else if (msg->msg_len > MAX_PACKET_SIZE || msg->msg_len < MIN_PACKET_SIZE) {
+            STAT_INC(rx_stats, msg->msg_len < MIN_PACKET_SIZE ? STAT_RX_UNDERSIZED : STAT_RX_TRUNCATED);
+            lengths[i] = 0;
+        }
+    }
+
+    /** The whole batch at once, whatever the client */
+    uint32_t header_crcs[count];
+    uint32_t payload_crcs[count];
+    hd_crcs(datagrams, lengths, count, header_crcs, payload_crcs);
+
+    int heads[count];
+    int next[count];
+    int groups = rx_group(seq->addrs, count, heads, next);
+
+    int group;
+    for (group = 0; group < groups; group++) {
+        int first = heads[group];
+
+        int valid = 0;
+        for (i = first; i != -1; i = next[i]) {
+            valid += lengths[i] > 0;
+        }
+
+        struct sockaddr_in6 *addr = &seq->addrs[first];
+        client_t *client = ht_get_nolock(rx->clients, addr->sin6_port, addr->sin6_addr.__in6_u.__u6_addr8);
+        if (client == NULL) {
+            client = rx_client(rx, addr, sizeof(struct sockaddr_in6), valid);
+        }
+
+        if (client == NULL || valid == 0) {
+            continue;
+        }
+
+        STAT_INC(hd_stats, STAT_HD_REQUESTS);
+        STAT_ADD(hd_stats, STAT_HD_PACKETS, valid);
+
+        uint64_t timestamp = rx_timestamp(&seq->msgs[first].msg_hdr);
+        if (timestamp != 0 && hd->latency != NULL) {
+            hist_record(&hd->latency[HIST_RX_TO_DEQUEUE], hist_elapsed(timestamp));
+        }
+
+        uint64_t acks_before = seq->acks.committed;
+        uint32_t last_timestamp = client->last_timestamp;
+
+        for (i = first; i != -1; i = next[i]) {
+            if (lengths[i] > 0) {
+                hd_decode(
+                    hd, client, NULL,
+                    datagrams[i], lengths[i],
+                    header_crcs[i], payload_crcs[i],
+                    &seq->acks, &last_timestamp
+                );
+            }
+        }
+
+        if (hd_flush(hd, client, seq->file_buffer, &seq->acks, last_timestamp, timestamp) == 0) {
+            shm_publish_client(client);
+        }
+
+        seq_keep(seq, client);
+
+        if (seq->acks.committed > acks_before) {
+            ack_batch_stamp(&seq->acks, timestamp);
+        }
+    }
+
+    ack_batch_flush(&seq->acks);
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    STAT_ADD(hd_stats, STAT_HD_BUSY_NS, (end.tv_sec - start.tv_sec) * 1000000000UL + end.tv_nsec - start.tv_nsec);
+}
+
+/**
+ * Drains the socket, at most `SEQ_DRAIN_MAX` batches.
+ */
+static void seq_drain(seq_t *seq) {
+    size_t batch = seq->batch;
+
+    int round;
+    for (round = 0; round < SEQ_DRAIN_MAX; round++) {
+        /** The kernel overwrites the length of the ancillary data */
+        size_t i;
+        for (i = 0; i < batch; i++) {
+            seq->msgs[i].msg_hdr.msg_controllen = RX_CONTROL_LEN;
+        }
+
+        int retval = recvmmsg(seq->rx->sockfd, seq->msgs, batch, MSG_DONTWAIT, NULL);
+        if (retval == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                STAT_INC(seq->rx->stats, STAT_RX_ERRORS);
+                log_event(LOG_RX_RECV_FAILED, errno, 0, 0);
+            }
+
+            return;
+        }
+
+        /** Until EAGAIN: under load, a single syscall per batch */
+        seq_batch(seq, retval);
+    }
+}
+
+/*
+ * Refer to headers/sequential.h
+ */
+int seq_run_once(seq_t *seq, int timeout_ms) {
+    struct epoll_event events[2];
+
+    int ready = epoll_wait(seq->epfd, events, 2, timeout_ms);
+    if (ready == -1) {
+        return -1;
+    }
+
+    int ticked = 0;
+
+    int i;
+    for (i = 0; i < ready; i++) {
+        if (events[i].data.fd == seq->timerfd) {
+            uint64_t expirations;
+            if (read(seq->timerfd, &expirations, sizeof(expirations)) == sizeof(expirations)) {
+                ticked = 1;
+            }
+        } else {
+            seq_drain(seq);
+        }
+    }
+
+    if (ticked) {
+        seq_reap(seq);
+    }
+
+    return ticked;
+}
+
+/*
+ * Refer to headers/sequential.h
+ */
+void seq_run(seq_t *seq, bool (*tick)()) {
+    /** Falls back to synchronous logging if it fails */
+    logger_register();
+
+    bool stop = false;
+    while (!stop) {
+        int retval = seq_run_once(seq, -1);
+        if (retval == -1 && errno != EINTR) {
+            LOG("SEQ", "epoll_wait failed (errno: %d)\n", errno);
+            break;
+        }
+
+        /** Signals interrupt the wait: SIGINT and SIGUSR1 are handled right away */
+        if (retval != 0) {
+            stop = tick();
+        }
+    }
+}
+
+/*
+ * Refer to headers/sequential.h
+ */
+void seq_reap(seq_t *seq) {
+    ht_t *clients = seq->rx->clients;
+
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    client_t *client_to_remove[clients->size];
+    size_t len_to_remove = 0;
+
+    size_t i;
+    for (i = 0; i < clients->size; i++) {
+        client_t *client = clients->items[i].value;
+        if (clients->items[i].used && client->end_time != NULL && !client->active) {
+            double time_inactive = ((double) time.tv_sec + 1.0e-9 * time.tv_nsec) -
+                ((double) client->end_time->tv_sec + 1.0e-9 * client->end_time->tv_nsec);
+            if (time_inactive > SEQ_LINGER_S) {
+                client_to_remove[len_to_remove++] = client;
+            }
+        }
+    }
+
+    for (i = 0; i < len_to_remove; i++) {
+        ht_remove(
+            clients,
+            client_to_remove[i]->address->sin6_port,
+            client_to_remove[i]->address->sin6_addr.__in6_u.__u6_addr8
+        );
+
+        LOG("SEQ", "Client #%d removed\n", client_to_remove[i]->id);
+
+        reg_release(seq->rx->registry, client_to_remove[i]->registry_entry);
+        shm_detach_client(client_to_remove[i]);
+        deallocate_client(client_to_remove[i], true, true);
+    }
+}
+
+/*
+ * Refer to headers/sequential.h
+ */
+void seq_destroy(seq_t *seq) {
+    if (seq == NULL) {
+        return;
+    }
+
+    if (seq->acks.count > 0) {
+        ack_batch_flush(&seq->acks);
+    }
+
+    size_t i;
+    for (i = 0; i < seq->spill_count; i++) {
+        enqueue_or_free(seq->rx->rx, seq->spills[i]);
+    }
+
+    if (seq->epfd != -1) {
+        close(seq->epfd);
+    }
+
+    if (seq->timerfd != -1) {
+        close(seq->timerfd);
+    }
+
+    free(seq->buffers);
+    free(seq->controls);
+    free(seq->addrs);
+    free(seq->msgs);
+    free(seq->iovecs);
+    free(seq->spills);
+
+    seq->buffers = NULL;
+    seq->controls = NULL;
+    seq->addrs = NULL;
+    seq->msgs = NULL;
+    seq->iovecs = NULL;
+    seq->spills = NULL;
+    seq->spill_count = 0;
+    seq->spill = NULL;
+    seq->epfd = -1;
+    seq->timerfd = -1;
+}
@@ -0,0 +1,329 @@
+#include "../headers/shm.h"
+
+/**
+ * Starts writing a record: `seq` becomes odd.
+ */
+static inline void seq_write_begin(uint32_t *seq) {
+    __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Finishes writing a record: `seq` becomes even.
+ */
+static inline void seq_write_end(uint32_t *seq) {
+    __atomic_store_n(seq, __atomic_load_n(seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Copies `len` bytes from a record protected by `seq`,
+ * retries as long as a writer is active.
+ */
+static void seq_read(uint32_t *seq, void *dst, void *src, size_t len) {
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+
+        memcpy(dst, src, len);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ *
+ * The coarse clock is read from the vDSO and does not
+ * enter the kernel which is why it's used on the data path.
+ */
+static inline uint64_t now_ns(clockid_t clock) {
+    struct timespec time;
+    clock_gettime(clock, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/**
+ * Computes the pointers to the records from the header.
+ */
+static void shm_layout(shm_seg_t *segment) {
+    uint8_t *base = (uint8_t *) segment->header;
+
+    segment->threads = (shm_thread_t *) (base + sizeof(shm_header_t));
+    segment->clients = (shm_client_t *) (
+        base + sizeof(shm_header_t) + segment->header->thread_count * sizeof(shm_thread_t)
+    );
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+int create_shm(shm_seg_t *segment, char *name, size_t rx_num, size_t hd_num, size_t client_count) {
+    if (segment == NULL || name == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(segment, 0, sizeof(shm_seg_t));
+
+    size_t size = sizeof(shm_header_t) +
+        (rx_num + hd_num) * sizeof(shm_thread_t) +
+        client_count * sizeof(shm_client_t);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd == -1) {
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    if (ftruncate(fd, size)) {
+        close(fd);
+        shm_unlink(name);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        shm_unlink(name);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    /** ftruncate already zeroed the segment */
+    segment->name = name;
+    segment->size = size;
+    segment->owner = true;
+    segment->header = (shm_header_t *) map;
+
+    shm_header_t *header = segment->header;
+    header->version = SHM_VERSION;
+    header->pid = getpid();
+    header->thread_count = rx_num + hd_num;
+    header->client_count = client_count;
+    header->stat_count = STAT_COUNT;
+    header->start_ns = now_ns(CLOCK_MONOTONIC);
+
+    size_t i;
+    for (i = 0; i < STAT_COUNT; i++) {
+        strncpy(header->stat_names[i], stat_names[i], SHM_NAME_LEN - 1);
+    }
+
+    shm_layout(segment);
+
+    for (i = 0; i < rx_num + hd_num; i++) {
+        segment->threads[i].kind = i < rx_num ? SHM_RECEIVER : SHM_HANDLER;
+        segment->threads[i].id = i < rx_num ? i : i - rx_num;
+    }
+
+    /** The magic number is written last: the viewer waits for it */
+    __atomic_store_n(&header->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+int open_shm(shm_seg_t *segment, char *name) {
+    if (segment == NULL || name == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(segment, 0, sizeof(shm_seg_t));
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) || (size_t) info.st_size < sizeof(shm_header_t)) {
+        close(fd);
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    void *map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    segment->name = name;
+    segment->size = info.st_size;
+    segment->owner = false;
+    segment->header = (shm_header_t *) map;
+
+    shm_header_t *header = segment->header;
+    size_t expected = sizeof(shm_header_t) +
+        header->thread_count * sizeof(shm_thread_t) +
+        header->client_count * sizeof(shm_client_t);
+
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_MAGIC ||
+        header->version != SHM_VERSION ||
+        header->stat_count > STAT_COUNT ||
+        expected > segment->size
+    ) {
+        munmap(map, segment->size);
+        segment->header = NULL;
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    shm_layout(segment);
+
+    return 0;
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void close_shm(shm_seg_t *segment) {
+    if (segment == NULL || segment->header == NULL) {
+        return;
+    }
+
+    munmap(segment->header, segment->size);
+    if (segment->owner) {
+        shm_unlink(segment->name);
+    }
+
+    segment->header = NULL;
+    segment->threads = NULL;
+    segment->clients = NULL;
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void shm_publish_threads(shm_seg_t *segment, stats_reg_t *registry) {
+    if (segment == NULL || segment->header == NULL || registry == NULL) {
+        return;
+    }
+
+    size_t i, j;
+    for (i = 0; i < registry->rx_num + registry->hd_num && i < segment->header->thread_count; i++) {
+        stats_t *stats = i < registry->rx_num ? &registry->rx[i] : &registry->hd[i - registry->rx_num];
+        shm_thread_t *record = &segment->threads[i];
+
+        seq_write_begin(&record->seq);
+        for (j = 0; j < STAT_COUNT; j++) {
+            record->counters[j] = STAT_GET(stats, j);
+        }
+        seq_write_end(&record->seq);
+    }
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void shm_attach_client(shm_seg_t *segment, client_t *client) {
+    if (segment == NULL || segment->header == NULL || client == NULL) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < segment->header->client_count; i++) {
+        shm_client_t *record = &segment->clients[i];
+        if (__atomic_load_n(&record->used, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        uint64_t now = now_ns(CLOCK_MONOTONIC_COARSE);
+
+        seq_write_begin(&record->seq);
+        record->used = true;
+        record->active = client->active;
+        record->id = client->id;
+        record->port = client->address->sin6_port;
+        record->window_low = 0;
+        record->window_length = 0;
+        memcpy(record->ip_as_string, client->ip_as_string, INET6_ADDRSTRLEN);
+        record->transferred = 0;
+        record->duplicates = 0;
+        record->rate = 0;
+        record->connected_ns = now;
+        record->progress_ns = now;
+        seq_write_end(&record->seq);
+
+        client->record = record;
+        return;
+    }
+
+    /** No free record: the client simply won't be visible */
+    client->record = NULL;
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void shm_detach_client(client_t *client) {
+    if (client == NULL || client->record == NULL) {
+        return;
+    }
+
+    shm_client_t *record = client->record;
+
+    seq_write_begin(&record->seq);
+    record->active = false;
+    __atomic_store_n(&record->used, false, __ATOMIC_RELEASE);
+    seq_write_end(&record->seq);
+
+    client->record = NULL;
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void shm_publish_client(client_t *client) {
+    if (client == NULL || client->record == NULL) {
+        return;
+    }
+
+    shm_client_t *record = client->record;
+    uint64_t progress = record->progress_ns;
+    uint64_t rate = record->rate;
+
+    if (client->transferred != record->transferred) {
+        progress = now_ns(CLOCK_MONOTONIC_COARSE);
+
+        if (progress > record->connected_ns) {
+            rate = (uint64_t) (client->transferred * 1.0e9 / (progress - record->connected_ns));
+        }
+    }
+
+    seq_write_begin(&record->seq);
+    record->active = client->active;
+    record->window_low = client->window->window_low;
+    record->window_length = client->window->length;
+    record->transferred = client->transferred;
+    record->duplicates = client->duplicates;
+    record->rate = rate;
+    record->progress_ns = progress;
+    seq_write_end(&record->seq);
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void shm_read_thread(shm_thread_t *src, shm_thread_t *dst) {
+    seq_read(&src->seq, dst, src, sizeof(shm_thread_t));
+}
+
+/*
+ * Refer to headers/shm.h
+ */
+void shm_read_client(shm_client_t *src, shm_client_t *dst) {
+    seq_read(&src->seq, dst, src, sizeof(shm_client_t));
+}
@@ -0,0 +1,391 @@
+#define _GNU_SOURCE
+#include "../headers/stats.h"
+
+/** Names of the counters, in the same order as `stat_counter_t` */
+const char *stat_names[STAT_COUNT] = {
+    "rx_batches",
+    "rx_packets",
+    "rx_bytes",
+    "rx_truncated",
+    "rx_undersized",
+    "rx_refused",
+    "rx_new_clients",
+    "rx_requests",
+    "rx_allocations",
+    "rx_errors",
+    "rx_pool_drops",
+    "rx_pool_waits",
+    "rx_spin_hits",
+    "rx_sleeps",
+    "rx_batch",
+    "rx_timeout_us",
+    "rx_batch_resizes",
+    "hd_requests",
+    "hd_packets",
+    "hd_crc_header",
+    "hd_crc_payload",
+    "hd_bad_length",
+    "hd_bad_type",
+    "hd_bad_other",
+    "hd_duplicates",
+    "hd_out_of_window",
+    "hd_truncated",
+    "hd_inactive",
+    "hd_acks",
+    "hd_nacks",
+    "hd_send_errors",
+    "hd_ack_sends",
+    "hd_write_errors",
+    "hd_bytes_written",
+    "hd_completed",
+    "hd_busy_ns",
+    "hd_spin_hits",
+    "hd_sleeps",
+    "hd_tx_full",
+    "hd_pin_drops",
+    "tx_sends",
+    "tx_frames",
+    "tx_errors"
+};
+
+/*
+ * Refer to headers/stats.h
+ */
+int allocate_stats_registry(stats_reg_t *registry, size_t rx_num, size_t hd_num, size_t tx_num) {
+    if (registry == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(registry, 0, sizeof(stats_reg_t));
+
+    if (posix_memalign((void **) &registry->rx, CACHE_LINE_SIZE, MAX(rx_num, 1) * sizeof(stats_t))) {
+        registry->rx = NULL;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    if (posix_memalign((void **) &registry->hd, CACHE_LINE_SIZE, MAX(hd_num, 1) * sizeof(stats_t))) {
+        free(registry->rx);
+        registry->rx = NULL;
+        registry->hd = NULL;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    if (posix_memalign((void **) &registry->latency, CACHE_LINE_SIZE, MAX(hd_num, 1) * HIST_COUNT * sizeof(hist_t))) {
+        free(registry->rx);
+        free(registry->hd);
+        registry->rx = NULL;
+        registry->hd = NULL;
+        registry->latency = NULL;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    if (tx_num > 0 && posix_memalign((void **) &registry->tx, CACHE_LINE_SIZE, tx_num * sizeof(stats_t))) {
+        free(registry->rx);
+        free(registry->hd);
+        free(registry->latency);
+        registry->rx = NULL;
+        registry->hd = NULL;
+        registry->latency = NULL;
+        registry->tx = NULL;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    if (tx_num > 0) {
+        memset(registry->tx, 0, tx_num * sizeof(stats_t));
+    }
+
+    memset(registry->rx, 0, MAX(rx_num, 1) * sizeof(stats_t));
+    memset(registry->hd, 0, MAX(hd_num, 1) * sizeof(stats_t));
+    memset(registry->latency, 0, MAX(hd_num, 1) * HIST_COUNT * sizeof(hist_t));
+
+    registry->rx_num = rx_num;
+    registry->hd_num = hd_num;
+    registry->tx_num = tx_num;
+
+    clock_gettime(CLOCK_MONOTONIC, &registry->start);
+
+    return 0;
+}
+
+/*
+ * Refer to headers/stats.h
+ */
+void dealloc_stats_registry(stats_reg_t *registry) {
+    if (registry == NULL) {
+        return;
+    }
+
+    free(registry->rx);
+    free(registry->hd);
+    free(registry->latency);
+    free(registry->tx);
+
+    registry->rx = NULL;
+    registry->hd = NULL;
+    registry->latency = NULL;
+    registry->tx = NULL;
+    registry->rx_num = 0;
+    registry->hd_num = 0;
+    registry->tx_num = 0;
+}
+
+/*
+ * Refer to headers/stats.h
+ */
+void stats_count_unpack_error(stats_t *stats, int error) {
+    switch(error) {
+        case CRC_VALIDATION_FAILED:
+            STAT_INC(stats, STAT_HD_CRC_HEADER);
+            break;
+        case PAYLOAD_VALIDATION_FAILED:
+            STAT_INC(stats, STAT_HD_CRC_PAYLOAD);
+            break;
+        case PACKET_TOO_SHORT:
+        case PACKET_TOO_LONG:
+        case PACKET_INCORRECT_LENGTH:
+        case PAYLOAD_TOO_LONG:
+            STAT_INC(stats, STAT_HD_BAD_LENGTH);
+            break;
+        case TYPE_IS_WRONG:
+        case NON_DATA_TRUNCATED:
+            STAT_INC(stats, STAT_HD_BAD_TYPE);
+            break;
+        default:
+            STAT_INC(stats, STAT_HD_BAD_OTHER);
+            break;
+    }
+}
+
+/*
+ * Refer to headers/stats.h
+ */
+int stats_write_text(stats_reg_t *registry, FILE *out) {
+    if (registry == NULL || out == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double uptime = ((double) now.tv_sec + 1.0e-9 * now.tv_nsec) -
+        ((double) registry->start.tv_sec + 1.0e-9 * registry->start.tv_nsec);
+
+    uint64_t totals[STAT_COUNT];
+    memset(totals, 0, sizeof(totals));
+
+    fprintf(out, "uptime %.3f\n", uptime);
+
+    size_t i, j;
+    for (i = 0; i < registry->rx_num; i++) {
+        for (j = 0; j < STAT_COUNT; j++) {
+            uint64_t value = STAT_GET(&registry->rx[i], j);
+            totals[j] += value;
+
+            if (value != 0) {
+                fprintf(out, "rx.%zu.%s %lu\n", i, stat_names[j], value);
+            }
+        }
+    }
+
+    for (i = 0; i < registry->hd_num; i++) {
+        for (j = 0; j < STAT_COUNT; j++) {
+            uint64_t value = STAT_GET(&registry->hd[i], j);
+            totals[j] += value;
+
+            if (value != 0) {
+                fprintf(out, "hd.%zu.%s %lu\n", i, stat_names[j], value);
+            }
+        }
+    }
+
+    for (i = 0; i < registry->tx_num; i++) {
+        for (j = 0; j < STAT_COUNT; j++) {
+            uint64_t value = STAT_GET(&registry->tx[i], j);
+            totals[j] += value;
+
+            if (value != 0) {
+                fprintf(out, "tx.%zu.%s %lu\n", i, stat_names[j], value);
+            }
+        }
+    }
+
+    for (i = 0; i < registry->stream_count; i++) {
+        if (registry->rx_to_hd != NULL && registry->rx_to_hd[i] != NULL) {
+            fprintf(out, "stream.%zu.rx_to_hd %d\n", i, __atomic_load_n(&registry->rx_to_hd[i]->length, __ATOMIC_RELAXED));
+        }
+
+        if (registry->hd_to_rx != NULL && registry->hd_to_rx[i] != NULL) {
+            fprintf(out, "stream.%zu.hd_to_rx %d\n", i, __atomic_load_n(&registry->hd_to_rx[i]->length, __ATOMIC_RELAXED));
+        }
+    }
+
+    for (j = 0; j < STAT_COUNT; j++) {
+        fprintf(out, "total.%s %lu\n", stat_names[j], totals[j]);
+    }
+
+    logger_write_text(out);
+
+    if (registry->latency == NULL) {
+        return 0;
+    }
+
+    /** Too large for the stack of the statistics thread */
+    hist_t *merged = NULL;
+    if (posix_memalign((void **) &merged, CACHE_LINE_SIZE, HIST_COUNT * sizeof(hist_t))) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    memset(merged, 0, HIST_COUNT * sizeof(hist_t));
+
+    char scope[32];
+    for (i = 0; i < registry->hd_num; i++) {
+        sprintf(scope, "hd.%zu", i);
+
+        for (j = 0; j < HIST_COUNT; j++) {
+            hist_t *hist = &registry->latency[i * HIST_COUNT + j];
+            hist_merge(&merged[j], hist);
+
+            if (__atomic_load_n(&hist->count, __ATOMIC_RELAXED) != 0) {
+                hist_write_text(hist, scope, hist_names[j], out);
+            }
+        }
+    }
+
+    for (j = 0; j < HIST_COUNT; j++) {
+        hist_write_text(&merged[j], "total", hist_names[j], out);
+    }
+
+    free(merged);
+
+    return 0;
+}
+
+/**
+ * The statistics thread: waits for connections and answers
+ * each of them with a snapshot before closing it.
+ */
+void *stats_thread(void *arg) {
+    stats_srv_t *server = (stats_srv_t *) arg;
+
+    struct pollfd pfd;
+    pfd.fd = server->sockfd;
+    pfd.events = POLLIN;
+
+    while (!server->stop) {
+        /** Wakes up regularly to check for `stop` */
+        int ready = poll(&pfd, 1, 200);
+        if (ready <= 0) {
+            continue;
+        }
+
+        int client = accept(server->sockfd, NULL, NULL);
+        if (client == -1) {
+            continue;
+        }
+
+        char *text = NULL;
+        size_t size = 0;
+        FILE *out = open_memstream(&text, &size);
+        if (out == NULL) {
+            close(client);
+            continue;
+        }
+
+        stats_write_text(server->registry, out);
+        fclose(out);
+
+        /** MSG_NOSIGNAL: a client gone before reading (EPIPE) is dropped, not a SIGPIPE */
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t result = send(client, text + sent, size - sent, MSG_NOSIGNAL);
+            if (result == -1 && errno == EINTR) {
+                continue;
+            } else if (result <= 0) {
+                break;
+            }
+
+            sent += result;
+        }
+
+        free(text);
+        close(client);
+    }
+
+    return NULL;
+}
+
+/*
+ * Refer to headers/stats.h
+ */
+int start_stats_server(stats_srv_t *server, stats_reg_t *registry, char *path) {
+    if (server == NULL || registry == NULL || path == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    strcpy(addr.sun_path, path);
+
+    server->registry = registry;
+    server->path = path;
+    server->stop = false;
+    server->sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->sockfd == -1) {
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    /** Removes a socket left over by a previous run */
+    unlink(path);
+
+    if (bind(server->sockfd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un)) || listen(server->sockfd, 8)) {
+        close(server->sockfd);
+        server->sockfd = -1;
+        errno = FAILED_TO_OPEN;
+        return -1;
+    }
+
+    if (pthread_create(&server->thread, NULL, &stats_thread, (void *) server)) {
+        close(server->sockfd);
+        unlink(path);
+        server->sockfd = -1;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    pthread_setname_np(server->thread, "trtp-stats");
+
+    return 0;
+}
+
+/*
+ * Refer to headers/stats.h
+ */
+void stop_stats_server(stats_srv_t *server) {
+    if (server == NULL || server->sockfd == -1) {
+        return;
+    }
+
+    server->stop = true;
+    pthread_join(server->thread, NULL);
+
+    close(server->sockfd);
+    unlink(server->path);
+
+    server->sockfd = -1;
+}
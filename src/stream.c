@@ -33,9 +33,7 @@ void deallocate_node(s_node_t *node) {
         return;
     }
 
-    if (node->content != NULL) {
-        free(node->content);
-    }
+    arena_put(node->content);
 
     free(node);
 }
@@ -147,10 +145,10 @@ s_node_t *stream_pop(stream_t *stream, bool wait) {
         }
     }
 
-    _fas(&stream->length, 1);
     s_node_t *head = stream->out_queue;
     if (head) {
         stream->out_queue = head->next;
+        _fas(&stream->length, 1);
     }
     
     pthread_mutex_unlock(&stream->lock);
@@ -160,3 +158,37 @@ s_node_t *stream_pop(stream_t *stream, bool wait) {
     return head;
 
 }
+
+
+/**
+ * Refer to headers/stream.h
+ */
+s_node_t *stream_pop_spin(stream_t *stream, uint64_t spin_ns, bool *slept) {
+    *slept = false;
+
+    if (spin_ns > 0) {
+        struct timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        uint64_t deadline = (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec + spin_ns;
+
+        uint32_t spins = 0;
+        while (__atomic_load_n(&stream->length, __ATOMIC_ACQUIRE) <= 0) {
+            _pause();
+
+            /** Reading the clock is slower than `pause`, only do it once in a while */
+            if ((++spins & 63) == 0) {
+                clock_gettime(CLOCK_MONOTONIC, &time);
+                if ((uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec >= deadline) {
+                    break;
+                }
+            }
+        }
+
+        if (__atomic_load_n(&stream->length, __ATOMIC_ACQUIRE) > 0) {
+            return stream_pop(stream, false);
+        }
+    }
+
+    *slept = true;
+    return stream_pop(stream, true);
+}
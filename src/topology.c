@@ -0,0 +1,631 @@
+#include "../headers/topology.h"
+
+/**
+ * Reads the first line of a file, without its line feed.
+ */
+static int read_line(const char *path, char *out, size_t len) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char *line = fgets(out, len, file);
+    fclose(file);
+
+    if (line == NULL) {
+        return -1;
+    }
+
+    out[strcspn(out, "\n")] = 0;
+
+    return 0;
+}
+
+/**
+ * Parses a CPU list (e.g `0-3,8,10-11`) into `set`.
+ *
+ * Returns the lowest CPU of the list, -1 if it is invalid or empty.
+ */
+static long parse_cpu_list(char *list, uint8_t set[TOPO_MAX_CPUS]) {
+    long lowest = -1;
+    char *save = NULL;
+    char *token = strtok_r(list, ",", &save);
+
+    memset(set, 0, TOPO_MAX_CPUS);
+
+    while (token != NULL) {
+        char *end;
+        unsigned long first = strtoul(token, &end, 10);
+        unsigned long last = first;
+
+        if (end == token) {
+            return -1;
+        }
+
+        if (*end == '-') {
+            char *range = end + 1;
+            last = strtoul(range, &end, 10);
+            if (end == range) {
+                return -1;
+            }
+        }
+
+        unsigned long cpu;
+        for (cpu = first; cpu <= last && cpu < TOPO_MAX_CPUS; cpu++) {
+            set[cpu] = 1;
+            if (lowest == -1 || (long) cpu < lowest) {
+                lowest = (long) cpu;
+            }
+        }
+
+        token = strtok_r(NULL, ",", &save);
+    }
+
+    return lowest;
+}
+
+/**
+ * Reads a CPU list file and returns its lowest CPU, `fallback` if
+ * it can't be read.
+ */
+static size_t read_lowest_cpu(const char *path, size_t fallback) {
+    char line[4096];
+    uint8_t set[TOPO_MAX_CPUS];
+
+    if (read_line(path, line, sizeof(line))) {
+        return fallback;
+    }
+
+    long lowest = parse_cpu_list(line, set);
+
+    return lowest < 0 ? fallback : (size_t) lowest;
+}
+
+/**
+ * Finds a CPU of the topology by its number.
+ */
+static topo_cpu_t *find_cpu(topo_t *topo, size_t cpu) {
+    size_t i;
+    for (i = 0; i < topo->count; i++) {
+        if (topo->cpus[i].cpu == cpu) {
+            return &topo->cpus[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+int topology_discover(topo_t *topo, const char *root) {
+    char path[PATH_MAX];
+    char line[4096];
+    uint8_t online[TOPO_MAX_CPUS];
+
+    memset(topo, 0, sizeof(topo_t));
+
+    snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/online", root);
+    if (read_line(path, line, sizeof(line)) || parse_cpu_list(line, online) < 0) {
+        errno = TOPOLOGY_UNAVAILABLE;
+        return -1;
+    }
+
+    size_t cpu;
+    size_t count = 0;
+    for (cpu = 0; cpu < TOPO_MAX_CPUS; cpu++) {
+        count += online[cpu];
+    }
+
+    topo->cpus = calloc(count, sizeof(topo_cpu_t));
+    if (topo->cpus == NULL) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    for (cpu = 0; cpu < TOPO_MAX_CPUS; cpu++) {
+        if (!online[cpu]) {
+            continue;
+        }
+
+        topo_cpu_t *current = &topo->cpus[topo->count++];
+        current->cpu = cpu;
+
+        snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%zu/topology/thread_siblings_list", root, cpu);
+        current->core = read_lowest_cpu(path, cpu);
+
+        size_t package = 0;
+        snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%zu/topology/physical_package_id", root, cpu);
+        if (!read_line(path, line, sizeof(line)) && !str2size(&package, line, 10)) {
+            current->package = package;
+        }
+
+        /** The lowest CPU of the package unless an L3 is found */
+        snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%zu/topology/core_siblings_list", root, cpu);
+        current->l3 = read_lowest_cpu(path, cpu);
+
+        int index;
+        for (index = 0; index < 16; index++) {
+            snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%zu/cache/index%d/level", root, cpu, index);
+            if (read_line(path, line, sizeof(line))) {
+                break;
+            }
+
+            if (!strcmp(line, "3")) {
+                snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%zu/cache/index%d/shared_cpu_list", root, cpu, index);
+                current->l3 = read_lowest_cpu(path, current->l3);
+                break;
+            }
+        }
+
+        /** The node is a `nodeN` link in the directory of the CPU */
+        snprintf(path, sizeof(path), "%s/sys/devices/system/cpu/cpu%zu", root, cpu);
+        DIR *dir = opendir(path);
+        if (dir != NULL) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                size_t node;
+                if (!strncmp(entry->d_name, "node", 4) && !str2size(&node, entry->d_name + 4, 10)) {
+                    current->node = node;
+                    break;
+                }
+            }
+
+            closedir(dir);
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+void topology_free(topo_t *topo) {
+    free(topo->cpus);
+    memset(topo, 0, sizeof(topo_t));
+}
+
+/**
+ * Marks the CPUs an interrupt is routed to.
+ */
+static void mark_irq(topo_t *topo, const char *root, const char *irq) {
+    char path[PATH_MAX];
+    char line[4096];
+    uint8_t set[TOPO_MAX_CPUS];
+
+    snprintf(path, sizeof(path), "%s/proc/irq/%s/effective_affinity_list", root, irq);
+    if (read_line(path, line, sizeof(line))) {
+        snprintf(path, sizeof(path), "%s/proc/irq/%s/smp_affinity_list", root, irq);
+        if (read_line(path, line, sizeof(line))) {
+            return;
+        }
+    }
+
+    if (parse_cpu_list(line, set) < 0) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < topo->count; i++) {
+        if (topo->cpus[i].cpu < TOPO_MAX_CPUS && set[topo->cpus[i].cpu]) {
+            topo->cpus[i].irq = true;
+        }
+    }
+}
+
+/**
+ * Marks the CPUs handling the interrupts of one interface.
+ */
+static void mark_interface(topo_t *topo, const char *root, const char *ifname) {
+    char path[PATH_MAX];
+
+    /** PCI devices list their MSI vectors */
+    snprintf(path, sizeof(path), "%s/sys/class/net/%s/device/msi_irqs", root, ifname);
+    DIR *dir = opendir(path);
+    if (dir != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (isdigit(entry->d_name[0])) {
+                mark_irq(topo, root, entry->d_name);
+            }
+        }
+
+        closedir(dir);
+        return;
+    }
+
+    /** Virtual devices (virtio, ...): the interrupts are named after the device */
+    char device[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/sys/class/net/%s/device", root, ifname);
+    ssize_t len = readlink(path, device, sizeof(device) - 1);
+    if (len <= 0) {
+        return;
+    }
+
+    device[len] = 0;
+    char *name = strrchr(device, '/');
+    name = name == NULL ? device : name + 1;
+
+    snprintf(path, sizeof(path), "%s/proc/interrupts", root);
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+
+    char line[8192];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *irq = line;
+        while (*irq == ' ') {
+            irq++;
+        }
+
+        char *colon = strchr(irq, ':');
+        if (colon == NULL || !isdigit(*irq)) {
+            continue;
+        }
+
+        if (strstr(colon, name) != NULL || strstr(colon, ifname) != NULL) {
+            *colon = 0;
+            mark_irq(topo, root, irq);
+        }
+    }
+
+    fclose(file);
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+size_t topology_mark_irqs(topo_t *topo, const char *root, const char *ifname) {
+    if (ifname != NULL) {
+        mark_interface(topo, root, ifname);
+    } else {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/sys/class/net", root);
+
+        DIR *dir = opendir(path);
+        if (dir != NULL) {
+            struct dirent *entry;
+            while ((entry = readdir(dir)) != NULL) {
+                if (entry->d_name[0] != '.') {
+                    mark_interface(topo, root, entry->d_name);
+                }
+            }
+
+            closedir(dir);
+        }
+    }
+
+    size_t i, j;
+    topo->irq_count = 0;
+    for (i = 0; i < topo->count; i++) {
+        topo->irq_count += topo->cpus[i].irq;
+    }
+
+    for (i = 0; i < topo->count; i++) {
+        for (j = 0; j < topo->count; j++) {
+            if (topo->cpus[j].irq) {
+                topo->cpus[i].irq_core |= topo->cpus[j].core == topo->cpus[i].core;
+                topo->cpus[i].irq_l3 |= topo->cpus[j].l3 == topo->cpus[i].l3;
+            }
+        }
+    }
+
+    return topo->irq_count;
+}
+
+/**
+ * Checks whether a thread already runs on the physical core of a CPU.
+ */
+static bool core_busy(topo_t *topo, size_t *load, size_t i) {
+    size_t j;
+    for (j = 0; j < topo->count; j++) {
+        if (load[j] > 0 && topo->cpus[j].core == topo->cpus[i].core) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Score of a CPU for a receiver, lower is better.
+ */
+static size_t rx_score(topo_t *topo, size_t *load, size_t i) {
+    topo_cpu_t *cpu = &topo->cpus[i];
+
+    return load[i] * 1000 +
+        (cpu->irq_core ? 0 : cpu->irq_l3 ? 100 : 200) +
+        (core_busy(topo, load, i) ? 50 : 0) +
+        (cpu->irq ? 10 : 0);
+}
+
+/**
+ * Score of a CPU for a handler fed by a receiver on `anchor`, lower is better.
+ */
+static size_t hd_score(topo_t *topo, size_t *load, size_t i, topo_cpu_t *anchor) {
+    topo_cpu_t *cpu = &topo->cpus[i];
+
+    return load[i] * 1000 +
+        (cpu->l3 == anchor->l3 ? 0 : cpu->node == anchor->node ? 100 : 200) +
+        (core_busy(topo, load, i) ? 50 : 0) +
+        (cpu->irq_core ? 10 : 0);
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+int topology_place(topo_t *topo, config_rcv_t *config) {
+    if (topo->count == 0 || config->receive_num == 0) {
+        errno = TOPOLOGY_UNAVAILABLE;
+        return -1;
+    }
+
+    size_t *load = calloc(topo->count, sizeof(size_t));
+    size_t *rx_cpus = calloc(config->receive_num, sizeof(size_t));
+    afs_t *receive_affinities = calloc(config->receive_num, sizeof(afs_t));
+    afs_t *handle_affinities = calloc(MAX(config->handle_num, 1), sizeof(afs_t));
+    if (load == NULL || rx_cpus == NULL || receive_affinities == NULL || handle_affinities == NULL) {
+        free(load);
+        free(rx_cpus);
+        free(receive_affinities);
+        free(handle_affinities);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    size_t i, j;
+    for (i = 0; i < config->receive_num; i++) {
+        size_t best = 0;
+        for (j = 1; j < topo->count; j++) {
+            if (rx_score(topo, load, j) < rx_score(topo, load, best)) {
+                best = j;
+            }
+        }
+
+        load[best]++;
+        rx_cpus[i] = best;
+        receive_affinities[i].cpu = topo->cpus[best].cpu;
+    }
+
+    for (i = 0; i < config->handle_num; i++) {
+        /** A receiver of the stream of this handler */
+        size_t receiver = i % config->receive_num;
+        for (j = 0; j < config->receive_num; j++) {
+            if (config->receive_streams[j].stream == config->handle_streams[i].stream) {
+                receiver = j;
+                break;
+            }
+        }
+
+        topo_cpu_t *anchor = &topo->cpus[rx_cpus[receiver]];
+
+        size_t best = 0;
+        for (j = 1; j < topo->count; j++) {
+            if (hd_score(topo, load, j, anchor) < hd_score(topo, load, best, anchor)) {
+                best = j;
+            }
+        }
+
+        load[best]++;
+        handle_affinities[i].cpu = topo->cpus[best].cpu;
+    }
+
+    free(load);
+    free(rx_cpus);
+
+    free(config->receive_affinities);
+    free(config->handle_affinities);
+    config->receive_affinities = receive_affinities;
+    config->handle_affinities = handle_affinities;
+
+    return 0;
+}
+
+/**
+ * Finds the interface an address is assigned to, NULL for the
+ * wildcard address or if it can't be found.
+ */
+static char *find_interface(struct sockaddr_in6 *addr, char ifname[IF_NAMESIZE]) {
+    if (IN6_IS_ADDR_UNSPECIFIED(&addr->sin6_addr)) {
+        return NULL;
+    }
+
+    struct ifaddrs *ifaddrs;
+    if (getifaddrs(&ifaddrs)) {
+        return NULL;
+    }
+
+    char *found = NULL;
+    struct ifaddrs *it;
+    for (it = ifaddrs; it != NULL; it = it->ifa_next) {
+        if (it->ifa_addr == NULL || it->ifa_addr->sa_family != AF_INET6) {
+            continue;
+        }
+
+        struct sockaddr_in6 *current = (struct sockaddr_in6 *) it->ifa_addr;
+        if (!memcmp(&current->sin6_addr, &addr->sin6_addr, sizeof(struct in6_addr))) {
+            strncpy(ifname, it->ifa_name, IF_NAMESIZE - 1);
+            ifname[IF_NAMESIZE - 1] = 0;
+            found = ifname;
+            break;
+        }
+    }
+
+    freeifaddrs(ifaddrs);
+
+    return found;
+}
+
+/**
+ * Counts the distinct values of a field of the CPUs.
+ */
+static size_t count_distinct(topo_t *topo, size_t offset) {
+    size_t i, j, count = 0;
+    for (i = 0; i < topo->count; i++) {
+        size_t value = *(size_t *) ((uint8_t *) &topo->cpus[i] + offset);
+
+        for (j = 0; j < i; j++) {
+            if (*(size_t *) ((uint8_t *) &topo->cpus[j] + offset) == value) {
+                break;
+            }
+        }
+
+        count += j == i;
+    }
+
+    return count;
+}
+
+/**
+ * Prints where a thread was placed.
+ */
+static void print_placement(topo_t *topo, const char *kind, size_t id, size_t cpu, size_t stream) {
+    topo_cpu_t *current = find_cpu(topo, cpu);
+
+    LOG(
+        "TOPO",
+        "%s %zu (stream %zu) -> CPU %zu (core %zu, L3 %zu, node %zu)%s\n",
+        kind,
+        id,
+        stream,
+        cpu,
+        current->core,
+        current->l3,
+        current->node,
+        current->irq ? " NIC IRQ" : current->irq_core ? " NIC IRQ sibling" : ""
+    );
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+int topology_plan(config_rcv_t *config) {
+    topo_t topo;
+    if (topology_discover(&topo, "")) {
+        return -1;
+    }
+
+    char buffer[IF_NAMESIZE];
+    char *ifname = find_interface((struct sockaddr_in6 *) config->addr_info->ai_addr, buffer);
+    topology_mark_irqs(&topo, "", ifname);
+
+    if (topology_place(&topo, config)) {
+        topology_free(&topo);
+        return -1;
+    }
+
+    LOG(
+        "TOPO",
+        "%zu CPUs, %zu cores, %zu L3 domains, %zu NUMA nodes\n",
+        topo.count,
+        count_distinct(&topo, offsetof(topo_cpu_t, core)),
+        count_distinct(&topo, offsetof(topo_cpu_t, l3)),
+        count_distinct(&topo, offsetof(topo_cpu_t, node))
+    );
+
+    if (topo.irq_count == 0) {
+        LOG("TOPO", "No NIC interrupt found (%s)\n", ifname == NULL ? "all interfaces" : ifname);
+    } else {
+        LOG("TOPO", "NIC interrupts (%s) on %zu CPUs\n", ifname == NULL ? "all interfaces" : ifname, topo.irq_count);
+    }
+
+    size_t i;
+    for (i = 0; i < config->receive_num; i++) {
+        print_placement(&topo, "Receiver", i, config->receive_affinities[i].cpu, config->receive_streams[i].stream);
+    }
+
+    for (i = 0; i < config->handle_num; i++) {
+        print_placement(&topo, "Handler", i, config->handle_affinities[i].cpu, config->handle_streams[i].stream);
+    }
+
+    topology_free(&topo);
+
+    return 0;
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+int topology_stream_nodes(config_rcv_t *config, const char *root) {
+    topo_t topo;
+    if (topology_discover(&topo, root)) {
+        return -1;
+    }
+
+    if (count_distinct(&topo, offsetof(topo_cpu_t, node)) < 2) {
+        topology_free(&topo);
+        return 0;
+    }
+
+    size_t *nodes = malloc(config->stream_count * sizeof(size_t));
+    if (nodes == NULL) {
+        topology_free(&topo);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    bool pinned = false;
+    size_t i, j;
+    for (i = 0; i < config->stream_count; i++) {
+        nodes[i] = TOPO_NO_NODE;
+
+        for (j = 0; j < config->receive_num && nodes[i] == TOPO_NO_NODE && config->receive_affinities != NULL; j++) {
+            topo_cpu_t *cpu = find_cpu(&topo, config->receive_affinities[j].cpu);
+            if (config->receive_streams[j].stream == i && cpu != NULL) {
+                nodes[i] = cpu->node;
+            }
+        }
+
+        for (j = 0; j < config->handle_num && nodes[i] == TOPO_NO_NODE && config->handle_affinities != NULL; j++) {
+            topo_cpu_t *cpu = find_cpu(&topo, config->handle_affinities[j].cpu);
+            if (config->handle_streams[j].stream == i && cpu != NULL) {
+                nodes[i] = cpu->node;
+            }
+        }
+
+        pinned |= nodes[i] != TOPO_NO_NODE;
+    }
+
+    topology_free(&topo);
+
+    if (!pinned) {
+        free(nodes);
+        return 0;
+    }
+
+    free(config->stream_nodes);
+    config->stream_nodes = nodes;
+
+    return 0;
+}
+
+/*
+ * Refer to headers/topology.h
+ */
+int topology_bind(void *addr, size_t len, size_t node) {
+    if (node >= TOPO_MAX_NODES - 1) {
+        errno = TOPOLOGY_UNAVAILABLE;
+        return -1;
+    }
+
+    uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t) addr + page - 1) & ~(page - 1);
+    uintptr_t end = ((uintptr_t) addr + len) & ~(page - 1);
+    if (end <= start) {
+        return 0;
+    }
+
+    unsigned long mask[TOPO_MAX_NODES / (8 * sizeof(unsigned long))];
+    memset(mask, 0, sizeof(mask));
+    mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+
+    /** The kernel ignores the last bit of `maxnode` */
+    if (syscall(SYS_mbind, start, end - start, TOPO_MPOL_PREFERRED, mask, TOPO_MAX_NODES, TOPO_MPOL_MF_MOVE)) {
+        errno = TOPOLOGY_UNAVAILABLE;
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,288 @@
+#define _GNU_SOURCE
+#include "../headers/tx.h"
+
+/**
+ * Monotonic time in nanoseconds, read from the vDSO.
+ */
+static inline uint64_t tx_now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/*
+ * Refer to headers/tx.h
+ */
+int tx_init(tx_stage_t *tx, size_t id, int sockfd, size_t deadline_us, stats_t *stats) {
+    if (tx == NULL || stats == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(tx, 0, sizeof(tx_stage_t));
+
+    if (posix_memalign((void **) &tx->slots, CACHE_LINE_SIZE, TX_RING_SIZE * sizeof(tx_slot_t))) {
+        tx->slots = NULL;
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < TX_RING_SIZE; i++) {
+        tx->slots[i].sequence = i;
+    }
+
+    tx->id = id;
+    tx->sockfd = sockfd;
+    tx->gso = true;
+    tx->deadline_ns = (uint64_t) deadline_us * 1000;
+    tx->stats = stats;
+
+    return 0;
+}
+
+/*
+ * Refer to headers/tx.h
+ */
+int tx_push(tx_stage_t *tx, struct sockaddr_in6 *destination, uint8_t *frames, size_t count) {
+    uint64_t position = __atomic_load_n(&tx->head, __ATOMIC_RELAXED);
+    tx_slot_t *slot;
+
+    while (true) {
+        slot = &tx->slots[position & (TX_RING_SIZE - 1)];
+
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t) (sequence - position);
+
+        if (diff == 0) {
+            /** On failure, `position` is updated with the current head */
+            if (__atomic_compare_exchange_n(&tx->head, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /** The slot still holds the batch of the previous lap */
+            errno = TX_FULL;
+            return -1;
+        } else {
+            position = __atomic_load_n(&tx->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->queued = tx_now();
+    slot->count = count;
+    memcpy(&slot->destination, destination, sizeof(struct sockaddr_in6));
+    memcpy(slot->frames, frames, count * ACK_FRAME_SIZE);
+
+    __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+/**
+ * Fills `msgs` with the batches `first` to `last` (excluded) from the
+ * tail of the ring: one GSO datagram per batch, or one datagram per
+ * frame without GSO. `owners` receives the batch of every message.
+ * Returns the number of messages.
+ */
+static size_t tx_build(
+    tx_stage_t *tx,
+    size_t first,
+    size_t last,
+    struct mmsghdr *msgs,
+    struct iovec *iovecs,
+    uint8_t control[][CMSG_SPACE(sizeof(uint16_t))],
+    size_t *owners
+) {
+    size_t count = 0;
+    size_t i, j;
+
+    for (i = first; i < last; i++) {
+        tx_slot_t *slot = &tx->slots[(tx->tail + i) & (TX_RING_SIZE - 1)];
+        bool gso = tx->gso && slot->count > 1;
+        size_t messages = gso ? 1 : slot->count;
+
+        for (j = 0; j < messages; j++) {
+            iovecs[count].iov_base = &slot->frames[j * ACK_FRAME_SIZE];
+            iovecs[count].iov_len = gso ? slot->count * ACK_FRAME_SIZE : ACK_FRAME_SIZE;
+
+            memset(&msgs[count], 0, sizeof(struct mmsghdr));
+            msgs[count].msg_hdr.msg_name = &slot->destination;
+            msgs[count].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            msgs[count].msg_hdr.msg_iov = &iovecs[count];
+            msgs[count].msg_hdr.msg_iovlen = 1;
+
+            if (gso) {
+                memset(control[i], 0, sizeof(control[i]));
+                msgs[count].msg_hdr.msg_control = control[i];
+                msgs[count].msg_hdr.msg_controllen = sizeof(control[i]);
+
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgs[count].msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+                uint16_t segment = ACK_FRAME_SIZE;
+                memcpy(CMSG_DATA(cmsg), &segment, sizeof(uint16_t));
+            }
+
+            owners[count++] = i;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Sends the `n` batches at the tail of the ring, with as few
+ * `sendmmsg` as possible (a single one unless it's cut short).
+ */
+static void tx_send(tx_stage_t *tx, size_t n) {
+    struct mmsghdr msgs[TX_SEND_MAX * ACK_BATCH_MAX];
+    struct iovec iovecs[TX_SEND_MAX * ACK_BATCH_MAX];
+    uint8_t control[TX_SEND_MAX][CMSG_SPACE(sizeof(uint16_t))];
+    size_t owners[TX_SEND_MAX * ACK_BATCH_MAX];
+
+    size_t count = tx_build(tx, 0, n, msgs, iovecs, control, owners);
+    size_t sent = 0;
+
+    while (sent < count) {
+        int retval = sendmmsg(tx->sockfd, &msgs[sent], count - sent, 0);
+        STAT_INC(tx->stats, STAT_TX_SENDS);
+
+        if (retval == -1) {
+            /** No GSO on this kernel, socket or route: resends the rest one frame per datagram */
+            if (tx->gso && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)) {
+                log_event(LOG_HD_GSO_DISABLED, errno, 0, 0);
+                tx->gso = false;
+
+                count = tx_build(tx, owners[sent], n, msgs, iovecs, control, owners);
+                sent = 0;
+                continue;
+            }
+
+            STAT_INC(tx->stats, STAT_TX_ERRORS);
+            log_event(LOG_HD_SEND_FAILED, tx->sockfd, count - sent, errno);
+            return;
+        }
+
+        int i;
+        for (i = 0; i < retval; i++) {
+            STAT_ADD(tx->stats, STAT_TX_FRAMES, msgs[sent + i].msg_hdr.msg_iov->iov_len / ACK_FRAME_SIZE);
+        }
+
+        sent += retval;
+    }
+}
+
+/*
+ * Refer to headers/tx.h
+ */
+size_t tx_run_once(tx_stage_t *tx, bool force) {
+    size_t ready = 0;
+    while (ready < TX_SEND_MAX) {
+        tx_slot_t *slot = &tx->slots[(tx->tail + ready) & (TX_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != tx->tail + ready + 1) {
+            break;
+        }
+
+        ready++;
+    }
+
+    if (ready == 0) {
+        return 0;
+    }
+
+    if (!force && ready < TX_SEND_MAX) {
+        tx_slot_t *oldest = &tx->slots[tx->tail & (TX_RING_SIZE - 1)];
+        if (tx_now() - oldest->queued < tx->deadline_ns) {
+            return 0;
+        }
+    }
+
+    tx_send(tx, ready);
+
+    /** Gives the slots back to the producers, for the next lap */
+    size_t i;
+    for (i = 0; i < ready; i++) {
+        tx_slot_t *slot = &tx->slots[(tx->tail + i) & (TX_RING_SIZE - 1)];
+        __atomic_store_n(&slot->sequence, tx->tail + i + TX_RING_SIZE, __ATOMIC_RELEASE);
+    }
+
+    tx->tail += ready;
+
+    return ready;
+}
+
+/**
+ * The TX thread, see `tx_stage_t`.
+ */
+static void *tx_thread(void *arg) {
+    tx_stage_t *tx = (tx_stage_t *) arg;
+
+    logger_register();
+
+    /** nanosleep would otherwise be rounded up by the default 50us slack */
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    uint64_t nap = tx->deadline_ns > TX_IDLE_NS ? tx->deadline_ns : TX_IDLE_NS;
+    struct timespec idle = {
+        .tv_sec = nap / 1000000000UL,
+        .tv_nsec = nap % 1000000000UL
+    };
+
+    while (!tx->stop) {
+        if (tx_run_once(tx, false) == 0) {
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    while (tx_run_once(tx, true) > 0);
+
+    return NULL;
+}
+
+/*
+ * Refer to headers/tx.h
+ */
+int tx_start(tx_stage_t *tx) {
+    tx->thread = malloc(sizeof(pthread_t));
+    if (tx->thread == NULL) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    tx->stop = false;
+    if (pthread_create(tx->thread, NULL, &tx_thread, tx)) {
+        free(tx->thread);
+        tx->thread = NULL;
+        errno = UNKNOWN;
+        return -1;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "trtp-tx-%zu", tx->id);
+    pthread_setname_np(*tx->thread, name);
+
+    return 0;
+}
+
+/*
+ * Refer to headers/tx.h
+ */
+void tx_stop(tx_stage_t *tx) {
+    if (tx->thread != NULL) {
+        tx->stop = true;
+        pthread_join(*tx->thread, NULL);
+        free(tx->thread);
+        tx->thread = NULL;
+    }
+}
+
+/*
+ * Refer to headers/tx.h
+ */
+void tx_destroy(tx_stage_t *tx) {
+    free(tx->slots);
+    tx->slots = NULL;
+}
@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+
+#include "../headers/workers.h"
+
+/** SIGINT received by the supervisor */
+static volatile sig_atomic_t workers_stop_requested = 0;
+
+/** SIGUSR1 received by the supervisor */
+static volatile sig_atomic_t workers_dump_requested = 0;
+
+static void workers_handle_stop() {
+    workers_stop_requested = 1;
+}
+
+static void workers_handle_dump() {
+    workers_dump_requested = 1;
+}
+
+/**
+ * Returns CLOCK_MONOTONIC in nanoseconds.
+ */
+static inline uint64_t workers_now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/*
+ * Refer to headers/workers.h
+ */
+int workers_init(workers_t *workers, config_rcv_t *config, reg_t *registry) {
+    if (workers == NULL || config == NULL || registry == NULL) {
+        errno = NULL_ARGUMENT;
+        return -1;
+    }
+
+    memset(workers, 0, sizeof(workers_t));
+    workers->count = config->workers;
+    workers->stream_count = config->stream_count;
+    workers->config = config;
+    workers->registry = registry;
+
+    size_t sockets = workers->count * workers->stream_count;
+
+    workers->sockfds = malloc(sockets * sizeof(int));
+    if (workers->sockfds == NULL) {
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < sockets; i++) {
+        workers->sockfds[i] = -1;
+    }
+
+    workers->pids = calloc(workers->count, sizeof(pid_t));
+    workers->started_ns = calloc(workers->count, sizeof(uint64_t));
+    workers->restarts = calloc(workers->count, sizeof(size_t));
+    if (workers->pids == NULL || workers->started_ns == NULL || workers->restarts == NULL) {
+        workers_destroy(workers);
+        errno = FAILED_TO_ALLOCATE;
+        return -1;
+    }
+
+    /** All bound before any worker starts: the group never changes */
+    for (i = 0; i < sockets; i++) {
+        workers->sockfds[i] = rx_socket(config);
+        if (workers->sockfds[i] == -1) {
+            workers_destroy(workers);
+            errno = FAILED_TO_OPEN;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Runs in the new worker: leaves the supervisor behind.
+ */
+static void workers_become(workers_t *workers, size_t worker) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGUSR1, SIG_DFL);
+
+    /** Out of the group of the terminal: SIGINT only comes from the supervisor */
+    setpgid(0, 0);
+    prctl(PR_SET_PDEATHSIG, SIGINT);
+
+    size_t i;
+    for (i = 0; i < workers->count * workers->stream_count; i++) {
+        if (i / workers->stream_count != worker && workers->sockfds[i] != -1) {
+            close(workers->sockfds[i]);
+            workers->sockfds[i] = -1;
+        }
+    }
+
+    config_rcv_t *config = workers->config;
+    if (config->shm_name != NULL) {
+        snprintf(workers->shm_name, sizeof(workers->shm_name), "%s.%zu", config->shm_name, worker);
+        config->shm_name = workers->shm_name;
+    }
+
+    if (config->stats_path != NULL) {
+        snprintf(workers->stats_path, sizeof(workers->stats_path), "%s.%zu", config->stats_path, worker);
+        config->stats_path = workers->stats_path;
+    }
+}
+
+/**
+ * Sends `signo` to every running worker.
+ */
+static void workers_signal(workers_t *workers, int signo) {
+    size_t i;
+    for (i = 0; i < workers->count; i++) {
+        if (workers->pids[i] > 0) {
+            kill(workers->pids[i], signo);
+        }
+    }
+}
+
+/**
+ * Reaps the workers that exited, returns the number of workers
+ * still running or waiting to be restarted.
+ */
+static size_t workers_reap(workers_t *workers, bool stopping) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        size_t i;
+        for (i = 0; i < workers->count && workers->pids[i] != pid; i++);
+
+        if (i == workers->count) {
+            continue;
+        }
+
+        bool crashed = WIFSIGNALED(status);
+        size_t lost = reg_release_worker(workers->registry, i, crashed);
+
+        if (crashed) {
+            workers->failures++;
+            workers->pids[i] = stopping ? WORKER_DONE : WORKER_WAITING;
+            LOG(
+                "WORKERS", "Worker #%zu (pid %d) killed by signal %d, %zu clients lost%s\n",
+                i, pid, WTERMSIG(status), lost, stopping ? "" : ", restarting"
+            );
+        } else {
+            if (WEXITSTATUS(status) != 0) {
+                workers->failures++;
+            }
+
+            workers->pids[i] = WORKER_DONE;
+            LOG("WORKERS", "Worker #%zu (pid %d) exited with status %d\n", i, pid, WEXITSTATUS(status));
+        }
+    }
+
+    size_t alive = 0;
+
+    size_t i;
+    for (i = 0; i < workers->count; i++) {
+        if (stopping && workers->pids[i] == WORKER_WAITING) {
+            workers->pids[i] = WORKER_DONE;
+        }
+
+        if (workers->pids[i] != WORKER_DONE) {
+            alive++;
+        }
+    }
+
+    return alive;
+}
+
+/*
+ * Refer to headers/workers.h
+ */
+int workers_run(workers_t *workers) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(struct sigaction));
+
+    /** No SA_RESTART: the signals cut the sleep short */
+    action.sa_handler = workers_handle_stop;
+    sigaction(SIGINT, &action, NULL);
+
+    action.sa_handler = workers_handle_dump;
+    sigaction(SIGUSR1, &action, NULL);
+
+    bool stopping = false;
+    while (true) {
+        if (workers_stop_requested) {
+            workers_stop_requested = 0;
+            stopping = true;
+
+            /** Every SIGINT is forwarded, a second one stops the workers right away */
+            workers_signal(workers, SIGINT);
+        }
+
+        if (workers_dump_requested) {
+            workers_dump_requested = 0;
+            workers_signal(workers, SIGUSR1);
+        }
+
+        if (workers_reap(workers, stopping) == 0) {
+            break;
+        }
+
+        uint64_t now = workers_now_ns();
+
+        size_t i;
+        for (i = 0; i < workers->count && !stopping; i++) {
+            if (
+                workers->pids[i] != WORKER_WAITING ||
+                now - workers->started_ns[i] < (uint64_t) WORKERS_RESPAWN_MS * 1000000UL
+            ) {
+                continue;
+            }
+
+            if (workers->started_ns[i] != 0) {
+                workers->restarts[i]++;
+            }
+            workers->started_ns[i] = now;
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                workers_become(workers, i);
+                return i;
+            } else if (pid == -1) {
+                LOG("WORKERS", "Failed to start worker #%zu (errno: %d)\n", i, errno);
+            } else {
+                workers->pids[i] = pid;
+                LOG("WORKERS", "Worker #%zu started (pid %d)\n", i, pid);
+            }
+        }
+
+        usleep(WORKERS_POLL_MS * 1000);
+    }
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGUSR1, SIG_DFL);
+
+    return -1;
+}
+
+/*
+ * Refer to headers/workers.h
+ */
+void workers_destroy(workers_t *workers) {
+    if (workers->sockfds != NULL) {
+        size_t i;
+        for (i = 0; i < workers->count * workers->stream_count; i++) {
+            if (workers->sockfds[i] != -1) {
+                close(workers->sockfds[i]);
+            }
+        }
+    }
+
+    free(workers->sockfds);
+    free(workers->pids);
+    free(workers->started_ns);
+    free(workers->restarts);
+
+    workers->sockfds = NULL;
+    workers->pids = NULL;
+    workers->started_ns = NULL;
+    workers->restarts = NULL;
+}
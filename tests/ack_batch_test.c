@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+
+#include "./headers/ack_batch_test.h"
+#include "../headers/ack_batch.h"
+
+/**
+ * Binds a non blocking socket on ::1 (any port), its address in `address`.
+ */
+static int bind_receiver(struct sockaddr_in6 *address) {
+    socklen_t addrlen = sizeof(struct sockaddr_in6);
+
+    memset(address, 0, addrlen);
+    address->sin6_family = AF_INET6;
+    address->sin6_addr = in6addr_loopback;
+
+    int sock = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    CU_ASSERT(sock > 0);
+    CU_ASSERT(bind(sock, (struct sockaddr *) address, addrlen) == 0);
+    CU_ASSERT(getsockname(sock, (struct sockaddr *) address, &addrlen) == 0);
+
+    return sock;
+}
+
+/**
+ * Packs an ACK for `seqnum` in the batch.
+ */
+static void add_ack(ack_batch_t *acks, struct sockaddr_in6 *destination, uint8_t seqnum) {
+    packet_t ack;
+    CU_ASSERT(init_packet(&ack) == 0);
+    ack.type = ACK;
+    ack.seqnum = seqnum;
+    ack.window = 31;
+
+    CU_ASSERT(pack(ack_batch_reserve(acks, destination), &ack, false) == 0);
+    ack_batch_commit(acks);
+}
+
+void test_ack_batch_gso() {
+    struct sockaddr_in6 address;
+    int receiver = bind_receiver(&address);
+    int sender = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sender > 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    ack_batch_t acks;
+    ack_batch_init(&acks, sender, &stats, NULL);
+
+    /** An empty batch sends nothing */
+    CU_ASSERT(ack_batch_flush(&acks) == 0);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACK_SENDS) == 0);
+
+    int i;
+    for (i = 0; i < 3; i++) {
+        add_ack(&acks, &address, i);
+    }
+
+    CU_ASSERT(acks.count == 3);
+    CU_ASSERT(ack_batch_flush(&acks) == 0);
+    CU_ASSERT(acks.count == 0);
+
+    /** A single send (if GSO is available), three datagrams of 11 bytes in order */
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACK_SENDS) == (acks.gso ? 1 : 2));
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACKS) == 3);
+
+    uint8_t buffer[MAX_PACKET_SIZE];
+    packet_t received;
+    CU_ASSERT(init_packet(&received) == 0);
+
+    for (i = 0; i < 3; i++) {
+        CU_ASSERT(recv(receiver, buffer, sizeof(buffer), 0) == ACK_FRAME_SIZE);
+        CU_ASSERT(unpack(buffer, ACK_FRAME_SIZE, &received) == 0);
+        CU_ASSERT(received.type == ACK);
+        CU_ASSERT(received.seqnum == i);
+    }
+
+    CU_ASSERT(recv(receiver, buffer, sizeof(buffer), 0) == -1);
+
+    close(sender);
+    close(receiver);
+}
+
+void test_ack_batch_destinations() {
+    struct sockaddr_in6 first_address, second_address;
+    int first = bind_receiver(&first_address);
+    int second = bind_receiver(&second_address);
+    int sender = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sender > 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    ack_batch_t acks;
+    ack_batch_init(&acks, sender, &stats, NULL);
+
+    /** Another destination sends the batch first */
+    add_ack(&acks, &first_address, 1);
+    add_ack(&acks, &first_address, 2);
+    add_ack(&acks, &second_address, 3);
+
+    CU_ASSERT(acks.count == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACKS) == 2);
+
+    uint8_t buffer[MAX_PACKET_SIZE];
+    CU_ASSERT(recv(first, buffer, sizeof(buffer), 0) == ACK_FRAME_SIZE);
+    CU_ASSERT(recv(first, buffer, sizeof(buffer), 0) == ACK_FRAME_SIZE);
+    CU_ASSERT(recv(second, buffer, sizeof(buffer), 0) == -1);
+
+    /** So does a full batch */
+    int i;
+    for (i = 0; i < ACK_BATCH_MAX; i++) {
+        add_ack(&acks, &second_address, i);
+    }
+
+    CU_ASSERT(acks.count == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACKS) == 2 + ACK_BATCH_MAX);
+
+    CU_ASSERT(ack_batch_flush(&acks) == 0);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACKS) == 3 + ACK_BATCH_MAX);
+
+    int count = 0;
+    while (recv(second, buffer, sizeof(buffer), 0) == ACK_FRAME_SIZE) {
+        count++;
+    }
+
+    CU_ASSERT(count == ACK_BATCH_MAX + 1);
+
+    close(sender);
+    close(first);
+    close(second);
+}
+
+int add_ack_batch_tests() {
+    CU_pSuite pSuite = CU_add_suite("ack_batch_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_ack_batch_gso", test_ack_batch_gso)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_ack_batch_destinations", test_ack_batch_destinations)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "./headers/arena_test.h"
+
+void test_arena_alloc() {
+    arena_t arena;
+    CU_ASSERT(arena_init(&arena, 100, 4, true) == 0);
+    CU_ASSERT(arena.backing != ARENA_MALLOC);
+    CU_ASSERT(arena.object_size == 128);
+    CU_ASSERT(arena.size % ARENA_HUGE_PAGE_SIZE == 0);
+
+    /** Fresh objects are contiguous and aligned */
+    uint8_t *objects[4];
+    size_t i;
+    for (i = 0; i < 4; i++) {
+        objects[i] = arena_alloc(&arena);
+        CU_ASSERT(objects[i] != NULL);
+        CU_ASSERT(arena_contains(&arena, objects[i]));
+        CU_ASSERT((uintptr_t) objects[i] % ARENA_ALIGN == 0);
+        memset(objects[i], 0xFF, 100);
+    }
+
+    CU_ASSERT(objects[3] - objects[0] == 3 * 128);
+    CU_ASSERT(arena.in_use == 4);
+
+    /** Full */
+    errno = 0;
+    CU_ASSERT(arena_alloc(&arena) == NULL);
+    CU_ASSERT(errno == FAILED_TO_ALLOCATE);
+
+    /** Freed objects are reused first */
+    arena_free(&arena, objects[1]);
+    arena_free(&arena, objects[2]);
+    CU_ASSERT(arena.in_use == 2);
+    CU_ASSERT(arena_alloc(&arena) == objects[2]);
+    CU_ASSERT(arena_alloc(&arena) == objects[1]);
+    CU_ASSERT(arena_alloc(&arena) == NULL);
+
+    int local;
+    CU_ASSERT(!arena_contains(&arena, &local));
+
+    arena_destroy(&arena);
+    CU_ASSERT(arena.backing == ARENA_MALLOC);
+
+    CU_ASSERT(arena_init(&arena, 0, 4, false) == -1);
+}
+
+void test_arena_fallback() {
+    /** Not reserved: malloc */
+    pkt_view_t *view = allocate_view();
+    CU_ASSERT(view != NULL);
+    CU_ASSERT(!arena_contains(&arenas[ARENA_VIEWS], view));
+    arena_put(view);
+
+    /** Room for the windows of a single client */
+    CU_ASSERT(arenas_init(1, 2, false) == 0);
+
+    buf_t *window = arena_get(ARENA_WINDOWS, sizeof(buf_t));
+    CU_ASSERT(arena_contains(&arenas[ARENA_WINDOWS], window));
+    CU_ASSERT(initialize_buffer(window, &allocate_view) == 0);
+    CU_ASSERT(arenas[ARENA_VIEWS].in_use == MAX_BUFFER_SIZE);
+
+    size_t i;
+    for (i = 0; i < MAX_BUFFER_SIZE; i++) {
+        CU_ASSERT(arena_contains(&arenas[ARENA_VIEWS], window->nodes[i].value));
+    }
+
+    /** Full: malloc again */
+    view = allocate_view();
+    CU_ASSERT(view != NULL);
+    CU_ASSERT(!arena_contains(&arenas[ARENA_VIEWS], view));
+    arena_put(view);
+
+    /** Packets are never in the arenas */
+    packet_t *pkt = allocate_packet();
+    CU_ASSERT(pkt != NULL);
+    CU_ASSERT(!arena_contains(&arenas[ARENA_VIEWS], pkt));
+    dealloc_packet(pkt);
+
+    /** Everything goes back to the arenas */
+    deallocate_buffer(window);
+    CU_ASSERT(arenas[ARENA_VIEWS].in_use == 0);
+    CU_ASSERT(arenas[ARENA_WINDOWS].in_use == 0);
+
+    arenas_destroy();
+    CU_ASSERT(arenas[ARENA_VIEWS].backing == ARENA_MALLOC);
+}
+
+int add_arena_tests() {
+    CU_pSuite pSuite = CU_add_suite("arena_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_arena_alloc", test_arena_alloc)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_arena_fallback", test_arena_fallback)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
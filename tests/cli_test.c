@@ -40,6 +40,17 @@ void test_cli_noopt() {
     CU_ASSERT(strcmp(config.format, "%d") == 0);
     CU_ASSERT(config.max_connections == 100);
     CU_ASSERT(config.port == 1234);
+    CU_ASSERT(config.arenas);
+    CU_ASSERT(!config.prefault);
+    CU_ASSERT(config.pool_size == 100 * DEFAULT_POOL_PER_CLIENT + 3 * DEFAULT_POOL_PER_THREAD);
+    CU_ASSERT(config.pool_policy == POOL_DROP);
+    CU_ASSERT(config.handle_num == 2);
+    CU_ASSERT(config.handle_min == 2);
+    CU_ASSERT(config.busy_poll_us == 0);
+    CU_ASSERT(!config.tx_stage);
+    CU_ASSERT(config.workers == 0);
+    CU_ASSERT(config.receive_window_size == MAX_WINDOW_SIZE);
+    CU_ASSERT(config.receive_window_min == MAX_WINDOW_SIZE);
 
     free_config_contents(&config);
 }
@@ -65,6 +76,104 @@ void test_cli_all_opt() {
     free_config_contents(&config);
 }
 
+void test_cli_elastic() {
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+
+    char *params[] = { "trtp_receiver", "-n", "1:4", "::1", "1234" };
+
+    CU_ASSERT(parse_receiver(5, params, &config) == 0);
+    CU_ASSERT(config.handle_min == 1);
+    CU_ASSERT(config.handle_num == 4);
+
+    free_config_contents(&config);
+
+    memset(&config, 0, sizeof(config_rcv_t));
+    char *invalid[] = { "trtp_receiver", "-n", "3:2", "::1", "1234" };
+
+    errno = 0;
+    CU_ASSERT(parse_receiver(5, invalid, &config) == -1);
+    CU_ASSERT(errno == CLI_HANDLE_INVALID);
+}
+
+void test_cli_adaptive() {
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+
+    char *params[] = { "trtp_receiver", "-W", "4:64", "::1", "1234" };
+
+    CU_ASSERT(parse_receiver(5, params, &config) == 0);
+    CU_ASSERT(config.receive_window_min == 4);
+    CU_ASSERT(config.receive_window_size == 64);
+
+    free_config_contents(&config);
+
+    memset(&config, 0, sizeof(config_rcv_t));
+    char *invalid[] = { "trtp_receiver", "-W", "0:64", "::1", "1234" };
+
+    errno = 0;
+    CU_ASSERT(parse_receiver(5, invalid, &config) == -1);
+    CU_ASSERT(errno == CLI_WINDOW_INVALID);
+}
+
+void test_cli_busy_poll() {
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+
+    char *params[] = { "trtp_receiver", "-B", "50", "::1", "1234" };
+
+    CU_ASSERT(parse_receiver(5, params, &config) == 0);
+    CU_ASSERT(config.busy_poll_us == 50);
+
+    free_config_contents(&config);
+
+    memset(&config, 0, sizeof(config_rcv_t));
+    char *invalid[] = { "trtp_receiver", "-B", "2000000", "::1", "1234" };
+
+    errno = 0;
+    CU_ASSERT(parse_receiver(5, invalid, &config) == -1);
+    CU_ASSERT(errno == CLI_BUSY_POLL_INVALID);
+}
+
+void test_cli_tx_stage() {
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+
+    char *params[] = { "trtp_receiver", "-T", "0", "::1", "1234" };
+
+    CU_ASSERT(parse_receiver(5, params, &config) == 0);
+    CU_ASSERT(config.tx_stage);
+    CU_ASSERT(config.tx_deadline_us == 0);
+
+    free_config_contents(&config);
+
+    memset(&config, 0, sizeof(config_rcv_t));
+    char *invalid[] = { "trtp_receiver", "-T", "2000000", "::1", "1234" };
+
+    errno = 0;
+    CU_ASSERT(parse_receiver(5, invalid, &config) == -1);
+    CU_ASSERT(errno == CLI_TX_INVALID);
+}
+
+void test_cli_workers() {
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+
+    char *params[] = { "trtp_receiver", "-P", "4", "::1", "1234" };
+
+    CU_ASSERT(parse_receiver(5, params, &config) == 0);
+    CU_ASSERT(config.workers == 4);
+
+    free_config_contents(&config);
+
+    memset(&config, 0, sizeof(config_rcv_t));
+    char *invalid[] = { "trtp_receiver", "-P", "65", "::1", "1234" };
+
+    errno = 0;
+    CU_ASSERT(parse_receiver(5, invalid, &config) == -1);
+    CU_ASSERT(errno == CLI_WORKERS_INVALID);
+}
+
 int add_cli_tests() {
     CU_pSuite pSuite = CU_add_suite("cli_test_suite", 0, 0);
 
@@ -83,5 +192,30 @@ int add_cli_tests() {
         return CU_get_error();
     }
 
+    if (NULL == CU_add_test(pSuite, "test_cli_elastic", test_cli_elastic)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_cli_adaptive", test_cli_adaptive)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_cli_busy_poll", test_cli_busy_poll)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_cli_tx_stage", test_cli_tx_stage)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_cli_workers", test_cli_workers)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
     return 0;
 }
\ No newline at end of file
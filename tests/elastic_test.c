@@ -0,0 +1,154 @@
+#define _GNU_SOURCE
+
+#include "./headers/elastic_test.h"
+#include "../headers/elastic.h"
+
+/** Number of handlers of the tests, all on a single stream */
+#define TEST_HANDLERS 3
+
+/**
+ * Handlers with their counters, ready for `elastic_init`.
+ */
+static void make_handlers(hd_cfg_t handlers[], hd_cfg_t *pointers[], stats_t stats[]) {
+    memset(stats, 0, TEST_HANDLERS * sizeof(stats_t));
+
+    size_t i;
+    for (i = 0; i < TEST_HANDLERS; i++) {
+        memset(&handlers[i], 0, sizeof(hd_cfg_t));
+        handlers[i].id = i;
+        handlers[i].stats = &stats[i];
+        CU_ASSERT(pthread_mutex_init(&handlers[i].park_lock, NULL) == 0);
+        CU_ASSERT(pthread_cond_init(&handlers[i].park_cond, NULL) == 0);
+        pointers[i] = &handlers[i];
+    }
+}
+
+void test_elastic_init() {
+    hd_cfg_t handlers[TEST_HANDLERS];
+    hd_cfg_t *pointers[TEST_HANDLERS];
+    stats_t stats[TEST_HANDLERS];
+    make_handlers(handlers, pointers, stats);
+
+    stream_t stream;
+    CU_ASSERT(initialize_stream(&stream) == 0);
+    stream_t *streams[] = { &stream };
+
+    sts_t handle_streams[TEST_HANDLERS] = { { .stream = 0 }, { .stream = 0 }, { .stream = 0 } };
+
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+    config.handle_num = TEST_HANDLERS;
+    config.handle_min = 2;
+    config.stream_count = 1;
+    config.handle_streams = handle_streams;
+
+    elastic_t elastic;
+    CU_ASSERT(elastic_init(&elastic, &config, pointers, streams) == 0);
+    CU_ASSERT(elastic.active == 2);
+    CU_ASSERT(!handlers[0].parked);
+    CU_ASSERT(!handlers[1].parked);
+    CU_ASSERT(handlers[2].parked);
+
+    /** Everything is woken up to be stopped */
+    elastic_stop(&elastic);
+    CU_ASSERT(!handlers[2].parked);
+
+    elastic_destroy(&elastic);
+    dealloc_stream(&stream);
+}
+
+void test_elastic_scaling() {
+    hd_cfg_t handlers[TEST_HANDLERS];
+    hd_cfg_t *pointers[TEST_HANDLERS];
+    stats_t stats[TEST_HANDLERS];
+    make_handlers(handlers, pointers, stats);
+
+    stream_t stream;
+    CU_ASSERT(initialize_stream(&stream) == 0);
+    stream_t *streams[] = { &stream };
+
+    sts_t handle_streams[TEST_HANDLERS] = { { .stream = 0 }, { .stream = 0 }, { .stream = 0 } };
+
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+    config.handle_num = TEST_HANDLERS;
+    config.handle_min = 1;
+    config.stream_count = 1;
+    config.handle_streams = handle_streams;
+
+    elastic_t elastic;
+    CU_ASSERT(elastic_init(&elastic, &config, pointers, streams) == 0);
+    CU_ASSERT(elastic.active == 1);
+
+    /** A deep queue unparks the next handler */
+    s_node_t nodes[ELASTIC_DEPTH_HIGH + 1];
+    size_t i;
+    for (i = 0; i < ELASTIC_DEPTH_HIGH + 1; i++) {
+        nodes[i].content = NULL;
+        stream_enqueue(&stream, &nodes[i]);
+    }
+
+    elastic_run_once(&elastic);
+    CU_ASSERT(elastic.active == 2);
+    CU_ASSERT(!handlers[1].parked);
+    CU_ASSERT(handlers[2].parked);
+
+    while (stream_pop(&stream, false) != NULL);
+    stream.length = 0;
+
+    /** Saturated handlers unpark the last one */
+    STAT_ADD(&stats[0], STAT_HD_BUSY_NS, ELASTIC_INTERVAL_MS * 1000000UL);
+    STAT_ADD(&stats[1], STAT_HD_BUSY_NS, ELASTIC_INTERVAL_MS * 1000000UL);
+    elastic_run_once(&elastic);
+    CU_ASSERT(elastic.active == 3);
+    CU_ASSERT(!handlers[2].parked);
+
+    /** Idle: parked one by one, from the last, after enough calm periods */
+    for (i = 0; i < ELASTIC_CALM_PERIODS - 1; i++) {
+        elastic_run_once(&elastic);
+    }
+
+    CU_ASSERT(elastic.active == 3);
+    elastic_run_once(&elastic);
+    CU_ASSERT(elastic.active == 2);
+    CU_ASSERT(handlers[2].parked);
+
+    for (i = 0; i < 4 * ELASTIC_CALM_PERIODS; i++) {
+        elastic_run_once(&elastic);
+    }
+
+    /** Never below the minimum */
+    CU_ASSERT(elastic.active == 1);
+    CU_ASSERT(!handlers[0].parked);
+    CU_ASSERT(handlers[1].parked);
+
+    elastic_stop(&elastic);
+    elastic_destroy(&elastic);
+    dealloc_stream(&stream);
+
+    for (i = 0; i < TEST_HANDLERS; i++) {
+        pthread_mutex_destroy(&handlers[i].park_lock);
+        pthread_cond_destroy(&handlers[i].park_cond);
+    }
+}
+
+int add_elastic_tests() {
+    CU_pSuite pSuite = CU_add_suite("elastic_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_elastic_init", test_elastic_init)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_elastic_scaling", test_elastic_scaling)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
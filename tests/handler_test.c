@@ -3,6 +3,7 @@
 #include "./headers/handler_test.h"
 #include "../headers/global.h"
 #include "../headers/handler.h"
+#include "../headers/elastic.h"
 
 void test_global() {
     int addrlen = sizeof(struct sockaddr_in6);
@@ -44,36 +45,20 @@ void test_global() {
     cfg->max_window_size = 31;
     cfg->sockfd = sockfd;
 
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+    cfg->stats = &stats;
+
     client_t client;
     CU_ASSERT(initialize_client(&client, 0, "./bin/%d", &address, &addrlen) == 0);
     
-    packet_t **decoded = alloca(sizeof(packet_t *));
-    CU_ASSERT(decoded != NULL);
-    *decoded = allocate_packet();
-    CU_ASSERT(*decoded != NULL);
-
     bool exit = false;
 
     uint8_t file_buffer[528 * 31];
 
 
-    uint8_t packets_to_send[31][12];
-    struct mmsghdr msg[31];
-    struct iovec hd_iovecs[31];
-
-    memset(hd_iovecs, 0, (size_t) 31);
-    int i;
-    for(i = 0; i < 31; i++) {
-        memset(&hd_iovecs[i], 0, sizeof(struct iovec));
-        hd_iovecs[i].iov_base = packets_to_send[i];
-        hd_iovecs[i].iov_len  = 11;
-
-        memset(&msg[i], 0, sizeof(struct mmsghdr));
-        msg[i].msg_hdr.msg_iov = &hd_iovecs[i];
-        msg[i].msg_hdr.msg_name = NULL;
-        msg[i].msg_hdr.msg_iovlen = 1;
-        msg[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
-    }
+    ack_batch_t acks;
+    ack_batch_init(&acks, sockfd, &stats, NULL);
     
 
     s_node_t *node1 = (s_node_t *)malloc(sizeof(s_node_t));
@@ -104,10 +89,11 @@ void test_global() {
     strcpy(pkt1.payload, "NOUGATERIGNO\n");
     pkt1.seqnum = 0;
 
-    pack(req1->buffer[0], &pkt1, true);
+    pack(req1->data, &pkt1, true);
     //packet_to_string(&pkt1, true);
     req1->client = &client;
-    req1->lengths[0] = 11 + 13 + 4;
+    req1->offsets[0] = 0;
+    req1->offsets[1] = 11 + 13 + 4;
     req1->num = 1;
     req1->stop = false;
 
@@ -123,10 +109,11 @@ void test_global() {
     strcpy(pkt2.payload, "ZA WAAAARUUUUDOOOOOOOOO!!!!!!\n");
     pkt2.seqnum = 0;
 
-    pack(req2->buffer[0], &pkt2, true);
+    pack(req2->data, &pkt2, true);
     //packet_to_string(&pkt2, true);
     req2->client = &client;
-    req2->lengths[0] = 11 + 30 + 4;
+    req2->offsets[0] = 0;
+    req2->offsets[1] = 11 + 30 + 4;
     req2->num = 1;
     req2->stop = false;
 
@@ -142,10 +129,11 @@ void test_global() {
     strcpy(pkt3.payload, "DIIIOOO DAAA!!!!\n");
     pkt3.seqnum = 1;
 
-    pack(req3->buffer[0], &pkt3, true);
+    pack(req3->data, &pkt3, true);
     //packet_to_string(&pkt3, true);
     req3->client = &client;
-    req3->lengths[0] = 11 + 17 + 4;
+    req3->offsets[0] = 0;
+    req3->offsets[1] = 11 + 17 + 4;
     req3->num = 1;
     req3->stop = false;
 
@@ -161,10 +149,11 @@ void test_global() {
     pkt4.length = 0;
     pkt4.seqnum = 2;
 
-    pack(req4->buffer[0], &pkt4, true);
+    pack(req4->data, &pkt4, true);
     //packet_to_string(&pkt4, true);
     req4->client = &client;
-    req4->lengths[0] = 11;
+    req4->offsets[0] = 0;
+    req4->offsets[1] = 11;
     req4->num = 1;
     req4->stop = false;
 
@@ -173,7 +162,7 @@ void test_global() {
 
     stream_enqueue(&rx_to_hd, node1);
 
-    hd_run_once(wait, cfg, decoded, &exit, file_buffer, packets_to_send, msg);
+    hd_run_once(wait, cfg, &exit, file_buffer, &acks);
 
     size_t nreceived = recv(send_sock, buf, sizeof(buf), 0);
     CU_ASSERT(nreceived > 0);
@@ -191,7 +180,7 @@ void test_global() {
 
     stream_enqueue(&rx_to_hd, node2);
 
-    hd_run_once(wait, cfg, decoded, &exit, file_buffer, packets_to_send, msg);
+    hd_run_once(wait, cfg, &exit, file_buffer, &acks);
     
     memset(buf, 0, 528);
     memset(&received, 0, sizeof(packet_t));
@@ -211,7 +200,7 @@ void test_global() {
 
     stream_enqueue(&rx_to_hd, node3);
 
-    hd_run_once(wait, cfg, decoded, &exit, file_buffer, packets_to_send, msg);
+    hd_run_once(wait, cfg, &exit, file_buffer, &acks);
     
     memset(buf, 0, 528);
     memset(&received, 0, sizeof(packet_t));
@@ -231,7 +220,7 @@ void test_global() {
 
     stream_enqueue(&rx_to_hd, node4);
 
-    hd_run_once(wait, cfg, decoded, &exit, file_buffer, packets_to_send, msg);
+    hd_run_once(wait, cfg, &exit, file_buffer, &acks);
     
     memset(buf, 0, 528);
     memset(&received, 0, sizeof(packet_t));
@@ -247,6 +236,11 @@ void test_global() {
 
     CU_ASSERT(client.active == false);
 
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_REQUESTS) == 4);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_DUPLICATES) + STAT_GET(&stats, STAT_HD_OUT_OF_WINDOW) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACKS) == 4);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_COMPLETED) == 1);
+
     FILE *fd = fopen("./bin/0", "rb");
     CU_ASSERT(fd > 0);
     char string[528];
@@ -270,10 +264,377 @@ void test_global() {
     dealloc_stream(&rx_to_hd);
     dealloc_stream(&hd_to_rx);
     free(cfg);
-    free(*decoded);
 
 }
 
+/**
+ * Queues a request holding a single DATA of one byte for `client`.
+ */
+static s_node_t *push_one(stream_t *stream, client_t *client, uint8_t seqnum) {
+    s_node_t *node = malloc(sizeof(s_node_t));
+    CU_ASSERT(node != NULL);
+    CU_ASSERT(initialize_node(node, allocate_handle_request) == 0);
+
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.length = 1;
+    pkt.payload[0] = 'a' + seqnum;
+    pkt.seqnum = seqnum;
+    pkt.timestamp = seqnum;
+
+    hd_req_t *req = node->content;
+    CU_ASSERT(pack(req->data, &pkt, true) == 0);
+    req->client = client;
+    req->offsets[0] = 0;
+    req->offsets[1] = 11 + 1 + 4;
+    req->num = 1;
+
+    stream_enqueue(stream, node);
+
+    return node;
+}
+
+void test_pinned() {
+    int addrlen = sizeof(struct sockaddr_in6);
+
+    struct sockaddr_in6 address;
+    memset(&address, 0, addrlen);
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_loopback;
+    address.sin6_port = htons(5557);
+
+    int sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sockfd > 0);
+
+    stream_t rx_to_hd;
+    CU_ASSERT(initialize_stream(&rx_to_hd) == 0);
+
+    stream_t hd_to_rx;
+    CU_ASSERT(initialize_stream(&hd_to_rx) == 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    hd_cfg_t cfg;
+    memset(&cfg, 0, sizeof(hd_cfg_t));
+    cfg.rx = &rx_to_hd;
+    cfg.tx = &hd_to_rx;
+    cfg.max_window_size = 31;
+    cfg.sockfd = sockfd;
+    cfg.stats = &stats;
+
+    client_t *client = malloc(sizeof(client_t));
+    CU_ASSERT(client != NULL);
+    CU_ASSERT(initialize_client(client, 1, "./bin/%d", &address, &addrlen) == 0);
+
+    ack_batch_t acks;
+    ack_batch_init(&acks, sockfd, &stats, NULL);
+
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE];
+    bool exit = false;
+
+    /** Ahead of the window: every request stays in it */
+    hd_req_t *first = push_one(&rx_to_hd, client, 1)->content;
+    hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    CU_ASSERT(hd_to_rx.length == 0);
+    CU_ASSERT(first->refs == 1);
+    CU_ASSERT(client->pinned == 1);
+
+    uint8_t seqnum;
+    for (seqnum = 2; seqnum < 5; seqnum++) {
+        push_one(&rx_to_hd, client, seqnum);
+        hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    }
+
+    CU_ASSERT(hd_to_rx.length == 0);
+    CU_ASSERT(client->pinned == 4);
+
+    /** The pool runs low: dropped, its request goes back */
+    cfg.pin_reserve = 1000;
+    push_one(&rx_to_hd, client, 5);
+    hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    CU_ASSERT(hd_to_rx.length == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_PIN_DROPS) == 1);
+    CU_ASSERT(client->pinned == 4);
+
+    /** The first one (never dropped) writes the window: every request goes back */
+    push_one(&rx_to_hd, client, 0);
+    hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    CU_ASSERT(hd_to_rx.length == 6);
+    CU_ASSERT(client->pinned == 0);
+    CU_ASSERT(client->window->window_low == 5);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_BYTES_WRITTEN) == 5);
+
+    /** A removed client gives back what it still holds */
+    cfg.pin_reserve = 0;
+    for (seqnum = 7; seqnum < 10; seqnum++) {
+        push_one(&rx_to_hd, client, seqnum);
+        hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    }
+
+    CU_ASSERT(hd_to_rx.length == 6);
+    CU_ASSERT(client->pinned == 3);
+
+    fflush(client->out_file);
+
+    FILE *fd = fopen("./bin/1", "rb");
+    CU_ASSERT(fd != NULL);
+    if (fd != NULL) {
+        char string[16];
+        memset(string, 0, sizeof(string));
+        CU_ASSERT(fread(string, 1, sizeof(string), fd) == 5);
+        CU_ASSERT(memcmp(string, "abcde", 5) == 0);
+        fclose(fd);
+    }
+
+    /** A failed write keeps its requests: the next flush copies them again */
+    FILE *out_file = client->out_file;
+    client->out_file = fopen("./bin/1", "rb");
+    CU_ASSERT(client->out_file != NULL);
+
+    push_one(&rx_to_hd, client, 5);
+    hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_WRITE_ERRORS) == 1);
+    CU_ASSERT(hd_to_rx.length == 6);
+    CU_ASSERT(client->pinned == 4);
+    CU_ASSERT(client->window->length == 4);
+    CU_ASSERT(client->window->window_low == 5);
+
+    fclose(client->out_file);
+    client->out_file = out_file;
+
+    push_one(&rx_to_hd, client, 6);
+    hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    CU_ASSERT(hd_to_rx.length == 11);
+    CU_ASSERT(client->pinned == 0);
+    CU_ASSERT(client->window->window_low == 10);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_BYTES_WRITTEN) == 10);
+
+    fflush(client->out_file);
+
+    fd = fopen("./bin/1", "rb");
+    CU_ASSERT(fd != NULL);
+    if (fd != NULL) {
+        char string[16];
+        memset(string, 0, sizeof(string));
+        CU_ASSERT(fread(string, 1, sizeof(string), fd) == 10);
+        CU_ASSERT(memcmp(string, "abcdefghij", 10) == 0);
+        fclose(fd);
+    }
+
+    deallocate_client(client, true, true);
+    CU_ASSERT(hd_to_rx.length == 11);
+
+    close(sockfd);
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+}
+
+/**
+ * Appends a DATA of one byte (none if `eof`) to a request.
+ */
+static void push_data(hd_req_t *req, size_t index, bool eof) {
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.window = 31;
+    pkt.length = eof ? 0 : 1;
+    pkt.payload[0] = 'a' + index % 26;
+    pkt.seqnum = index & 0xFF;
+    pkt.timestamp = index;
+
+    uint8_t buffer[MAX_PACKET_SIZE];
+    CU_ASSERT(pack(buffer, &pkt, true) == 0);
+    CU_ASSERT(hd_req_push(req, buffer, eof ? 11 : 11 + 1 + 4));
+}
+
+void test_pinned_pool() {
+    int addrlen = sizeof(struct sockaddr_in6);
+
+    struct sockaddr_in6 address;
+    memset(&address, 0, addrlen);
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_loopback;
+    address.sin6_port = htons(5558);
+
+    int sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sockfd > 0);
+
+    stream_t rx_to_hd;
+    CU_ASSERT(initialize_stream(&rx_to_hd) == 0);
+
+    stream_t hd_to_rx;
+    CU_ASSERT(initialize_stream(&hd_to_rx) == 0);
+
+    /** A pool of 4 requests, with the reserve main gives it */
+    size_t i;
+    for (i = 0; i < 4; i++) {
+        s_node_t *node = malloc(sizeof(s_node_t));
+        CU_ASSERT(node != NULL);
+        CU_ASSERT(initialize_node(node, allocate_handle_request) == 0);
+        stream_enqueue(&hd_to_rx, node);
+    }
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    hd_cfg_t cfg;
+    memset(&cfg, 0, sizeof(hd_cfg_t));
+    cfg.rx = &rx_to_hd;
+    cfg.tx = &hd_to_rx;
+    cfg.max_window_size = 31;
+    cfg.sockfd = sockfd;
+    cfg.stats = &stats;
+    cfg.pin_reserve = 1;
+
+    client_t *client = malloc(sizeof(client_t));
+    CU_ASSERT(client != NULL);
+    CU_ASSERT(initialize_client(client, 2, "./bin/%d", &address, &addrlen) == 0);
+
+    ack_batch_t acks;
+    ack_batch_init(&acks, sockfd, &stats, NULL);
+
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE];
+    bool exit = false;
+
+    /**
+     * Every request holds the first missing packet and one 8 ahead
+     * of it: the first one is written, the other one pins the request
+     * (more requests than in the pool before it can be written).
+     * 300 packets (the sequence numbers wrap) and the end of transfer.
+     */
+    size_t count = 300;
+    size_t round;
+    for (round = 0; round < 10 * count && STAT_GET(&stats, STAT_HD_COMPLETED) == 0; round++) {
+        s_node_t *node = stream_pop(&hd_to_rx, false);
+        if (node == NULL) {
+            /** What a receiver does with an empty pool (-Q drop) */
+            continue;
+        }
+
+        size_t low = STAT_GET(&stats, STAT_HD_BYTES_WRITTEN);
+
+        hd_req_t *req = node->content;
+        req->client = client;
+        req->num = 0;
+        req->offsets[0] = 0;
+        req->timestamp = 0;
+
+        push_data(req, low, low == count);
+        if (low + 8 <= count) {
+            push_data(req, low + 8, low + 8 == count);
+        }
+
+        client->queued++;
+        stream_enqueue(&rx_to_hd, node);
+        hd_run_once(false, &cfg, &exit, file_buffer, &acks);
+    }
+
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_COMPLETED) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_BYTES_WRITTEN) == count);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_PIN_DROPS) > 0);
+    CU_ASSERT(client->pinned == 0);
+    CU_ASSERT(hd_to_rx.length == 4);
+
+    FILE *fd = fopen("./bin/2", "rb");
+    CU_ASSERT(fd != NULL);
+    if (fd != NULL) {
+        char string[400];
+        CU_ASSERT(fread(string, 1, sizeof(string), fd) == count);
+        for (i = 0; i < count && string[i] == 'a' + i % 26; i++);
+        CU_ASSERT(i == count);
+        fclose(fd);
+    }
+
+    deallocate_client(client, true, true);
+
+    close(sockfd);
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+}
+
+/** What a parked handler holds */
+typedef struct park_args {
+    hd_cfg_t *cfg;
+    ack_batch_t *acks;
+} park_args_t;
+
+static void *park_thread(void *arg) {
+    park_args_t *args = (park_args_t *) arg;
+    hd_park(args->cfg, args->acks);
+
+    return NULL;
+}
+
+void test_park_flush() {
+    socklen_t addrlen = sizeof(struct sockaddr_in6);
+
+    /** The sender of the pending ACK */
+    struct sockaddr_in6 address;
+    memset(&address, 0, addrlen);
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_loopback;
+
+    int sender = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    CU_ASSERT(sender > 0);
+    CU_ASSERT(bind(sender, (struct sockaddr *) &address, addrlen) == 0);
+    CU_ASSERT(getsockname(sender, (struct sockaddr *) &address, &addrlen) == 0);
+
+    int sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sockfd > 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    hd_cfg_t cfg;
+    memset(&cfg, 0, sizeof(hd_cfg_t));
+    cfg.sockfd = sockfd;
+    cfg.stats = &stats;
+    cfg.parked = true;
+    pthread_mutex_init(&cfg.park_lock, NULL);
+    pthread_cond_init(&cfg.park_cond, NULL);
+
+    ack_batch_t acks;
+    ack_batch_init(&acks, sockfd, &stats, NULL);
+
+    /** Left by the last request, another handler took the next one */
+    packet_t ack;
+    CU_ASSERT(init_packet(&ack) == 0);
+    ack.type = ACK;
+    ack.seqnum = 7;
+    ack.window = 31;
+    CU_ASSERT(pack_ack(ack_batch_reserve(&acks, &address), &ack) == 0);
+    ack_batch_commit(&acks);
+    CU_ASSERT(acks.count == 1);
+
+    park_args_t args = { .cfg = &cfg, .acks = &acks };
+
+    pthread_t thread;
+    CU_ASSERT(pthread_create(&thread, NULL, park_thread, &args) == 0);
+
+    /** Still parked, the ACK must be out */
+    uint8_t buffer[MAX_PACKET_SIZE];
+    ssize_t received = -1;
+    int tries;
+    for (tries = 0; tries < 100 && received == -1; tries++) {
+        usleep(10 * 1000);
+        received = recv(sender, buffer, sizeof(buffer), 0);
+    }
+
+    CU_ASSERT(received == ACK_FRAME_SIZE);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACKS) == 1);
+
+    elastic_set_parked(&cfg, false);
+    CU_ASSERT(pthread_join(thread, NULL) == 0);
+    CU_ASSERT(acks.count == 0);
+
+    pthread_mutex_destroy(&cfg.park_lock);
+    pthread_cond_destroy(&cfg.park_cond);
+    close(sender);
+    close(sockfd);
+}
+
 int add_global_tests() {
     CU_pSuite pSuite = CU_add_suite("handler_test_suite", 0, 0);
 
@@ -287,5 +648,20 @@ int add_global_tests() {
         return CU_get_error();
     }
 
+    if (NULL == CU_add_test(pSuite, "test_pinned", test_pinned)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_pinned_pool", test_pinned_pool)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_park_flush", test_park_flush)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include <CUnit/CUnit.h>
+
+void test_ack_batch_gso();
+
+void test_ack_batch_destinations();
+
+int add_ack_batch_tests();
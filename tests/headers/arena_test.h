@@ -0,0 +1,10 @@
+#include <CUnit/CUnit.h>
+
+#include "../../headers/arena.h"
+#include "../../headers/buffer.h"
+
+void test_arena_alloc();
+
+void test_arena_fallback();
+
+int add_arena_tests();
@@ -6,4 +6,14 @@ void test_cli_noopt();
 
 void test_cli_all_opt();
 
+void test_cli_elastic();
+
+void test_cli_adaptive();
+
+void test_cli_busy_poll();
+
+void test_cli_tx_stage();
+
+void test_cli_workers();
+
 int add_cli_tests();
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include <CUnit/CUnit.h>
+
+void test_elastic_init();
+
+void test_elastic_scaling();
+
+int add_elastic_tests();
@@ -2,4 +2,10 @@
 
 void test_global();
 
+void test_pinned();
+
+void test_pinned_pool();
+
+void test_park_flush();
+
 int add_global_tests();
\ No newline at end of file
@@ -0,0 +1,9 @@
+#include <CUnit/CUnit.h>
+
+#include "../../headers/histogram.h"
+
+void test_histogram_buckets();
+
+void test_histogram_percentiles();
+
+int add_histogram_tests();
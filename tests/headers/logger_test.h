@@ -0,0 +1,7 @@
+#include <CUnit/CUnit.h>
+
+#include "../../headers/logger.h"
+
+void test_logger_async();
+
+int add_logger_tests();
@@ -6,8 +6,16 @@ void test_ack_decoding();
 
 void test_ack_encoding();
 
+void test_ack_template();
+
+void test_crc32_batch();
+
+void test_unpack_precomputed();
+
 void test_data_decoding();
 
 void test_data_encoding();
 
+void test_long_length_encoding();
+
 int add_packet_tests();
\ No newline at end of file
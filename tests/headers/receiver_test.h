@@ -3,4 +3,14 @@
 
 void test_receiver();
 
+void test_receiver_dispatch();
+
+void test_receiver_pool();
+
+void test_receiver_split();
+
+void test_receiver_interleaved();
+
+void test_receiver_adapt();
+
 int add_receiver_tests();
\ No newline at end of file
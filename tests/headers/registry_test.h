@@ -0,0 +1,9 @@
+#include <CUnit/CUnit.h>
+
+void test_registry_claim();
+
+void test_registry_worker();
+
+void test_registry_shared();
+
+int add_registry_tests();
@@ -0,0 +1,7 @@
+#include <CUnit/CUnit.h>
+
+void test_seq_in_order();
+
+void test_seq_keep();
+
+int add_sequential_tests();
@@ -0,0 +1,7 @@
+#include <CUnit/CUnit.h>
+
+#include "../../headers/shm.h"
+
+void test_shm_publish();
+
+int add_shm_tests();
@@ -0,0 +1,9 @@
+#include <CUnit/CUnit.h>
+
+#include "../../headers/stats.h"
+
+void test_stats_snapshot();
+
+void test_stats_server();
+
+int add_stats_tests();
@@ -6,4 +6,6 @@ void test_single();
 
 void test_many();
 
+void test_spin();
+
 int add_stream_tests();
\ No newline at end of file
@@ -0,0 +1,17 @@
+#include <CUnit/CUnit.h>
+
+/** mkdir */
+#include <sys/stat.h>
+
+#include "../../headers/topology.h"
+#include "../../headers/arena.h"
+
+void test_topology_discover();
+
+void test_topology_place();
+
+void test_topology_nodes();
+
+void test_topology_bind();
+
+int add_topology_tests();
@@ -0,0 +1,7 @@
+#include <CUnit/CUnit.h>
+
+void test_tx_handover();
+
+void test_tx_full();
+
+int add_tx_tests();
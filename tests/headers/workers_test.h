@@ -0,0 +1,5 @@
+#include <CUnit/CUnit.h>
+
+void test_workers_restart();
+
+int add_workers_tests();
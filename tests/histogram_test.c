@@ -0,0 +1,86 @@
+#include "./headers/histogram_test.h"
+
+void test_histogram_buckets() {
+    size_t i;
+
+    /** Small values are exact */
+    for (i = 0; i < 16; i++) {
+        CU_ASSERT(hist_index(i) == i);
+        CU_ASSERT(hist_lower_bound(i) == i);
+    }
+
+    /** Every bucket contains its lower bound and the buckets are sorted */
+    for (i = 1; i < HIST_BUCKETS; i++) {
+        CU_ASSERT(hist_index(hist_lower_bound(i)) == i);
+        CU_ASSERT(hist_lower_bound(i) > hist_lower_bound(i - 1));
+        CU_ASSERT(hist_index(hist_lower_bound(i) - 1) == i - 1);
+    }
+
+    /** The relative error stays below 1/8th */
+    uint64_t value;
+    for (value = 1; value < (1UL << 36); value = value * 3 + 1) {
+        uint64_t lower = hist_lower_bound(hist_index(value));
+        CU_ASSERT(lower <= value);
+        CU_ASSERT((value - lower) * HIST_SUB_BUCKETS <= value);
+    }
+
+    /** Values that are too large end up in the last bucket */
+    CU_ASSERT(hist_index(UINT64_MAX) == HIST_BUCKETS - 1);
+}
+
+void test_histogram_percentiles() {
+    hist_t *hist = NULL;
+    CU_ASSERT(posix_memalign((void **) &hist, 64, 2 * sizeof(hist_t)) == 0);
+    memset(hist, 0, 2 * sizeof(hist_t));
+
+    CU_ASSERT(hist_percentile(&hist[0], 50.0) == 0);
+
+    uint64_t i;
+    for (i = 1; i <= 1000; i++) {
+        hist_record(&hist[0], i * 1000);
+    }
+
+    CU_ASSERT(hist[0].count == 1000);
+    CU_ASSERT(hist[0].max == 1000000);
+
+    uint64_t p50 = hist_percentile(&hist[0], 50.0);
+    uint64_t p99 = hist_percentile(&hist[0], 99.0);
+    CU_ASSERT(p50 <= 500000 && p50 >= 500000 - 500000 / HIST_SUB_BUCKETS);
+    CU_ASSERT(p99 <= 990000 && p99 >= 990000 - 990000 / HIST_SUB_BUCKETS);
+    CU_ASSERT(hist_percentile(&hist[0], 100.0) <= 1000000);
+
+    hist_merge(&hist[1], &hist[0]);
+    hist_merge(&hist[1], &hist[0]);
+    CU_ASSERT(hist[1].count == 2000);
+    CU_ASSERT(hist_percentile(&hist[1], 50.0) == p50);
+
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    hist_write_text(&hist[0], "hd.0", "rx_to_ack", out);
+    fclose(out);
+
+    CU_ASSERT(strstr(text, "hd.0.rx_to_ack.count 1000\n") != NULL);
+    CU_ASSERT(strstr(text, "hd.0.rx_to_ack.mean 500500\n") != NULL);
+    CU_ASSERT(strstr(text, "hd.0.rx_to_ack.max 1000000\n") != NULL);
+
+    free(text);
+    free(hist);
+}
+
+int add_histogram_tests() {
+    CU_pSuite pSuite = CU_add_suite("histogram_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_histogram_buckets", test_histogram_buckets) ||
+        NULL == CU_add_test(pSuite, "test_histogram_percentiles", test_histogram_percentiles)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "./headers/logger_test.h"
+
+void test_logger_async() {
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    CU_ASSERT(out != NULL);
+
+    CU_ASSERT(logger_register() == -1);
+    CU_ASSERT(logger_start(out) == 0);
+    CU_ASSERT(logger_register() == 0);
+
+    struct sockaddr_in6 address;
+    memset(&address, 0, sizeof(struct sockaddr_in6));
+    address.sin6_family = AF_INET6;
+    address.sin6_port = htons(1234);
+    address.sin6_addr.__in6_u.__u6_addr8[15] = 1;
+
+    log_client_event(LOG_RX_NEW_CLIENT, 7, &address, 0, 0, 0);
+    log_event(LOG_HD_AFFINITY, 1, 2, 0);
+
+    /** Only the first 20 packet errors per second are kept */
+    int i;
+    for (i = 0; i < 50; i++) {
+        log_client_event(LOG_HD_CRC_HEADER, 7, &address, 0, 0, 0);
+    }
+
+    char *counters = NULL;
+    size_t counters_len = 0;
+    FILE *counters_out = open_memstream(&counters, &counters_len);
+    logger_write_text(counters_out);
+    fclose(counters_out);
+
+    CU_ASSERT(strstr(counters, "log.packet.suppressed 30\n") != NULL);
+    CU_ASSERT(strstr(counters, "log.packet.dropped 0\n") != NULL);
+
+    logger_stop();
+    fclose(out);
+
+    CU_ASSERT(strstr(text, "[RX] New client #7 at [::1]:1234\n") != NULL);
+    CU_ASSERT(strstr(text, "[HD] Handler #1 running on CPU #2\n") != NULL);
+    CU_ASSERT(strstr(text, "[LOG] 30 packet messages suppressed") != NULL);
+
+    int count = 0;
+    char *cursor = text;
+    while ((cursor = strstr(cursor, "Header could not be validated")) != NULL) {
+        count++;
+        cursor++;
+    }
+    CU_ASSERT(count == 20);
+
+    free(counters);
+    free(text);
+}
+
+int add_logger_tests() {
+    CU_pSuite pSuite = CU_add_suite("logger_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_logger_async", test_logger_async)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "./headers/packet_test.h"
+#include "../headers/handler.h"
 
 uint8_t ack_packet[11] = {
     // Type + TR + Window
@@ -59,6 +60,203 @@ void test_ack_encoding() {
     free(packed);
 }
 
+void test_ack_template() {
+    packet_t packet;
+    memset(&packet, 0, sizeof(packet_t));
+
+    uint8_t expected[11];
+    uint8_t packed[11];
+
+    uint32_t timestamps[] = { 0, 0xFFFFFFFF, 0b10101010000000000101010100000000, 1, 0x80000000 };
+    uint32_t random = 42;
+
+    /** Every type, window and seqnum with a few timestamps, bit for bit the same frame as pack */
+    int mismatches = 0;
+    int type, window, seqnum;
+    size_t i;
+    for (type = ACK; type <= NACK; type++) {
+        for (window = 0; window < 32; window++) {
+            for (seqnum = 0; seqnum < 256; seqnum++) {
+                for (i = 0; i < sizeof(timestamps) / sizeof(uint32_t) + 2; i++) {
+                    random = random * 1103515245 + 12345;
+
+                    packet.type = type;
+                    packet.window = window;
+                    packet.seqnum = seqnum;
+                    packet.timestamp = i < sizeof(timestamps) / sizeof(uint32_t) ? timestamps[i] : random;
+
+                    pack(expected, &packet, false);
+                    if (pack_ack(packed, &packet) || memcmp(expected, packed, sizeof(packed))) {
+                        mismatches++;
+                    }
+                }
+            }
+        }
+    }
+
+    CU_ASSERT(mismatches == 0);
+
+    /** The reference frame */
+    packet.type = ACK;
+    packet.window = 0b01010;
+    packet.seqnum = 0b10101010;
+    packet.timestamp = 0b10101010000000000101010100000000;
+
+    CU_ASSERT(pack_ack(packed, &packet) == 0);
+    CU_ASSERT(unpack(packed, sizeof(packed), &packet) == 0);
+    CU_ASSERT(packet.crc1 == crc32_8bytes(packed, 7, 0));
+
+    packet.type = DATA;
+    errno = 0;
+    CU_ASSERT(pack_ack(packed, &packet) == -1);
+    CU_ASSERT(errno == TYPE_IS_WRONG);
+}
+
+void test_crc32_batch() {
+    uint8_t data[9][600];
+    uint8_t *buffers[9];
+    size_t lengths[9] = { 512, 7, 8, 0, 513, 100, 3, 600, 64 };
+    uint32_t crcs[9];
+
+    size_t i, j;
+    for (i = 0; i < 9; i++) {
+        for (j = 0; j < sizeof(data[i]); j++) {
+            data[i][j] = (uint8_t) (i * 31 + j * 7 + (j >> 3));
+        }
+
+        buffers[i] = data[i];
+    }
+
+    /** Every count, so that every group size (and the padding of the last one) is tried */
+    size_t count;
+    for (count = 0; count <= 9; count++) {
+        memset(crcs, 0, sizeof(crcs));
+        crc32_batch(buffers, lengths, count, crcs);
+
+        for (i = 0; i < count; i++) {
+            CU_ASSERT(crcs[i] == crc32_16bytes(buffers[i], lengths[i], 0));
+        }
+    }
+
+    /** Unaligned buffers */
+    for (i = 0; i < 9; i++) {
+        buffers[i] = data[i] + i;
+    }
+
+    crc32_batch(buffers, lengths, 8, crcs);
+    for (i = 0; i < 8; i++) {
+        CU_ASSERT(crcs[i] == crc32_16bytes(buffers[i], lengths[i], 0));
+    }
+
+    /** Every length around the folded ones (`CRC_FOLD_MIN`) and their tails */
+    for (i = 0; i < 300; i++) {
+        uint8_t *buffer = data[7] + (i & 7);
+        size_t length = i;
+        uint32_t crc = 0;
+
+        crc32_batch(&buffer, &length, 1, &crc);
+        CU_ASSERT(crc == crc32_16bytes(buffer, length, 0));
+    }
+}
+
+void test_unpack_precomputed() {
+    hd_req_t *req = malloc(sizeof(hd_req_t));
+    CU_ASSERT(req != NULL);
+    if (req == NULL) {
+        return;
+    }
+
+    hd_req_reset(req);
+
+    packet_t packet;
+    CU_ASSERT(init_packet(&packet) == 0);
+
+    uint8_t raw[MAX_PACKET_SIZE];
+    size_t i;
+    for (i = 0; i < MAX_PAYLOAD_SIZE; i++) {
+        packet.payload[i] = (uint8_t) (i * 13);
+    }
+
+    /** A full DATA, a short one, a truncated one (all with a long length) and an ACK */
+    packet.type = DATA;
+    set_length(&packet, MAX_PAYLOAD_SIZE);
+    packet.seqnum = 1;
+    CU_ASSERT(pack(raw, &packet, true) == 0);
+    CU_ASSERT(hd_req_push(req, raw, 8 + 4 + MAX_PAYLOAD_SIZE + 4));
+
+    set_length(&packet, 13);
+    packet.seqnum = 2;
+    CU_ASSERT(pack(raw, &packet, true) == 0);
+    CU_ASSERT(hd_req_push(req, raw, 8 + 4 + 13 + 4));
+
+    /** The same one with a corrupted payload, then a corrupted header */
+    raw[16] ^= 1;
+    CU_ASSERT(hd_req_push(req, raw, 8 + 4 + 13 + 4));
+    raw[16] ^= 1;
+    raw[3] ^= 1;
+    CU_ASSERT(hd_req_push(req, raw, 8 + 4 + 13 + 4));
+
+    packet.truncated = true;
+    packet.seqnum = 3;
+    CU_ASSERT(pack(raw, &packet, true) == 0);
+    CU_ASSERT(hd_req_push(req, raw, 8 + 4));
+
+    packet.truncated = false;
+    packet.type = ACK;
+    set_length(&packet, 0);
+    packet.seqnum = 4;
+    CU_ASSERT(pack_ack(raw, &packet) == 0);
+    CU_ASSERT(hd_req_push(req, raw, ACK_FRAME_SIZE));
+
+    /** Too short to hold a header, then a payload cut short */
+    CU_ASSERT(hd_req_push(req, raw, 5));
+    CU_ASSERT(hd_req_push(req, raw, 1));
+
+    packet.type = DATA;
+    set_length(&packet, 100);
+    CU_ASSERT(pack(raw, &packet, true) == 0);
+    CU_ASSERT(hd_req_push(req, raw, 8 + 4 + 50));
+
+    uint32_t header_crcs[MAX_WINDOW_SIZE];
+    uint32_t payload_crcs[MAX_WINDOW_SIZE];
+    hd_req_crcs(req, header_crcs, payload_crcs);
+
+    /** The same result (and error) as `unpack` for every datagram */
+    packet_t expected, unpacked;
+    for (i = 0; i < req->num; i++) {
+        uint8_t copy[MAX_PACKET_SIZE];
+        memcpy(copy, hd_req_datagram(req, i), hd_req_length(req, i));
+
+        errno = 0;
+        int expected_result = unpack(copy, hd_req_length(req, i), &expected);
+        int expected_errno = errno;
+
+        errno = 0;
+        int result = unpack_precomputed(hd_req_datagram(req, i), hd_req_length(req, i), &unpacked, header_crcs[i], payload_crcs[i]);
+
+        CU_ASSERT(result == expected_result);
+        CU_ASSERT(errno == expected_errno);
+
+        if (result == 0) {
+            CU_ASSERT(unpacked.type == expected.type);
+            CU_ASSERT(unpacked.truncated == expected.truncated);
+            CU_ASSERT(unpacked.seqnum == expected.seqnum);
+            CU_ASSERT(unpacked.length == expected.length);
+            CU_ASSERT(memcmp(unpacked.payload, expected.payload, expected.type == DATA ? expected.length : 0) == 0);
+        }
+    }
+
+    /** Only the corrupted ones fail on their CRC */
+    CU_ASSERT(unpack_precomputed(hd_req_datagram(req, 0), hd_req_length(req, 0), &unpacked, header_crcs[0], payload_crcs[0]) == 0);
+    CU_ASSERT(unpack_precomputed(hd_req_datagram(req, 1), hd_req_length(req, 1), &unpacked, header_crcs[1], payload_crcs[1]) == 0);
+    CU_ASSERT(unpack_precomputed(hd_req_datagram(req, 2), hd_req_length(req, 2), &unpacked, header_crcs[2], payload_crcs[2]) == -1);
+    CU_ASSERT(errno == PAYLOAD_VALIDATION_FAILED);
+    CU_ASSERT(unpack_precomputed(hd_req_datagram(req, 3), hd_req_length(req, 3), &unpacked, header_crcs[3], payload_crcs[3]) == -1);
+    CU_ASSERT(errno == CRC_VALIDATION_FAILED);
+
+    free(req);
+}
+
 void test_data_decoding() {
     char *str = "hello, world!";
 
@@ -187,6 +385,36 @@ void test_data_encoding() {
     free(packed);
 }
 
+void test_long_length_encoding() {
+    uint16_t lengths[] = { 128, 255, 256, 288, 300, 511, 512 };
+
+    size_t i;
+    for (i = 0; i < sizeof(lengths) / sizeof(uint16_t); i++) {
+        packet_t packet;
+        init_packet(&packet);
+        packet.type = DATA;
+        packet.window = 31;
+        packet.long_length = true;
+        packet.length = lengths[i];
+        packet.seqnum = (uint8_t) i;
+        memset(&packet.payload, 0xA5, lengths[i]);
+
+        uint8_t packed[MAX_PACKET_SIZE];
+        CU_ASSERT(pack(packed, &packet, true) == 0);
+
+        // 15 bits length in network byte order after the L bit
+        CU_ASSERT(packed[1] == (0x80 | (lengths[i] >> 8)));
+        CU_ASSERT(packed[2] == (lengths[i] & 0xFF));
+
+        packet_t unpacked;
+        init_packet(&unpacked);
+        CU_ASSERT(unpack(packed, 8 + 4 + lengths[i] + 4, &unpacked) == 0);
+        CU_ASSERT(unpacked.long_length);
+        CU_ASSERT(unpacked.length == lengths[i]);
+        CU_ASSERT(memcmp(&unpacked.payload, &packet.payload, lengths[i]) == 0);
+    }
+}
+
 int add_packet_tests() {
     CU_pSuite pSuite = CU_add_suite("packet_test_suite", 0, 0);
 
@@ -210,10 +438,30 @@ int add_packet_tests() {
         return CU_get_error();
     }
 
+    if (NULL == CU_add_test(pSuite, "test_ack_template", test_ack_template)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_crc32_batch", test_crc32_batch)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_unpack_precomputed", test_unpack_precomputed)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
     if (NULL == CU_add_test(pSuite, "test_data_encoding", test_data_encoding)) {
         CU_cleanup_registry();
         return CU_get_error();
     }
 
+    if (NULL == CU_add_test(pSuite, "test_long_length_encoding", test_long_length_encoding)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
     return 0;
 }
\ No newline at end of file
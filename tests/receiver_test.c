@@ -52,8 +52,9 @@ void test_receiver() {
     memset(&cfg, 0, sizeof(rx_cfg_t));
     cfg.id = 0;
     cfg.thread = NULL;
-    int idx = 0;
-    cfg.idx = &idx;
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 100) == 0);
+    cfg.registry = &registry;
     cfg.file_format = "./bin/%d";
     cfg.stop = false;
     cfg.tx = &rx_to_hd;
@@ -66,6 +67,10 @@ void test_receiver() {
     cfg.affinity = NULL;
     cfg.max_clients = 100;
     cfg.window_size = 31;
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+    cfg.stats = &stats;
     struct timeval tv;
     tv.tv_sec = 0;
     tv.tv_usec = 100000;
@@ -118,7 +123,7 @@ void test_receiver() {
     CU_ASSERT(s_node->content != NULL);
     hd_req_t *req = s_node->content;
     CU_ASSERT(req->client->address->sin6_port == send_port);
-    CU_ASSERT(req->lengths[0] == pkt.length + 11 + 4); // payload + header + CRC2
+    CU_ASSERT(hd_req_length(req, 0) == pkt.length + 11 + 4); // payload + header + CRC2
     CU_ASSERT(req->num == 1);
     CU_ASSERT(req->stop == false);
     deallocate_node(s_node);
@@ -159,20 +164,442 @@ void test_receiver() {
     CU_ASSERT(s_node->content != NULL);
     req = s_node->content;
     CU_ASSERT(req->client->address->sin6_port == send_port);
-    CU_ASSERT(req->lengths[0] == 20 + 11 + 4); // payload + header + CRC2
-    CU_ASSERT(req->lengths[1] == 88 + 11 + 4); // payload + header + CRC2
+    CU_ASSERT(hd_req_length(req, 0) == 20 + 11 + 4); // payload + header + CRC2
+    CU_ASSERT(hd_req_length(req, 1) == 88 + 11 + 4); // payload + header + CRC2
     CU_ASSERT(req->num == 2);
     CU_ASSERT(req->stop == false);
     deallocate_node(s_node);
 
 
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_PACKETS) == 3);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_NEW_CLIENTS) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == 2);
+
     close(cfg.sockfd);
     dealloc_stream(&rx_to_hd);
     dealloc_stream(&hd_to_rx);
     dealloc_ht(&clients);
+    close_registry(&registry);
+
+}
+
+
+void test_receiver_dispatch() {
+    uint8_t buffers[4][MAX_PACKET_SIZE];
+    socklen_t addr_len = sizeof(struct sockaddr_in6);
+    struct sockaddr_in6 addrs[4];
+    struct mmsghdr msgs[4];
+
+    memset(buffers, 0, sizeof(buffers));
+    memset(addrs, 0, sizeof(addrs));
+    memset(msgs, 0, sizeof(msgs));
+
+    stream_t rx_to_hd;
+    CU_ASSERT(initialize_stream(&rx_to_hd) == 0);
+    
+    stream_t hd_to_rx;
+    CU_ASSERT(initialize_stream(&hd_to_rx) == 0);
+
+    ht_t clients;
+    CU_ASSERT(allocate_ht(&clients) == 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    rx_cfg_t cfg;
+    memset(&cfg, 0, sizeof(rx_cfg_t));
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 100) == 0);
+    cfg.registry = &registry;
+    cfg.file_format = "./bin/%d";
+    cfg.tx = &rx_to_hd;
+    cfg.rx = &hd_to_rx;
+    cfg.clients = &clients;
+    cfg.sockfd = -1;
+    cfg.addr_len = &addr_len;
+    cfg.max_clients = 100;
+    cfg.window_size = 4;
+    cfg.stats = &stats;
+
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.length = 20;
+
+    /** Two datagrams from the first client, one that's too short, one from a second client */
+    int i;
+    for (i = 0; i < 4; i++) {
+        addrs[i].sin6_family = AF_INET6;
+        addrs[i].sin6_addr.__in6_u.__u6_addr32[3] = htonl(1);
+        addrs[i].sin6_port = i < 3 ? htons(4000) : htons(4001);
+
+        pkt.seqnum = i;
+        CU_ASSERT(pack(buffers[i], &pkt, true) == 0);
+        msgs[i].msg_len = i == 2 ? MIN_PACKET_SIZE - 1 : 20 + 11 + 4;
+    }
+
+    rx_dispatch(&cfg, buffers, addr_len, addrs, msgs, 4);
+
+    CU_ASSERT(ht_length(&clients) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_PACKETS) == 4);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_BATCHES) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_UNDERSIZED) == 1);
+
+    s_node_t *s_node = stream_pop(&rx_to_hd, false);
+    CU_ASSERT(s_node != NULL);
+    hd_req_t *req = s_node->content;
+    CU_ASSERT(req->client->address->sin6_port == htons(4000));
+    CU_ASSERT(req->num == 2);
+    CU_ASSERT(req->timestamp == 0);
+    CU_ASSERT(memcmp(hd_req_datagram(req, 1), buffers[1], 20 + 11 + 4) == 0);
+    deallocate_node(s_node);
+
+    s_node = stream_pop(&rx_to_hd, false);
+    CU_ASSERT(s_node != NULL);
+    req = s_node->content;
+    CU_ASSERT(req->client->address->sin6_port == htons(4001));
+    CU_ASSERT(req->num == 1);
+    deallocate_node(s_node);
+
+    /** An empty batch does nothing */
+    rx_dispatch(&cfg, buffers, addr_len, addrs, msgs, 0);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_BATCHES) == 1);
+    CU_ASSERT(stream_pop(&rx_to_hd, false) == NULL);
+
+    /** Nothing valid for a client: its request goes back to the pool */
+    client_t *client = ht_get(&clients, addrs[3].sin6_port, addrs[3].sin6_addr.__in6_u.__u6_addr8);
+    CU_ASSERT(client != NULL);
+    uint32_t queued = client->queued;
+
+    msgs[3].msg_len = MIN_PACKET_SIZE - 1;
+    rx_dispatch(&cfg, &buffers[3], addr_len, &addrs[3], &msgs[3], 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_UNDERSIZED) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == 2);
+    CU_ASSERT(stream_pop(&rx_to_hd, false) == NULL);
+    CU_ASSERT(hd_to_rx.length == 1);
+    CU_ASSERT(client->queued == queued);
+
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+    dealloc_ht(&clients);
+    close_registry(&registry);
+}
+
+void test_receiver_pool() {
+    uint8_t buffers[3][MAX_PACKET_SIZE];
+    socklen_t addr_len = sizeof(struct sockaddr_in6);
+    struct sockaddr_in6 addrs[3];
+    struct mmsghdr msgs[3];
+
+    memset(buffers, 0, sizeof(buffers));
+    memset(addrs, 0, sizeof(addrs));
+    memset(msgs, 0, sizeof(msgs));
+
+    stream_t rx_to_hd;
+    CU_ASSERT(initialize_stream(&rx_to_hd) == 0);
+    
+    stream_t hd_to_rx;
+    CU_ASSERT(initialize_stream(&hd_to_rx) == 0);
+
+    ht_t clients;
+    CU_ASSERT(allocate_ht(&clients) == 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    rx_cfg_t cfg;
+    memset(&cfg, 0, sizeof(rx_cfg_t));
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 100) == 0);
+    cfg.registry = &registry;
+    cfg.file_format = "./bin/%d";
+    cfg.tx = &rx_to_hd;
+    cfg.rx = &hd_to_rx;
+    cfg.clients = &clients;
+    cfg.sockfd = -1;
+    cfg.addr_len = &addr_len;
+    cfg.max_clients = 100;
+    cfg.window_size = 3;
+    cfg.stats = &stats;
+    cfg.pool_size = 1;
+    cfg.pool_policy = POOL_DROP;
+
+    s_node_t *s_node = malloc(sizeof(s_node_t));
+    CU_ASSERT(initialize_node(s_node, allocate_handle_request) == 0);
+    stream_enqueue(&hd_to_rx, s_node);
+
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.length = 20;
+
+    /** Two datagrams from the first client, one from the second */
+    int i;
+    for (i = 0; i < 3; i++) {
+        addrs[i].sin6_family = AF_INET6;
+        addrs[i].sin6_addr.__in6_u.__u6_addr32[3] = htonl(1);
+        addrs[i].sin6_port = i < 2 ? htons(4000) : htons(4001);
+
+        pkt.seqnum = i;
+        CU_ASSERT(pack(buffers[i], &pkt, true) == 0);
+        msgs[i].msg_len = 20 + 11 + 4;
+    }
+
+    /** A single request: the second client is dropped, nothing is allocated */
+    rx_dispatch(&cfg, buffers, addr_len, addrs, msgs, 3);
+
+    CU_ASSERT(ht_length(&clients) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_POOL_DROPS) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_ALLOCATIONS) == 0);
+
+    s_node_t *first = stream_pop(&rx_to_hd, false);
+    CU_ASSERT(first != NULL);
+    CU_ASSERT(((hd_req_t *) first->content)->num == 2);
+    CU_ASSERT(((hd_req_t *) first->content)->client->queued == 1);
+
+    /** The first client already holds its share (one of two requests) */
+    cfg.pool_size = 2;
+    cfg.pool_policy = POOL_CLIENT;
+
+    s_node = malloc(sizeof(s_node_t));
+    CU_ASSERT(initialize_node(s_node, allocate_handle_request) == 0);
+    stream_enqueue(&hd_to_rx, s_node);
+
+    rx_dispatch(&cfg, &buffers[1], addr_len, &addrs[1], &msgs[1], 2);
+
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_POOL_DROPS) == 2);
+
+    s_node = stream_pop(&rx_to_hd, false);
+    CU_ASSERT(s_node != NULL);
+    CU_ASSERT(((hd_req_t *) s_node->content)->client->address->sin6_port == htons(4001));
+    deallocate_node(s_node);
+    deallocate_node(first);
+
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+    dealloc_ht(&clients);
+    close_registry(&registry);
+}
+
+void test_receiver_split() {
+    uint8_t buffers[MAX_WINDOW_SIZE][MAX_PACKET_SIZE];
+    socklen_t addr_len = sizeof(struct sockaddr_in6);
+    struct sockaddr_in6 addrs[MAX_WINDOW_SIZE];
+    struct mmsghdr msgs[MAX_WINDOW_SIZE];
+
+    memset(buffers, 0, sizeof(buffers));
+    memset(addrs, 0, sizeof(addrs));
+    memset(msgs, 0, sizeof(msgs));
+
+    stream_t rx_to_hd;
+    CU_ASSERT(initialize_stream(&rx_to_hd) == 0);
+    
+    stream_t hd_to_rx;
+    CU_ASSERT(initialize_stream(&hd_to_rx) == 0);
+
+    ht_t clients;
+    CU_ASSERT(allocate_ht(&clients) == 0);
+
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    rx_cfg_t cfg;
+    memset(&cfg, 0, sizeof(rx_cfg_t));
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 100) == 0);
+    cfg.registry = &registry;
+    cfg.file_format = "./bin/%d";
+    cfg.tx = &rx_to_hd;
+    cfg.rx = &hd_to_rx;
+    cfg.clients = &clients;
+    cfg.sockfd = -1;
+    cfg.addr_len = &addr_len;
+    cfg.max_clients = 100;
+    cfg.window_size = MAX_WINDOW_SIZE;
+    cfg.stats = &stats;
+
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.length = MAX_PAYLOAD_SIZE;
+
+    /** A full window of full sized datagrams from a single client */
+    int i;
+    for (i = 0; i < MAX_WINDOW_SIZE; i++) {
+        addrs[i].sin6_family = AF_INET6;
+        addrs[i].sin6_addr.__in6_u.__u6_addr32[3] = htonl(1);
+        addrs[i].sin6_port = htons(4000);
+
+        pkt.seqnum = i;
+        CU_ASSERT(pack(buffers[i], &pkt, true) == 0);
+        msgs[i].msg_len = MAX_PACKET_SIZE;
+    }
+
+    rx_dispatch(&cfg, buffers, addr_len, addrs, msgs, MAX_WINDOW_SIZE);
+
+    CU_ASSERT(ht_length(&clients) == 1);
+
+    /** They don't fit in a single request: every datagram is kept, in order */
+    size_t seen = 0;
+    s_node_t *s_node;
+    while ((s_node = stream_pop(&rx_to_hd, false)) != NULL) {
+        hd_req_t *req = s_node->content;
+        CU_ASSERT(req->num > 0);
+        CU_ASSERT(req->offsets[req->num] <= HD_REQ_DATA_SIZE);
+
+        size_t j;
+        for (j = 0; j < req->num; j++) {
+            CU_ASSERT(hd_req_length(req, j) == MAX_PACKET_SIZE);
+            CU_ASSERT(memcmp(hd_req_datagram(req, j), buffers[seen + j], MAX_PACKET_SIZE) == 0);
+        }
+
+        seen += req->num;
+        deallocate_node(s_node);
+    }
+
+    CU_ASSERT(seen == MAX_WINDOW_SIZE);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == (MAX_WINDOW_SIZE * MAX_PACKET_SIZE + HD_REQ_DATA_SIZE - 1) / HD_REQ_DATA_SIZE);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_POOL_DROPS) == 0);
+
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+    dealloc_ht(&clients);
+    close_registry(&registry);
+}
+
+void test_receiver_interleaved() {
+    uint8_t buffers[4][MAX_PACKET_SIZE];
+    socklen_t addr_len = sizeof(struct sockaddr_in6);
+    struct sockaddr_in6 addrs[4];
+    struct mmsghdr msgs[4];
+
+    memset(buffers, 0, sizeof(buffers));
+    memset(addrs, 0, sizeof(addrs));
+    memset(msgs, 0, sizeof(msgs));
+
+    stream_t rx_to_hd;
+    CU_ASSERT(initialize_stream(&rx_to_hd) == 0);
+    
+    stream_t hd_to_rx;
+    CU_ASSERT(initialize_stream(&hd_to_rx) == 0);
+
+    ht_t clients;
+    CU_ASSERT(allocate_ht(&clients) == 0);
 
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    rx_cfg_t cfg;
+    memset(&cfg, 0, sizeof(rx_cfg_t));
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 100) == 0);
+    cfg.registry = &registry;
+    cfg.file_format = "./bin/%d";
+    cfg.tx = &rx_to_hd;
+    cfg.rx = &hd_to_rx;
+    cfg.clients = &clients;
+    cfg.sockfd = -1;
+    cfg.addr_len = &addr_len;
+    cfg.max_clients = 100;
+    cfg.window_size = 4;
+    cfg.stats = &stats;
+
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.length = 20;
+
+    /** Two clients interleaved: A, B, A, B */
+    int i;
+    for (i = 0; i < 4; i++) {
+        addrs[i].sin6_family = AF_INET6;
+        addrs[i].sin6_addr.__in6_u.__u6_addr32[3] = htonl(1);
+        addrs[i].sin6_port = i % 2 == 0 ? htons(4000) : htons(4001);
+
+        pkt.seqnum = i;
+        CU_ASSERT(pack(buffers[i], &pkt, true) == 0);
+        msgs[i].msg_len = 20 + 11 + 4;
+    }
+
+    rx_dispatch(&cfg, buffers, addr_len, addrs, msgs, 4);
+
+    CU_ASSERT(ht_length(&clients) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_NEW_CLIENTS) == 2);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_REQUESTS) == 2);
+
+    /** One request per client, in order of arrival, the datagrams in order */
+    uint16_t port;
+    for (port = 4000; port <= 4001; port++) {
+        s_node_t *s_node = stream_pop(&rx_to_hd, false);
+        CU_ASSERT(s_node != NULL);
+        hd_req_t *req = s_node->content;
+        CU_ASSERT(req->client->address->sin6_port == htons(port));
+        CU_ASSERT(req->num == 2);
+        CU_ASSERT(memcmp(hd_req_datagram(req, 0), buffers[port - 4000], 20 + 11 + 4) == 0);
+        CU_ASSERT(memcmp(hd_req_datagram(req, 1), buffers[port - 4000 + 2], 20 + 11 + 4) == 0);
+        deallocate_node(s_node);
+    }
+
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+    dealloc_ht(&clients);
+    close_registry(&registry);
 }
 
+void test_receiver_adapt() {
+    stats_t stats;
+    memset(&stats, 0, sizeof(stats_t));
+
+    rx_cfg_t cfg;
+    memset(&cfg, 0, sizeof(rx_cfg_t));
+    cfg.stats = &stats;
+    cfg.window_size = 64;
+    cfg.batch_min = 4;
+    cfg.batch = 64;
+    cfg.fill = 64 * RX_FILL_ONE;
+
+    /** Idle: halves down to the minimum, with the shortest timeout */
+    int i;
+    for (i = 0; i < 50 * RX_ADAPT_PERIOD; i++) {
+        rx_adapt(&cfg, 0);
+    }
+
+    CU_ASSERT(cfg.batch == 4);
+    CU_ASSERT(cfg.timeout_ns == RX_TIMEOUT_MIN_NS);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_BATCH) == 4);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_TIMEOUT_US) == RX_TIMEOUT_MIN_NS / 1000);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_BATCH_RESIZES) == 4);
+
+    /** Full batches: doubles up to the maximum */
+    for (i = 0; i < 50 * RX_ADAPT_PERIOD; i++) {
+        rx_adapt(&cfg, cfg.batch);
+    }
+
+    CU_ASSERT(cfg.batch == 64);
+    CU_ASSERT(cfg.timeout_ns == RX_TIMEOUT_MAX_NS);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_BATCH) == 64);
+
+    /** Half full batches: stays where it is */
+    uint64_t resizes = STAT_GET(&stats, STAT_RX_BATCH_RESIZES);
+    cfg.fill = 32 * RX_FILL_ONE;
+    for (i = 0; i < 50 * RX_ADAPT_PERIOD; i++) {
+        rx_adapt(&cfg, 32);
+    }
+
+    CU_ASSERT(cfg.batch == 64);
+    CU_ASSERT(STAT_GET(&stats, STAT_RX_BATCH_RESIZES) == resizes);
+
+    /** Fixed size: never changes */
+    cfg.batch_min = 64;
+    for (i = 0; i < 50 * RX_ADAPT_PERIOD; i++) {
+        rx_adapt(&cfg, 0);
+    }
+
+    CU_ASSERT(cfg.batch == 64);
+}
 
 int add_receiver_tests() {
     CU_pSuite pSuite = CU_add_suite("receiver_test_suite", 0, 0);
@@ -187,5 +614,30 @@ int add_receiver_tests() {
         return CU_get_error();
     }
 
+    if (NULL == CU_add_test(pSuite, "test_receiver_dispatch", test_receiver_dispatch)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_receiver_pool", test_receiver_pool)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_receiver_split", test_receiver_split)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_receiver_interleaved", test_receiver_interleaved)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_receiver_adapt", test_receiver_adapt)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
     return 0;
 }
\ No newline at end of file
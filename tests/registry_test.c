@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+
+#include "./headers/registry_test.h"
+#include "../headers/registry.h"
+
+/**
+ * An address on ::1 with the given port.
+ */
+static struct sockaddr_in6 reg_address(uint16_t port) {
+    struct sockaddr_in6 address;
+    memset(&address, 0, sizeof(struct sockaddr_in6));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_loopback;
+    address.sin6_port = htons(port);
+
+    return address;
+}
+
+void test_registry_claim() {
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 2) == 0);
+
+    struct sockaddr_in6 a = reg_address(1000);
+    struct sockaddr_in6 b = reg_address(1001);
+    struct sockaddr_in6 c = reg_address(1002);
+
+    uint32_t id = UINT32_MAX;
+    CU_ASSERT(reg_claim(&registry, 0, &a, &id) == 0);
+    CU_ASSERT(id == 0);
+
+    /** Already registered */
+    errno = 0;
+    CU_ASSERT(reg_claim(&registry, 0, &a, &id) == -1);
+    CU_ASSERT(errno == REGISTRY_ORPHAN);
+
+    CU_ASSERT(reg_claim(&registry, 0, &b, &id) == 1);
+    CU_ASSERT(id == 1);
+
+    errno = 0;
+    CU_ASSERT(reg_claim(&registry, 0, &c, &id) == -1);
+    CU_ASSERT(errno == REGISTRY_FULL);
+
+    /** The entry is reused, not the ID */
+    reg_release(&registry, 0);
+    CU_ASSERT(reg_claim(&registry, 0, &c, &id) == 0);
+    CU_ASSERT(id == 2);
+
+    close_registry(&registry);
+    CU_ASSERT(registry.header == NULL);
+}
+
+void test_registry_worker() {
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 4) == 0);
+
+    struct sockaddr_in6 a = reg_address(1000);
+    struct sockaddr_in6 b = reg_address(1001);
+
+    uint32_t id;
+    int entry = reg_claim(&registry, 1, &a, &id);
+    CU_ASSERT(entry == 0);
+    CU_ASSERT(reg_claim(&registry, 2, &b, &id) == 1);
+    CU_ASSERT(REG_WORKER(registry.entries[0].state) == 1);
+    CU_ASSERT(REG_STATE(registry.entries[0].state) == REG_OWNED);
+
+    /** Worker 1 crashed: its client is refused... */
+    CU_ASSERT(reg_release_worker(&registry, 1, true) == 1);
+    CU_ASSERT(REG_STATE(registry.entries[0].state) == REG_ORPHAN);
+
+    errno = 0;
+    CU_ASSERT(reg_claim(&registry, 0, &a, &id) == -1);
+    CU_ASSERT(errno == REGISTRY_ORPHAN);
+
+    /** ...until REG_ORPHAN_S have passed */
+    registry.entries[0].orphaned_ns -= (uint64_t) REG_ORPHAN_S * 1000000000UL;
+    CU_ASSERT(reg_claim(&registry, 0, &a, &id) == 0);
+    CU_ASSERT(id == 2);
+    CU_ASSERT(REG_WORKER(registry.entries[0].state) == 0);
+
+    /** Worker 2 exited: its entry is free */
+    CU_ASSERT(reg_release_worker(&registry, 2, false) == 1);
+    CU_ASSERT(registry.entries[1].state == REG_FREE);
+    CU_ASSERT(reg_claim(&registry, 0, &b, &id) == 1);
+
+    close_registry(&registry);
+}
+
+void test_registry_shared() {
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 4) == 0);
+
+    struct sockaddr_in6 a = reg_address(1000);
+    struct sockaddr_in6 b = reg_address(1001);
+
+    pid_t pid = fork();
+    CU_ASSERT(pid != -1);
+    if (pid == 0) {
+        uint32_t id;
+        _exit(reg_claim(&registry, 3, &a, &id) == 0 && id == 0 ? 0 : 1);
+    }
+
+    int status;
+    CU_ASSERT(waitpid(pid, &status, 0) == pid);
+    CU_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    /** Seen from here: the address is taken and the next ID is 1 */
+    CU_ASSERT(REG_WORKER(registry.entries[0].state) == 3);
+
+    uint32_t id;
+    errno = 0;
+    CU_ASSERT(reg_claim(&registry, 0, &a, &id) == -1);
+    CU_ASSERT(errno == REGISTRY_ORPHAN);
+    CU_ASSERT(reg_claim(&registry, 0, &b, &id) == 1);
+    CU_ASSERT(id == 1);
+
+    close_registry(&registry);
+}
+
+int add_registry_tests() {
+    CU_pSuite pSuite = CU_add_suite("registry_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_registry_claim", test_registry_claim)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_registry_worker", test_registry_worker)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_registry_shared", test_registry_shared)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
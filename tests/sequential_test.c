@@ -0,0 +1,207 @@
+#define _GNU_SOURCE
+
+#include "./headers/sequential_test.h"
+#include "../headers/sequential.h"
+
+/**
+ * Everything an engine needs, bound on ::1 (any port).
+ */
+typedef struct seq_fixture {
+    ht_t clients;
+    stream_t pool;
+    stats_t rx_stats;
+    stats_t hd_stats;
+    rx_cfg_t rx;
+    hd_cfg_t hd;
+    seq_t seq;
+    reg_t registry;
+    struct sockaddr_in6 address;
+} seq_fixture_t;
+
+static void seq_setup(seq_fixture_t *f, size_t pool_size) {
+    memset(f, 0, sizeof(seq_fixture_t));
+
+    socklen_t addrlen = sizeof(struct sockaddr_in6);
+    f->address.sin6_family = AF_INET6;
+    f->address.sin6_addr = in6addr_loopback;
+
+    int sockfd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    CU_ASSERT(sockfd > 0);
+    CU_ASSERT(bind(sockfd, (struct sockaddr *) &f->address, addrlen) == 0);
+    CU_ASSERT(getsockname(sockfd, (struct sockaddr *) &f->address, &addrlen) == 0);
+
+    CU_ASSERT(allocate_ht(&f->clients) == 0);
+    CU_ASSERT(initialize_stream(&f->pool) == 0);
+
+    f->rx.clients = &f->clients;
+    CU_ASSERT(create_registry(&f->registry, 100) == 0);
+    f->rx.registry = &f->registry;
+    f->rx.file_format = "./bin/seq_%d";
+    f->rx.sockfd = sockfd;
+    f->rx.rx = &f->pool;
+    f->rx.max_clients = 100;
+    f->rx.window_size = 31;
+    f->rx.stats = &f->rx_stats;
+    f->rx.pool_size = pool_size;
+
+    f->hd.clients = &f->clients;
+    f->hd.sockfd = sockfd;
+    f->hd.max_window_size = 31;
+    f->hd.stats = &f->hd_stats;
+
+    CU_ASSERT(seq_init(&f->seq, &f->rx, &f->hd) == 0);
+}
+
+static void seq_teardown(seq_fixture_t *f) {
+    seq_destroy(&f->seq);
+
+    /** The clients first, they may still pin requests of the pool */
+    dealloc_ht(&f->clients);
+    dealloc_stream(&f->pool);
+    close(f->rx.sockfd);
+    close_registry(&f->registry);
+}
+
+/**
+ * Sends a DATA packet (one byte, 'a' + seqnum, none if `eof`).
+ */
+static void send_data(int sock, struct sockaddr_in6 *address, uint8_t seqnum, bool eof) {
+    packet_t pkt;
+    CU_ASSERT(init_packet(&pkt) == 0);
+    pkt.type = DATA;
+    pkt.window = 31;
+    pkt.length = eof ? 0 : 1;
+    pkt.payload[0] = 'a' + seqnum;
+    pkt.seqnum = seqnum;
+    pkt.timestamp = seqnum;
+
+    uint8_t buffer[MAX_PACKET_SIZE];
+    CU_ASSERT(pack(buffer, &pkt, true) == 0);
+
+    ssize_t size = eof ? 11 : 11 + 1 + 4;
+    CU_ASSERT(sendto(sock, buffer, size, 0, (struct sockaddr *) address, sizeof(struct sockaddr_in6)) == size);
+}
+
+/**
+ * Runs the engine until `packets` datagrams were received (at most 1s).
+ */
+static void run_until(seq_fixture_t *f, uint64_t packets) {
+    int round;
+    for (round = 0; round < 100 && STAT_GET(&f->rx_stats, STAT_RX_PACKETS) < packets; round++) {
+        seq_run_once(&f->seq, 10);
+    }
+
+    CU_ASSERT(STAT_GET(&f->rx_stats, STAT_RX_PACKETS) == packets);
+}
+
+void test_seq_in_order() {
+    seq_fixture_t f;
+    seq_setup(&f, 0);
+
+    int sender = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sender > 0);
+
+    send_data(sender, &f.address, 0, false);
+    send_data(sender, &f.address, 1, false);
+    send_data(sender, &f.address, 2, false);
+    send_data(sender, &f.address, 3, true);
+    run_until(&f, 4);
+
+    CU_ASSERT(STAT_GET(&f.rx_stats, STAT_RX_NEW_CLIENTS) == 1);
+    CU_ASSERT(STAT_GET(&f.hd_stats, STAT_HD_BYTES_WRITTEN) == 3);
+    CU_ASSERT(STAT_GET(&f.hd_stats, STAT_HD_COMPLETED) == 1);
+
+    /** Straight from the receive buffers */
+    CU_ASSERT(f.seq.spill_count == 0);
+
+    /** The ACK of the end of the transfer */
+    uint8_t ack[MAX_PACKET_SIZE];
+    ssize_t length;
+    packet_t decoded;
+    do {
+        length = recv(sender, ack, sizeof(ack), MSG_DONTWAIT);
+        CU_ASSERT(length == ACK_FRAME_SIZE);
+        CU_ASSERT(unpack(ack, length, &decoded) == 0);
+    } while (length == ACK_FRAME_SIZE && decoded.seqnum != 4);
+
+    CU_ASSERT(decoded.type == ACK);
+    CU_ASSERT(decoded.seqnum == 4);
+
+    FILE *fd = fopen("./bin/seq_0", "rb");
+    CU_ASSERT(fd != NULL);
+    if (fd != NULL) {
+        char string[8];
+        CU_ASSERT(fread(string, 1, sizeof(string), fd) == 3);
+        CU_ASSERT(memcmp(string, "abc", 3) == 0);
+        fclose(fd);
+    }
+
+    close(sender);
+    seq_teardown(&f);
+}
+
+void test_seq_keep() {
+    seq_fixture_t f;
+    seq_setup(&f, 1);
+
+    int first = socket(AF_INET6, SOCK_DGRAM, 0);
+    int second = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(first > 0 && second > 0);
+
+    /** Ahead of the window: moved out of the receive buffers */
+    send_data(first, &f.address, 1, false);
+    send_data(first, &f.address, 2, false);
+    run_until(&f, 2);
+
+    struct sockaddr_in6 source;
+    socklen_t addrlen = sizeof(struct sockaddr_in6);
+    CU_ASSERT(getsockname(first, (struct sockaddr *) &source, &addrlen) == 0);
+
+    client_t *client = ht_get(&f.clients, source.sin6_port, f.address.sin6_addr.s6_addr);
+    CU_ASSERT(client != NULL);
+    CU_ASSERT(client->window->length == 2);
+    CU_ASSERT(client->pinned == 1);
+    CU_ASSERT(f.seq.spill_count == 1);
+    CU_ASSERT(f.seq.spill->refs == 2);
+    CU_ASSERT(STAT_GET(&f.hd_stats, STAT_HD_BYTES_WRITTEN) == 0);
+
+    /** The pool (one request) is pinned: the other client's one is dropped */
+    send_data(second, &f.address, 3, false);
+    run_until(&f, 3);
+    CU_ASSERT(STAT_GET(&f.hd_stats, STAT_HD_PIN_DROPS) == 1);
+    CU_ASSERT(f.seq.spill_count == 1);
+
+    /** The missing one writes the window, the request is free again */
+    send_data(first, &f.address, 0, false);
+    run_until(&f, 4);
+    CU_ASSERT(STAT_GET(&f.hd_stats, STAT_HD_BYTES_WRITTEN) == 3);
+    CU_ASSERT(client->window->length == 0);
+    CU_ASSERT(client->window->window_low == 3);
+    CU_ASSERT(client->pinned == 0);
+    CU_ASSERT(f.seq.spill->refs == 0);
+
+    close(first);
+    close(second);
+    seq_teardown(&f);
+}
+
+int add_sequential_tests() {
+    CU_pSuite pSuite = CU_add_suite("sequential_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_seq_in_order", test_seq_in_order)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_seq_keep", test_seq_keep)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "./headers/shm_test.h"
+
+void test_shm_publish() {
+    char name[64];
+    sprintf(name, "/trtp_test_%d", getpid());
+
+    shm_seg_t segment;
+    CU_ASSERT(create_shm(&segment, name, 1, 2, 4) == 0);
+
+    shm_seg_t viewer;
+    CU_ASSERT(open_shm(&viewer, name) == 0);
+    CU_ASSERT(viewer.header->thread_count == 3);
+    CU_ASSERT(viewer.header->client_count == 4);
+    CU_ASSERT(strcmp(viewer.header->stat_names[STAT_RX_PACKETS], "rx_packets") == 0);
+    CU_ASSERT(((uintptr_t) viewer.clients) % CACHE_LINE_SIZE == 0);
+
+    stats_reg_t registry;
+    CU_ASSERT(allocate_stats_registry(&registry, 1, 2, 0) == 0);
+    STAT_ADD(&registry.rx[0], STAT_RX_PACKETS, 42);
+    STAT_ADD(&registry.hd[1], STAT_HD_ACKS, 7);
+    shm_publish_threads(&segment, &registry);
+
+    shm_thread_t thread;
+    shm_read_thread(&viewer.threads[0], &thread);
+    CU_ASSERT(thread.kind == SHM_RECEIVER);
+    CU_ASSERT(thread.counters[STAT_RX_PACKETS] == 42);
+    CU_ASSERT(thread.seq % 2 == 0);
+
+    shm_read_thread(&viewer.threads[2], &thread);
+    CU_ASSERT(thread.kind == SHM_HANDLER);
+    CU_ASSERT(thread.id == 1);
+    CU_ASSERT(thread.counters[STAT_HD_ACKS] == 7);
+
+    struct sockaddr_in6 address;
+    memset(&address, 0, sizeof(struct sockaddr_in6));
+    address.sin6_family = AF_INET6;
+    address.sin6_port = htons(1234);
+    address.sin6_addr.__in6_u.__u6_addr8[15] = 1;
+
+    buf_t window;
+    memset(&window, 0, sizeof(buf_t));
+
+    client_t client;
+    memset(&client, 0, sizeof(client_t));
+    client.active = true;
+    client.id = 3;
+    client.address = &address;
+    client.window = &window;
+    strcpy(client.ip_as_string, "::1");
+
+    shm_attach_client(&segment, &client);
+    CU_ASSERT(client.record == &segment.clients[0]);
+
+    client.transferred = 1024;
+    client.duplicates = 2;
+    window.window_low = 5;
+    window.length = 1;
+    shm_publish_client(&client);
+
+    shm_client_t record;
+    shm_read_client(&viewer.clients[0], &record);
+    CU_ASSERT(record.used);
+    CU_ASSERT(record.active);
+    CU_ASSERT(record.id == 3);
+    CU_ASSERT(ntohs(record.port) == 1234);
+    CU_ASSERT(strcmp(record.ip_as_string, "::1") == 0);
+    CU_ASSERT(record.transferred == 1024);
+    CU_ASSERT(record.duplicates == 2);
+    CU_ASSERT(record.window_low == 5);
+    CU_ASSERT(record.window_length == 1);
+
+    shm_detach_client(&client);
+    CU_ASSERT(client.record == NULL);
+
+    shm_read_client(&viewer.clients[0], &record);
+    CU_ASSERT(!record.used);
+
+    close_shm(&viewer);
+    close_shm(&segment);
+    dealloc_stats_registry(&registry);
+
+    /** The creator unlinks the segment */
+    CU_ASSERT(open_shm(&viewer, name) == -1);
+}
+
+int add_shm_tests() {
+    CU_pSuite pSuite = CU_add_suite("shm_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_shm_publish", test_shm_publish)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
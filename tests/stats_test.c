@@ -0,0 +1,96 @@
+#include "./headers/stats_test.h"
+
+void test_stats_snapshot() {
+    stats_reg_t registry;
+    CU_ASSERT(allocate_stats_registry(&registry, 2, 3, 0) == 0);
+
+    /** Every thread must be on its own cache line */
+    CU_ASSERT(((uintptr_t) &registry.rx[1]) % CACHE_LINE_SIZE == 0);
+    CU_ASSERT(((uintptr_t) &registry.hd[1]) % CACHE_LINE_SIZE == 0);
+    CU_ASSERT(sizeof(stats_t) % CACHE_LINE_SIZE == 0);
+
+    STAT_ADD(&registry.rx[0], STAT_RX_PACKETS, 10);
+    STAT_ADD(&registry.rx[1], STAT_RX_PACKETS, 5);
+    STAT_INC(&registry.hd[2], STAT_HD_DUPLICATES);
+    stats_count_unpack_error(&registry.hd[0], CRC_VALIDATION_FAILED);
+    stats_count_unpack_error(&registry.hd[0], PACKET_TOO_SHORT);
+
+    CU_ASSERT(STAT_GET(&registry.rx[0], STAT_RX_PACKETS) == 10);
+    CU_ASSERT(STAT_GET(&registry.hd[0], STAT_HD_CRC_HEADER) == 1);
+    CU_ASSERT(STAT_GET(&registry.hd[0], STAT_HD_BAD_LENGTH) == 1);
+
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    CU_ASSERT(out != NULL);
+    CU_ASSERT(stats_write_text(&registry, out) == 0);
+    fclose(out);
+
+    CU_ASSERT(strstr(text, "rx.0.rx_packets 10\n") != NULL);
+    CU_ASSERT(strstr(text, "rx.1.rx_packets 5\n") != NULL);
+    CU_ASSERT(strstr(text, "hd.2.hd_duplicates 1\n") != NULL);
+    CU_ASSERT(strstr(text, "total.rx_packets 15\n") != NULL);
+    CU_ASSERT(strstr(text, "total.hd_crc_header 1\n") != NULL);
+
+    free(text);
+    dealloc_stats_registry(&registry);
+}
+
+void test_stats_server() {
+    stats_reg_t registry;
+    CU_ASSERT(allocate_stats_registry(&registry, 1, 1, 0) == 0);
+    STAT_ADD(&registry.rx[0], STAT_RX_PACKETS, 7);
+
+    stats_srv_t server;
+    CU_ASSERT(start_stats_server(&server, &registry, "./bin/stats.sock") == 0);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(struct sockaddr_un));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, "./bin/stats.sock");
+
+    /** Gone before the snapshot is written: the server must not get a SIGPIPE */
+    int sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CU_ASSERT(connect(sockfd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un)) == 0);
+    close(sockfd);
+    usleep(300 * 1000);
+
+    /** And still answers the next one */
+    sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CU_ASSERT(connect(sockfd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un)) == 0);
+
+    char text[1 << 16];
+    size_t len = 0;
+    ssize_t result;
+    while ((result = read(sockfd, text + len, sizeof(text) - 1 - len)) > 0) {
+        len += result;
+    }
+    text[len] = '\0';
+    close(sockfd);
+
+    CU_ASSERT(strstr(text, "total.rx_packets 7\n") != NULL);
+
+    stop_stats_server(&server);
+    dealloc_stats_registry(&registry);
+}
+
+int add_stats_tests() {
+    CU_pSuite pSuite = CU_add_suite("stats_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_stats_snapshot", test_stats_snapshot)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_stats_server", test_stats_server)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -56,6 +56,41 @@ void test_many() {
     dealloc_stream(&stream);
 }
 
+void *late_enqueue(void *arg) {
+    struct timespec delay = { .tv_sec = 0, .tv_nsec = 20 * 1000 * 1000 };
+    nanosleep(&delay, NULL);
+
+    stream_enqueue((stream_t *) arg, calloc(1, sizeof(s_node_t)));
+    return NULL;
+}
+
+void test_spin() {
+    stream_t stream;
+    initialize_stream(&stream);
+
+    s_node_t *node = calloc(1, sizeof(s_node_t));
+    CU_ASSERT(initialize_node(node, empty_allocator) == 0);
+    CU_ASSERT(stream_enqueue(&stream, node) == true);
+
+    /** Already there: no spin, no sleep */
+    bool slept = true;
+    CU_ASSERT(stream_pop_spin(&stream, 1000 * 1000, &slept) == node);
+    CU_ASSERT(!slept);
+    free(node);
+
+    /** Comes after the budget (100us): sleeps */
+    pthread_t thread;
+    CU_ASSERT(pthread_create(&thread, NULL, late_enqueue, &stream) == 0);
+
+    node = stream_pop_spin(&stream, 100 * 1000, &slept);
+    CU_ASSERT(node != NULL);
+    CU_ASSERT(slept);
+    pthread_join(thread, NULL);
+    free(node);
+
+    dealloc_stream(&stream);
+}
+
 int add_stream_tests() {
     CU_pSuite pSuite = CU_add_suite("stream_test_suite", 0, 0);
 
@@ -74,5 +109,10 @@ int add_stream_tests() {
         return CU_get_error();
     }
 
+    if (NULL == CU_add_test(pSuite, "test_spin", test_spin)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
     return 0;
 }
\ No newline at end of file
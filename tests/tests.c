@@ -7,6 +7,18 @@
 #include "./headers/stream_test.h"
 #include "./headers/handler_test.h"
 #include "./headers/receiver_test.h"
+#include "./headers/stats_test.h"
+#include "./headers/shm_test.h"
+#include "./headers/histogram_test.h"
+#include "./headers/logger_test.h"
+#include "./headers/arena_test.h"
+#include "./headers/topology_test.h"
+#include "./headers/elastic_test.h"
+#include "./headers/ack_batch_test.h"
+#include "./headers/tx_test.h"
+#include "./headers/sequential_test.h"
+#include "./headers/registry_test.h"
+#include "./headers/workers_test.h"
 
 /*#include "handler_test.c"
 #include "receiver_test.c"*/
@@ -34,6 +46,23 @@ int main() {
 
     add_receiver_tests();
 
+    add_stats_tests();
+
+    add_shm_tests();
+
+    add_histogram_tests();
+
+    add_logger_tests();
+
+    add_arena_tests();
+    add_topology_tests();
+    add_elastic_tests();
+    add_ack_batch_tests();
+    add_tx_tests();
+    add_sequential_tests();
+    add_registry_tests();
+    add_workers_tests();
+
     CU_basic_run_tests();
     
     CU_cleanup_registry();
@@ -0,0 +1,220 @@
+#include "./headers/topology_test.h"
+
+/** Root of the fake /sys and /proc */
+#define TOPO_ROOT "./bin/topo"
+
+/**
+ * Writes `content` in `TOPO_ROOT/path`, creating the directories.
+ */
+static void write_file(const char *path, const char *content) {
+    char full[PATH_MAX];
+    snprintf(full, sizeof(full), "%s/%s", TOPO_ROOT, path);
+
+    char *slash;
+    for (slash = strchr(full + 2, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+        *slash = 0;
+        mkdir(full, 0755);
+        *slash = '/';
+    }
+
+    FILE *file = fopen(full, "w");
+    CU_ASSERT(file != NULL);
+    if (file != NULL) {
+        fputs(content, file);
+        fclose(file);
+    }
+}
+
+/**
+ * 2 packages (one L3 and one node each) of 2 cores with 2 threads:
+ * core 0 = CPU 0 & 4, core 1 = CPU 1 & 5 on package 0
+ * core 2 = CPU 2 & 6, core 3 = CPU 3 & 7 on package 1
+ * The NIC (eth0) has a single interrupt, on CPU 1.
+ */
+static void make_host() {
+    char path[PATH_MAX];
+    char content[64];
+
+    write_file("sys/devices/system/cpu/online", "0-7\n");
+
+    size_t cpu;
+    for (cpu = 0; cpu < 8; cpu++) {
+        size_t core = cpu % 4;
+        size_t package = core / 2;
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/topology/thread_siblings_list", cpu);
+        snprintf(content, sizeof(content), "%zu,%zu\n", core, core + 4);
+        write_file(path, content);
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/topology/physical_package_id", cpu);
+        snprintf(content, sizeof(content), "%zu\n", package);
+        write_file(path, content);
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/topology/core_siblings_list", cpu);
+        snprintf(content, sizeof(content), "%zu-%zu,%zu-%zu\n", package * 2, package * 2 + 1, package * 2 + 4, package * 2 + 5);
+        write_file(path, content);
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/cache/index0/level", cpu);
+        write_file(path, "1\n");
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/cache/index1/level", cpu);
+        write_file(path, "3\n");
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/cache/index1/shared_cpu_list", cpu);
+        write_file(path, content);
+
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%zu/node%zu/cpulist", cpu, package);
+        write_file(path, content);
+    }
+
+    write_file("sys/class/net/eth0/device/msi_irqs/40", "msix\n");
+    write_file("proc/irq/40/effective_affinity_list", "1\n");
+}
+
+void test_topology_discover() {
+    make_host();
+
+    topo_t topo;
+    CU_ASSERT(topology_discover(&topo, TOPO_ROOT) == 0);
+    CU_ASSERT(topo.count == 8);
+
+    CU_ASSERT(topo.cpus[5].cpu == 5);
+    CU_ASSERT(topo.cpus[5].core == 1);
+    CU_ASSERT(topo.cpus[5].package == 0);
+    CU_ASSERT(topo.cpus[5].l3 == 0);
+    CU_ASSERT(topo.cpus[5].node == 0);
+
+    CU_ASSERT(topo.cpus[6].core == 2);
+    CU_ASSERT(topo.cpus[6].package == 1);
+    CU_ASSERT(topo.cpus[6].l3 == 2);
+    CU_ASSERT(topo.cpus[6].node == 1);
+
+    CU_ASSERT(topology_mark_irqs(&topo, TOPO_ROOT, "eth0") == 1);
+    CU_ASSERT(topo.cpus[1].irq);
+    CU_ASSERT(!topo.cpus[5].irq && topo.cpus[5].irq_core);
+    CU_ASSERT(!topo.cpus[0].irq_core && topo.cpus[0].irq_l3);
+    CU_ASSERT(!topo.cpus[2].irq_l3);
+
+    topology_free(&topo);
+
+    errno = 0;
+    CU_ASSERT(topology_discover(&topo, TOPO_ROOT "/missing") == -1);
+    CU_ASSERT(errno == TOPOLOGY_UNAVAILABLE);
+}
+
+void test_topology_place() {
+    make_host();
+
+    topo_t topo;
+    CU_ASSERT(topology_discover(&topo, TOPO_ROOT) == 0);
+    CU_ASSERT(topology_mark_irqs(&topo, TOPO_ROOT, NULL) == 1);
+
+    sts_t receive_streams[1] = { { .stream = 0 } };
+    sts_t handle_streams[4] = { { .stream = 0 }, { .stream = 0 }, { .stream = 0 }, { .stream = 0 } };
+
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+    config.receive_num = 1;
+    config.handle_num = 4;
+    config.receive_streams = receive_streams;
+    config.handle_streams = handle_streams;
+
+    CU_ASSERT(topology_place(&topo, &config) == 0);
+    CU_ASSERT(config.receive_affinities != NULL);
+    CU_ASSERT(config.handle_affinities != NULL);
+
+    /** The SMT sibling of the CPU handling the interrupt */
+    CU_ASSERT(config.receive_affinities[0].cpu == 5);
+
+    /** The idle core of the same L3, its sibling, the IRQ CPU and then the other package */
+    CU_ASSERT(config.handle_affinities[0].cpu == 0);
+    CU_ASSERT(config.handle_affinities[1].cpu == 4);
+    CU_ASSERT(config.handle_affinities[2].cpu == 1);
+    CU_ASSERT(config.handle_affinities[3].cpu == 2);
+
+    free(config.receive_affinities);
+    free(config.handle_affinities);
+    topology_free(&topo);
+}
+
+void test_topology_nodes() {
+    make_host();
+
+    sts_t receive_streams[2] = { { .stream = 0 }, { .stream = 1 } };
+    sts_t handle_streams[2] = { { .stream = 0 }, { .stream = 1 } };
+    afs_t receive_affinities[2] = { { .cpu = 5 }, { .cpu = 6 } };
+
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+    config.stream_count = 3;
+    config.receive_num = 2;
+    config.handle_num = 2;
+    config.receive_streams = receive_streams;
+    config.handle_streams = handle_streams;
+
+    /** Nothing is pinned */
+    CU_ASSERT(topology_stream_nodes(&config, TOPO_ROOT) == 0);
+    CU_ASSERT(config.stream_nodes == NULL);
+
+    /** The node of the receiver, nothing runs on the third stream */
+    config.receive_affinities = receive_affinities;
+    CU_ASSERT(topology_stream_nodes(&config, TOPO_ROOT) == 0);
+    CU_ASSERT(config.stream_nodes != NULL);
+    if (config.stream_nodes != NULL) {
+        CU_ASSERT(config.stream_nodes[0] == 0);
+        CU_ASSERT(config.stream_nodes[1] == 1);
+        CU_ASSERT(config.stream_nodes[2] == TOPO_NO_NODE);
+    }
+
+    free(config.stream_nodes);
+}
+
+void test_topology_bind() {
+    size_t size = 4 * ARENA_PAGE_SIZE;
+    uint8_t *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CU_ASSERT(map != MAP_FAILED);
+
+    /** Every host has a node 0, the pages are still usable */
+    CU_ASSERT(topology_bind(map, size, 0) == 0);
+    memset(map, 0xFF, size);
+
+    /** Only whole pages are bound */
+    CU_ASSERT(topology_bind(map + 1, ARENA_PAGE_SIZE, 0) == 0);
+
+    errno = 0;
+    CU_ASSERT(topology_bind(map, size, TOPO_MAX_NODES) == -1);
+    CU_ASSERT(errno == TOPOLOGY_UNAVAILABLE);
+
+    munmap(map, size);
+}
+
+int add_topology_tests() {
+    CU_pSuite pSuite = CU_add_suite("topology_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_topology_discover", test_topology_discover)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_topology_place", test_topology_place)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_topology_nodes", test_topology_nodes)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_topology_bind", test_topology_bind)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
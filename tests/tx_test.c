@@ -0,0 +1,184 @@
+#define _GNU_SOURCE
+
+#include "./headers/tx_test.h"
+#include "../headers/tx.h"
+
+/**
+ * Binds a non blocking socket on ::1 (any port), its address in `address`.
+ */
+static int bind_receiver(struct sockaddr_in6 *address) {
+    socklen_t addrlen = sizeof(struct sockaddr_in6);
+
+    memset(address, 0, addrlen);
+    address->sin6_family = AF_INET6;
+    address->sin6_addr = in6addr_loopback;
+
+    int sock = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    CU_ASSERT(sock > 0);
+    CU_ASSERT(bind(sock, (struct sockaddr *) address, addrlen) == 0);
+    CU_ASSERT(getsockname(sock, (struct sockaddr *) address, &addrlen) == 0);
+
+    return sock;
+}
+
+/**
+ * Packs an ACK for `seqnum` in the batch.
+ */
+static void add_ack(ack_batch_t *acks, struct sockaddr_in6 *destination, uint8_t seqnum) {
+    packet_t ack;
+    CU_ASSERT(init_packet(&ack) == 0);
+    ack.type = ACK;
+    ack.seqnum = seqnum;
+    ack.window = 31;
+
+    CU_ASSERT(pack(ack_batch_reserve(acks, destination), &ack, false) == 0);
+    ack_batch_commit(acks);
+}
+
+void test_tx_handover() {
+    struct sockaddr_in6 address;
+    int receiver = bind_receiver(&address);
+    int sender = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sender > 0);
+
+    stats_t tx_stats, first_stats, second_stats;
+    memset(&tx_stats, 0, sizeof(stats_t));
+    memset(&first_stats, 0, sizeof(stats_t));
+    memset(&second_stats, 0, sizeof(stats_t));
+
+    tx_stage_t tx;
+    CU_ASSERT(tx_init(&tx, 0, sender, 1000000, &tx_stats) == 0);
+
+    /** Two handlers of the same stream */
+    ack_batch_t first, second;
+    ack_batch_init(&first, sender, &first_stats, NULL);
+    ack_batch_init(&second, sender, &second_stats, NULL);
+    first.tx = &tx;
+    second.tx = &tx;
+
+    add_ack(&first, &address, 0);
+    add_ack(&first, &address, 1);
+    add_ack(&second, &address, 2);
+    add_ack(&second, &address, 3);
+    add_ack(&second, &address, 4);
+
+    CU_ASSERT(ack_batch_flush(&first) == 0);
+    CU_ASSERT(ack_batch_flush(&second) == 0);
+
+    /** The handlers didn't send anything but counted their ACKs */
+    CU_ASSERT(STAT_GET(&first_stats, STAT_HD_ACK_SENDS) == 0);
+    CU_ASSERT(STAT_GET(&second_stats, STAT_HD_ACK_SENDS) == 0);
+    CU_ASSERT(STAT_GET(&first_stats, STAT_HD_ACKS) == 2);
+    CU_ASSERT(STAT_GET(&second_stats, STAT_HD_ACKS) == 3);
+
+    /** Not full and before the deadline */
+    CU_ASSERT(tx_run_once(&tx, false) == 0);
+    CU_ASSERT(STAT_GET(&tx_stats, STAT_TX_SENDS) == 0);
+
+    /** Both batches in a single sendmmsg, in the order they were handed over */
+    CU_ASSERT(tx_run_once(&tx, true) == 2);
+    CU_ASSERT(STAT_GET(&tx_stats, STAT_TX_SENDS) == (tx.gso ? 1 : 2));
+    CU_ASSERT(STAT_GET(&tx_stats, STAT_TX_FRAMES) == 5);
+    CU_ASSERT(tx_run_once(&tx, true) == 0);
+
+    uint8_t buffer[MAX_PACKET_SIZE];
+    packet_t received;
+    CU_ASSERT(init_packet(&received) == 0);
+
+    int i;
+    for (i = 0; i < 5; i++) {
+        CU_ASSERT(recv(receiver, buffer, sizeof(buffer), 0) == ACK_FRAME_SIZE);
+        CU_ASSERT(unpack(buffer, ACK_FRAME_SIZE, &received) == 0);
+        CU_ASSERT(received.seqnum == i);
+    }
+
+    CU_ASSERT(recv(receiver, buffer, sizeof(buffer), 0) == -1);
+
+    /** The thread sends what's left when it's stopped */
+    CU_ASSERT(tx_start(&tx) == 0);
+    add_ack(&first, &address, 5);
+    CU_ASSERT(ack_batch_flush(&first) == 0);
+    tx_stop(&tx);
+
+    CU_ASSERT(recv(receiver, buffer, sizeof(buffer), 0) == ACK_FRAME_SIZE);
+    CU_ASSERT(unpack(buffer, ACK_FRAME_SIZE, &received) == 0);
+    CU_ASSERT(received.seqnum == 5);
+
+    tx_destroy(&tx);
+    close(sender);
+    close(receiver);
+}
+
+void test_tx_full() {
+    struct sockaddr_in6 address;
+    int receiver = bind_receiver(&address);
+    int sender = socket(AF_INET6, SOCK_DGRAM, 0);
+    CU_ASSERT(sender > 0);
+
+    stats_t tx_stats, stats;
+    memset(&tx_stats, 0, sizeof(stats_t));
+    memset(&stats, 0, sizeof(stats_t));
+
+    tx_stage_t tx;
+    CU_ASSERT(tx_init(&tx, 0, sender, 0, &tx_stats) == 0);
+
+    uint8_t frames[ACK_FRAME_SIZE];
+    memset(frames, 0, sizeof(frames));
+
+    int i;
+    for (i = 0; i < TX_RING_SIZE; i++) {
+        CU_ASSERT(tx_push(&tx, &address, frames, 1) == 0);
+    }
+
+    errno = 0;
+    CU_ASSERT(tx_push(&tx, &address, frames, 1) == -1);
+    CU_ASSERT(errno == TX_FULL);
+
+    /** The handler sends it itself */
+    ack_batch_t acks;
+    ack_batch_init(&acks, sender, &stats, NULL);
+    acks.tx = &tx;
+
+    add_ack(&acks, &address, 1);
+    CU_ASSERT(ack_batch_flush(&acks) == 0);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_TX_FULL) == 1);
+    CU_ASSERT(STAT_GET(&stats, STAT_HD_ACK_SENDS) == 1);
+
+    /** `TX_SEND_MAX` batches at a time, the slots are reused on the next lap */
+    CU_ASSERT(tx_run_once(&tx, false) == TX_SEND_MAX);
+
+    size_t drained = TX_SEND_MAX;
+    size_t sent;
+    while ((sent = tx_run_once(&tx, false)) > 0) {
+        drained += sent;
+    }
+
+    CU_ASSERT(drained == TX_RING_SIZE);
+    CU_ASSERT(tx_push(&tx, &address, frames, 1) == 0);
+    CU_ASSERT(tx_run_once(&tx, false) == 1);
+
+    tx_destroy(&tx);
+    close(sender);
+    close(receiver);
+}
+
+int add_tx_tests() {
+    CU_pSuite pSuite = CU_add_suite("tx_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_tx_handover", test_tx_handover)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_tx_full", test_tx_full)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+#define _GNU_SOURCE
+
+#include "./headers/workers_test.h"
+#include "../headers/workers.h"
+
+void test_workers_restart() {
+    config_rcv_t config;
+    memset(&config, 0, sizeof(config_rcv_t));
+    config.workers = 2;
+    config.stream_count = 1;
+    config.shm_name = "/trtp_workers_test";
+
+    /** Any port: only the restarts are looked at */
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    CU_ASSERT(getaddrinfo("::1", "0", &hints, &config.addr_info) == 0);
+
+    reg_t registry;
+    CU_ASSERT(create_registry(&registry, 4) == 0);
+
+    workers_t workers;
+    CU_ASSERT(workers_init(&workers, &config, &registry) == 0);
+    CU_ASSERT(workers.sockfds[0] > 0 && workers.sockfds[1] > 0);
+
+    int worker = workers_run(&workers);
+    if (worker >= 0) {
+        /** In a worker: the first #0 takes a client and crashes, the others exit */
+        if (strcmp(config.shm_name, worker == 0 ? "/trtp_workers_test.0" : "/trtp_workers_test.1")) {
+            _exit(2);
+        }
+
+        if (worker == 0 && workers.restarts[0] == 0) {
+            struct sockaddr_in6 address;
+            memset(&address, 0, sizeof(struct sockaddr_in6));
+            address.sin6_family = AF_INET6;
+            address.sin6_port = htons(1000);
+
+            uint32_t id;
+            reg_claim(&registry, 0, &address, &id);
+            raise(SIGKILL);
+        }
+
+        _exit(workers.sockfds[worker] != -1 && workers.sockfds[1 - worker] == -1 ? 0 : 1);
+    }
+
+    CU_ASSERT(workers.restarts[0] == 1);
+    CU_ASSERT(workers.restarts[1] == 0);
+    CU_ASSERT(workers.failures == 1);
+    CU_ASSERT(workers.pids[0] == WORKER_DONE && workers.pids[1] == WORKER_DONE);
+
+    /** The client of the crash is an orphan */
+    CU_ASSERT(REG_STATE(registry.entries[0].state) == REG_ORPHAN);
+
+    /** Only in the workers */
+    CU_ASSERT(strcmp(config.shm_name, "/trtp_workers_test") == 0);
+
+    workers_destroy(&workers);
+    close_registry(&registry);
+    freeaddrinfo(config.addr_info);
+}
+
+int add_workers_tests() {
+    CU_pSuite pSuite = CU_add_suite("workers_test_suite", 0, 0);
+
+    if (NULL == pSuite) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    if (NULL == CU_add_test(pSuite, "test_workers_restart", test_workers_restart)) {
+        CU_cleanup_registry();
+        return CU_get_error();
+    }
+
+    return 0;
+}
@@ -0,0 +1,688 @@
+/**
+ * trtp-bench-sender - a multithreaded TRTP load generator.
+ *
+ * Every thread drives its share of the virtual clients, each client
+ * has its own UDP socket (hence its own port, i.e its own transfer
+ * on the receiver side) and sends a synthetic file using `pack()`.
+ *
+ * The impairments (loss, reordering, duplication and truncation) are
+ * applied when sending and are reproducible using the seed.
+ *
+ * At the end it reports the goodput and the ACK RTT measured from
+ * the timestamp echoed by the receiver.
+ */
+#define _GNU_SOURCE
+#include "../headers/packet.h"
+#include "../headers/histogram.h"
+
+/** Maximum number of datagrams sent at once per client (duplicates included) */
+#define BENCH_MAX_BATCH (2 * MAX_WINDOW_SIZE)
+
+/** Maximum number of ACKs read at once per client */
+#define BENCH_MAX_ACKS 32
+
+/** Number of epoll events handled per iteration */
+#define BENCH_MAX_EVENTS 256
+
+typedef struct bench_options {
+    /** Receiver address */
+    struct addrinfo *addr_info;
+
+    /** Number of threads */
+    size_t threads;
+
+    /** Number of virtual clients */
+    size_t clients;
+
+    /** Bytes sent by each client */
+    uint64_t bytes;
+
+    /** Payload size */
+    size_t payload;
+
+    /** Maximum sender window */
+    size_t window;
+
+    /** Impairment probabilities (between 0 and 1) */
+    double loss, reorder, duplicate, truncate;
+
+    /** Seed of the impairments */
+    uint64_t seed;
+
+    /** Retransmission timeout (in ns) */
+    uint64_t rto;
+
+    /** Maximum duration of the run (in ns) */
+    uint64_t timeout;
+
+    /** true = send using UDP_SEGMENT (GSO) */
+    bool gso;
+} bench_opt_t;
+
+typedef struct bench_client {
+    /** Connected socket of the client */
+    int sockfd;
+
+    /** Number of packets to send (including the final empty packet) */
+    uint64_t total;
+
+    /** Payload length of the last data packet */
+    uint16_t last_length;
+
+    /** Index of the next new packet */
+    uint64_t next;
+
+    /** Every packet before this index has been acknowledged */
+    uint64_t acked;
+
+    /** Window advertised by the receiver */
+    uint8_t window;
+
+    /** Last send time of each packet of the window, 0 = must be sent */
+    uint64_t sent_at[MAX_BUFFER_SIZE];
+
+    /** true = every packet was acknowledged */
+    bool done;
+} bench_client_t;
+
+typedef struct bench_thread {
+    /** Thread reference */
+    pthread_t thread;
+
+    /** Thread ID */
+    size_t id;
+
+    /** Options */
+    bench_opt_t *opt;
+
+    /** Clients of this thread */
+    bench_client_t *clients;
+
+    /** Number of clients of this thread */
+    size_t count;
+
+    /** State of the random generator */
+    uint64_t rng;
+
+    /** A packet with the payload and its CRC already computed */
+    packet_t *template;
+
+    /** ACK round trip times (in ns) */
+    hist_t *rtt;
+
+    /** Counters */
+    uint64_t sent, retransmitted, lost, duplicated, reordered, truncated;
+    uint64_t acks, nacks, send_errors, completed;
+
+    /** Time at which the last client completed */
+    uint64_t end;
+} bench_thr_t;
+
+volatile bool stop = false;
+
+void handle_stop() {
+    stop = true;
+}
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/**
+ * xorshift64*, one state per thread for reproducible runs
+ */
+static inline double next_random(bench_thr_t *thr) {
+    thr->rng ^= thr->rng >> 12;
+    thr->rng ^= thr->rng << 25;
+    thr->rng ^= thr->rng >> 27;
+
+    return ((thr->rng * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void print_usage(char *exec) {
+    fprintf(stderr, "Multithreaded TRTP load generator\n\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "  %s [options] <ip> <port>\n\n", exec);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -t  Number of threads                [default: 1]\n");
+    fprintf(stderr, "  -c  Number of virtual clients        [default: 64]\n");
+    fprintf(stderr, "  -b  Bytes sent per client            [default: 1048576]\n");
+    fprintf(stderr, "  -p  Payload size                     [default: %d]\n", MAX_PAYLOAD_SIZE);
+    fprintf(stderr, "  -w  Maximum sender window            [default: %d]\n", MAX_WINDOW_SIZE);
+    fprintf(stderr, "  -l  Loss probability (%%)             [default: 0]\n");
+    fprintf(stderr, "  -r  Reordering probability (%%)       [default: 0]\n");
+    fprintf(stderr, "  -u  Duplication probability (%%)      [default: 0]\n");
+    fprintf(stderr, "  -x  Truncation probability (%%)       [default: 0]\n");
+    fprintf(stderr, "  -s  Seed of the impairments          [default: 1]\n");
+    fprintf(stderr, "  -R  Retransmission timeout (ms)      [default: 20]\n");
+    fprintf(stderr, "  -d  Maximum duration (s)             [default: 60]\n");
+    fprintf(stderr, "  -G  Send using UDP_SEGMENT (GSO)     [default: false]\n\n");
+    fprintf(stderr, "Each client is a transfer: remember to start the receiver\n");
+    fprintf(stderr, "with a large enough maximum number of connections (-m).\n");
+}
+
+/**
+ * Parses the options, returns -1 if they are invalid.
+ */
+int parse_options(int argc, char *argv[], bench_opt_t *opt) {
+    memset(opt, 0, sizeof(bench_opt_t));
+    opt->threads = 1;
+    opt->clients = 64;
+    opt->bytes = 1048576;
+    opt->payload = MAX_PAYLOAD_SIZE;
+    opt->window = MAX_WINDOW_SIZE;
+    opt->seed = 1;
+    opt->rto = 20 * 1000000UL;
+    opt->timeout = 60 * 1000000000UL;
+
+    int c;
+    while ((c = getopt(argc, argv, ":t:c:b:p:w:l:r:u:x:s:R:d:G")) != -1) {
+        switch (c) {
+            case 't': opt->threads = strtoul(optarg, NULL, 10); break;
+            case 'c': opt->clients = strtoul(optarg, NULL, 10); break;
+            case 'b': opt->bytes = strtoull(optarg, NULL, 10); break;
+            case 'p': opt->payload = strtoul(optarg, NULL, 10); break;
+            case 'w': opt->window = strtoul(optarg, NULL, 10); break;
+            case 'l': opt->loss = strtod(optarg, NULL) / 100.0; break;
+            case 'r': opt->reorder = strtod(optarg, NULL) / 100.0; break;
+            case 'u': opt->duplicate = strtod(optarg, NULL) / 100.0; break;
+            case 'x': opt->truncate = strtod(optarg, NULL) / 100.0; break;
+            case 's': opt->seed = strtoull(optarg, NULL, 10); break;
+            case 'R': opt->rto = strtoull(optarg, NULL, 10) * 1000000UL; break;
+            case 'd': opt->timeout = strtoull(optarg, NULL, 10) * 1000000000UL; break;
+            case 'G': opt->gso = true; break;
+            default: return -1;
+        }
+    }
+
+    if (argc - optind != 2 || opt->threads == 0 || opt->clients == 0 ||
+        opt->payload == 0 || opt->payload > MAX_PAYLOAD_SIZE ||
+        opt->window == 0 || opt->window > MAX_WINDOW_SIZE || opt->rto == 0) {
+        return -1;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+
+    if (getaddrinfo(argv[optind], argv[optind + 1], &hints, &opt->addr_info)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Builds a packet of a client, returns its length.
+ */
+static int build_packet(bench_thr_t *thr, bench_client_t *client, uint64_t idx, bool truncated, uint8_t *out) {
+    packet_t *pkt = thr->template;
+    uint16_t length = thr->opt->payload;
+    bool recompute = false;
+
+    if (idx == client->total - 1) {
+        /** End of file */
+        length = 0;
+    } else if (idx == client->total - 2 && client->last_length != length) {
+        length = client->last_length;
+        recompute = true;
+    }
+
+    pkt->type = DATA;
+    pkt->window = thr->opt->window;
+    pkt->seqnum = idx & 0xFF;
+    pkt->length = length;
+    pkt->long_length = length > 0x7F;
+    pkt->truncated = truncated && length > 0;
+    pkt->timestamp = (uint32_t) (now_ns() / 1000);
+
+    int len = 7 + pkt->long_length + 4;
+    if (!pkt->truncated && length > 0) {
+        len += length + 4;
+    }
+
+    if (pack(out, pkt, recompute)) {
+        return -1;
+    }
+
+    return len;
+}
+
+/**
+ * Sends a batch on the socket of a client.
+ */
+static void flush(bench_thr_t *thr, bench_client_t *client, uint8_t bufs[][MAX_PACKET_SIZE], int *lens, size_t n) {
+    struct iovec iovecs[BENCH_MAX_BATCH];
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        iovecs[i].iov_base = bufs[i];
+        iovecs[i].iov_len = lens[i];
+    }
+
+    if (thr->opt->gso) {
+        /** Runs of datagrams of the same size are sent in a single call */
+        size_t start = 0;
+        while (start < n) {
+            size_t end = start + 1;
+            while (end < n && lens[end] == lens[start]) {
+                end++;
+            }
+
+            uint8_t control[CMSG_SPACE(sizeof(uint16_t))];
+            struct msghdr hdr;
+            memset(&hdr, 0, sizeof(struct msghdr));
+            hdr.msg_iov = &iovecs[start];
+            hdr.msg_iovlen = end - start;
+
+            if (end - start > 1) {
+                memset(control, 0, sizeof(control));
+                hdr.msg_control = control;
+                hdr.msg_controllen = sizeof(control);
+
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                *((uint16_t *) CMSG_DATA(cmsg)) = lens[start];
+            }
+
+            if (sendmsg(client->sockfd, &hdr, 0) == -1) {
+                thr->send_errors++;
+            } else {
+                thr->sent += end - start;
+            }
+
+            start = end;
+        }
+
+        return;
+    }
+
+    struct mmsghdr msgs[BENCH_MAX_BATCH];
+    memset(msgs, 0, n * sizeof(struct mmsghdr));
+    for (i = 0; i < n; i++) {
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int retval = sendmmsg(client->sockfd, msgs, n, 0);
+    if (retval == -1) {
+        thr->send_errors++;
+    } else {
+        thr->sent += retval;
+    }
+}
+
+/**
+ * Retransmits the expired packets of a client and sends
+ * as many new packets as the window allows.
+ */
+static void send_step(bench_thr_t *thr, bench_client_t *client, uint64_t now) {
+    uint8_t bufs[BENCH_MAX_BATCH][MAX_PACKET_SIZE];
+    int lens[BENCH_MAX_BATCH];
+    size_t n = 0;
+
+    bench_opt_t *opt = thr->opt;
+    uint64_t window = MIN(client->window, opt->window);
+    uint64_t idx;
+
+    for (idx = client->acked; idx < client->next + 1 && n + 2 <= BENCH_MAX_BATCH; idx++) {
+        bool fresh = idx == client->next;
+        if (fresh) {
+            if (client->next >= client->total || client->next - client->acked >= window) {
+                break;
+            }
+
+            client->next++;
+        } else {
+            uint64_t sent_at = client->sent_at[idx % MAX_BUFFER_SIZE];
+            if (sent_at != 0 && now - sent_at < opt->rto) {
+                continue;
+            }
+
+            if (sent_at != 0) {
+                thr->retransmitted++;
+            }
+        }
+
+        client->sent_at[idx % MAX_BUFFER_SIZE] = now;
+
+        if (next_random(thr) < opt->loss) {
+            /** Considered sent, will be retransmitted after the timeout */
+            thr->lost++;
+            continue;
+        }
+
+        bool truncated = next_random(thr) < opt->truncate;
+        int len = build_packet(thr, client, idx, truncated, bufs[n]);
+        if (len == -1) {
+            continue;
+        }
+
+        thr->truncated += truncated;
+        lens[n++] = len;
+
+        if (next_random(thr) < opt->duplicate) {
+            memcpy(bufs[n], bufs[n - 1], len);
+            lens[n++] = len;
+            thr->duplicated++;
+        }
+    }
+
+    size_t i;
+    for (i = 0; i + 1 < n; i++) {
+        if (next_random(thr) < opt->reorder) {
+            uint8_t temp[MAX_PACKET_SIZE];
+            int temp_len = lens[i];
+
+            memcpy(temp, bufs[i], lens[i]);
+            memcpy(bufs[i], bufs[i + 1], lens[i + 1]);
+            memcpy(bufs[i + 1], temp, temp_len);
+
+            lens[i] = lens[i + 1];
+            lens[i + 1] = temp_len;
+            thr->reordered++;
+            i++;
+        }
+    }
+
+    if (n > 0) {
+        flush(thr, client, bufs, lens, n);
+    }
+}
+
+/**
+ * Reads every pending (N)ACK of a client.
+ */
+static void receive_acks(bench_thr_t *thr, bench_client_t *client) {
+    uint8_t bufs[BENCH_MAX_ACKS][MAX_PACKET_SIZE];
+    struct iovec iovecs[BENCH_MAX_ACKS];
+    struct mmsghdr msgs[BENCH_MAX_ACKS];
+    packet_t pkt;
+
+    size_t i;
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < BENCH_MAX_ACKS; i++) {
+        iovecs[i].iov_base = bufs[i];
+        iovecs[i].iov_len = MAX_PACKET_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!client->done) {
+        int retval = recvmmsg(client->sockfd, msgs, BENCH_MAX_ACKS, MSG_DONTWAIT, NULL);
+        if (retval <= 0) {
+            return;
+        }
+
+        uint32_t now_us = (uint32_t) (now_ns() / 1000);
+
+        int j;
+        for (j = 0; j < retval; j++) {
+            if (unpack(bufs[j], msgs[j].msg_len, &pkt)) {
+                continue;
+            }
+
+            if (pkt.type == NACK) {
+                thr->nacks++;
+
+                uint64_t idx;
+                for (idx = client->acked; idx < client->next; idx++) {
+                    if ((idx & 0xFF) == pkt.seqnum) {
+                        client->sent_at[idx % MAX_BUFFER_SIZE] = 0;
+                        break;
+                    }
+                }
+
+                continue;
+            }
+
+            if (pkt.type != ACK) {
+                continue;
+            }
+
+            thr->acks++;
+            hist_record(thr->rtt, (uint64_t) (uint32_t) (now_us - pkt.timestamp) * 1000);
+
+            uint64_t acked = client->acked + ((pkt.seqnum - (client->acked & 0xFF)) & 0xFF);
+            if (acked > client->acked && acked <= client->next) {
+                client->acked = acked;
+            }
+
+            client->window = pkt.window;
+
+            if (client->acked == client->total) {
+                client->done = true;
+                thr->completed++;
+                thr->end = now_ns();
+                return;
+            }
+        }
+    }
+}
+
+/**
+ * A sender thread: drives `thr->count` clients until they all complete.
+ */
+void *bench_thread(void *arg) {
+    bench_thr_t *thr = (bench_thr_t *) arg;
+    bench_opt_t *opt = thr->opt;
+
+    int epfd = epoll_create1(0);
+    if (epfd == -1) {
+        perror("epoll_create1");
+        return NULL;
+    }
+
+    size_t i;
+    for (i = 0; i < thr->count; i++) {
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = &thr->clients[i];
+
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, thr->clients[i].sockfd, &event)) {
+            perror("epoll_ctl");
+        }
+    }
+
+    uint64_t deadline = now_ns() + opt->timeout;
+    struct epoll_event events[BENCH_MAX_EVENTS];
+
+    while (!stop && thr->completed < thr->count) {
+        uint64_t now = now_ns();
+        if (now > deadline) {
+            break;
+        }
+
+        for (i = 0; i < thr->count; i++) {
+            if (!thr->clients[i].done) {
+                send_step(thr, &thr->clients[i], now);
+            }
+        }
+
+        int ready = epoll_wait(epfd, events, BENCH_MAX_EVENTS, 1);
+
+        int j;
+        for (j = 0; j < ready; j++) {
+            receive_acks(thr, (bench_client_t *) events[j].data.ptr);
+        }
+    }
+
+    close(epfd);
+
+    return NULL;
+}
+
+/**
+ * Number of payload bytes acknowledged for a client.
+ */
+uint64_t acked_bytes(bench_opt_t *opt, bench_client_t *client) {
+    uint64_t data_packets = client->total - 1;
+    uint64_t packets = MIN(client->acked, data_packets);
+
+    if (packets == data_packets) {
+        return opt->bytes;
+    }
+
+    return packets * opt->payload;
+}
+
+int main(int argc, char *argv[]) {
+    bench_opt_t opt;
+    if (parse_options(argc, argv, &opt)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    signal(SIGINT, handle_stop);
+
+    bench_client_t *clients = calloc(opt.clients, sizeof(bench_client_t));
+    bench_thr_t *threads = calloc(opt.threads, sizeof(bench_thr_t));
+    if (clients == NULL || threads == NULL) {
+        LOGN("BENCH", "Failed to allocate\n");
+        return -1;
+    }
+
+    uint64_t data_packets = (opt.bytes + opt.payload - 1) / opt.payload;
+    uint16_t last_length = opt.bytes % opt.payload == 0 ? opt.payload : opt.bytes % opt.payload;
+
+    size_t i;
+    for (i = 0; i < opt.clients; i++) {
+        bench_client_t *client = &clients[i];
+
+        client->total = data_packets + 1;
+        client->last_length = last_length;
+        client->window = 1;
+        client->sockfd = socket(opt.addr_info->ai_family, SOCK_DGRAM, IPPROTO_UDP);
+
+        if (client->sockfd == -1 || connect(client->sockfd, opt.addr_info->ai_addr, opt.addr_info->ai_addrlen)) {
+            LOG("BENCH", "Failed to open the socket of client #%zu\n", i);
+            perror("socket");
+            return -1;
+        }
+    }
+
+    for (i = 0; i < opt.threads; i++) {
+        bench_thr_t *thr = &threads[i];
+        size_t first = i * opt.clients / opt.threads;
+        size_t last = (i + 1) * opt.clients / opt.threads;
+
+        thr->id = i;
+        thr->opt = &opt;
+        thr->clients = &clients[first];
+        thr->count = last - first;
+        thr->rng = opt.seed * 0x9E3779B97F4A7C15ULL + i + 1;
+        thr->template = allocate_packet();
+
+        if (thr->template == NULL || posix_memalign((void **) &thr->rtt, 64, sizeof(hist_t))) {
+            LOGN("BENCH", "Failed to allocate\n");
+            return -1;
+        }
+
+        memset(thr->rtt, 0, sizeof(hist_t));
+
+        /** Every full packet carries the same payload: its CRC is computed once */
+        size_t j;
+        for (j = 0; j < MAX_PAYLOAD_SIZE; j++) {
+            thr->template->payload[j] = (uint8_t) j;
+        }
+
+        uint8_t scratch[MAX_PACKET_SIZE];
+        thr->template->type = DATA;
+        thr->template->length = opt.payload;
+        thr->template->long_length = opt.payload > 0x7F;
+        if (pack(scratch, thr->template, true) || unpack(scratch, 7 + thr->template->long_length + 8 + opt.payload, thr->template)) {
+            LOGN("BENCH", "Failed to prepare the payload\n");
+            return -1;
+        }
+    }
+
+    LOG(
+        "BENCH", "%zu clients, %zu threads, %lu bytes per client, payload %zu, window %zu%s\n",
+        opt.clients, opt.threads, opt.bytes, opt.payload, opt.window, opt.gso ? ", GSO" : ""
+    );
+
+    uint64_t start = now_ns();
+
+    for (i = 0; i < opt.threads; i++) {
+        if (pthread_create(&threads[i].thread, NULL, &bench_thread, &threads[i])) {
+            LOGN("BENCH", "Failed to start a thread\n");
+            return -1;
+        }
+    }
+
+    hist_t *rtt = NULL;
+    if (posix_memalign((void **) &rtt, 64, sizeof(hist_t))) {
+        LOGN("BENCH", "Failed to allocate\n");
+        return -1;
+    }
+    memset(rtt, 0, sizeof(hist_t));
+
+    uint64_t end = start, bytes = 0;
+    uint64_t sent = 0, retransmitted = 0, lost = 0, duplicated = 0, reordered = 0, truncated = 0;
+    uint64_t acks = 0, nacks = 0, send_errors = 0, completed = 0;
+
+    for (i = 0; i < opt.threads; i++) {
+        bench_thr_t *thr = &threads[i];
+        pthread_join(thr->thread, NULL);
+
+        hist_merge(rtt, thr->rtt);
+        sent += thr->sent;
+        retransmitted += thr->retransmitted;
+        lost += thr->lost;
+        duplicated += thr->duplicated;
+        reordered += thr->reordered;
+        truncated += thr->truncated;
+        acks += thr->acks;
+        nacks += thr->nacks;
+        send_errors += thr->send_errors;
+        completed += thr->completed;
+
+        if (thr->completed < thr->count) {
+            thr->end = now_ns();
+        }
+
+        end = MAX(end, thr->end);
+
+        free(thr->rtt);
+        dealloc_packet(thr->template);
+    }
+
+    for (i = 0; i < opt.clients; i++) {
+        bytes += acked_bytes(&opt, &clients[i]);
+        close(clients[i].sockfd);
+    }
+
+    double elapsed = (end - start) * 1.0e-9;
+    if (elapsed <= 0.0) {
+        elapsed = 1.0e-9;
+    }
+
+    printf("clients:        %lu/%zu completed\n", completed, opt.clients);
+    printf("elapsed:        %.3f s\n", elapsed);
+    printf("sent:           %lu datagrams (%.0f pps)\n", sent, sent / elapsed);
+    printf("retransmitted:  %lu\n", retransmitted);
+    printf("impairments:    %lu lost, %lu reordered, %lu duplicated, %lu truncated\n", lost, reordered, duplicated, truncated);
+    printf("received:       %lu acks, %lu nacks\n", acks, nacks);
+    printf("send errors:    %lu\n", send_errors);
+    printf("goodput:        %.2f MiB/s (%.1f Mbit/s)\n", bytes / elapsed / 1048576.0, bytes * 8.0 / elapsed / 1.0e6);
+    printf(
+        "ack rtt (us):   p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+        hist_percentile(rtt, 50.0) / 1000.0, hist_percentile(rtt, 90.0) / 1000.0,
+        hist_percentile(rtt, 99.0) / 1000.0, hist_percentile(rtt, 99.9) / 1000.0,
+        rtt->max / 1000.0
+    );
+
+    free(rtt);
+    free(clients);
+    free(threads);
+    freeaddrinfo(opt.addr_info);
+
+    return completed == opt.clients ? 0 : 1;
+}
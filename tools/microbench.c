@@ -0,0 +1,885 @@
+/**
+ * trtp-microbench - microbenchmarks of the hot paths.
+ *
+ * Every benchmark runs its operation in batches, each batch is a
+ * sample and the percentiles are computed over the samples (in
+ * cycles per operation, using the TSC when available).
+ *
+ * The results are written as JSON, one benchmark per line, and
+ * can be compared against a previous run (the baseline): the
+ * median of every benchmark is compared and the tool fails
+ * if one of them got slower than the threshold.
+ */
+#define _GNU_SOURCE
+#include "../headers/packet.h"
+#include "../headers/hash_table.h"
+#include "../headers/stream.h"
+#include "../headers/buffer.h"
+#include "../headers/handler.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_TSC 1
+#else
+#define HAS_TSC 0
+#endif
+
+/** Default number of samples per benchmark */
+#define BENCH_SAMPLES 200
+
+/** Target duration of a sample (in ns) */
+#define BENCH_SAMPLE_NS 20000
+
+/** Maximum number of benchmarks */
+#define BENCH_MAX 64
+
+/** Maximum number of threads of the stream benchmarks */
+#define BENCH_MAX_THREADS 8
+
+/** Number of items exchanged per stream sample */
+#define BENCH_STREAM_ITEMS 20000
+
+typedef struct bench_result {
+    char name[64];
+
+    /** Total number of operations measured */
+    uint64_t ops;
+
+    /** Cycles per operation */
+    double mean, min, p50, p90, p99;
+
+    /** Baseline median, < 0 if unknown */
+    double baseline;
+} bench_res_t;
+
+typedef struct bench_options {
+    /** Only runs the benchmarks containing this string */
+    char *filter;
+
+    /** Where to write the results (NULL = stdout) */
+    char *output;
+
+    /** Baseline to compare against */
+    char *baseline;
+
+    /** Allowed regression of the median (in %) */
+    double threshold;
+
+    /** Number of samples */
+    size_t samples;
+
+    /** Maximum number of producers/consumers */
+    size_t threads;
+} bench_opt_t;
+
+/** Results of every benchmark that ran */
+bench_res_t results[BENCH_MAX];
+size_t result_count = 0;
+
+/** TSC frequency (in GHz) */
+double tsc_ghz = 1.0;
+
+/** Prevents the compiler from removing the benchmarked calls */
+volatile uint64_t sink;
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+static inline uint64_t cycles() {
+#if HAS_TSC
+    return __rdtsc();
+#else
+    return now_ns();
+#endif
+}
+
+/**
+ * Measures the frequency of the TSC against CLOCK_MONOTONIC.
+ */
+static void calibrate() {
+#if HAS_TSC
+    uint64_t ns = now_ns();
+    uint64_t c = cycles();
+
+    while (now_ns() - ns < 50000000UL);
+
+    tsc_ghz = (double) (cycles() - c) / (now_ns() - ns);
+#endif
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Computes the statistics of the samples (sorts them).
+ */
+static bench_res_t *add_result(char *name, double *samples, size_t count, uint64_t ops) {
+    bench_res_t *res = &results[result_count++];
+    memset(res, 0, sizeof(bench_res_t));
+    strncpy(res->name, name, sizeof(res->name) - 1);
+
+    qsort(samples, count, sizeof(double), compare_double);
+
+    double sum = 0;
+    size_t i;
+    for (i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+
+    res->ops = ops;
+    res->mean = sum / count;
+    res->min = samples[0];
+    res->p50 = samples[(size_t) (0.50 * (count - 1))];
+    res->p90 = samples[(size_t) (0.90 * (count - 1))];
+    res->p99 = samples[(size_t) (0.99 * (count - 1))];
+    res->baseline = -1;
+
+    fprintf(
+        stderr, "%-32s p50 %10.1f  p90 %10.1f  p99 %10.1f cycles/op (%.1f ns)\n",
+        res->name, res->p50, res->p90, res->p99, res->p50 / tsc_ghz
+    );
+
+    return res;
+}
+
+/** A single threaded benchmark: runs `ops` operations */
+typedef void (*bench_fn_t)(void *ctx, size_t ops);
+
+/**
+ * Runs a single threaded benchmark: finds a batch size such that
+ * a sample lasts about `BENCH_SAMPLE_NS` then takes the samples.
+ */
+static void run(bench_opt_t *opt, char *name, bench_fn_t fn, void *ctx) {
+    if (opt->filter != NULL && strstr(name, opt->filter) == NULL) {
+        return;
+    }
+
+    if (result_count == BENCH_MAX) {
+        return;
+    }
+
+    /** Warm-up (the first call may fault in a lookup table) and calibration */
+    fn(ctx, 1);
+
+    size_t batch = 1;
+    while (batch < (1 << 24)) {
+        uint64_t start = now_ns();
+        fn(ctx, batch);
+        if (now_ns() - start >= BENCH_SAMPLE_NS) {
+            break;
+        }
+        batch *= 2;
+    }
+
+    double samples[opt->samples];
+    size_t i;
+    for (i = 0; i < opt->samples; i++) {
+        uint64_t start = cycles();
+        fn(ctx, batch);
+        samples[i] = (double) (cycles() - start) / batch;
+    }
+
+    add_result(name, samples, opt->samples, (uint64_t) batch * opt->samples);
+}
+
+// -----------------------------------------------------------------------------
+// Packets
+// -----------------------------------------------------------------------------
+
+typedef struct packet_ctx {
+    packet_t *pkt;
+    uint8_t raw[MAX_PACKET_SIZE];
+    int length;
+} packet_ctx_t;
+
+static void bench_pack(void *ctx, size_t ops) {
+    packet_ctx_t *c = (packet_ctx_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        c->pkt->seqnum = i;
+        pack(c->raw, c->pkt, true);
+    }
+
+    sink += c->raw[2];
+}
+
+static void bench_pack_ack(void *ctx, size_t ops) {
+    packet_ctx_t *c = (packet_ctx_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        c->pkt->seqnum = i;
+        c->pkt->timestamp = i * 2654435761U;
+        pack_ack(c->raw, c->pkt);
+    }
+
+    sink += c->raw[7];
+}
+
+static void bench_unpack(void *ctx, size_t ops) {
+    packet_ctx_t *c = (packet_ctx_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        sink += unpack(c->raw, c->length, c->pkt);
+    }
+}
+
+static void packet_benchmarks(bench_opt_t *opt) {
+    packet_ctx_t ctx;
+    ctx.pkt = allocate_packet();
+    if (ctx.pkt == NULL) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < MAX_PAYLOAD_SIZE; i++) {
+        ctx.pkt->payload[i] = (uint8_t) (i * 7);
+    }
+
+    ctx.pkt->type = DATA;
+    ctx.pkt->length = MAX_PAYLOAD_SIZE;
+    ctx.pkt->long_length = true;
+    ctx.length = 8 + 4 + MAX_PAYLOAD_SIZE + 4;
+
+    run(opt, "pack/data_512", bench_pack, &ctx);
+
+    ctx.pkt->seqnum = 0;
+    pack(ctx.raw, ctx.pkt, true);
+    run(opt, "unpack/data_512", bench_unpack, &ctx);
+
+    ctx.pkt->type = ACK;
+    ctx.pkt->length = 0;
+    ctx.pkt->long_length = false;
+    ctx.length = 7 + 4;
+
+    run(opt, "pack/ack", bench_pack, &ctx);
+    run(opt, "pack_ack/ack", bench_pack_ack, &ctx);
+
+    ctx.pkt->seqnum = 0;
+    pack(ctx.raw, ctx.pkt, false);
+    run(opt, "unpack/ack", bench_unpack, &ctx);
+
+    dealloc_packet(ctx.pkt);
+}
+
+typedef struct validate_ctx {
+    packet_t *pkt;
+    hd_req_t *req;
+} validate_ctx_t;
+
+static void bench_validate_serial(void *ctx, size_t ops) {
+    validate_ctx_t *c = (validate_ctx_t *) ctx;
+
+    size_t i, j;
+    for (i = 0; i < ops; i++) {
+        for (j = 0; j < c->req->num; j++) {
+            sink += unpack(hd_req_datagram(c->req, j), hd_req_length(c->req, j), c->pkt);
+        }
+    }
+}
+
+static void bench_validate_batch(void *ctx, size_t ops) {
+    validate_ctx_t *c = (validate_ctx_t *) ctx;
+    uint32_t header_crcs[MAX_WINDOW_SIZE];
+    uint32_t payload_crcs[MAX_WINDOW_SIZE];
+
+    size_t i, j;
+    for (i = 0; i < ops; i++) {
+        hd_req_crcs(c->req, header_crcs, payload_crcs);
+
+        for (j = 0; j < c->req->num; j++) {
+            sink += unpack_precomputed(
+                hd_req_datagram(c->req, j),
+                hd_req_length(c->req, j),
+                c->pkt,
+                header_crcs[j],
+                payload_crcs[j]
+            );
+        }
+    }
+}
+
+/**
+ * Validation of a whole request (one op), datagram by datagram
+ * with `unpack` or with the CRCs of `hd_req_crcs`.
+ */
+static void validate_benchmarks(bench_opt_t *opt) {
+    validate_ctx_t ctx;
+    ctx.pkt = allocate_packet();
+    ctx.req = malloc(sizeof(hd_req_t));
+    if (ctx.pkt == NULL || ctx.req == NULL) {
+        dealloc_packet(ctx.pkt);
+        free(ctx.req);
+        return;
+    }
+
+    uint8_t raw[MAX_PACKET_SIZE];
+    size_t i;
+    for (i = 0; i < MAX_PAYLOAD_SIZE; i++) {
+        ctx.pkt->payload[i] = (uint8_t) (i * 7);
+    }
+
+    /** As many full datagrams as a request holds, then a window of small ones */
+    size_t lengths[] = { MAX_PAYLOAD_SIZE, 64 };
+    char name[64];
+
+    size_t l;
+    for (l = 0; l < sizeof(lengths) / sizeof(size_t); l++) {
+        hd_req_reset(ctx.req);
+        ctx.pkt->type = DATA;
+        set_length(ctx.pkt, lengths[l]);
+
+        do {
+            ctx.pkt->seqnum = ctx.req->num;
+            pack(raw, ctx.pkt, true);
+        } while (hd_req_push(ctx.req, raw, 7 + ctx.pkt->long_length + 4 + lengths[l] + 4));
+
+        snprintf(name, sizeof(name), "validate/serial/%zux%zu", ctx.req->num, lengths[l]);
+        run(opt, name, bench_validate_serial, &ctx);
+
+        snprintf(name, sizeof(name), "validate/batch/%zux%zu", ctx.req->num, lengths[l]);
+        run(opt, name, bench_validate_batch, &ctx);
+    }
+
+    dealloc_packet(ctx.pkt);
+    free(ctx.req);
+}
+
+// -----------------------------------------------------------------------------
+// CRC32
+// -----------------------------------------------------------------------------
+
+typedef struct crc_ctx {
+    uint32_t (*crc)(const void *, size_t, uint32_t);
+    uint8_t data[MAX_PAYLOAD_SIZE];
+    size_t length;
+} crc_ctx_t;
+
+static void bench_crc(void *ctx, size_t ops) {
+    crc_ctx_t *c = (crc_ctx_t *) ctx;
+
+    uint32_t crc = 0;
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        crc = c->crc(c->data, c->length, crc);
+    }
+
+    sink += crc;
+}
+
+static uint32_t crc32_16bytes_prefetch256(const void *data, size_t length, uint32_t previous) {
+    return crc32_16bytes_prefetch(data, length, previous, 256);
+}
+
+static void crc_benchmarks(bench_opt_t *opt) {
+    struct {
+        char *name;
+        uint32_t (*crc)(const void *, size_t, uint32_t);
+    } variants[] = {
+        { "bitwise", crc32_bitwise },
+        { "halfbyte", crc32_halfbyte },
+        { "1byte", crc32_1byte },
+        { "1byte_tableless", crc32_1byte_tableless },
+        { "1byte_tableless2", crc32_1byte_tableless2 },
+        { "4bytes", crc32_4bytes },
+        { "8bytes", crc32_8bytes },
+        { "4x8bytes", crc32_4x8bytes },
+        { "16bytes", crc32_16bytes },
+        { "16bytes_prefetch", crc32_16bytes_prefetch256 },
+        { "fast", crc32_fast },
+    };
+
+    crc_ctx_t ctx;
+    size_t i;
+    for (i = 0; i < MAX_PAYLOAD_SIZE; i++) {
+        ctx.data[i] = (uint8_t) (i * 13);
+    }
+
+    char name[64];
+    for (i = 0; i < sizeof(variants) / sizeof(variants[0]); i++) {
+        ctx.crc = variants[i].crc;
+
+        /** The header (CRC1) and a full payload (CRC2) */
+        ctx.length = 8;
+        snprintf(name, sizeof(name), "crc32/%s/8", variants[i].name);
+        run(opt, name, bench_crc, &ctx);
+
+        ctx.length = MAX_PAYLOAD_SIZE;
+        snprintf(name, sizeof(name), "crc32/%s/%d", variants[i].name, MAX_PAYLOAD_SIZE);
+        run(opt, name, bench_crc, &ctx);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Hash table
+// -----------------------------------------------------------------------------
+
+typedef struct ht_ctx {
+    ht_t table;
+    size_t count;
+    uint16_t ports[4096];
+    uint8_t ip[16];
+} ht_ctx_t;
+
+static void bench_ht_get(void *ctx, size_t ops) {
+    ht_ctx_t *c = (ht_ctx_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        sink += (uintptr_t) ht_get(&c->table, c->ports[(i * 2654435761U) % c->count], c->ip);
+    }
+}
+
+static void bench_ht_get_miss(void *ctx, size_t ops) {
+    ht_ctx_t *c = (ht_ctx_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        /** Odd ports are never inserted */
+        sink += (uintptr_t) ht_get(&c->table, c->ports[(i * 2654435761U) % c->count] | 1, c->ip);
+    }
+}
+
+static void bench_ht_put(void *ctx, size_t ops) {
+    ht_ctx_t *c = (ht_ctx_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        uint16_t port = c->ports[(i * 2654435761U) % c->count];
+
+        /** Replaces the client by itself */
+        client_t *client = ht_get(&c->table, port, c->ip);
+        sink += (uintptr_t) ht_put(&c->table, port, c->ip, client);
+    }
+}
+
+static void ht_benchmarks(bench_opt_t *opt) {
+    size_t loads[] = { 16, 256, 4096 };
+    char name[64];
+
+    size_t l;
+    for (l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+        ht_ctx_t *ctx = calloc(1, sizeof(ht_ctx_t));
+        if (ctx == NULL || allocate_ht(&ctx->table)) {
+            free(ctx);
+            return;
+        }
+
+        ctx->count = loads[l];
+        ctx->ip[15] = 1;
+
+        size_t i;
+        for (i = 0; i < ctx->count; i++) {
+            /** Even ports, spread over the whole range */
+            ctx->ports[i] = (uint16_t) ((i * 40503U) & 0xFFFE);
+            ht_put(&ctx->table, ctx->ports[i], ctx->ip, calloc(1, sizeof(client_t)));
+        }
+
+        snprintf(name, sizeof(name), "ht_get/hit/%zu", ctx->count);
+        run(opt, name, bench_ht_get, ctx);
+
+        snprintf(name, sizeof(name), "ht_get/miss/%zu", ctx->count);
+        run(opt, name, bench_ht_get_miss, ctx);
+
+        snprintf(name, sizeof(name), "ht_put/update/%zu", ctx->count);
+        run(opt, name, bench_ht_put, ctx);
+
+        dealloc_ht(&ctx->table);
+        free(ctx);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Buffer
+// -----------------------------------------------------------------------------
+
+static void bench_buffer(void *ctx, size_t ops) {
+    buf_t *buffer = (buf_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        uint8_t seqnum = buffer->window_low;
+
+        sink += (uintptr_t) next(buffer, seqnum);
+        sink += (uintptr_t) get(buffer, seqnum, true);
+    }
+}
+
+static void bench_is_used(void *ctx, size_t ops) {
+    buf_t *buffer = (buf_t *) ctx;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        sink += is_used(buffer, (uint8_t) i);
+    }
+}
+
+static void buffer_benchmarks(bench_opt_t *opt) {
+    /** `deallocate_buffer` also frees the buffer itself */
+    buf_t *buffer = malloc(sizeof(buf_t));
+    if (buffer == NULL || initialize_buffer(buffer, allocate_packet)) {
+        return;
+    }
+
+    run(opt, "buffer/next+get", bench_buffer, buffer);
+    run(opt, "buffer/is_used", bench_is_used, buffer);
+
+    deallocate_buffer(buffer);
+}
+
+// -----------------------------------------------------------------------------
+// Stream
+// -----------------------------------------------------------------------------
+
+static void bench_stream_single(void *ctx, size_t ops) {
+    stream_t *stream = (stream_t *) ctx;
+    s_node_t node;
+    node.content = NULL;
+
+    size_t i;
+    for (i = 0; i < ops; i++) {
+        stream_enqueue(stream, &node);
+        sink += (uintptr_t) stream_pop(stream, false);
+    }
+}
+
+typedef struct stream_ctx {
+    stream_t stream;
+
+    /** Nodes of every producer */
+    s_node_t *nodes;
+
+    size_t producers;
+    size_t consumers;
+
+    /** Items popped so far */
+    volatile uint64_t popped __attribute__((aligned(64)));
+
+    /** Start signal */
+    volatile bool go;
+} stream_ctx_t;
+
+typedef struct stream_thr {
+    pthread_t thread;
+    stream_ctx_t *ctx;
+    size_t id;
+} stream_thr_t;
+
+static void *stream_producer(void *arg) {
+    stream_thr_t *thr = (stream_thr_t *) arg;
+    stream_ctx_t *ctx = thr->ctx;
+
+    size_t per_producer = BENCH_STREAM_ITEMS / ctx->producers;
+    s_node_t *nodes = &ctx->nodes[thr->id * per_producer];
+
+    while (!ctx->go);
+
+    size_t i;
+    for (i = 0; i < per_producer; i++) {
+        stream_enqueue(&ctx->stream, &nodes[i]);
+    }
+
+    return NULL;
+}
+
+static void *stream_consumer(void *arg) {
+    stream_thr_t *thr = (stream_thr_t *) arg;
+    stream_ctx_t *ctx = thr->ctx;
+
+    uint64_t total = (BENCH_STREAM_ITEMS / ctx->producers) * ctx->producers;
+
+    while (!ctx->go);
+
+    while (__atomic_load_n(&ctx->popped, __ATOMIC_RELAXED) < total) {
+        if (stream_pop(&ctx->stream, false) == NULL) {
+            sched_yield();
+            continue;
+        }
+
+        __atomic_fetch_add(&ctx->popped, 1, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/**
+ * Exchanges `BENCH_STREAM_ITEMS` nodes between the producers and the consumers,
+ * a sample is the wall time of a whole exchange divided by the number of items.
+ */
+static void stream_threaded(bench_opt_t *opt, size_t producers, size_t consumers) {
+    char name[64];
+    snprintf(name, sizeof(name), "stream/%zup%zuc", producers, consumers);
+
+    if (opt->filter != NULL && strstr(name, opt->filter) == NULL) {
+        return;
+    }
+
+    if (result_count == BENCH_MAX) {
+        return;
+    }
+
+    stream_ctx_t *ctx = calloc(1, sizeof(stream_ctx_t));
+    if (ctx == NULL) {
+        return;
+    }
+
+    ctx->nodes = calloc(BENCH_STREAM_ITEMS, sizeof(s_node_t));
+    if (ctx->nodes == NULL) {
+        free(ctx);
+        return;
+    }
+
+    ctx->producers = producers;
+    ctx->consumers = consumers;
+
+    /** Each exchange spawns threads, fewer samples are taken */
+    size_t samples = opt->samples / 10 > 5 ? opt->samples / 10 : 5;
+    double values[samples];
+    uint64_t items = (BENCH_STREAM_ITEMS / producers) * producers;
+
+    size_t s, i;
+    for (s = 0; s < samples; s++) {
+        stream_thr_t threads[2 * BENCH_MAX_THREADS];
+
+        initialize_stream(&ctx->stream);
+        ctx->popped = 0;
+        ctx->go = false;
+
+        for (i = 0; i < producers + consumers; i++) {
+            threads[i].ctx = ctx;
+            threads[i].id = i < producers ? i : i - producers;
+            pthread_create(&threads[i].thread, NULL, i < producers ? stream_producer : stream_consumer, &threads[i]);
+        }
+
+        uint64_t start = cycles();
+        ctx->go = true;
+
+        for (i = 0; i < producers + consumers; i++) {
+            pthread_join(threads[i].thread, NULL);
+        }
+
+        values[s] = (double) (cycles() - start) / items;
+
+        /** The nodes belong to `ctx->nodes`, nothing to free */
+        pthread_mutex_destroy(&ctx->stream.lock);
+        pthread_cond_destroy(&ctx->stream.read_cond);
+    }
+
+    add_result(name, values, samples, items * samples);
+
+    free(ctx->nodes);
+    free(ctx);
+}
+
+static void stream_benchmarks(bench_opt_t *opt) {
+    stream_t stream;
+    if (initialize_stream(&stream)) {
+        return;
+    }
+
+    run(opt, "stream/enqueue+pop", bench_stream_single, &stream);
+    dealloc_stream(&stream);
+
+    size_t p, c;
+    for (p = 1; p <= opt->threads; p++) {
+        for (c = 1; c <= opt->threads; c++) {
+            stream_threaded(opt, p, c);
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Output & comparison
+// -----------------------------------------------------------------------------
+
+/**
+ * Reads the medians of a previous run, one benchmark per line.
+ */
+static int load_baseline(char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *name = strstr(line, "\"name\": \"");
+        char *cycles = strstr(line, "\"cycles_per_op\"");
+        if (name == NULL || cycles == NULL) {
+            continue;
+        }
+
+        name += strlen("\"name\": \"");
+        char *end = strchr(name, '"');
+        char *p50 = strstr(cycles, "\"p50\": ");
+        if (end == NULL || p50 == NULL) {
+            continue;
+        }
+
+        *end = '\0';
+
+        size_t i;
+        for (i = 0; i < result_count; i++) {
+            if (strcmp(results[i].name, name) == 0) {
+                results[i].baseline = strtod(p50 + strlen("\"p50\": "), NULL);
+            }
+        }
+    }
+
+    fclose(file);
+
+    return 0;
+}
+
+static void write_json(FILE *out) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"tsc_ghz\": %.4f,\n", tsc_ghz);
+    fprintf(out, "  \"benchmarks\": [\n");
+
+    size_t i;
+    for (i = 0; i < result_count; i++) {
+        bench_res_t *res = &results[i];
+        fprintf(
+            out,
+            "    {\"name\": \"%s\", \"ops\": %lu, "
+            "\"cycles_per_op\": {\"mean\": %.2f, \"min\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f}, "
+            "\"ns_per_op\": {\"mean\": %.2f, \"min\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f}",
+            res->name, res->ops,
+            res->mean, res->min, res->p50, res->p90, res->p99,
+            res->mean / tsc_ghz, res->min / tsc_ghz, res->p50 / tsc_ghz, res->p90 / tsc_ghz, res->p99 / tsc_ghz
+        );
+
+        if (res->baseline >= 0) {
+            fprintf(out, ", \"baseline_p50\": %.2f", res->baseline);
+        }
+
+        fprintf(out, "}%s\n", i + 1 < result_count ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+/**
+ * Returns the number of benchmarks slower than the threshold.
+ */
+static int compare(bench_opt_t *opt) {
+    int regressions = 0;
+
+    fprintf(stderr, "\n%-32s %12s %12s %9s\n", "benchmark", "baseline", "current", "delta");
+
+    size_t i;
+    for (i = 0; i < result_count; i++) {
+        bench_res_t *res = &results[i];
+        if (res->baseline <= 0) {
+            fprintf(stderr, "%-32s %12s %12.1f %9s\n", res->name, "-", res->p50, "new");
+            continue;
+        }
+
+        double delta = (res->p50 - res->baseline) / res->baseline * 100.0;
+        bool regressed = delta > opt->threshold;
+        regressions += regressed;
+
+        fprintf(
+            stderr, "%-32s %12.1f %12.1f %+8.1f%%%s\n",
+            res->name, res->baseline, res->p50, delta, regressed ? "  REGRESSION" : ""
+        );
+    }
+
+    return regressions;
+}
+
+void print_usage(char *exec) {
+    fprintf(stderr, "Microbenchmarks of the TRTP receiver\n\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "  %s [options]\n\n", exec);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -f  Only runs the benchmarks containing this string\n");
+    fprintf(stderr, "  -o  Writes the results (JSON) to this file  [default: stdout]\n");
+    fprintf(stderr, "  -b  Compares against a baseline (JSON)\n");
+    fprintf(stderr, "  -t  Allowed regression of the median (%%)   [default: 10]\n");
+    fprintf(stderr, "  -n  Number of samples                       [default: %d]\n", BENCH_SAMPLES);
+    fprintf(stderr, "  -T  Maximum number of stream producers and  [default: min(4, cores)]\n");
+    fprintf(stderr, "      consumers (each combination is measured)\n");
+}
+
+int main(int argc, char *argv[]) {
+    bench_opt_t opt;
+    memset(&opt, 0, sizeof(bench_opt_t));
+    opt.threshold = 10.0;
+    opt.samples = BENCH_SAMPLES;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    opt.threads = cores > 4 ? 4 : (cores < 1 ? 1 : cores);
+
+    int c;
+    while ((c = getopt(argc, argv, ":f:o:b:t:n:T:")) != -1) {
+        switch (c) {
+            case 'f': opt.filter = optarg; break;
+            case 'o': opt.output = optarg; break;
+            case 'b': opt.baseline = optarg; break;
+            case 't': opt.threshold = strtod(optarg, NULL); break;
+            case 'n': opt.samples = strtoul(optarg, NULL, 10); break;
+            case 'T': opt.threads = strtoul(optarg, NULL, 10); break;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+
+    if (opt.samples == 0 || opt.threads == 0 || opt.threads > BENCH_MAX_THREADS) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    calibrate();
+    fprintf(stderr, "TSC: %.3f GHz\n", tsc_ghz);
+
+    packet_benchmarks(&opt);
+    validate_benchmarks(&opt);
+    crc_benchmarks(&opt);
+    ht_benchmarks(&opt);
+    buffer_benchmarks(&opt);
+    stream_benchmarks(&opt);
+
+    int regressions = 0;
+    if (opt.baseline != NULL) {
+        if (load_baseline(opt.baseline)) {
+            LOG("BENCH", "Failed to read the baseline %s\n", opt.baseline);
+            return -1;
+        }
+
+        regressions = compare(&opt);
+    }
+
+    FILE *out = stdout;
+    if (opt.output != NULL) {
+        out = fopen(opt.output, "w");
+        if (out == NULL) {
+            LOG("BENCH", "Failed to open %s\n", opt.output);
+            return -1;
+        }
+    }
+
+    write_json(out);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    if (regressions > 0) {
+        LOG("BENCH", "%d benchmark(s) slower than the baseline by more than %.1f%%\n", regressions, opt.threshold);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,651 @@
+/**
+ * trtp-netem - a UDP relay impairing the traffic between a sender
+ * and the receiver, without root nor netem.
+ *
+ * Every source address seen on the listening socket is a flow: it
+ * gets its own socket connected to the receiver (hence its own port,
+ * i.e its own transfer on the receiver side) and the datagrams
+ * received on that socket are relayed back to the source.
+ *
+ * The impairments (loss, delay, jitter, reordering, duplication,
+ * corruption and truncation) are drawn from a single seeded
+ * generator on a single thread: the same traffic gives the same
+ * decisions. The delayed datagrams are kept in a min-heap ordered
+ * by release time and released using a timerfd.
+ */
+#define _GNU_SOURCE
+#include "../headers/global.h"
+
+/** Largest datagram relayed (larger ones are truncated) */
+#define NETEM_MAX_DATAGRAM 2048
+
+/** Number of datagrams read at once per socket */
+#define NETEM_BATCH 64
+
+/** Number of epoll events handled per iteration */
+#define NETEM_MAX_EVENTS 64
+
+typedef enum netem_direction {
+    /** From the sender to the receiver */
+    UP = 0,
+
+    /** From the receiver to the sender (ACKs and NACKs) */
+    DOWN = 1,
+} netem_dir_t;
+
+typedef struct netem_options {
+    /** Address the sender sends to */
+    struct addrinfo *listen_info;
+
+    /** Address of the receiver */
+    struct addrinfo *target_info;
+
+    /** Impairment probabilities (between 0 and 1) */
+    double loss, reorder, duplicate, corrupt, truncate;
+
+    /** Delay, jitter and extra delay of the reordered datagrams (in ns) */
+    uint64_t delay, jitter, gap;
+
+    /** Seed of the impairments */
+    uint64_t seed;
+
+    /** Maximum number of delayed datagrams */
+    size_t queue;
+
+    /** Maximum number of flows */
+    size_t flows;
+
+    /** true = impairs the ACKs as well */
+    bool both;
+
+    /** Duration of the run (in ns), 0 = until SIGINT */
+    uint64_t duration;
+} netem_opt_t;
+
+typedef struct netem_flow {
+    /** true = this slot is used */
+    bool used;
+
+    /** Address of the sender */
+    struct sockaddr_storage addr;
+
+    /** Length of `addr` */
+    socklen_t addr_len;
+
+    /** Socket connected to the receiver */
+    int sockfd;
+} netem_flow_t;
+
+typedef struct netem_packet {
+    /** Time at which it must be sent */
+    uint64_t release;
+
+    /** Arrival order, keeps the heap stable for equal release times */
+    uint64_t order;
+
+    /** Flow of the datagram */
+    netem_flow_t *flow;
+
+    /** Direction of the datagram */
+    netem_dir_t dir;
+
+    /** Length of the datagram */
+    uint16_t length;
+
+    /** Content of the datagram */
+    uint8_t data[NETEM_MAX_DATAGRAM];
+} netem_pkt_t;
+
+typedef struct netem_counters {
+    uint64_t received, sent, lost, reordered, duplicated, corrupted, truncated, overflow, errors;
+} netem_ctr_t;
+
+typedef struct netem_state {
+    /** Options */
+    netem_opt_t *opt;
+
+    /** Listening socket */
+    int listenfd;
+
+    /** epoll instance */
+    int epollfd;
+
+    /** Release timer */
+    int timerfd;
+
+    /** Flows (open addressing) */
+    netem_flow_t *flows;
+
+    /** Number of flows in use */
+    size_t flow_count;
+
+    /** Datagrams that couldn't get a flow */
+    uint64_t refused;
+
+    /** Min-heap of the delayed datagrams */
+    netem_pkt_t **heap;
+
+    /** Number of datagrams in the heap */
+    size_t heap_len;
+
+    /** Free datagrams (a stack of `opt->queue` of them) */
+    netem_pkt_t **free;
+
+    /** Number of free datagrams */
+    size_t free_len;
+
+    /** Next arrival order */
+    uint64_t order;
+
+    /** Release time the timer is armed for, 0 = disarmed */
+    uint64_t armed;
+
+    /** State of the random generator */
+    uint64_t rng;
+
+    /** Counters of each direction */
+    netem_ctr_t ctr[2];
+} netem_state_t;
+
+volatile bool stop = false;
+
+void handle_stop() {
+    stop = true;
+}
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/**
+ * xorshift64*, the same generator as trtp-bench-sender
+ */
+static inline double next_random(netem_state_t *state) {
+    state->rng ^= state->rng >> 12;
+    state->rng ^= state->rng << 25;
+    state->rng ^= state->rng >> 27;
+
+    return ((state->rng * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline bool chance(netem_state_t *state, double p) {
+    return p > 0.0 && next_random(state) < p;
+}
+
+void print_usage(char *exec) {
+    fprintf(stderr, "UDP relay impairing the traffic between a sender and a receiver\n\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "  %s [options] <listen ip> <listen port> <receiver ip> <receiver port>\n\n", exec);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -l  Loss probability (%%)             [default: 0]\n");
+    fprintf(stderr, "  -d  Delay (ms)                       [default: 0]\n");
+    fprintf(stderr, "  -j  Jitter (ms, +/- around -d)       [default: 0]\n");
+    fprintf(stderr, "  -r  Reordering probability (%%)       [default: 0]\n");
+    fprintf(stderr, "  -g  Extra delay when reordered (ms)  [default: 1]\n");
+    fprintf(stderr, "  -u  Duplication probability (%%)      [default: 0]\n");
+    fprintf(stderr, "  -c  Corruption probability (%%)       [default: 0]\n");
+    fprintf(stderr, "  -x  Truncation probability (%%)       [default: 0]\n");
+    fprintf(stderr, "  -s  Seed of the impairments          [default: 1]\n");
+    fprintf(stderr, "  -q  Maximum delayed datagrams        [default: 65536]\n");
+    fprintf(stderr, "  -m  Maximum number of flows          [default: 1024]\n");
+    fprintf(stderr, "  -A  Impairs the ACKs as well         [default: false]\n");
+    fprintf(stderr, "  -D  Duration (s), 0 = until SIGINT   [default: 0]\n\n");
+    fprintf(stderr, "Example (1%% loss, 5 +/- 2ms, 1%% reordering):\n");
+    fprintf(stderr, "  %s -l 1 -d 5 -j 2 -r 1 ::1 64537 ::1 64536\n", exec);
+    fprintf(stderr, "  sender ::1 64537\n");
+}
+
+/**
+ * Parses the options, returns -1 if they are invalid.
+ */
+int parse_options(int argc, char *argv[], netem_opt_t *opt) {
+    memset(opt, 0, sizeof(netem_opt_t));
+    opt->gap = 1000000UL;
+    opt->seed = 1;
+    opt->queue = 65536;
+    opt->flows = 1024;
+
+    int c;
+    while ((c = getopt(argc, argv, ":l:d:j:r:g:u:c:x:s:q:m:AD:")) != -1) {
+        switch (c) {
+            case 'l': opt->loss = strtod(optarg, NULL) / 100.0; break;
+            case 'd': opt->delay = (uint64_t) (strtod(optarg, NULL) * 1.0e6); break;
+            case 'j': opt->jitter = (uint64_t) (strtod(optarg, NULL) * 1.0e6); break;
+            case 'r': opt->reorder = strtod(optarg, NULL) / 100.0; break;
+            case 'g': opt->gap = (uint64_t) (strtod(optarg, NULL) * 1.0e6); break;
+            case 'u': opt->duplicate = strtod(optarg, NULL) / 100.0; break;
+            case 'c': opt->corrupt = strtod(optarg, NULL) / 100.0; break;
+            case 'x': opt->truncate = strtod(optarg, NULL) / 100.0; break;
+            case 's': opt->seed = strtoull(optarg, NULL, 10); break;
+            case 'q': opt->queue = strtoul(optarg, NULL, 10); break;
+            case 'm': opt->flows = strtoul(optarg, NULL, 10); break;
+            case 'A': opt->both = true; break;
+            case 'D': opt->duration = strtoull(optarg, NULL, 10) * 1000000000UL; break;
+            default: return -1;
+        }
+    }
+
+    if (argc - optind != 4 || opt->queue == 0 || opt->flows == 0) {
+        return -1;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+
+    if (getaddrinfo(argv[optind], argv[optind + 1], &hints, &opt->listen_info)) {
+        return -1;
+    }
+
+    if (getaddrinfo(argv[optind + 2], argv[optind + 3], &hints, &opt->target_info)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * FNV-1a of the source address
+ */
+static size_t flow_hash(struct sockaddr_storage *addr, socklen_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint8_t *bytes = (uint8_t *) addr;
+
+    socklen_t i;
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    }
+
+    return (size_t) hash;
+}
+
+/**
+ * Finds the flow of a source address, creates it if needed.
+ * Returns NULL if there is no room left or if its socket can't be opened.
+ */
+static netem_flow_t *get_flow(netem_state_t *state, struct sockaddr_storage *addr, socklen_t len) {
+    size_t size = state->opt->flows * 2;
+    size_t idx = flow_hash(addr, len) % size;
+
+    size_t i;
+    for (i = 0; i < size; i++, idx = (idx + 1) % size) {
+        netem_flow_t *flow = &state->flows[idx];
+
+        if (!flow->used) {
+            break;
+        }
+
+        if (flow->addr_len == len && !memcmp(&flow->addr, addr, len)) {
+            return flow;
+        }
+    }
+
+    if (state->flow_count >= state->opt->flows) {
+        return NULL;
+    }
+
+    netem_flow_t *flow = &state->flows[idx];
+    struct addrinfo *target = state->opt->target_info;
+
+    flow->sockfd = socket(target->ai_family, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+    if (flow->sockfd == -1) {
+        return NULL;
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = flow };
+    if (connect(flow->sockfd, target->ai_addr, target->ai_addrlen) ||
+        epoll_ctl(state->epollfd, EPOLL_CTL_ADD, flow->sockfd, &event)) {
+        close(flow->sockfd);
+        return NULL;
+    }
+
+    flow->used = true;
+    flow->addr = *addr;
+    flow->addr_len = len;
+    state->flow_count++;
+
+    return flow;
+}
+
+static inline bool heap_before(netem_pkt_t *a, netem_pkt_t *b) {
+    return a->release < b->release || (a->release == b->release && a->order < b->order);
+}
+
+static void heap_push(netem_state_t *state, netem_pkt_t *pkt) {
+    size_t i = state->heap_len++;
+
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!heap_before(pkt, state->heap[parent])) {
+            break;
+        }
+
+        state->heap[i] = state->heap[parent];
+        i = parent;
+    }
+
+    state->heap[i] = pkt;
+}
+
+static netem_pkt_t *heap_pop(netem_state_t *state) {
+    netem_pkt_t *top = state->heap[0];
+    netem_pkt_t *last = state->heap[--state->heap_len];
+
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= state->heap_len) {
+            break;
+        }
+
+        if (child + 1 < state->heap_len && heap_before(state->heap[child + 1], state->heap[child])) {
+            child++;
+        }
+
+        if (!heap_before(state->heap[child], last)) {
+            break;
+        }
+
+        state->heap[i] = state->heap[child];
+        i = child;
+    }
+
+    if (state->heap_len > 0) {
+        state->heap[i] = last;
+    }
+
+    return top;
+}
+
+/**
+ * Sends a datagram to its destination.
+ */
+static void transmit(netem_state_t *state, netem_flow_t *flow, netem_dir_t dir, uint8_t *data, uint16_t length) {
+    ssize_t sent;
+
+    if (dir == UP) {
+        sent = send(flow->sockfd, data, length, 0);
+    } else {
+        sent = sendto(state->listenfd, data, length, 0, (struct sockaddr *) &flow->addr, flow->addr_len);
+    }
+
+    if (sent == -1) {
+        state->ctr[dir].errors++;
+    } else {
+        state->ctr[dir].sent++;
+    }
+}
+
+/**
+ * Applies the impairments to a datagram and either sends it
+ * right away or delays it.
+ */
+static void impair(netem_state_t *state, netem_flow_t *flow, netem_dir_t dir, uint8_t *data, uint16_t length, uint64_t now) {
+    netem_opt_t *opt = state->opt;
+    netem_ctr_t *ctr = &state->ctr[dir];
+
+    ctr->received++;
+
+    if (dir == DOWN && !opt->both) {
+        transmit(state, flow, dir, data, length);
+        return;
+    }
+
+    if (chance(state, opt->loss)) {
+        ctr->lost++;
+        return;
+    }
+
+    if (length > 1 && chance(state, opt->truncate)) {
+        length = 1 + (uint16_t) (next_random(state) * (length - 1));
+        ctr->truncated++;
+    }
+
+    if (chance(state, opt->corrupt)) {
+        size_t bit = (size_t) (next_random(state) * length * 8);
+        data[bit / 8] ^= (uint8_t) (1 << (bit % 8));
+        ctr->corrupted++;
+    }
+
+    int copies = 1;
+    if (chance(state, opt->duplicate)) {
+        ctr->duplicated++;
+        copies = 2;
+    }
+
+    int i;
+    for (i = 0; i < copies; i++) {
+        uint64_t delay = opt->delay;
+
+        if (opt->jitter > 0) {
+            int64_t offset = (int64_t) ((2.0 * next_random(state) - 1.0) * opt->jitter);
+            delay = offset < 0 && (uint64_t) -offset > delay ? 0 : delay + offset;
+        }
+
+        if (chance(state, opt->reorder)) {
+            delay += opt->gap;
+            ctr->reordered++;
+        }
+
+        /** Nothing is delayed: no need to go through the heap */
+        if (delay == 0 && state->heap_len == 0) {
+            transmit(state, flow, dir, data, length);
+            continue;
+        }
+
+        if (state->free_len == 0) {
+            ctr->overflow++;
+            continue;
+        }
+
+        netem_pkt_t *pkt = state->free[--state->free_len];
+        pkt->release = now + delay;
+        pkt->order = state->order++;
+        pkt->flow = flow;
+        pkt->dir = dir;
+        pkt->length = length;
+        memcpy(pkt->data, data, length);
+
+        heap_push(state, pkt);
+    }
+}
+
+/**
+ * Sends every datagram that is due and (re)arms the timer
+ * for the next one.
+ */
+static void release(netem_state_t *state) {
+    uint64_t now = now_ns();
+
+    while (state->heap_len > 0 && state->heap[0]->release <= now) {
+        netem_pkt_t *pkt = heap_pop(state);
+        transmit(state, pkt->flow, pkt->dir, pkt->data, pkt->length);
+        state->free[state->free_len++] = pkt;
+    }
+
+    uint64_t next = state->heap_len > 0 ? state->heap[0]->release : 0;
+    if (next == state->armed) {
+        return;
+    }
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(struct itimerspec));
+    spec.it_value.tv_sec = next / 1000000000UL;
+    spec.it_value.tv_nsec = next % 1000000000UL;
+
+    timerfd_settime(state->timerfd, TFD_TIMER_ABSTIME, &spec, NULL);
+    state->armed = next;
+}
+
+/**
+ * Reads the pending datagrams of a socket and impairs them.
+ */
+static void receive(netem_state_t *state, int sockfd, netem_flow_t *flow) {
+    static uint8_t buffers[NETEM_BATCH][NETEM_MAX_DATAGRAM];
+    static struct sockaddr_storage addrs[NETEM_BATCH];
+    struct mmsghdr msgs[NETEM_BATCH];
+    struct iovec iovecs[NETEM_BATCH];
+
+    for (;;) {
+        memset(msgs, 0, sizeof(msgs));
+
+        int i;
+        for (i = 0; i < NETEM_BATCH; i++) {
+            iovecs[i].iov_base = buffers[i];
+            iovecs[i].iov_len = NETEM_MAX_DATAGRAM;
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = flow == NULL ? &addrs[i] : NULL;
+            msgs[i].msg_hdr.msg_namelen = flow == NULL ? sizeof(struct sockaddr_storage) : 0;
+        }
+
+        int count = recvmmsg(sockfd, msgs, NETEM_BATCH, MSG_DONTWAIT, NULL);
+        if (count <= 0) {
+            return;
+        }
+
+        uint64_t now = now_ns();
+
+        for (i = 0; i < count; i++) {
+            if (flow != NULL) {
+                impair(state, flow, DOWN, buffers[i], msgs[i].msg_len, now);
+                continue;
+            }
+
+            netem_flow_t *source = get_flow(state, &addrs[i], msgs[i].msg_hdr.msg_namelen);
+            if (source == NULL) {
+                state->refused++;
+                continue;
+            }
+
+            impair(state, source, UP, buffers[i], msgs[i].msg_len, now);
+        }
+
+        if (count < NETEM_BATCH) {
+            return;
+        }
+    }
+}
+
+static void print_counters(char *name, netem_ctr_t *ctr) {
+    printf(
+        "%-8s%lu received, %lu sent, %lu lost, %lu reordered, %lu duplicated, %lu corrupted, %lu truncated, %lu overflow, %lu errors\n",
+        name, ctr->received, ctr->sent, ctr->lost, ctr->reordered, ctr->duplicated,
+        ctr->corrupted, ctr->truncated, ctr->overflow, ctr->errors
+    );
+}
+
+int main(int argc, char *argv[]) {
+    netem_opt_t opt;
+    if (parse_options(argc, argv, &opt)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+
+    netem_state_t state;
+    memset(&state, 0, sizeof(netem_state_t));
+    state.opt = &opt;
+    state.rng = opt.seed * 0x9E3779B97F4A7C15ULL + 1;
+    state.flows = calloc(opt.flows * 2, sizeof(netem_flow_t));
+    state.heap = calloc(opt.queue, sizeof(netem_pkt_t *));
+    state.free = calloc(opt.queue, sizeof(netem_pkt_t *));
+    netem_pkt_t *pool = calloc(opt.queue, sizeof(netem_pkt_t));
+
+    if (state.flows == NULL || state.heap == NULL || state.free == NULL || pool == NULL) {
+        LOGN("NETEM", "Failed to allocate\n");
+        return -1;
+    }
+
+    size_t i;
+    for (i = 0; i < opt.queue; i++) {
+        state.free[state.free_len++] = &pool[i];
+    }
+
+    state.listenfd = socket(opt.listen_info->ai_family, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+    if (state.listenfd == -1 || bind(state.listenfd, opt.listen_info->ai_addr, opt.listen_info->ai_addrlen)) {
+        LOGN("NETEM", "Failed to bind the listening socket\n");
+        perror("bind");
+        return -1;
+    }
+
+    state.epollfd = epoll_create1(0);
+    state.timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+
+    struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+    if (state.epollfd == -1 || state.timerfd == -1 ||
+        epoll_ctl(state.epollfd, EPOLL_CTL_ADD, state.listenfd, &event)) {
+        LOGN("NETEM", "Failed to create the event loop\n");
+        return -1;
+    }
+
+    /** The timer is told apart from the flows by its address */
+    event.data.ptr = &state;
+    if (epoll_ctl(state.epollfd, EPOLL_CTL_ADD, state.timerfd, &event)) {
+        LOGN("NETEM", "Failed to create the event loop\n");
+        return -1;
+    }
+
+    LOG(
+        "NETEM", "loss %.2f%%, delay %.3f ms +/- %.3f ms, reorder %.2f%% (+%.3f ms), duplicate %.2f%%, corrupt %.2f%%, truncate %.2f%%, seed %lu%s\n",
+        opt.loss * 100.0, opt.delay / 1.0e6, opt.jitter / 1.0e6, opt.reorder * 100.0, opt.gap / 1.0e6,
+        opt.duplicate * 100.0, opt.corrupt * 100.0, opt.truncate * 100.0, opt.seed, opt.both ? ", both ways" : ""
+    );
+
+    uint64_t start = now_ns();
+    struct epoll_event events[NETEM_MAX_EVENTS];
+
+    while (!stop && (opt.duration == 0 || now_ns() - start < opt.duration)) {
+        int count = epoll_wait(state.epollfd, events, NETEM_MAX_EVENTS, 100);
+
+        int j;
+        for (j = 0; j < count; j++) {
+            void *ptr = events[j].data.ptr;
+
+            if (ptr == &state) {
+                uint64_t expirations;
+                if (read(state.timerfd, &expirations, sizeof(uint64_t)) == -1) {
+                    /** Spurious wake up, the heap is checked anyway */
+                }
+
+                state.armed = 0;
+            } else if (ptr == NULL) {
+                receive(&state, state.listenfd, NULL);
+            } else {
+                netem_flow_t *flow = ptr;
+                receive(&state, flow->sockfd, flow);
+            }
+        }
+
+        release(&state);
+    }
+
+    print_counters("up:", &state.ctr[UP]);
+    print_counters("down:", &state.ctr[DOWN]);
+    printf("flows:  %zu (%lu datagrams refused)\n", state.flow_count, state.refused);
+
+    for (i = 0; i < opt.flows * 2; i++) {
+        if (state.flows[i].used) {
+            close(state.flows[i].sockfd);
+        }
+    }
+
+    close(state.timerfd);
+    close(state.epollfd);
+    close(state.listenfd);
+    free(pool);
+    free(state.free);
+    free(state.heap);
+    free(state.flows);
+    freeaddrinfo(opt.listen_info);
+    freeaddrinfo(opt.target_info);
+
+    return 0;
+}
@@ -0,0 +1,744 @@
+/**
+ * trtp-replay - replays a capture through the receiver pipeline.
+ *
+ * The UDP datagrams of a pcap or pcapng file are loaded in memory,
+ * then fed in batches (like `recvmmsg` would) to `rx_dispatch` and
+ * the resulting requests are processed by `hd_run_once` on the same
+ * thread, as fast as possible. The time spent in every stage is
+ * measured separately and reported in packets per second.
+ *
+ * No network is required: every flow (source address and port) of
+ * the capture is mapped to its own loopback address (127.0.0.0/8,
+ * IPv4-mapped) so the ACKs are sent to the loopback interface.
+ * This also makes it possible to replay the capture several times
+ * (-l), every loop using new clients.
+ */
+#define _GNU_SOURCE
+#include "../headers/receiver.h"
+#include "../headers/handler.h"
+
+/** pcap magic numbers (micro and nanosecond resolution) */
+#define PCAP_MAGIC_US 0xA1B2C3D4
+#define PCAP_MAGIC_NS 0xA1B23C4D
+
+/** pcapng block types */
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_OPB 0x00000002
+#define PCAPNG_SPB 0x00000003
+#define PCAPNG_EPB 0x00000006
+
+/** pcapng byte order magic */
+#define PCAPNG_BOM 0x1A2B3C4D
+
+/** Maximum number of interfaces in a pcapng section */
+#define PCAPNG_MAX_IF 64
+
+/** Link types */
+#define LINK_NULL       0
+#define LINK_ETHERNET   1
+#define LINK_RAW_OLD    12
+#define LINK_RAW        101
+#define LINK_LOOP       108
+#define LINK_LINUX_SLL  113
+#define LINK_IPV4       228
+#define LINK_IPV6       229
+#define LINK_LINUX_SLL2 276
+
+typedef struct replay_options {
+    /** Path of the capture */
+    char *path;
+
+    /** Only the datagrams sent to this port are replayed, 0 = all */
+    uint16_t port;
+
+    /** Output file format */
+    char *file_format;
+
+    /** Maximum number of clients */
+    size_t max_clients;
+
+    /** Batch size (like `-W`) */
+    size_t window_size;
+
+    /** Maximum window (like `-w`) */
+    int max_window_size;
+
+    /** Number of times the capture is replayed */
+    size_t loops;
+
+    /** true = writes the counters at the end */
+    bool verbose;
+} replay_opt_t;
+
+/**
+ * A UDP datagram of the capture, points into the file.
+ */
+typedef struct replay_dgram {
+    /** The flow of the datagram */
+    uint32_t flow;
+
+    /** Length of the UDP payload */
+    uint16_t length;
+
+    /** The UDP payload */
+    uint8_t *data;
+} replay_dgram_t;
+
+/**
+ * A flow: a source address and port.
+ */
+typedef struct replay_flow {
+    bool used;
+    uint16_t port;
+    uint8_t ip[16];
+    uint32_t index;
+} replay_flow_t;
+
+typedef struct replay_capture {
+    /** Content of the file */
+    uint8_t *file;
+    size_t file_len;
+
+    /** The datagrams */
+    replay_dgram_t *dgrams;
+    size_t count;
+    size_t capacity;
+
+    /** The flows (open addressing) */
+    replay_flow_t *flows;
+    size_t flow_count;
+    size_t flow_capacity;
+
+    /** Number of packets in the file (including the ignored ones) */
+    size_t packets;
+
+    /** Port filter */
+    uint16_t port;
+} replay_cap_t;
+
+static inline uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+static inline uint16_t rd16(uint8_t *p, bool swap) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return swap ? __builtin_bswap16(v) : v;
+}
+
+static inline uint32_t rd32(uint8_t *p, bool swap) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swap ? __builtin_bswap32(v) : v;
+}
+
+static inline uint16_t rd16be(uint8_t *p) {
+    return ((uint16_t) p[0] << 8) | p[1];
+}
+
+void print_usage(char *exec) {
+    fprintf(stderr, "Replays a pcap/pcapng capture through the TRTP receiver\n\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "  %s [options] <capture>\n\n", exec);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -p  Destination port filter     [default: any]\n");
+    fprintf(stderr, "  -o  Output file format          [default: /dev/null]\n");
+    fprintf(stderr, "  -m  Max. number of connection   [default: 100]\n");
+    fprintf(stderr, "  -W  Maximum receive buffer      [default: %d]\n", MAX_WINDOW_SIZE);
+    fprintf(stderr, "  -w  Maximum window size         [default: %d]\n", MAX_WINDOW_SIZE);
+    fprintf(stderr, "  -l  Number of loops             [default: 1]\n");
+    fprintf(stderr, "  -v  Writes the counters at the end\n\n");
+    fprintf(stderr, "Every loop replays the capture with new clients, remember\n");
+    fprintf(stderr, "to raise -m accordingly (flows * loops).\n");
+}
+
+int parse_options(int argc, char *argv[], replay_opt_t *opt) {
+    memset(opt, 0, sizeof(replay_opt_t));
+    opt->file_format = "/dev/null";
+    opt->max_clients = 100;
+    opt->window_size = MAX_WINDOW_SIZE;
+    opt->max_window_size = MAX_WINDOW_SIZE;
+    opt->loops = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, ":p:o:m:W:w:l:v")) != -1) {
+        switch (c) {
+            case 'p': opt->port = strtoul(optarg, NULL, 10); break;
+            case 'o': opt->file_format = optarg; break;
+            case 'm': opt->max_clients = strtoul(optarg, NULL, 10); break;
+            case 'W': opt->window_size = strtoul(optarg, NULL, 10); break;
+            case 'w': opt->max_window_size = strtol(optarg, NULL, 10); break;
+            case 'l': opt->loops = strtoul(optarg, NULL, 10); break;
+            case 'v': opt->verbose = true; break;
+            default: return -1;
+        }
+    }
+
+    if (argc - optind != 1 || opt->window_size == 0 || opt->max_window_size <= 0 ||
+        opt->max_window_size > MAX_WINDOW_SIZE || opt->loops == 0) {
+        return -1;
+    }
+
+    opt->path = argv[optind];
+
+    return 0;
+}
+
+/**
+ * FNV-1a of a source address and port.
+ */
+static inline size_t flow_hash(uint8_t *ip, uint16_t port) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    size_t i;
+    for (i = 0; i < 16; i++) {
+        hash = (hash ^ ip[i]) * 0x100000001B3ULL;
+    }
+
+    hash = (hash ^ (port & 0xFF)) * 0x100000001B3ULL;
+    hash = (hash ^ (port >> 8)) * 0x100000001B3ULL;
+
+    return hash;
+}
+
+/**
+ * Returns the index of a flow, creating it if needed (-1 if it failed).
+ */
+static int64_t get_flow(replay_cap_t *cap, uint8_t *ip, uint16_t port) {
+    if (cap->flow_count * 2 >= cap->flow_capacity) {
+        size_t capacity = cap->flow_capacity == 0 ? 1024 : cap->flow_capacity * 2;
+        replay_flow_t *flows = calloc(capacity, sizeof(replay_flow_t));
+        if (flows == NULL) {
+            return -1;
+        }
+
+        size_t i;
+        for (i = 0; i < cap->flow_capacity; i++) {
+            if (cap->flows[i].used) {
+                size_t j = flow_hash(cap->flows[i].ip, cap->flows[i].port) & (capacity - 1);
+                while (flows[j].used) {
+                    j = (j + 1) & (capacity - 1);
+                }
+
+                flows[j] = cap->flows[i];
+            }
+        }
+
+        free(cap->flows);
+        cap->flows = flows;
+        cap->flow_capacity = capacity;
+    }
+
+    size_t j = flow_hash(ip, port) & (cap->flow_capacity - 1);
+    while (cap->flows[j].used) {
+        if (cap->flows[j].port == port && ip_equals(cap->flows[j].ip, ip)) {
+            return cap->flows[j].index;
+        }
+
+        j = (j + 1) & (cap->flow_capacity - 1);
+    }
+
+    cap->flows[j].used = true;
+    cap->flows[j].port = port;
+    cap->flows[j].index = cap->flow_count++;
+    memcpy(cap->flows[j].ip, ip, 16);
+
+    return cap->flows[j].index;
+}
+
+/**
+ * Extracts the UDP payload of an IP packet and appends it.
+ */
+static int add_ip_packet(replay_cap_t *cap, uint8_t *pkt, size_t len) {
+    cap->packets++;
+
+    if (len < 1) {
+        return 0;
+    }
+
+    uint8_t ip[16];
+    memset(ip, 0, 16);
+
+    uint8_t *udp;
+    size_t remaining;
+
+    if ((pkt[0] >> 4) == 4) {
+        size_t ihl = (pkt[0] & 0x0F) * 4;
+        if (len < 20 || ihl < 20 || len < ihl || pkt[9] != IPPROTO_UDP) {
+            return 0;
+        }
+
+        /** Fragments are ignored */
+        if (rd16be(pkt + 6) & 0x3FFF) {
+            return 0;
+        }
+
+        /** IPv4-mapped address */
+        ip[10] = 0xFF;
+        ip[11] = 0xFF;
+        memcpy(ip + 12, pkt + 12, 4);
+
+        udp = pkt + ihl;
+        remaining = len - ihl;
+    } else if ((pkt[0] >> 4) == 6) {
+        if (len < 40) {
+            return 0;
+        }
+
+        memcpy(ip, pkt + 8, 16);
+
+        uint8_t next = pkt[6];
+        size_t offset = 40;
+
+        /** Hop-by-hop, routing and destination options */
+        while (next == 0 || next == 43 || next == 60) {
+            if (len < offset + 8) {
+                return 0;
+            }
+
+            next = pkt[offset];
+            offset += (pkt[offset + 1] + 1) * 8;
+        }
+
+        if (next != IPPROTO_UDP || len < offset) {
+            return 0;
+        }
+
+        udp = pkt + offset;
+        remaining = len - offset;
+    } else {
+        return 0;
+    }
+
+    if (remaining < 8) {
+        return 0;
+    }
+
+    uint16_t src_port = rd16be(udp);
+    uint16_t dst_port = rd16be(udp + 2);
+    size_t length = rd16be(udp + 4);
+
+    if (cap->port != 0 && dst_port != cap->port) {
+        return 0;
+    }
+
+    if (length < 8) {
+        return 0;
+    }
+
+    /** The payload may have been cut by the snap length */
+    length = MIN(length - 8, remaining - 8);
+
+    int64_t flow = get_flow(cap, ip, src_port);
+    if (flow == -1) {
+        return -1;
+    }
+
+    if (cap->count == cap->capacity) {
+        size_t capacity = cap->capacity == 0 ? 4096 : cap->capacity * 2;
+        replay_dgram_t *dgrams = realloc(cap->dgrams, capacity * sizeof(replay_dgram_t));
+        if (dgrams == NULL) {
+            return -1;
+        }
+
+        cap->dgrams = dgrams;
+        cap->capacity = capacity;
+    }
+
+    replay_dgram_t *dgram = &cap->dgrams[cap->count++];
+    dgram->flow = flow;
+    dgram->length = MIN(length, (size_t) UINT16_MAX);
+    dgram->data = udp + 8;
+
+    return 0;
+}
+
+/**
+ * Strips the link layer header of a frame.
+ */
+static int add_frame(replay_cap_t *cap, uint32_t linktype, uint8_t *frame, size_t len) {
+    size_t offset;
+    uint16_t protocol;
+
+    switch (linktype) {
+        case LINK_NULL:
+        case LINK_LOOP:
+            offset = 4;
+            break;
+        case LINK_RAW_OLD:
+        case LINK_RAW:
+        case LINK_IPV4:
+        case LINK_IPV6:
+            offset = 0;
+            break;
+        case LINK_ETHERNET:
+            if (len < 14) {
+                cap->packets++;
+                return 0;
+            }
+
+            offset = 14;
+            protocol = rd16be(frame + 12);
+
+            /** VLAN tags */
+            while ((protocol == 0x8100 || protocol == 0x88A8) && len >= offset + 4) {
+                protocol = rd16be(frame + offset + 2);
+                offset += 4;
+            }
+
+            if (protocol != 0x0800 && protocol != 0x86DD) {
+                cap->packets++;
+                return 0;
+            }
+            break;
+        case LINK_LINUX_SLL:
+            offset = 16;
+            break;
+        case LINK_LINUX_SLL2:
+            offset = 20;
+            break;
+        default:
+            cap->packets++;
+            return 0;
+    }
+
+    if (len < offset) {
+        cap->packets++;
+        return 0;
+    }
+
+    return add_ip_packet(cap, frame + offset, len - offset);
+}
+
+static int parse_pcap(replay_cap_t *cap) {
+    uint8_t *file = cap->file;
+    size_t len = cap->file_len;
+
+    uint32_t magic;
+    memcpy(&magic, file, 4);
+    bool swap = magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS);
+
+    if (len < 24) {
+        return -1;
+    }
+
+    uint32_t linktype = rd32(file + 20, swap) & 0x0FFFFFFF;
+    size_t offset = 24;
+
+    while (offset + 16 <= len) {
+        size_t caplen = rd32(file + offset + 8, swap);
+        offset += 16;
+
+        if (offset + caplen > len) {
+            break;
+        }
+
+        if (add_frame(cap, linktype, file + offset, caplen)) {
+            return -1;
+        }
+
+        offset += caplen;
+    }
+
+    return 0;
+}
+
+static int parse_pcapng(replay_cap_t *cap) {
+    uint8_t *file = cap->file;
+    size_t len = cap->file_len;
+    size_t offset = 0;
+
+    uint32_t linktypes[PCAPNG_MAX_IF];
+    size_t if_count = 0;
+    bool swap = false;
+
+    while (offset + 12 <= len) {
+        uint8_t *block = file + offset;
+
+        uint32_t type = rd32(block, swap);
+        if (type == PCAPNG_SHB) {
+            uint32_t bom;
+            memcpy(&bom, block + 8, 4);
+            swap = bom == __builtin_bswap32(PCAPNG_BOM);
+            if_count = 0;
+        }
+
+        size_t block_len = rd32(block + 4, swap);
+        if (block_len < 12 || offset + block_len > len) {
+            break;
+        }
+
+        uint8_t *data = NULL;
+        size_t caplen = 0;
+        uint32_t interface = 0;
+
+        switch (type) {
+            case PCAPNG_IDB:
+                if (if_count < PCAPNG_MAX_IF && block_len >= 20) {
+                    linktypes[if_count++] = rd16(block + 8, swap);
+                }
+                break;
+            case PCAPNG_EPB:
+            case PCAPNG_OPB:
+                if (block_len >= 32) {
+                    interface = type == PCAPNG_EPB ? rd32(block + 8, swap) : rd16(block + 8, swap);
+                    caplen = rd32(block + 20, swap);
+                    data = block + 28;
+
+                    caplen = MIN(caplen, block_len - 32);
+                }
+                break;
+            case PCAPNG_SPB:
+                if (block_len >= 16) {
+                    caplen = MIN(rd32(block + 8, swap), block_len - 16);
+                    data = block + 12;
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (data != NULL && interface < if_count) {
+            if (add_frame(cap, linktypes[interface], data, caplen)) {
+                return -1;
+            }
+        }
+
+        offset += block_len;
+    }
+
+    return 0;
+}
+
+/**
+ * Reads a capture and extracts its UDP datagrams.
+ */
+int load_capture(replay_cap_t *cap, char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size < 4) {
+        fclose(file);
+        return -1;
+    }
+
+    cap->file_len = size;
+    cap->file = malloc(size);
+    if (cap->file == NULL || fread(cap->file, 1, size, file) != (size_t) size) {
+        fclose(file);
+        return -1;
+    }
+
+    fclose(file);
+
+    uint32_t magic;
+    memcpy(&magic, cap->file, 4);
+
+    if (magic == PCAPNG_SHB) {
+        return parse_pcapng(cap);
+    }
+
+    if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+        magic == __builtin_bswap32(PCAP_MAGIC_US) || magic == __builtin_bswap32(PCAP_MAGIC_NS)) {
+        return parse_pcap(cap);
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+/**
+ * Loopback address of a flow: ::ffff:127.x.y.z
+ */
+static void flow_address(struct sockaddr_in6 *addr, replay_cap_t *cap, uint32_t flow, size_t loop) {
+    uint32_t n = loop * cap->flow_count + flow + 1;
+
+    memset(addr, 0, sizeof(struct sockaddr_in6));
+    addr->sin6_family = AF_INET6;
+    addr->sin6_port = htons(1024 + n % 64512);
+    addr->sin6_addr.__in6_u.__u6_addr8[10] = 0xFF;
+    addr->sin6_addr.__in6_u.__u6_addr8[11] = 0xFF;
+    addr->sin6_addr.__in6_u.__u6_addr8[12] = 127;
+    addr->sin6_addr.__in6_u.__u6_addr8[13] = (n >> 16) & 0xFF;
+    addr->sin6_addr.__in6_u.__u6_addr8[14] = (n >> 8) & 0xFF;
+    addr->sin6_addr.__in6_u.__u6_addr8[15] = n & 0xFF;
+}
+
+static void print_stage(char *name, uint64_t packets, uint64_t ns) {
+    double seconds = ns * 1.0e-9;
+
+    printf(
+        "%-8s %12.3f ms %14.0f pps %10.1f ns/pkt\n",
+        name, seconds * 1000.0,
+        seconds > 0 ? packets / seconds : 0.0,
+        packets > 0 ? (double) ns / packets : 0.0
+    );
+}
+
+int main(int argc, char *argv[]) {
+    replay_opt_t opt;
+    if (parse_options(argc, argv, &opt)) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    replay_cap_t cap;
+    memset(&cap, 0, sizeof(replay_cap_t));
+    cap.port = opt.port;
+
+    uint64_t start = now_ns();
+    if (load_capture(&cap, opt.path)) {
+        LOG("REPLAY", "Failed to read the capture %s\n", opt.path);
+        perror("load_capture");
+        return -1;
+    }
+    uint64_t parse_ns = now_ns() - start;
+
+    LOG(
+        "REPLAY", "%zu datagrams in %zu flows (out of %zu packets)\n",
+        cap.count, cap.flow_count, cap.packets
+    );
+
+    // -------------------------------------------------------------------------
+    // Pipeline (same as the sequential mode)
+    // -------------------------------------------------------------------------
+
+    stats_reg_t stats_registry;
+    stream_t rx_to_hd, hd_to_rx;
+    ht_t clients;
+    reg_t registry;
+
+    int sockfd = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (sockfd == -1 || allocate_stats_registry(&stats_registry, 1, 1, 0) ||
+        create_registry(&registry, opt.max_clients) ||
+        initialize_stream(&rx_to_hd) || initialize_stream(&hd_to_rx) || allocate_ht(&clients)) {
+        LOGN("REPLAY", "Failed to initialize the pipeline\n");
+        return -1;
+    }
+
+    socklen_t addr_len = sizeof(struct sockaddr_in6);
+
+    rx_cfg_t rx_cfg;
+    memset(&rx_cfg, 0, sizeof(rx_cfg_t));
+    rx_cfg.registry = &registry;
+    rx_cfg.worker = 0;
+    rx_cfg.file_format = opt.file_format;
+    rx_cfg.tx = &rx_to_hd;
+    rx_cfg.rx = &hd_to_rx;
+    rx_cfg.clients = &clients;
+    rx_cfg.sockfd = -1;
+    rx_cfg.addr_len = &addr_len;
+    rx_cfg.max_clients = opt.max_clients;
+    rx_cfg.window_size = opt.window_size;
+    rx_cfg.stats = &stats_registry.rx[0];
+
+    hd_cfg_t hd_cfg;
+    memset(&hd_cfg, 0, sizeof(hd_cfg_t));
+    hd_cfg.rx = &rx_to_hd;
+    hd_cfg.tx = &hd_to_rx;
+    hd_cfg.clients = &clients;
+    hd_cfg.max_window_size = opt.max_window_size;
+    hd_cfg.sockfd = sockfd;
+    hd_cfg.stats = &stats_registry.hd[0];
+
+    size_t window_size = opt.window_size;
+    uint8_t (*buffers)[MAX_PACKET_SIZE] = malloc(window_size * MAX_PACKET_SIZE);
+    struct sockaddr_in6 *addrs = calloc(window_size, sizeof(struct sockaddr_in6));
+    struct mmsghdr *msgs = calloc(window_size, sizeof(struct mmsghdr));
+    if (buffers == NULL || addrs == NULL || msgs == NULL) {
+        LOGN("REPLAY", "Failed to allocate\n");
+        return -1;
+    }
+
+    ack_batch_t acks;
+    ack_batch_init(&acks, sockfd, hd_cfg.stats, NULL);
+
+    uint8_t file_buffer[MAX_PAYLOAD_SIZE * MAX_WINDOW_SIZE];
+
+    // -------------------------------------------------------------------------
+    // Replay
+    // -------------------------------------------------------------------------
+
+    uint64_t load_ns = 0, rx_ns = 0, hd_ns = 0;
+    uint64_t total = 0;
+    bool exit = false;
+
+    size_t loop;
+    for (loop = 0; loop < opt.loops; loop++) {
+        size_t next = 0;
+        while (next < cap.count) {
+            uint64_t t0 = now_ns();
+
+            /** What recvmmsg would have done */
+            int count = 0;
+            while (next < cap.count && (size_t) count < window_size) {
+                replay_dgram_t *dgram = &cap.dgrams[next++];
+                size_t length = MIN(dgram->length, (uint16_t) MAX_PACKET_SIZE);
+
+                memcpy(buffers[count], dgram->data, length);
+                flow_address(&addrs[count], &cap, dgram->flow, loop);
+
+                msgs[count].msg_len = length;
+                msgs[count].msg_hdr.msg_flags = dgram->length > MAX_PACKET_SIZE ? MSG_TRUNC : 0;
+                msgs[count].msg_hdr.msg_control = NULL;
+                count++;
+            }
+
+            uint64_t t1 = now_ns();
+            rx_dispatch(&rx_cfg, buffers, addr_len, addrs, msgs, count);
+
+            uint64_t t2 = now_ns();
+            while (rx_to_hd.length != 0) {
+                hd_run_once(false, &hd_cfg, &exit, file_buffer, &acks);
+            }
+
+            uint64_t t3 = now_ns();
+
+            load_ns += t1 - t0;
+            rx_ns += t2 - t1;
+            hd_ns += t3 - t2;
+            total += count;
+        }
+    }
+
+    printf("%-8s %15s %18s %17s\n", "stage", "time", "rate", "cost");
+    print_stage("parse", cap.count, parse_ns);
+    print_stage("load", total, load_ns);
+    print_stage("rx", total, rx_ns);
+    print_stage("hd", total, hd_ns);
+    print_stage("rx+hd", total, rx_ns + hd_ns);
+
+    if (opt.verbose) {
+        stats_write_text(&stats_registry, stdout);
+    }
+
+    // -------------------------------------------------------------------------
+    // Cleanup
+    // -------------------------------------------------------------------------
+
+    free(buffers);
+    free(addrs);
+    free(msgs);
+    dealloc_ht(&clients);
+    dealloc_stream(&rx_to_hd);
+    dealloc_stream(&hd_to_rx);
+    dealloc_stats_registry(&stats_registry);
+    close_registry(&registry);
+    close(sockfd);
+
+    free(cap.dgrams);
+    free(cap.flows);
+    free(cap.file);
+
+    return 0;
+}
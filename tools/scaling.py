@@ -0,0 +1,441 @@
+#!/usr/bin/env python3
+"""
+Scaling matrix of the receiver.
+
+Starts the receiver on the loopback interface for every combination of
+receivers (-N), handlers (-n), receive buffer (-W), stream layout,
+affinity layout and number of clients, drives it with trtp-bench-sender
+and collects the throughput, the drops and the CPU time of every thread.
+
+The results are written to a CSV file (one line per run) and plotted
+as SVG bar charts (no dependency required).
+
+Example:
+    make release trtp-bench-sender
+    python3 tools/scaling.py -N 1,2 -n 1,2,4 -W 31,62 --clients 10,100
+
+The stream layouts are:
+    shared  - a single stream for every thread (no streams.cfg)
+    split   - one stream per receiver, the handlers are spread over them
+
+The affinity layouts are:
+    none    - no affinity.cfg
+    compact - the receivers then the handlers on consecutive CPUs
+    spread  - the threads spaced as far apart as possible
+
+With --netem, the sender goes through trtp-netem (listening on the
+port after the receiver's) to measure the receiver under impairment.
+"""
+
+import argparse
+import csv
+import itertools
+import os
+import re
+import shutil
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+CSV_FIELDS = [
+    'receivers', 'handlers', 'window', 'streams', 'affinity', 'clients', 'repeat',
+    'completed', 'elapsed_s', 'goodput_mbps', 'sent_pps', 'retransmitted',
+    'rx_packets', 'rx_batches', 'hd_acks', 'udp_rcvbuf_errors', 'udp_in_errors',
+    'cpu_rx_pct', 'cpu_hd_pct', 'cpu_total_pct', 'cpu_threads',
+]
+
+
+def int_list(value):
+    return [int(v) for v in value.split(',') if v]
+
+
+def str_list(value):
+    return [v for v in value.split(',') if v]
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Scaling matrix of the TRTP receiver',
+        formatter_class=argparse.RawDescriptionHelpFormatter,
+        epilog=__doc__,
+    )
+    parser.add_argument('-N', dest='receivers', type=int_list, default=[1], help='receiver counts (default: 1)')
+    parser.add_argument('-n', dest='handlers', type=int_list, default=[1, 2], help='handler counts (default: 1,2)')
+    parser.add_argument('-W', dest='windows', type=int_list, default=[31], help='receive buffers (default: 31)')
+    parser.add_argument('--streams', type=str_list, default=['shared'], help='stream layouts: shared,split')
+    parser.add_argument('--affinity', type=str_list, default=['none'], help='affinity layouts: none,compact,spread')
+    parser.add_argument('--clients', type=int_list, default=[10], help='client counts (default: 10)')
+    parser.add_argument('--bytes', type=int, default=1 << 20, help='bytes per client (default: 1 MiB)')
+    parser.add_argument('--sender-threads', type=int, default=1, help='threads of the sender (default: 1)')
+    parser.add_argument('--sender-args', default='', help='extra arguments of the sender (e.g "-l 1 -G")')
+    parser.add_argument('--netem', default=None, help='relays through trtp-netem with these arguments (e.g "-l 1 -d 5 -j 2")')
+    parser.add_argument('--repeat', type=int, default=1, help='runs per configuration (default: 1)')
+    parser.add_argument('--timeout', type=int, default=60, help='maximum duration of a run in s (default: 60)')
+    parser.add_argument('--port', type=int, default=64536, help='port of the receiver (default: 64536)')
+    parser.add_argument('--receiver', default=os.path.join(ROOT, 'receiver'), help='receiver binary')
+    parser.add_argument('--sender', default=os.path.join(ROOT, 'trtp-bench-sender'), help='sender binary')
+    parser.add_argument('--netem-binary', default=os.path.join(ROOT, 'trtp-netem'), help='relay binary')
+    parser.add_argument('--out', default=os.path.join(ROOT, 'bin', 'scaling.csv'), help='CSV output')
+    parser.add_argument('--plot', default=None, help='prefix of the SVG plots (default: next to the CSV)')
+    return parser.parse_args()
+
+
+def cpu_layout(layout, count):
+    """Returns the CPU of every thread (receivers first) or None."""
+    cpus = os.cpu_count() or 1
+    if layout == 'none':
+        return None
+    if layout == 'compact':
+        return [i % cpus for i in range(count)]
+    if layout == 'spread':
+        step = max(1, cpus // count)
+        return [(i * step) % cpus for i in range(count)]
+    raise ValueError('unknown affinity layout: %s' % layout)
+
+
+def write_configs(directory, receivers, handlers, streams, affinity):
+    """Writes streams.cfg and affinity.cfg, returns False if the layout is impossible."""
+    if streams == 'split':
+        if handlers < receivers:
+            return False
+
+        lines = []
+        for r in range(receivers):
+            owned = [h for h in range(handlers) if h % receivers == r]
+            lines.append('%d:%s' % (r, ','.join(str(h) for h in owned)))
+
+        with open(os.path.join(directory, 'streams.cfg'), 'w') as f:
+            f.write('\n'.join(lines) + '\n')
+    elif streams != 'shared':
+        raise ValueError('unknown stream layout: %s' % streams)
+
+    cpus = cpu_layout(affinity, receivers + handlers)
+    if cpus is not None:
+        with open(os.path.join(directory, 'affinity.cfg'), 'w') as f:
+            f.write(','.join(str(c) for c in cpus[:receivers]) + '\n')
+            f.write(','.join(str(c) for c in cpus[receivers:]) + '\n')
+
+    return True
+
+
+def udp_counters():
+    """Reads the UDP and UDPv6 error counters of the host."""
+    counters = {'rcvbuf': 0, 'in': 0}
+
+    try:
+        with open('/proc/net/snmp') as f:
+            lines = [l.split() for l in f if l.startswith('Udp:')]
+        if len(lines) == 2:
+            values = dict(zip(lines[0][1:], lines[1][1:]))
+            counters['rcvbuf'] += int(values.get('RcvbufErrors', 0))
+            counters['in'] += int(values.get('InErrors', 0))
+    except OSError:
+        pass
+
+    try:
+        with open('/proc/net/snmp6') as f:
+            for line in f:
+                name, value = line.split()
+                if name == 'Udp6RcvbufErrors':
+                    counters['rcvbuf'] += int(value)
+                elif name == 'Udp6InErrors':
+                    counters['in'] += int(value)
+    except OSError:
+        pass
+
+    return counters
+
+
+def thread_times(pid):
+    """CPU time (in ns) of every thread of a process, by name."""
+    times = {}
+    task_dir = '/proc/%d/task' % pid
+    tick = 1e9 / os.sysconf('SC_CLK_TCK')
+
+    try:
+        tids = os.listdir(task_dir)
+    except OSError:
+        return times
+
+    for tid in tids:
+        try:
+            with open(os.path.join(task_dir, tid, 'comm')) as f:
+                name = f.read().strip()
+
+            # schedstat has a ns resolution, stat only counts clock ticks
+            try:
+                with open(os.path.join(task_dir, tid, 'schedstat')) as f:
+                    value = int(f.read().split()[0])
+            except (OSError, IndexError):
+                with open(os.path.join(task_dir, tid, 'stat')) as f:
+                    fields = f.read().rsplit(')', 1)[1].split()
+                # utime and stime are the 14th and 15th fields of the file
+                value = int((int(fields[11]) + int(fields[12])) * tick)
+        except OSError:
+            continue
+
+        times[name] = times.get(name, 0) + value
+
+    return times
+
+
+def read_stats(path):
+    """Reads a snapshot from the statistics socket of the receiver."""
+    values = {}
+
+    try:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.settimeout(2)
+        sock.connect(path)
+
+        data = b''
+        while True:
+            chunk = sock.recv(65536)
+            if not chunk:
+                break
+            data += chunk
+        sock.close()
+    except OSError:
+        return values
+
+    for line in data.decode(errors='replace').splitlines():
+        parts = line.split()
+        if len(parts) == 2:
+            try:
+                values[parts[0]] = float(parts[1])
+            except ValueError:
+                pass
+
+    return values
+
+
+def parse_sender(output):
+    """Extracts the results from the report of trtp-bench-sender."""
+    result = {}
+    patterns = {
+        'completed': r'clients:\s+(\d+)/',
+        'elapsed_s': r'elapsed:\s+([\d.]+) s',
+        'sent_pps': r'sent:\s+\d+ datagrams \(([\d.]+) pps\)',
+        'retransmitted': r'retransmitted:\s+(\d+)',
+        'goodput_mbps': r'goodput:.*\(([\d.]+) Mbit/s\)',
+    }
+
+    for key, pattern in patterns.items():
+        match = re.search(pattern, output)
+        if match:
+            result[key] = float(match.group(1)) if '.' in match.group(1) else int(match.group(1))
+        else:
+            result[key] = ''
+
+    return result
+
+
+def wait_for_socket(path, process, timeout=5.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if os.path.exists(path) or process.poll() is not None:
+            return
+        time.sleep(0.05)
+
+
+def run_once(args, receivers, handlers, window, streams, affinity, clients, repeat, out_dir):
+    work = tempfile.mkdtemp(prefix='trtp-scaling-')
+
+    try:
+        if not write_configs(work, receivers, handlers, streams, affinity):
+            return None
+
+        stats_path = os.path.join(work, 'stats.sock')
+        receiver = subprocess.Popen(
+            [
+                args.receiver,
+                '-m', str(max(100, clients * 2)),
+                '-o', os.path.join(out_dir, 'out_%d'),
+                '-N', str(receivers),
+                '-n', str(handlers),
+                '-W', str(window),
+                '-S', stats_path,
+                '::1', str(args.port),
+            ],
+            cwd=work,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+
+        wait_for_socket(stats_path, receiver)
+
+        # The relay listens on the next port, the sender goes through it
+        port = args.port
+        netem = None
+        if args.netem is not None:
+            port = args.port + 1
+            netem = subprocess.Popen(
+                [args.netem_binary] + args.netem.split() + ['::1', str(port), '::1', str(args.port)],
+                stdout=subprocess.DEVNULL,
+                stderr=subprocess.DEVNULL,
+            )
+            time.sleep(0.2)
+
+        udp_before = udp_counters()
+        cpu_before = thread_times(receiver.pid)
+
+        sender = subprocess.run(
+            [
+                args.sender,
+                '-t', str(args.sender_threads),
+                '-c', str(clients),
+                '-b', str(args.bytes),
+                '-d', str(args.timeout),
+            ] + args.sender_args.split() + ['::1', str(port)],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            universal_newlines=True,
+        )
+
+        cpu_after = thread_times(receiver.pid)
+        udp_after = udp_counters()
+        stats = read_stats(stats_path)
+
+        if netem is not None:
+            netem.send_signal(signal.SIGINT)
+            netem.wait()
+
+        receiver.send_signal(signal.SIGINT)
+        try:
+            receiver.wait(timeout=10)
+        except subprocess.TimeoutExpired:
+            receiver.kill()
+            receiver.wait()
+
+        result = parse_sender(sender.stdout)
+        elapsed = result['elapsed_s'] or 1.0
+
+        cpu = {}
+        for name, value in cpu_after.items():
+            cpu[name] = 100.0 * (value - cpu_before.get(name, 0)) / 1e9 / elapsed
+
+        result.update({
+            'receivers': receivers,
+            'handlers': handlers,
+            'window': window,
+            'streams': streams,
+            'affinity': affinity,
+            'clients': clients,
+            'repeat': repeat,
+            'rx_packets': int(stats.get('total.rx_packets', 0)),
+            'rx_batches': int(stats.get('total.rx_batches', 0)),
+            'hd_acks': int(stats.get('total.hd_acks', 0)),
+            'udp_rcvbuf_errors': udp_after['rcvbuf'] - udp_before['rcvbuf'],
+            'udp_in_errors': udp_after['in'] - udp_before['in'],
+            'cpu_rx_pct': round(sum(v for k, v in cpu.items() if k.startswith('trtp-rx')), 1),
+            'cpu_hd_pct': round(sum(v for k, v in cpu.items() if k.startswith('trtp-hd')), 1),
+            'cpu_total_pct': round(sum(cpu.values()), 1),
+            'cpu_threads': ';'.join('%s:%.1f' % (k, v) for k, v in sorted(cpu.items())),
+        })
+
+        return result
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+        for name in os.listdir(out_dir):
+            if name.startswith('out_'):
+                os.remove(os.path.join(out_dir, name))
+
+
+def svg_bars(path, title, unit, labels, values):
+    """A horizontal bar chart, one bar per configuration."""
+    width, bar, label_width = 900, 18, 330
+    height = 60 + len(labels) * (bar + 6)
+    largest = max([v for v in values if isinstance(v, (int, float))] + [1e-9])
+
+    out = [
+        '<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" font-family="monospace" font-size="12">' % (width, height),
+        '<rect width="100%" height="100%" fill="white"/>',
+        '<text x="10" y="24" font-size="16">%s (%s)</text>' % (title, unit),
+    ]
+
+    for i, (label, value) in enumerate(zip(labels, values)):
+        y = 44 + i * (bar + 6)
+        value = value if isinstance(value, (int, float)) else 0
+        length = (width - label_width - 90) * value / largest
+        out.append('<text x="10" y="%d">%s</text>' % (y + 13, label))
+        out.append('<rect x="%d" y="%d" width="%.1f" height="%d" fill="#4878a8"/>' % (label_width, y, length, bar))
+        out.append('<text x="%.1f" y="%d">%.1f</text>' % (label_width + length + 6, y + 13, value))
+
+    out.append('</svg>')
+
+    with open(path, 'w') as f:
+        f.write('\n'.join(out) + '\n')
+
+
+def plot(prefix, rows):
+    labels = [
+        'N=%s n=%s W=%s %s/%s c=%s' % (r['receivers'], r['handlers'], r['window'], r['streams'], r['affinity'], r['clients'])
+        for r in rows
+    ]
+
+    svg_bars(prefix + '_goodput.svg', 'Goodput', 'Mbit/s', labels, [r['goodput_mbps'] for r in rows])
+    svg_bars(prefix + '_cpu.svg', 'CPU of the receiver', '% of a core', labels, [r['cpu_total_pct'] for r in rows])
+    svg_bars(prefix + '_drops.svg', 'Socket buffer drops', 'datagrams', labels, [r['udp_rcvbuf_errors'] for r in rows])
+
+
+def main():
+    args = parse_args()
+
+    binaries = [args.receiver, args.sender] + ([args.netem_binary] if args.netem is not None else [])
+    for binary in binaries:
+        if not os.access(binary, os.X_OK):
+            sys.exit('%s not found, run: make release trtp-bench-sender trtp-netem' % binary)
+
+    # The output files are written to memory when possible
+    base = '/dev/shm' if os.access('/dev/shm', os.W_OK) else tempfile.gettempdir()
+    out_dir = tempfile.mkdtemp(prefix='trtp-scaling-out-', dir=base)
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.out)), exist_ok=True)
+    prefix = args.plot or os.path.splitext(args.out)[0]
+
+    matrix = list(itertools.product(
+        args.receivers, args.handlers, args.windows, args.streams, args.affinity, args.clients, range(args.repeat)
+    ))
+
+    rows = []
+    try:
+        with open(args.out, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=CSV_FIELDS)
+            writer.writeheader()
+
+            for i, (receivers, handlers, window, streams, affinity, clients, repeat) in enumerate(matrix):
+                print(
+                    '[%d/%d] N=%d n=%d W=%d streams=%s affinity=%s clients=%d' %
+                    (i + 1, len(matrix), receivers, handlers, window, streams, affinity, clients),
+                    file=sys.stderr,
+                )
+
+                row = run_once(args, receivers, handlers, window, streams, affinity, clients, repeat, out_dir)
+                if row is None:
+                    print('    skipped (impossible layout)', file=sys.stderr)
+                    continue
+
+                print(
+                    '    %s Mbit/s, %s/%d completed, %d drops, %.1f%% CPU' %
+                    (row['goodput_mbps'], row['completed'], clients, row['udp_rcvbuf_errors'], row['cpu_total_pct']),
+                    file=sys.stderr,
+                )
+
+                writer.writerow(row)
+                f.flush()
+                rows.append(row)
+    finally:
+        shutil.rmtree(out_dir, ignore_errors=True)
+
+    if rows:
+        plot(prefix, rows)
+        print('Results: %s, plots: %s_*.svg' % (args.out, prefix), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,271 @@
+/**
+ * trtpstat - a top-like viewer for the statistics segment
+ * of a running receiver (see headers/shm.h and the -M option).
+ *
+ * It only maps the segment read-only: it never slows down
+ * nor blocks the receiver.
+ */
+#include "../headers/shm.h"
+
+/** Default refresh interval (in ms) */
+#define DEFAULT_INTERVAL 1000
+
+/** Default number of clients shown */
+#define DEFAULT_ROWS 20
+
+/** Counters summed in the `drops` column */
+static const stat_counter_t drop_counters[] = {
+    STAT_RX_TRUNCATED,
+    STAT_RX_UNDERSIZED,
+    STAT_RX_REFUSED,
+    STAT_RX_POOL_DROPS,
+    STAT_HD_CRC_HEADER,
+    STAT_HD_CRC_PAYLOAD,
+    STAT_HD_BAD_LENGTH,
+    STAT_HD_BAD_TYPE,
+    STAT_HD_BAD_OTHER
+};
+
+/** A client along with its rate over the last interval */
+typedef struct client_row {
+    shm_client_t record;
+    double current;
+} row_t;
+
+bool stop = false;
+
+void handle_stop() {
+    stop = true;
+}
+
+void print_usage(char *exec) {
+    fprintf(stderr, "Top-like viewer for the receiver statistics segment\n\n");
+    fprintf(stderr, "Usage:\n");
+    fprintf(stderr, "  %s [options] [name]\n\n", exec);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -i  Refresh interval in ms      [default: %d]\n", DEFAULT_INTERVAL);
+    fprintf(stderr, "  -c  Number of clients shown     [default: %d]\n", DEFAULT_ROWS);
+    fprintf(stderr, "  -1  Print a single snapshot and exit\n\n");
+    fprintf(stderr, "The name must match the -M option of the receiver [default: %s]\n", DEFAULT_SHM_NAME);
+}
+
+uint64_t now_ns() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000UL + time.tv_nsec;
+}
+
+/**
+ * Formats a number of bytes (or bytes per second) in `out`.
+ */
+void human(char *out, size_t len, double value) {
+    char *units[5] = { "B", "KiB", "MiB", "GiB", "TiB" };
+
+    int i = 0;
+    while (value >= 1024.0 && i < 4) {
+        value /= 1024.0;
+        i++;
+    }
+
+    snprintf(out, len, "%.1f %s", value, units[i]);
+}
+
+int compare_rows(const void *a, const void *b) {
+    const row_t *left = (const row_t *) a;
+    const row_t *right = (const row_t *) b;
+
+    if (left->current != right->current) {
+        return left->current < right->current ? 1 : -1;
+    }
+
+    return (int) left->record.id - (int) right->record.id;
+}
+
+int main(int argc, char *argv[]) {
+    char *name = DEFAULT_SHM_NAME;
+    size_t interval = DEFAULT_INTERVAL;
+    size_t rows = DEFAULT_ROWS;
+    bool once = false;
+
+    int c;
+    while ((c = getopt(argc, argv, ":i:c:1")) != -1) {
+        switch (c) {
+            case 'i':
+                interval = strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                rows = strtoul(optarg, NULL, 10);
+                break;
+            case '1':
+                once = true;
+                break;
+            default:
+                print_usage(argv[0]);
+                return -1;
+        }
+    }
+
+    if (optind < argc) {
+        name = argv[optind];
+    }
+
+    if (interval == 0) {
+        interval = DEFAULT_INTERVAL;
+    }
+
+    shm_seg_t segment;
+    if (open_shm(&segment, name)) {
+        LOG("STAT", "Failed to open the statistics segment %s (is the receiver running with -M?)\n", name);
+        return -1;
+    }
+
+    shm_header_t *header = segment.header;
+    size_t thread_count = header->thread_count;
+    size_t client_count = header->client_count;
+
+    shm_thread_t *threads = calloc(thread_count, sizeof(shm_thread_t));
+    shm_thread_t *previous_threads = calloc(thread_count, sizeof(shm_thread_t));
+    shm_client_t *previous_clients = calloc(client_count, sizeof(shm_client_t));
+    row_t *table = calloc(client_count, sizeof(row_t));
+
+    if ((thread_count && (threads == NULL || previous_threads == NULL)) ||
+        (client_count && (previous_clients == NULL || table == NULL))) {
+        LOGN("STAT", "Failed to allocate\n");
+        close_shm(&segment);
+        return -1;
+    }
+
+    signal(SIGINT, handle_stop);
+
+    uint64_t previous = 0;
+    size_t i, j;
+    while (!stop) {
+        uint64_t now = now_ns();
+        double elapsed = previous == 0 ? 0.0 : (now - previous) * 1.0e-9;
+
+        for (i = 0; i < thread_count; i++) {
+            shm_read_thread(&segment.threads[i], &threads[i]);
+        }
+
+        size_t used = 0;
+        for (i = 0; i < client_count; i++) {
+            shm_read_client(&segment.clients[i], &table[used].record);
+            shm_client_t *record = &table[used].record;
+
+            if (!record->used) {
+                previous_clients[i].used = false;
+                continue;
+            }
+
+            table[used].current = 0.0;
+            if (elapsed > 0.0 && previous_clients[i].used && previous_clients[i].id == record->id) {
+                table[used].current = (record->transferred - previous_clients[i].transferred) / elapsed;
+            }
+
+            previous_clients[i] = *record;
+            used++;
+        }
+
+        qsort(table, used, sizeof(row_t), compare_rows);
+
+        /** A single snapshot still needs two samples to compute the rates */
+        if (once && previous == 0) {
+            memcpy(previous_threads, threads, thread_count * sizeof(shm_thread_t));
+            previous = now;
+            usleep(interval * 1000);
+            continue;
+        }
+
+        if (!once) {
+            /** Clears the terminal */
+            printf("\033[H\033[2J");
+        }
+
+        bool alive = kill(header->pid, 0) == 0;
+        printf(
+            "trtpstat - %s - pid %u%s - up %.0fs - %zu/%zu clients\n\n",
+            name, header->pid, alive ? "" : " (exited)",
+            (now - header->start_ns) * 1.0e-9, used, client_count
+        );
+
+        printf("%-8s %12s %12s %12s %10s %10s %10s %12s\n",
+            "THREAD", "PACKETS/s", "RX/s", "WRITTEN/s", "ACKS/s", "NACKS/s", "DUPS", "DROPS");
+
+        for (i = 0; i < thread_count; i++) {
+            uint64_t *now_c = threads[i].counters;
+            uint64_t *old_c = previous_threads[i].counters;
+
+            double packets, bytes, written, acks, nacks;
+            if (threads[i].kind == SHM_RECEIVER) {
+                packets = elapsed > 0.0 ? (now_c[STAT_RX_PACKETS] - old_c[STAT_RX_PACKETS]) / elapsed : 0.0;
+            } else {
+                packets = elapsed > 0.0 ? (now_c[STAT_HD_PACKETS] - old_c[STAT_HD_PACKETS]) / elapsed : 0.0;
+            }
+
+            bytes = elapsed > 0.0 ? (now_c[STAT_RX_BYTES] - old_c[STAT_RX_BYTES]) / elapsed : 0.0;
+            written = elapsed > 0.0 ? (now_c[STAT_HD_BYTES_WRITTEN] - old_c[STAT_HD_BYTES_WRITTEN]) / elapsed : 0.0;
+            acks = elapsed > 0.0 ? (now_c[STAT_HD_ACKS] - old_c[STAT_HD_ACKS]) / elapsed : 0.0;
+            nacks = elapsed > 0.0 ? (now_c[STAT_HD_NACKS] - old_c[STAT_HD_NACKS]) / elapsed : 0.0;
+
+            uint64_t drops = 0;
+            for (j = 0; j < sizeof(drop_counters) / sizeof(stat_counter_t); j++) {
+                drops += now_c[drop_counters[j]];
+            }
+
+            char label[16], rx[16], wr[16];
+            snprintf(label, sizeof(label), "%s#%u", threads[i].kind == SHM_RECEIVER ? "rx" : "hd", threads[i].id);
+            human(rx, sizeof(rx), bytes);
+            human(wr, sizeof(wr), written);
+
+            printf("%-8s %12.0f %10s/s %10s/s %10.0f %10.0f %10lu %12lu\n",
+                label, packets, rx, wr, acks, nacks,
+                now_c[STAT_HD_DUPLICATES] + now_c[STAT_HD_OUT_OF_WINDOW], drops);
+        }
+
+        printf("\n%-6s %-40s %12s %7s %12s %12s %8s %8s\n",
+            "CLIENT", "ADDRESS", "TRANSFERRED", "WINDOW", "RATE", "AVG", "DUPS", "STALL");
+
+        for (i = 0; i < used && i < rows; i++) {
+            shm_client_t *record = &table[i].record;
+
+            char address[INET6_ADDRSTRLEN + 8], total[16], rate[16], avg[16], stall[16];
+            snprintf(address, sizeof(address), "[%s]:%u", record->ip_as_string, ntohs(record->port));
+            human(total, sizeof(total), record->transferred);
+            human(rate, sizeof(rate), table[i].current);
+            human(avg, sizeof(avg), record->rate);
+
+            if (!record->active) {
+                snprintf(stall, sizeof(stall), "done");
+            } else if (now > record->progress_ns) {
+                snprintf(stall, sizeof(stall), "%.1fs", (now - record->progress_ns) * 1.0e-9);
+            } else {
+                snprintf(stall, sizeof(stall), "0.0s");
+            }
+
+            printf("%-6u %-40s %12s %3u+%-3u %10s/s %10s/s %8lu %8s\n",
+                record->id, address, total,
+                record->window_low, record->window_length,
+                rate, avg, record->duplicates, stall);
+        }
+
+        fflush(stdout);
+
+        memcpy(previous_threads, threads, thread_count * sizeof(shm_thread_t));
+        previous = now;
+
+        if (once) {
+            break;
+        }
+
+        usleep(interval * 1000);
+    }
+
+    free(threads);
+    free(previous_threads);
+    free(previous_clients);
+    free(table);
+    close_shm(&segment);
+
+    return 0;
+}